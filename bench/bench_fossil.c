@@ -0,0 +1,212 @@
+/*
+==============================================================================
+Author: Michael Gene Brockus (Dreamer)
+Email: michaelbrockus@gmail.com
+Organization: Fossil Logic
+Description:
+    This file is part of the Fossil Logic project, where innovation meets
+    excellence in software development. Michael Gene Brockus, also known as
+    "Dreamer," is a dedicated contributor to this project. For any inquiries,
+    feel free to contact Michael at michaelbrockus@gmail.com.
+==============================================================================
+*/
+#include "fossil/xcore/fossil.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_KB ((size_t)1024)
+#define BENCH_MB (BENCH_KB * 1024)
+
+// Sizes of the generated programs
+static const size_t bench_sizes[] = {BENCH_KB, 10 * BENCH_KB, 100 * BENCH_KB, BENCH_MB, 10 * BENCH_MB, 100 * BENCH_MB};
+
+// Deepest nesting of the generated functions
+#define BENCH_MAX_DEPTH 8
+
+// Source bytes each measurement works through, small inputs are repeated
+#define BENCH_WORK ((size_t)8 * 1024 * 1024)
+
+// Seconds since an arbitrary point
+static double bench_now(void) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+// Write n levels of indentation
+static size_t bench_indent(FILE* file, int level) {
+    for (int i = 0; i < level; ++i) {
+        fputs("    ", file);
+    }
+    return (size_t)level * 4;
+}
+
+// Write a function with braces whose ifs nest depth levels deep
+static size_t bench_braced_function(FILE* file, size_t index, int depth) {
+    int written = fprintf(file, "fossil f%zu(a: int, b: int) -> int {\n    x = a * 2 + b - %zu;\n", index, index % 97);
+    size_t size = written > 0 ? (size_t)written : 0;
+
+    for (int level = 1; level <= depth; ++level) {
+        size += bench_indent(file, level);
+        written = fprintf(file, "if (x > %d && a != b) || b < %d {\n", level, -level);
+        size += written > 0 ? (size_t)written : 0;
+    }
+    size += bench_indent(file, depth + 1);
+    written = fprintf(file, "x = x - 1;\n");
+    size += written > 0 ? (size_t)written : 0;
+    for (int level = depth; level >= 1; --level) {
+        size += bench_indent(file, level);
+        fputs("}\n", file);
+        size += 2;
+    }
+
+    written = fprintf(file, "    while (x > 100) { x = x / 2; }\n"
+                            "    print(\"f%zu\", x, [a, b, %zu]);\n"
+                            "    return x;\n"
+                            "}\n\n",
+                      index, index);
+    return size + (written > 0 ? (size_t)written : 0);
+}
+
+// Write a function with indented bodies whose ifs nest depth levels deep
+static size_t bench_indented_function(FILE* file, size_t index, int depth) {
+    int written = fprintf(file, "# Generated function %zu\nfossil g%zu(a: int) -> int:\n    x = a + %zu\n", index, index, index % 89);
+    size_t size = written > 0 ? (size_t)written : 0;
+
+    for (int level = 1; level <= depth; ++level) {
+        size += bench_indent(file, level);
+        written = fprintf(file, "if x >= %d:\n", level);
+        size += written > 0 ? (size_t)written : 0;
+    }
+    size += bench_indent(file, depth + 1);
+    written = fprintf(file, "x = -x + \"s\"\n    return f%zu(x, a)\n\n", index > 0 ? index - 1 : 0);
+    return size + (written > 0 ? (size_t)written : 0);
+}
+
+// Write a class with a few fields and a method
+static size_t bench_class(FILE* file, size_t index) {
+    int written = fprintf(file, "fossil class C%zu {\n"
+                                "    public int count = %zu;\n"
+                                "    private string name;\n"
+                                "    public int next(step: int) -> int { count = count + step; return count; }\n"
+                                "}\n\n",
+                          index, index);
+    return written > 0 ? (size_t)written : 0;
+}
+
+// Write a program of at least size bytes, returning the bytes written
+static size_t bench_generate(const char* path, size_t size) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        return 0;
+    }
+
+    size_t written = 0;
+    for (size_t index = 0; written < size; ++index) {
+        int depth = (int)(index % BENCH_MAX_DEPTH) + 1;
+        if (index % 16 == 15) {
+            written += bench_class(file, index);
+        } else if (index % 2 == 0) {
+            written += bench_braced_function(file, index, depth);
+        } else {
+            written += bench_indented_function(file, index, depth);
+        }
+    }
+    written += (size_t)fprintf(file, "fossil main() -> int {\n    return f0(1, 2);\n}\n");
+
+    if (fclose(file) != 0) {
+        return 0;
+    }
+    return written;
+}
+
+// Megabytes per second for repeat passes over size bytes
+static double bench_rate(size_t size, size_t repeat, double seconds) {
+    return seconds > 0.0 ? (double)size * (double)repeat / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+// Measure one source file and print a row of the table
+static int bench_file(const char* path) {
+    char* code = fscl_fossil_read_dsl(path);
+    size_t size = strlen(code);
+    size_t repeat = size > 0 && size < BENCH_WORK ? BENCH_WORK / size : 1;
+
+    // Lexing alone, reusing the token array between passes
+    fossil_token_array tokens = {NULL, 0, 0};
+    double start = bench_now();
+    for (size_t i = 0; i < repeat; ++i) {
+        if (fscl_fossil_lex(code, size, &tokens) != 0) {
+            fprintf(stderr, "%s: lexing failed\n", path);
+            fscl_fossil_token_array_erase(&tokens);
+            free(code);
+            return -1;
+        }
+    }
+    double lex = bench_now() - start;
+    size_t num_tokens = tokens.count;
+    fscl_fossil_token_array_erase(&tokens);
+    free(code);
+
+    // Parsing from the file, then printing and erasing each tree
+    double parse = 0.0;
+    double print = 0.0;
+    double erase = 0.0;
+    size_t allocations = 0;
+    for (size_t i = 0; i < repeat; ++i) {
+        start = bench_now();
+        ASTNode* root = fscl_fossil_parse_dsl_file(path);
+        parse += bench_now() - start;
+        if (root == NULL) {
+            fprintf(stderr, "%s: parsing failed\n", path);
+            return -1;
+        }
+        allocations = root->arena != NULL ? root->arena->num_allocations : 0;
+
+        start = bench_now();
+        size_t length;
+        char* text = fscl_fossil_dump_ast(root, FOSSIL_DUMP_TEXT, &length);
+        print += bench_now() - start;
+        free(text);
+
+        start = bench_now();
+        fscl_fossil_erase_node(root);
+        erase += bench_now() - start;
+    }
+
+    double kilobytes = (double)size / 1024.0;
+    printf("%-28s %12zu %10zu %10.1f %10.1f %10.1f %10.1f %10.2f\n", path, size, num_tokens,
+           bench_rate(size, repeat, lex), bench_rate(size, repeat, parse), bench_rate(size, repeat, print),
+           bench_rate(size, repeat, erase), kilobytes > 0.0 ? (double)allocations / kilobytes : 0.0);
+    fflush(stdout);
+    return 0;
+}
+
+// Usage: xbench [largest size in bytes] [extra .fossil files...]
+int main(int argc, char** argv) {
+    size_t max_size = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : 100 * BENCH_MB;
+    int failures = 0;
+
+    printf("%-28s %12s %10s %10s %10s %10s %10s %10s\n", "source", "bytes", "tokens", "lex MB/s", "parse MB/s",
+           "print MB/s", "erase MB/s", "allocs/KB");
+
+    for (int i = 2; i < argc; ++i) {
+        failures += bench_file(argv[i]) != 0;
+    }
+
+    for (size_t i = 0; i < sizeof(bench_sizes) / sizeof(bench_sizes[0]) && bench_sizes[i] <= max_size; ++i) {
+        char path[64];
+        snprintf(path, sizeof(path), "bench_%zu.fossil", bench_sizes[i]);
+        if (bench_generate(path, bench_sizes[i]) == 0) {
+            fprintf(stderr, "%s: cannot write the program\n", path);
+            failures++;
+            break;
+        }
+        failures += bench_file(path) != 0;
+        remove(path);
+    }
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -80,6 +80,7 @@ extern "C"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <string.h>
 #include <ctype.h>
@@ -114,7 +115,13 @@ typedef enum {
     PUBLIC,   // New: Public member visibility
     PRIVATE,  // New: Private member visibility
     INHERITANCE,      // New: Inheritance
-    ENCAPSULATION     // New: Encapsulation
+    ENCAPSULATION,    // New: Encapsulation
+    BLOCK_STATEMENT,  // Statements of a body, in order
+    ASSIGNMENT,       // Value is the target, child is the assigned expression
+    RETURN_STATEMENT, // Optional child is the returned expression
+    BINARY_OP,        // Arithmetic operation, children are the operands
+    CALL_EXPRESSION,  // Value is the callee, children are the arguments
+    ARRAY_LITERAL     // Children are the elements
 } NodeType;
 
 // Enumeration for data types
@@ -159,14 +166,107 @@ typedef enum {
     LESS_THAN,
     GREATER_THAN,
     AND,
-    OR
+    OR,
+    MODULO,
+    NOT,
+    LESS_EQUAL,
+    GREATER_EQUAL
 } OperatorType;
 
+// Enumeration for token kinds produced by the lexer
+typedef enum {
+    FOSSIL_TOKEN_EOF,
+    FOSSIL_TOKEN_ERROR,       // Unexpected character or unterminated literal
+    FOSSIL_TOKEN_IDENTIFIER,
+    FOSSIL_TOKEN_INTEGER,
+    FOSSIL_TOKEN_FLOAT,
+    FOSSIL_TOKEN_STRING,
+    FOSSIL_TOKEN_CHAR,
+    FOSSIL_TOKEN_FUNCTION,    // FUNCTION_KEYWORD
+    FOSSIL_TOKEN_CLASS,
+    FOSSIL_TOKEN_EXTENDS,
+    FOSSIL_TOKEN_PUBLIC,
+    FOSSIL_TOKEN_PRIVATE,
+    FOSSIL_TOKEN_IF,
+    FOSSIL_TOKEN_ELSE,
+    FOSSIL_TOKEN_WHILE,
+    FOSSIL_TOKEN_RETURN,
+    FOSSIL_TOKEN_INCLUDE,
+    FOSSIL_TOKEN_LINK,
+    FOSSIL_TOKEN_TRUE,
+    FOSSIL_TOKEN_FALSE,
+    FOSSIL_TOKEN_NULL,
+    FOSSIL_TOKEN_LPAREN,
+    FOSSIL_TOKEN_RPAREN,
+    FOSSIL_TOKEN_LBRACE,      // OPEN_BRACE_KEYWORD
+    FOSSIL_TOKEN_RBRACE,      // CLOSE_BRACE_KEYWORD
+    FOSSIL_TOKEN_LBRACKET,
+    FOSSIL_TOKEN_RBRACKET,
+    FOSSIL_TOKEN_COMMA,
+    FOSSIL_TOKEN_SEMICOLON,
+    FOSSIL_TOKEN_COLON,
+    FOSSIL_TOKEN_DOT,
+    FOSSIL_TOKEN_ARROW,
+    FOSSIL_TOKEN_ASSIGN,
+    FOSSIL_TOKEN_PLUS,
+    FOSSIL_TOKEN_MINUS,
+    FOSSIL_TOKEN_STAR,
+    FOSSIL_TOKEN_SLASH,
+    FOSSIL_TOKEN_PERCENT,
+    FOSSIL_TOKEN_EQUAL,
+    FOSSIL_TOKEN_NOT_EQUAL,
+    FOSSIL_TOKEN_LESS,
+    FOSSIL_TOKEN_LESS_EQUAL,
+    FOSSIL_TOKEN_GREATER,
+    FOSSIL_TOKEN_GREATER_EQUAL,
+    FOSSIL_TOKEN_AND,
+    FOSSIL_TOKEN_OR,
+    FOSSIL_TOKEN_NOT,
+    FOSSIL_TOKEN_INCREMENT,
+    FOSSIL_TOKEN_DECREMENT
+} fossil_token_kind;
+
+// Structure for a token, a span of the source with its position
+typedef struct {
+    fossil_token_kind kind;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t line;    // 1-based
+    uint32_t column;  // 1-based
+} fossil_token;
+
+// Growable array of tokens, always terminated by FOSSIL_TOKEN_EOF
+typedef struct {
+    fossil_token* tokens;
+    size_t count;
+    size_t capacity;
+} fossil_token_array;
+
+// Block of memory handed out by an arena (the data follows the header)
+typedef struct fossil_arena_block {
+    struct fossil_arena_block* next;
+    size_t size;
+    size_t used;
+} fossil_arena_block;
+
+// Arena owning the nodes, child arrays and strings of one parse
+typedef struct fossil_arena {
+    fossil_arena_block* blocks;
+    size_t block_size;
+    size_t num_allocations;
+    size_t num_adopted;    // Heap nodes added as children of its nodes
+    struct ASTNode* root;  // Erasing this node erases the whole arena
+} fossil_arena;
+
+// Source offset of nodes that were not parsed from text
+#define FOSSIL_NO_SOURCE_OFFSET UINT32_MAX
+
 // Structure for AST nodes
 typedef struct ASTNode {
     NodeType type;
     DataType data_type;
     OperatorType operator_type;
+    uint32_t source_offset;  // Byte offset in the parsed source, FOSSIL_NO_SOURCE_OFFSET if unknown
     char* value;
     int error_flag;
     int is_public;
@@ -178,6 +278,7 @@ typedef struct ASTNode {
     size_t num_private_members;
     struct ASTNode* parent_class;  // For INHERITANCE
     size_t encapsulated_member_index;  // For ENCAPSULATION
+    fossil_arena* arena;  // Owning arena, NULL for heap nodes
 } ASTNode;
 
 // Define ParseError type
@@ -188,11 +289,398 @@ typedef enum {
     // Add more error types as needed
 } ParseError;
 
+// Byte and line span of a top-level declaration
+typedef struct {
+    uint32_t start;     // Offset of the first token
+    uint32_t end;       // Offset just past the last token
+    uint32_t line;      // Line of the first token
+    uint32_t end_line;  // Line of the last token
+} fossil_span;
+
+// Source text kept together with its AST for incremental reparsing.
+// Each child of root lives in its own arena so it can be replaced alone,
+// and the source offsets of its nodes are relative to its span start.
+typedef struct {
+    char* code;
+    size_t length;
+    ASTNode* root;        // NULL while the text does not parse
+    fossil_span* spans;   // Span of each child of root
+    size_t reparsed;      // Declarations parsed by the last open or edit
+} fossil_document;
+
+// Index value meaning "no node" in a flat AST
+#define FOSSIL_FLAT_NONE UINT32_MAX
+
+// Node flags in a flat AST
+enum {
+    FOSSIL_FLAT_PUBLIC    = 1 << 0,  // is_public
+    FOSSIL_FLAT_ERROR     = 1 << 1,  // error_flag
+    FOSSIL_FLAT_HAS_VALUE = 1 << 2   // value is not NULL
+};
+
+// Flat AST stored as parallel arrays in pre-order, node 0 is the root.
+// About 20 bytes per node; values live in one string pool.
+typedef struct {
+    uint8_t* kinds;          // NodeType
+    uint8_t* types;          // DataType
+    uint8_t* operators;      // OperatorType
+    uint8_t* flags;          // FOSSIL_FLAT_* bits
+    uint32_t* first_child;   // FOSSIL_FLAT_NONE for leaves
+    uint32_t* next_sibling;  // FOSSIL_FLAT_NONE for the last child
+    uint32_t* value_offset;  // Offset of the value in strings
+    uint32_t* value_length;
+    uint32_t count;
+    uint32_t capacity;
+    char* strings;           // NUL-terminated values, back to back
+    uint32_t strings_length;
+    uint32_t strings_capacity;
+} fossil_flat_ast;
+
+// Visitor callback for a flat AST, return non-zero to stop the walk
+typedef int (*fossil_flat_visitor)(const fossil_flat_ast* flat, uint32_t index, uint32_t depth, void* user_data);
+
+// What an AST visitor asks the walk to do next
+typedef enum {
+    FOSSIL_VISIT_CONTINUE,    // Go on, into the children of the node
+    FOSSIL_VISIT_SKIP,        // Go on, but not below the node
+    FOSSIL_VISIT_STOP         // End the walk
+} fossil_visit_result;
+
+// Visitor callback for an AST, returns a fossil_visit_result
+typedef int (*fossil_ast_visitor)(ASTNode* node, size_t depth, void* user_data);
+
+// Output formats of an AST dump
+typedef enum {
+    FOSSIL_DUMP_TEXT,         // Indented lines, as printed by fscl_fossil_print_ast
+    FOSSIL_DUMP_JSON,         // One object per node with a children array
+    FOSSIL_DUMP_SEXPR         // (TYPE data_type [OPERATOR] ["value"] children...)
+} fossil_dump_format;
+
+// Bytecode instructions, operands follow the opcode as 32-bit words
+typedef enum {
+    FOSSIL_OP_CONST,          // constant index
+    FOSSIL_OP_NULL,
+    FOSSIL_OP_POP,
+    FOSSIL_OP_DUP,
+    FOSSIL_OP_LOAD,           // local slot
+    FOSSIL_OP_STORE,          // local slot, pops the value
+    FOSSIL_OP_ADD,
+    FOSSIL_OP_SUB,
+    FOSSIL_OP_MUL,
+    FOSSIL_OP_DIV,
+    FOSSIL_OP_MOD,
+    FOSSIL_OP_NEG,
+    FOSSIL_OP_NOT,
+    FOSSIL_OP_EQ,
+    FOSSIL_OP_NE,
+    FOSSIL_OP_LT,
+    FOSSIL_OP_LE,
+    FOSSIL_OP_GT,
+    FOSSIL_OP_GE,
+    FOSSIL_OP_JUMP,           // target
+    FOSSIL_OP_JUMP_IF_FALSE,  // target, pops the condition
+    FOSSIL_OP_AND,            // target, keeps a false value and jumps
+    FOSSIL_OP_OR,             // target, keeps a true value and jumps
+    FOSSIL_OP_CALL,           // function index, argument count
+    FOSSIL_OP_PRINT,          // argument count, pushes null
+    FOSSIL_OP_ARRAY,          // element count
+    FOSSIL_OP_RETURN,
+    FOSSIL_OP_COUNT
+} fossil_opcode;
+
+// Kinds of runtime values
+typedef enum {
+    FOSSIL_VALUE_NULL,
+    FOSSIL_VALUE_BOOL,
+    FOSSIL_VALUE_INT,
+    FOSSIL_VALUE_FLOAT,
+    FOSSIL_VALUE_STRING,
+    FOSSIL_VALUE_ARRAY
+} fossil_value_kind;
+
+struct fossil_value_array;
+
+// Runtime value
+typedef struct {
+    fossil_value_kind kind;
+    union {
+        int boolean;
+        int64_t integer;
+        double number;
+        const char* string;
+        const struct fossil_value_array* array;
+    } as;
+} fossil_value;
+
+// Runtime array
+typedef struct fossil_value_array {
+    size_t count;
+    fossil_value* items;
+} fossil_value_array;
+
+// Compiled function
+typedef struct {
+    char* name;
+    uint32_t arity;
+    uint32_t num_locals;  // Parameters included
+    uint32_t max_stack;   // Operand stack depth needed beyond the locals
+    uint32_t entry;       // Offset of the first instruction
+} fossil_function_info;
+
+// Compiled program
+typedef struct {
+    uint32_t* code;
+    size_t code_size;
+    size_t code_capacity;
+    fossil_value* constants;  // String constants are owned by the program
+    size_t num_constants;
+    size_t constants_capacity;
+    fossil_function_info* functions;
+    size_t num_functions;
+    char error[128];          // Message of the last compile error
+} fossil_program;
+
+// Call frame of the virtual machine
+typedef struct {
+    const fossil_function_info* function;
+    size_t return_ip;
+    size_t base;
+} fossil_vm_frame;
+
+// Virtual machine state; strings and arrays built at runtime stay alive
+// until the machine is erased, so results can be inspected after a run.
+typedef struct {
+    fossil_value* stack;
+    size_t stack_capacity;
+    fossil_vm_frame* frames;
+    size_t frames_capacity;
+    void* objects;            // Runtime allocations, freed on erase
+    FILE* output;             // Destination of print
+    char error[128];          // Message of the last runtime error
+} fossil_vm;
+
+struct fossil_expr_step;
+struct fossil_expr_state;
+
+// Code of one step of a compiled expression; returns the step to run next,
+// or NULL when the expression is done or failed
+typedef const struct fossil_expr_step* (*fossil_expr_fn)(struct fossil_expr_state* state, const struct fossil_expr_step* step);
+
+// Step of a compiled expression: the code to run and its operands
+typedef struct fossil_expr_step {
+    fossil_expr_fn run;
+    OperatorType op;          // Operator of operator steps
+    uint32_t operand;         // Variable slot, or distance to the step jumped to
+    fossil_value value;       // Constant of constant steps
+} fossil_expr_step;
+
+// Expression compiled once to threaded code for repeated evaluation
+typedef struct {
+    fossil_expr_step* steps;
+    size_t num_steps;
+    size_t steps_capacity;
+    char** names;             // Variable of each environment slot
+    size_t num_names;
+    size_t max_stack;         // Values live at once during evaluation
+    char error[128];          // Message of the last compile error
+} fossil_expr;
+
+// A source file of a project and the files it includes
+typedef struct {
+    char* path;               // Normalized path, '/' separated
+    ASTNode* root;            // Parsed tree, owned by its arena
+    size_t* includes;         // Indices of the included files
+    size_t num_includes;
+    char error[192];          // Message of a read or parse failure
+} fossil_project_file;
+
+// Files reachable from an entry file through include, parsed into one tree
+typedef struct {
+    fossil_project_file* files; // In discovery order, entry first
+    size_t num_files;
+    size_t files_capacity;
+    ASTNode* root;            // Merged declarations, included files first
+    char** libraries;         // Distinct link names in discovery order
+    size_t num_libraries;
+    char error[256];          // Message of the last failure
+} fossil_project;
+
+// Kinds of declared names
+typedef enum {
+    FOSSIL_SYMBOL_CLASS,
+    FOSSIL_SYMBOL_FUNCTION,
+    FOSSIL_SYMBOL_METHOD,
+    FOSSIL_SYMBOL_FIELD,
+    FOSSIL_SYMBOL_PARAMETER,
+    FOSSIL_SYMBOL_VARIABLE
+} fossil_symbol_kind;
+
+struct fossil_scope;
+
+// A declared name
+typedef struct {
+    const char* name;            // Interned: equal names share one pointer
+    fossil_symbol_kind kind;
+    ASTNode* node;               // Declaring node
+    struct fossil_scope* scope;  // Scope declaring the name
+    struct fossil_scope* body;   // Scope opened by a class or function, else NULL
+} fossil_symbol;
+
+// Names declared by a class, function or block, hashed by interned name
+typedef struct fossil_scope {
+    struct fossil_scope* parent; // Enclosing scope, NULL for the global one
+    struct fossil_scope* base;   // Scope of the parent class of a class scope
+    ASTNode* owner;              // Node opening the scope, NULL for the global one
+    fossil_symbol** slots;
+    size_t capacity;
+    size_t count;
+} fossil_scope;
+
+// A name declared twice in one scope
+typedef struct {
+    ASTNode* node;               // Later declaration
+    ASTNode* previous;           // Declaration it clashes with
+} fossil_duplicate;
+
+// Scopes and symbols of a tree, built by fscl_fossil_symbols_build
+typedef struct {
+    fossil_arena* arena;         // Scopes, symbols, tables and names
+    fossil_scope* global;
+    const char** names;          // Intern table
+    size_t names_capacity;
+    size_t num_names;
+    const ASTNode** scope_owners; // Nodes opening scopes, hashed by address
+    fossil_scope** scopes;       // Scope of each owner slot
+    size_t scopes_capacity;
+    size_t num_scopes;
+    fossil_duplicate* duplicates;
+    size_t num_duplicates;
+    size_t duplicates_capacity;
+} fossil_symbol_table;
+
+// A problem found in a tree or in the source it was parsed from
+typedef struct {
+    ASTNode* node;               // Node the message is about, NULL for parse errors
+    uint32_t line;               // 1-based span of the offending source, 0 when unknown
+    uint32_t column;
+    uint32_t end_line;
+    uint32_t end_column;         // Column just past the span
+    char message[160];
+} fossil_diagnostic;
+
+// Problems collected by a pass, in the order they were found
+typedef struct {
+    fossil_diagnostic* items;
+    size_t count;
+    size_t capacity;
+} fossil_diagnostics;
+
+// Settings and outcome of parses made through one context. Nothing in it is
+// shared, so threads that each use their own context can parse in parallel.
+typedef struct {
+    char open_brace;                 // Opens a body, like OPEN_BRACE_KEYWORD
+    char close_brace;                // Closes a body, like CLOSE_BRACE_KEYWORD
+    const char* function_keyword;    // Starts a function, like FUNCTION_KEYWORD
+    size_t arena_block_size;         // Block size of the arenas created, 0 for the default
+    fossil_diagnostics* diagnostics; // When set, parses recover and record every error here
+    fossil_arena* arena;             // Arena of the last tree, owned by its root
+    ParseError error;                // Outcome of the last parse
+    char message[160];               // First error of the last parse with its position
+    fossil_token_array tokens;       // Token buffer reused between parses
+} fossil_parser_ctx;
+
+// Start offset of every line of a source, for turning the source offsets of
+// nodes into lines and columns without scanning the text again
+typedef struct {
+    uint32_t* starts;         // starts[i] is the offset of line i + 1, in increasing order
+    size_t count;
+    uint32_t length;          // Length of the source in bytes
+} fossil_line_table;
+
 // Global variables for custom names
 extern char OPEN_BRACE_KEYWORD;
 extern char CLOSE_BRACE_KEYWORD;
 extern char* FUNCTION_KEYWORD;
 
+// =================================================================
+// Arena functions
+// =================================================================
+
+/**
+ * Create an arena for AST nodes, child arrays and strings.
+ *
+ * @param block_size Size of each memory block, or 0 for the default.
+ * @return           A pointer to the created arena, or NULL on failure.
+ */
+fossil_arena* fscl_fossil_arena_create(size_t block_size);
+
+/**
+ * Erase an arena and everything allocated from it in one call.
+ *
+ * @param arena The arena to be erased.
+ */
+void fscl_fossil_arena_erase(fossil_arena* arena);
+
+/**
+ * Allocate memory from an arena, aligned for any node or pointer type.
+ *
+ * @param arena The arena to allocate from.
+ * @param size  The number of bytes to allocate.
+ * @return      A pointer to the memory, or NULL on failure.
+ */
+void* fscl_fossil_arena_alloc(fossil_arena* arena, size_t size);
+
+/**
+ * Copy a string of the given length into an arena.
+ *
+ * @param arena  The arena to allocate from.
+ * @param str    The characters to be copied.
+ * @param length The number of characters to copy.
+ * @return       A NUL-terminated copy owned by the arena.
+ */
+char* fscl_fossil_arena_strndup(fossil_arena* arena, const char* str, size_t length);
+
+/**
+ * Create a new AST node owned by an arena.
+ *
+ * Children added to an arena node are stored in the same arena, and
+ * fscl_fossil_erase_node is a no-op for it unless it is the arena root.
+ *
+ * @param arena         The arena owning the node.
+ * @param type          The type of the AST node.
+ * @param data_type     The data type associated with the node.
+ * @param operator_type The operator type for operator nodes.
+ * @param value         The value associated with the node.
+ * @return              A pointer to the created AST node.
+ */
+ASTNode* fscl_fossil_arena_create_node(fossil_arena* arena, NodeType type, DataType data_type, OperatorType operator_type, char* value);
+
+// =================================================================
+// Lexer functions
+// =================================================================
+
+/**
+ * Split source code into tokens in one linear pass.
+ *
+ * Comments (#, // and block comments) and whitespace are dropped.
+ * FUNCTION_KEYWORD, OPEN_BRACE_KEYWORD and CLOSE_BRACE_KEYWORD are
+ * honoured. Malformed input produces FOSSIL_TOKEN_ERROR tokens rather
+ * than stopping the lexer.
+ *
+ * @param code   The source code.
+ * @param length The length of the source code in bytes.
+ * @param tokens Pointer to the token array to fill (previous content is replaced).
+ * @return       0 on success, non-zero if memory ran out or the input exceeds 4 GiB.
+ */
+int fscl_fossil_lex(const char* code, size_t length, fossil_token_array* tokens);
+
+/**
+ * Free the storage of a token array.
+ *
+ * @param tokens Pointer to the token array to be erased.
+ */
+void fscl_fossil_token_array_erase(fossil_token_array* tokens);
+
 // =================================================================
 // DSL functions
 // =================================================================
@@ -219,6 +707,11 @@ ASTNode* fscl_fossil_create_node(NodeType type, DataType data_type, OperatorType
 /**
  * Add a child node to the specified parent AST node.
  *
+ * The parent takes ownership of a heap child: erasing the parent's tree
+ * erases the child too, including when the parent belongs to an arena. A
+ * child owned by another arena is only borrowed and must be erased
+ * through its own arena root.
+ *
  * @param parent The parent AST node.
  * @param child  The child AST node to be added.
  */
@@ -235,15 +728,65 @@ void fscl_fossil_add_children(ASTNode* parent, size_t num_children, ...);
 
 /**
  * Print the AST in a readable format with specified depth.
+ * Nodes marked as erroneous are left out with their children.
+ * The output is rendered first and written to stdout at once.
  *
  * @param root  The root AST node.
  * @param depth The initial depth for indentation.
  */
 void fscl_fossil_print_ast(ASTNode* root, int depth);
 
+/**
+ * Render an AST as indented text, JSON or an S-expression.
+ * Nodes marked as erroneous are left out with their children.
+ *
+ * @param root   The root AST node.
+ * @param format The output format.
+ * @param length Optional pointer that receives the length of the result.
+ * @return       A NUL-terminated string to be released with free, or NULL on failure.
+ */
+char* fscl_fossil_dump_ast(ASTNode* root, fossil_dump_format format, size_t* length);
+
+/**
+ * Render an AST like fscl_fossil_dump_ast and write it with a single call.
+ *
+ * @param root   The root AST node.
+ * @param format The output format.
+ * @param file   The destination.
+ * @return       0 on success, -1 on error.
+ */
+int fscl_fossil_write_ast(ASTNode* root, fossil_dump_format format, FILE* file);
+
+/**
+ * Get the symbolic name of a node type, such as "FUNCTION".
+ *
+ * @param type The node type.
+ * @return     The name, or "UNKNOWN".
+ */
+const char* fscl_fossil_node_type_name(NodeType type);
+
+/**
+ * Get the DSL name of a data type, such as "int32".
+ *
+ * @param type The data type.
+ * @return     The name, or "unknown".
+ */
+const char* fscl_fossil_data_type_name(DataType type);
+
+/**
+ * Get the symbolic name of an operator, such as "ADD".
+ *
+ * @param op The operator.
+ * @return   The name, or "UNKNOWN".
+ */
+const char* fscl_fossil_operator_name(OperatorType op);
+
 /**
  * Erase an AST node and its children from memory.
  *
+ * For a tree returned by fscl_fossil_parse_dsl_file this releases the
+ * parse arena, and for other arena nodes it does nothing.
+ *
  * @param node The AST node to be erased.
  */
 void fscl_fossil_erase_node(ASTNode* node);
@@ -381,21 +924,35 @@ char* fscl_fossil_parse_identifier(const char* code, size_t* index);
  */
 DataType fscl_fossil_parse_data_type(const char* code, size_t* index);
 
+/**
+ * Map a type name to its data type without copying or allocating.
+ *
+ * @param text   Start of the type name (need not be NUL-terminated).
+ * @param length Length of the type name in bytes.
+ * @return       The data type, or FOSSIL_ERROR if the name is not a type.
+ */
+DataType fscl_fossil_data_type_from_span(const char* text, size_t length);
+
 /**
  * Parse a statement in the code and return the corresponding ASTNode.
  *
  * @param statement The statement string to parse.
- * @return          A pointer to the created ASTNode representing the statement.
+ * @return          A pointer to the created ASTNode representing the statement,
+ *                  or NULL on a parse error. Erase it with fscl_fossil_erase_node.
  */
 ASTNode* fscl_fossil_parse_statement(const char* statement);
 
 /**
  * Parse a function declaration in the code and return the corresponding ASTNode.
  *
+ * The declaration may start with FUNCTION_KEYWORD or directly with its name.
+ * On return the index points just past the declaration.
+ *
  * @param code      The code string to parse.
  * @param index     Pointer to the index in the code string.
  * @param entryPoint The entry point for the function.
- * @return          A pointer to the created ASTNode representing the function declaration.
+ * @return          A pointer to the created ASTNode representing the function declaration,
+ *                  or NULL on a parse error. Erase it with fscl_fossil_erase_node.
  */
 ASTNode* fscl_fossil_parse_function_declaration(const char* code, size_t* index, const char* entryPoint);
 
@@ -419,20 +976,782 @@ void fscl_fossil_add_class_member(ASTNode* classNode, ASTNode* member, int is_pu
 /**
  * Parse a class declaration in the code and return the corresponding ASTNode.
  *
+ * The declaration may start with the class keyword or directly with its name.
+ * On return the index points just past the declaration.
+ *
  * @param code  The code string to parse.
  * @param index Pointer to the index in the code string.
- * @return      A pointer to the created ASTNode representing the class declaration.
+ * @return      A pointer to the created ASTNode representing the class declaration,
+ *              or NULL on a parse error. Erase it with fscl_fossil_erase_node.
  */
 ASTNode* fscl_fossil_parse_class_declaration(const char* code, size_t* index);
 
 /**
  * Parse a DSL file into an AST and return the root ASTNode.
  *
+ * When a cache directory is set with fscl_fossil_set_cache_directory,
+ * unchanged files are loaded from the parse cache instead of parsed.
+ *
  * @param filename The name of the DSL file to be parsed.
  * @return         A pointer to the root ASTNode representing the parsed DSL file.
  */
 ASTNode* fscl_fossil_parse_dsl_file(const char* filename);
 
+/**
+ * Parse DSL source held in memory into an AST and return the root ASTNode.
+ *
+ * @param code The NUL-terminated DSL source.
+ * @return     A pointer to the root ASTNode, or NULL on a parse error.
+ */
+ASTNode* fscl_fossil_parse_dsl_string(const char* code);
+
+/**
+ * Parse DSL source held in memory and keep going after errors.
+ *
+ * After an error the parser skips to the next statement boundary (a ';',
+ * the closing brace of the block or a new line) or, outside functions and
+ * classes, to the next declaration, and carries on. Every error is
+ * appended to diagnostics with its source span, so one parse reports all
+ * of them; errors caused by the skipped tokens are not reported. Nothing is
+ * printed and the global parse error is left alone, so separate parses can
+ * run on separate threads.
+ *
+ * @param code        The NUL-terminated DSL source.
+ * @param diagnostics Pointer to the array receiving the errors (existing entries are kept).
+ * @return            The root of the tree of everything that parsed, or NULL when out of memory.
+ *                    Erase it with fscl_fossil_erase_node.
+ */
+ASTNode* fscl_fossil_parse_dsl_recover(const char* code, fossil_diagnostics* diagnostics);
+
+/**
+ * Initialize a parser context with the current global keywords.
+ *
+ * The keywords are copied, so later changes to OPEN_BRACE_KEYWORD,
+ * CLOSE_BRACE_KEYWORD and FUNCTION_KEYWORD do not affect the context. Set
+ * diagnostics afterwards to make its parses recover from errors.
+ *
+ * @param ctx Pointer to the context to be initialized.
+ */
+void fscl_fossil_parser_ctx_init(fossil_parser_ctx* ctx);
+
+/**
+ * Parse DSL source with the keywords of a context.
+ *
+ * Nothing is printed and the global parse error is not touched; the
+ * outcome is left in ctx->error and ctx->message.
+ *
+ * @param ctx    Pointer to the parser context.
+ * @param code   The DSL source, NUL-terminated at length.
+ * @param length The length of the source in bytes.
+ * @return       A pointer to the root ASTNode, or NULL on a parse error (always the
+ *               tree of everything that parsed when ctx->diagnostics is set).
+ */
+ASTNode* fscl_fossil_parser_ctx_parse(fossil_parser_ctx* ctx, const char* code, size_t length);
+
+/**
+ * Parse a DSL file with the keywords of a context.
+ *
+ * @param ctx      Pointer to the parser context.
+ * @param filename The name of the DSL file; a file that cannot be read is reported in ctx->message.
+ * @return         A pointer to the root ASTNode, or NULL on failure.
+ */
+ASTNode* fscl_fossil_parser_ctx_parse_file(fossil_parser_ctx* ctx, const char* filename);
+
+/**
+ * Free the token buffer of a parser context. Trees it parsed are kept.
+ *
+ * @param ctx Pointer to the context to be erased.
+ */
+void fscl_fossil_parser_ctx_erase(fossil_parser_ctx* ctx);
+
+// =================================================================
+// Document functions
+// =================================================================
+
+/**
+ * Open a document from source text and parse it.
+ *
+ * @param doc  Pointer to the document to initialize.
+ * @param code The NUL-terminated DSL source, copied into the document.
+ * @return     0 on success, -1 if the text does not parse (doc->root is NULL).
+ *             The document must be erased either way.
+ */
+int fscl_fossil_document_open(fossil_document* doc, const char* code);
+
+/**
+ * Open a document from a DSL file and parse it.
+ *
+ * @param doc      Pointer to the document to initialize.
+ * @param filename The name of the DSL file.
+ * @return         0 on success, -1 if the file cannot be read or the text
+ *                 does not parse. The document must be erased either way.
+ */
+int fscl_fossil_document_load(fossil_document* doc, const char* filename);
+
+/**
+ * Replace a byte range of the document and update the AST.
+ *
+ * Only the top-level declarations touched by the edit (plus the one
+ * before it when the edit lands in a gap) are parsed again; the other
+ * subtrees are kept as they are and only their spans are shifted, since
+ * node offsets are relative to the span of their declaration. If the
+ * edited range no longer ends on a declaration boundary the reparse
+ * widens until it does. When the text stops parsing, doc->root becomes
+ * NULL and the next edit parses the whole text.
+ *
+ * @param doc         Pointer to the document.
+ * @param offset      Byte offset of the edit.
+ * @param removed     Number of bytes removed at offset.
+ * @param text        Text inserted at offset.
+ * @param text_length Number of bytes inserted.
+ * @return            0 on success, -1 on invalid input or a parse error.
+ */
+int fscl_fossil_document_edit(fossil_document* doc, size_t offset, size_t removed, const char* text, size_t text_length);
+
+/**
+ * Free a document and its AST.
+ *
+ * @param doc Pointer to the document to be erased.
+ */
+void fscl_fossil_document_erase(fossil_document* doc);
+
+// =================================================================
+// Flat AST functions
+// =================================================================
+
+/**
+ * Convert a pointer-based AST into a flat AST.
+ *
+ * @param root The root of the AST to convert.
+ * @param flat Pointer to the flat AST to fill (previous content is erased).
+ * @return     0 on success, -1 on invalid input or allocation failure.
+ */
+int fscl_fossil_flat_from_ast(const ASTNode* root, fossil_flat_ast* flat);
+
+/**
+ * Free the storage of a flat AST.
+ *
+ * @param flat Pointer to the flat AST to be erased.
+ */
+void fscl_fossil_flat_erase(fossil_flat_ast* flat);
+
+/**
+ * Get the value of a node in a flat AST.
+ *
+ * @param flat  Pointer to the flat AST.
+ * @param index Index of the node.
+ * @return      The NUL-terminated value, or NULL if the node has none.
+ */
+const char* fscl_fossil_flat_value(const fossil_flat_ast* flat, uint32_t index);
+
+/**
+ * Count the children of a node in a flat AST.
+ *
+ * @param flat  Pointer to the flat AST.
+ * @param index Index of the node.
+ * @return      The number of children.
+ */
+uint32_t fscl_fossil_flat_num_children(const fossil_flat_ast* flat, uint32_t index);
+
+/**
+ * Walk the subtree under a node depth-first in pre-order, without recursion.
+ *
+ * @param flat      Pointer to the flat AST.
+ * @param index     Index of the subtree root.
+ * @param visitor   Callback invoked for each node with its depth below index.
+ * @param user_data Pointer passed through to the visitor.
+ * @return          0 if every node was visited, 1 if the visitor stopped the walk,
+ *                  -1 on allocation failure.
+ */
+int fscl_fossil_flat_visit(const fossil_flat_ast* flat, uint32_t index, fossil_flat_visitor visitor, void* user_data);
+
+/**
+ * Visit every node in storage order, which is pre-order over the whole tree.
+ * This is the fastest whole-tree pass; depth is not tracked and is always 0.
+ *
+ * @param flat      Pointer to the flat AST.
+ * @param visitor   Callback invoked for each node.
+ * @param user_data Pointer passed through to the visitor.
+ * @return          0 if every node was visited, 1 if the visitor stopped the walk.
+ */
+int fscl_fossil_flat_for_each(const fossil_flat_ast* flat, fossil_flat_visitor visitor, void* user_data);
+
+// =================================================================
+// Optimization functions
+// =================================================================
+
+/**
+ * Fold constant expressions in place.
+ *
+ * Arithmetic, relational, logical and unary operations on constants
+ * become single CONSTANT nodes. Logical operations with a constant left
+ * side are short-circuited. Results follow the virtual machine's rules;
+ * division by zero and float results that are not finite are left for
+ * run time. Replaced heap subtrees are erased; replaced arena nodes stay
+ * in the arena until it is erased.
+ *
+ * @param root The root of the tree; the root node itself is never replaced.
+ * @return     The number of simplifications made.
+ */
+size_t fscl_fossil_fold_constants(ASTNode* root);
+
+/**
+ * Remove dead code in place.
+ *
+ * An IF_STATEMENT with a constant condition is replaced by the branch
+ * that runs. A WHILE_LOOP whose condition is constant false is removed.
+ * Statements after a RETURN_STATEMENT in the same block are dropped.
+ *
+ * @param root The root of the tree; the root node itself is never replaced.
+ * @return     The number of nodes removed or replaced.
+ */
+size_t fscl_fossil_eliminate_dead_code(ASTNode* root);
+
+/**
+ * Run constant folding and dead-code elimination until nothing changes.
+ *
+ * @param root The root of the tree; the root node itself is never replaced.
+ * @return     The total number of changes.
+ */
+size_t fscl_fossil_optimize(ASTNode* root);
+
+// =================================================================
+// Bytecode functions
+// =================================================================
+
+/**
+ * Compile the functions of a parsed program to stack bytecode.
+ *
+ * Top-level functions are compiled; classes, includes and links are
+ * skipped. Calls are resolved by name at compile time and missing
+ * arguments take the parameter defaults.
+ *
+ * @param root    The root returned by fscl_fossil_parse_dsl_file or fscl_fossil_parse_dsl_string.
+ * @param program Pointer to the program to fill (previous content is replaced).
+ * @return        0 on success, -1 on error with the message in program->error.
+ */
+int fscl_fossil_compile(const ASTNode* root, fossil_program* program);
+
+/**
+ * Free the storage of a compiled program.
+ *
+ * @param program Pointer to the program to be erased.
+ */
+void fscl_fossil_program_erase(fossil_program* program);
+
+/**
+ * Find a compiled function by name.
+ *
+ * @param program Pointer to the program.
+ * @param name    The function name.
+ * @return        The function index, or -1 if there is none.
+ */
+int fscl_fossil_program_find(const fossil_program* program, const char* name);
+
+/**
+ * Initialize a virtual machine.
+ *
+ * @param vm     Pointer to the machine.
+ * @param output Destination of print, or NULL for stdout.
+ */
+void fscl_fossil_vm_init(fossil_vm* vm, FILE* output);
+
+/**
+ * Run a function of a compiled program, such as main, until it returns.
+ * Parameters of the entry function start out as null.
+ *
+ * @param vm       Pointer to an initialized machine.
+ * @param program  Pointer to the compiled program.
+ * @param function Name of the function to run.
+ * @param result   Optional pointer that receives the returned value.
+ * @return         0 on success, -1 on error with the message in vm->error.
+ */
+int fscl_fossil_vm_run(fossil_vm* vm, const fossil_program* program, const char* function, fossil_value* result);
+
+/**
+ * Free the stacks of a machine and every value it created.
+ *
+ * @param vm Pointer to the machine to be erased.
+ */
+void fscl_fossil_vm_erase(fossil_vm* vm);
+
+/**
+ * Apply a binary or relational operator with the semantics of the machine.
+ * Used by generated C code; the result replaces a, and strings built by
+ * concatenation live until the machine is erased.
+ *
+ * @param vm Pointer to the machine owning new values and the error message.
+ * @param op An arithmetic, equality or ordering operator.
+ * @param a  The left operand, replaced by the result.
+ * @param b  The right operand.
+ * @return   0 on success, -1 on error with the message in vm->error.
+ */
+int fscl_fossil_vm_binary(fossil_vm* vm, OperatorType op, fossil_value* a, const fossil_value* b);
+
+/**
+ * Apply NEGATION or NOT with the semantics of the machine.
+ *
+ * @param vm    Pointer to the machine receiving the error message.
+ * @param op    NEGATION or NOT.
+ * @param value The operand, replaced by the result.
+ * @return      0 on success, -1 on error with the message in vm->error.
+ */
+int fscl_fossil_vm_unary(fossil_vm* vm, OperatorType op, fossil_value* value);
+
+/**
+ * Get the truth value of a runtime value, as used by if, while, and and or.
+ *
+ * @param value Pointer to the value.
+ * @return      1 if the value is true, 0 otherwise.
+ */
+int fscl_fossil_vm_truthy(const fossil_value* value);
+
+/**
+ * Print values like the print statement: separated by spaces and
+ * followed by a newline, to the output of the machine.
+ *
+ * @param vm     Pointer to the machine.
+ * @param values The values to print.
+ * @param count  The number of values.
+ * @return       0 on success, -1 on error with the message in vm->error.
+ */
+int fscl_fossil_vm_print(fossil_vm* vm, const fossil_value* values, size_t count);
+
+/**
+ * Create an array value that lives until the machine is erased.
+ *
+ * @param vm     Pointer to the machine owning the array.
+ * @param items  The items to copy into the array.
+ * @param count  The number of items.
+ * @param result Pointer that receives the array value.
+ * @return       0 on success, -1 on error with the message in vm->error.
+ */
+int fscl_fossil_vm_array(fossil_vm* vm, const fossil_value* items, size_t count, fossil_value* result);
+
+// =================================================================
+// Project functions
+// =================================================================
+
+/**
+ * Load an entry file and every file it includes, directly or not.
+ *
+ * Include paths are relative to the including file. Each file is read
+ * and parsed once however often it is included, and files are parsed on
+ * up to num_threads threads. The merged root holds the declarations of
+ * every file, included files before the files including them; include
+ * and link statements are left out and the links are collected in
+ * project->libraries.
+ *
+ * @param project     Pointer to the project to fill (previous content is replaced).
+ * @param entry_path  Path of the entry file.
+ * @param num_threads Maximum number of parsing threads, 0 or 1 for none.
+ * @return            0 on success, -1 on error with the message in project->error.
+ */
+int fscl_fossil_project_load(fossil_project* project, const char* entry_path, size_t num_threads);
+
+/**
+ * Free the merged tree, the file trees and the paths of a project.
+ *
+ * @param project Pointer to the project to be erased.
+ */
+void fscl_fossil_project_erase(fossil_project* project);
+
+// =================================================================
+// Serialization functions
+// =================================================================
+
+/**
+ * Compute the key of a source for the parse cache.
+ *
+ * The key hashes the text together with FUNCTION_KEYWORD,
+ * OPEN_BRACE_KEYWORD and CLOSE_BRACE_KEYWORD, since those change how
+ * the same text parses.
+ *
+ * @param code   The source code.
+ * @param length The length of the source code in bytes.
+ * @return       A 64-bit content hash.
+ */
+uint64_t fscl_fossil_source_key(const char* code, size_t length);
+
+/**
+ * Serialize a tree to a compact binary blob.
+ *
+ * Nodes are stored in pre-order as fixed-size records followed by a pool
+ * of their values; source offsets and class member lists are preserved.
+ *
+ * @param root The root of the tree.
+ * @param key  Key stored in the blob, usually from fscl_fossil_source_key.
+ * @param data Receives the blob, to be released with free.
+ * @param size Receives the size of the blob in bytes.
+ * @return     0 on success, -1 on error.
+ */
+int fscl_fossil_serialize(const ASTNode* root, uint64_t key, unsigned char** data, size_t* size);
+
+/**
+ * Rebuild a tree from a blob written by fscl_fossil_serialize.
+ *
+ * The tree is owned by a single arena, like a freshly parsed one.
+ *
+ * @param data The blob.
+ * @param size The size of the blob in bytes.
+ * @param key  The key the blob must carry.
+ * @return     The root of the tree, or NULL if the blob is malformed, of another version or for another key.
+ */
+ASTNode* fscl_fossil_deserialize(const void* data, size_t size, uint64_t key);
+
+/**
+ * Set the directory of the parse cache used by fscl_fossil_parse_dsl_file.
+ *
+ * When set, a file whose key has an entry is loaded from it without
+ * parsing, and every other parsed file is stored. Caching is off by default.
+ *
+ * @param directory An existing directory, or NULL to turn caching off.
+ * @return          0 on success, -1 if memory ran out.
+ */
+int fscl_fossil_set_cache_directory(const char* directory);
+
+/**
+ * Get the directory of the parse cache.
+ *
+ * @return The directory, or NULL if caching is off.
+ */
+const char* fscl_fossil_get_cache_directory(void);
+
+/**
+ * Write a tree to the parse cache under a key.
+ *
+ * @param directory The cache directory.
+ * @param key       The key of the source the tree was parsed from.
+ * @param root      The root of the tree.
+ * @return          0 on success, -1 on error.
+ */
+int fscl_fossil_cache_store(const char* directory, uint64_t key, const ASTNode* root);
+
+/**
+ * Load a tree from the parse cache, mapping the entry into memory.
+ *
+ * @param directory The cache directory.
+ * @param key       The key of the source.
+ * @return          The root of the tree, or NULL if there is no valid entry.
+ */
+ASTNode* fscl_fossil_cache_load(const char* directory, uint64_t key);
+
+// =================================================================
+// Symbol table functions
+// =================================================================
+
+/**
+ * Build the scopes and symbols of a parsed tree in one pass.
+ *
+ * Classes and functions go in the global scope, fields and methods in
+ * their class scope, parameters and top-level locals in their function
+ * scope, and locals of nested blocks in a scope of their own. As in the
+ * compiler, assigning an unknown name declares it. Each INHERITANCE
+ * node gets its parent_class set to the class it names, and the class
+ * scope its base; unknown or cyclic parents are left unlinked. Names
+ * declared twice in one scope are listed in table->duplicates.
+ *
+ * @param root  The root of the tree.
+ * @param table Pointer to the table to fill (previous content is replaced).
+ * @return      0 on success, -1 if memory ran out.
+ */
+int fscl_fossil_symbols_build(ASTNode* root, fossil_symbol_table* table);
+
+/**
+ * Free a symbol table. The tree is left as it is.
+ *
+ * @param table Pointer to the table to be erased.
+ */
+void fscl_fossil_symbols_erase(fossil_symbol_table* table);
+
+/**
+ * Get the scope opened by a CLASS, FUNCTION or BLOCK_STATEMENT node.
+ * The body block of a function shares the function scope.
+ *
+ * @param table Pointer to the table.
+ * @param owner The node.
+ * @return      The scope, or NULL if the node opens none.
+ */
+fossil_scope* fscl_fossil_symbols_scope(const fossil_symbol_table* table, const ASTNode* owner);
+
+/**
+ * Resolve a name from a scope outwards, searching the parent classes of
+ * class scopes on the way.
+ *
+ * @param table Pointer to the table.
+ * @param scope The innermost scope, or NULL for the global one.
+ * @param name  The name to resolve.
+ * @return      The symbol, or NULL if the name is not declared.
+ */
+fossil_symbol* fscl_fossil_symbols_resolve(const fossil_symbol_table* table, const fossil_scope* scope, const char* name);
+
+/**
+ * Find a field or method of a class or of one of its parent classes.
+ *
+ * @param table      Pointer to the table.
+ * @param class_name The name of the class.
+ * @param name       The member name.
+ * @return           The nearest declaration, or NULL if there is none.
+ */
+fossil_symbol* fscl_fossil_symbols_find_member(const fossil_symbol_table* table, const char* class_name, const char* name);
+
+// =================================================================
+// Traversal functions
+// =================================================================
+
+// The walks below keep their own stack or queue instead of recursing, so
+// the depth of a tree is bounded by memory rather than the call stack.
+
+/**
+ * Walk a tree depth-first, calling enter before the children of a node
+ * and leave after them. Either callback may be NULL. FOSSIL_VISIT_SKIP
+ * from enter skips the children of the node and its leave call; from
+ * leave it acts like FOSSIL_VISIT_CONTINUE. The walk does not touch a
+ * node again once leave, or enter returning FOSSIL_VISIT_SKIP, is done
+ * with it, so either may free the node. NULL children are skipped.
+ *
+ * @param root      The root of the tree.
+ * @param enter     Callback before the children, with the depth below root.
+ * @param leave     Callback after the children, with the depth below root.
+ * @param user_data Pointer passed through to the callbacks.
+ * @return          0 if every node was visited, 1 if a callback stopped the walk,
+ *                  -1 on allocation failure.
+ */
+int fscl_fossil_visit(ASTNode* root, fossil_ast_visitor enter, fossil_ast_visitor leave, void* user_data);
+
+/**
+ * Walk a tree in pre-order: each node before its children.
+ *
+ * @param root      The root of the tree.
+ * @param visitor   Callback invoked for each node with its depth below root.
+ * @param user_data Pointer passed through to the visitor.
+ * @return          0 if every node was visited, 1 if the visitor stopped the walk,
+ *                  -1 on allocation failure.
+ */
+int fscl_fossil_visit_preorder(ASTNode* root, fossil_ast_visitor visitor, void* user_data);
+
+/**
+ * Walk a tree in post-order: each node after its children.
+ *
+ * @param root      The root of the tree.
+ * @param visitor   Callback invoked for each node with its depth below root.
+ * @param user_data Pointer passed through to the visitor.
+ * @return          0 if every node was visited, 1 if the visitor stopped the walk,
+ *                  -1 on allocation failure.
+ */
+int fscl_fossil_visit_postorder(ASTNode* root, fossil_ast_visitor visitor, void* user_data);
+
+/**
+ * Walk a tree in level order: all nodes of one depth, left to right,
+ * before any node of the next.
+ *
+ * @param root      The root of the tree.
+ * @param visitor   Callback invoked for each node with its depth below root.
+ * @param user_data Pointer passed through to the visitor.
+ * @return          0 if every node was visited, 1 if the visitor stopped the walk,
+ *                  -1 on allocation failure.
+ */
+int fscl_fossil_visit_level_order(ASTNode* root, fossil_ast_visitor visitor, void* user_data);
+
+// =================================================================
+// C code generation functions
+// =================================================================
+
+/**
+ * Lower a parsed program to a C translation unit that links against xcore.
+ *
+ * Functions become C functions named fsl_<name>, and a main function gets
+ * a C main that runs it. Each class becomes struct fsl_<Class> with one
+ * value per field and its parent class embedded as the first member,
+ * base; fsl_init_<Class> sets the fields to their initializers, and
+ * methods take the object as self. Private methods are static, public
+ * ones link externally, and private members of a parent class are not
+ * reachable from its subclasses. Values stay dynamic as in the virtual
+ * machine and errors at run time end the program with the message of
+ * the machine. Calls through objects ("a.b()") are not supported, since
+ * declarations do not keep the class of a variable.
+ *
+ * @param root       The root returned by fscl_fossil_parse_dsl_file or fscl_fossil_project_load.
+ * @param length     Optional pointer that receives the length of the text.
+ * @param error      Buffer that receives the message of the first error, or NULL.
+ * @param error_size Size of the error buffer.
+ * @return           The C source, to be released with free, or NULL on error.
+ */
+char* fscl_fossil_generate_c(ASTNode* root, size_t* length, char* error, size_t error_size);
+
+// =================================================================
+// Type checking functions
+// =================================================================
+
+/**
+ * Infer the type of every expression and check it against the declared
+ * types of variables, parameters, fields and return values.
+ *
+ * The inferred type is stored once in the data_type of each expression
+ * node, and a local declared by assignment takes the type of its first
+ * value. Integer types mix freely, as do string, char and datetime; tofu
+ * and user-defined types are dynamic and accepted anywhere, and null is
+ * accepted by every type. Problems are appended to diagnostics instead of
+ * being printed, so one pass reports all of them.
+ *
+ * @param root        The root returned by fscl_fossil_parse_dsl_file or fscl_fossil_project_load.
+ * @param diagnostics Pointer to the array receiving the problems (existing entries are kept).
+ * @return            The number of problems found, or -1 on allocation failure.
+ */
+int fscl_fossil_check_types(ASTNode* root, fossil_diagnostics* diagnostics);
+
+/**
+ * Free the entries of a diagnostics array.
+ *
+ * @param diagnostics Pointer to the array to be erased.
+ */
+void fscl_fossil_diagnostics_erase(fossil_diagnostics* diagnostics);
+
+// =================================================================
+// Expression evaluation functions
+// =================================================================
+
+/**
+ * Compile an expression tree to threaded code: an array of steps, each a
+ * function pointer with its operands, so evaluating it many times does
+ * not walk the tree or convert constant strings again.
+ *
+ * Constants, variables, arithmetic, relational, logical (short circuit),
+ * NEGATION and NOT are supported. Each distinct variable name gets an
+ * environment slot, in order of first use.
+ *
+ * @param expression The root of the expression, e.g. the condition of an if.
+ * @param expr       Pointer to the expression to fill; erase it even when compiling fails.
+ * @return           0 on success, -1 on error with the message in expr->error.
+ */
+int fscl_fossil_expr_compile(const ASTNode* expression, fossil_expr* expr);
+
+/**
+ * Find the environment slot of a variable.
+ *
+ * @param expr Pointer to the compiled expression.
+ * @param name The variable name.
+ * @return     The slot, or -1 if the expression does not use the variable.
+ */
+int fscl_fossil_expr_slot(const fossil_expr* expr, const char* name);
+
+/**
+ * Evaluate a compiled expression with the semantics of the virtual machine.
+ *
+ * The machine provides the operand stack, owns strings built during the
+ * evaluation and receives error messages; a compiled expression can be
+ * shared by threads that each use their own machine.
+ *
+ * @param expr   Pointer to the compiled expression.
+ * @param vm     Pointer to an initialized machine.
+ * @param env    The value of each variable, indexed by slot (may be NULL without variables).
+ * @param result Pointer that receives the value of the expression.
+ * @return       0 on success, -1 on error with the message in vm->error.
+ */
+int fscl_fossil_expr_eval(const fossil_expr* expr, fossil_vm* vm, const fossil_value* env, fossil_value* result);
+
+/**
+ * Free a compiled expression.
+ *
+ * @param expr Pointer to the expression to be erased.
+ */
+void fscl_fossil_expr_erase(fossil_expr* expr);
+
+// =================================================================
+// Structural sharing functions
+// =================================================================
+
+/**
+ * Hash the structure of a subtree: the type, data type, operator and value
+ * of every node and the shape of the children, but not node addresses, so
+ * equal subtrees of different trees hash alike.
+ *
+ * @param node The root of the subtree.
+ * @return     The hash of the subtree.
+ */
+uint64_t fscl_fossil_node_hash(const ASTNode* node);
+
+/**
+ * Check whether two subtrees have the same structure, comparing the fields
+ * hashed by fscl_fossil_node_hash.
+ *
+ * @param a The first subtree.
+ * @param b The second subtree.
+ * @return  1 if the subtrees are equal, 0 otherwise (or when memory runs out).
+ */
+int fscl_fossil_node_equal(const ASTNode* a, const ASTNode* b);
+
+/**
+ * Share structurally identical expressions of an arena tree (hash-consing).
+ *
+ * Constants, variables, operators, calls and array literals that occur
+ * more than once are replaced by one node, so the tree becomes a graph in
+ * which later passes can cache results per node. Statements, bodies and
+ * declarations keep their own nodes. Only nodes of the root's arena are
+ * shared, and heap trees are left alone, since erasing them would free
+ * a shared node twice. The replaced copies stay in the arena until it is
+ * erased.
+ *
+ * A shared node keeps the source offset of its first occurrence.
+ *
+ * A node changed in place after sharing changes at every place it is
+ * used, so run passes that annotate or rewrite expressions, such as
+ * fscl_fossil_check_types and fscl_fossil_optimize, before sharing.
+ *
+ * @param root The root of a tree owned by an arena.
+ * @return     The number of child links that now point to a shared node.
+ */
+size_t fscl_fossil_share_subtrees(ASTNode* root);
+
+// =================================================================
+// Source location functions
+// =================================================================
+
+/**
+ * Build the line table of a source.
+ *
+ * Lines end at '\n' and columns count bytes, like the positions of the
+ * lexer. Parsed nodes record a byte offset in source_offset, relative to
+ * the text they were parsed from (the file for project trees, the span
+ * start of their declaration for documents), and the table maps it to a
+ * line and column.
+ *
+ * @param code   The source code the tree was parsed from.
+ * @param length The length of the source code in bytes.
+ * @param table  Pointer to the table to fill.
+ * @return       0 on success, -1 on error.
+ */
+int fscl_fossil_line_table_build(const char* code, size_t length, fossil_line_table* table);
+
+/**
+ * Find the line and column of a source offset by binary search.
+ *
+ * @param table  Pointer to the line table.
+ * @param offset Byte offset in the source, such as a node's source_offset.
+ * @param line   Receives the 1-based line.
+ * @param column Receives the 1-based column.
+ * @return       0 on success, -1 if the offset is unknown or past the end of the source.
+ */
+int fscl_fossil_line_table_locate(const fossil_line_table* table, uint32_t offset, uint32_t* line, uint32_t* column);
+
+/**
+ * Fill in the position of diagnostics that name a node but have none,
+ * such as those of fscl_fossil_check_types, from the node's source offset.
+ * The span is empty and starts at the node.
+ *
+ * @param diagnostics Pointer to the diagnostics.
+ * @param table       Pointer to the line table of the source the nodes were parsed from.
+ * @return            The number of diagnostics that got a position.
+ */
+size_t fscl_fossil_diagnostics_locate(fossil_diagnostics* diagnostics, const fossil_line_table* table);
+
+/**
+ * Free a line table.
+ *
+ * @param table Pointer to the table to be erased.
+ */
+void fscl_fossil_line_table_erase(fossil_line_table* table);
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,6 +20,7 @@ extern "C"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "stream.h"
 
 typedef struct {
     char* json_data;
@@ -58,8 +59,92 @@ typedef struct {
     char*** rows;
     size_t num_rows;
     size_t num_columns;
+    int has_header;            // Row 0 holds column names
+    size_t* header_index;      // Hash of column names to column index + 1
+    size_t header_index_size;
 } ccsv;
 
+// Structure to hold one CSV column converted to doubles (NaN marks null cells)
+typedef struct {
+    double* values;
+    size_t count;
+} ccsv_column;
+
+// Structure to hold the aggregates of a group-by, one entry per distinct key
+typedef struct {
+    const char** keys;   // Point into the cells of the grouped table
+    double* sums;
+    double* mins;
+    double* maxs;
+    size_t* counts;      // Number of non-null values in each group
+    size_t num_groups;
+} ccsv_groups;
+
+// Returned by fscl_csv_column_index when no column has the given name
+#define FSCL_CSV_NO_COLUMN ((size_t)-1)
+
+// Comparison operators for CSV row predicates
+typedef enum {
+    CSV_OP_EQUAL,
+    CSV_OP_NOT_EQUAL,
+    CSV_OP_LESS,
+    CSV_OP_LESS_EQUAL,
+    CSV_OP_GREATER,
+    CSV_OP_GREATER_EQUAL
+} ccsv_op;
+
+// Structure to hold a "column op constant" row predicate
+typedef struct {
+    size_t column;       // Column index in the source file
+    ccsv_op op;
+    const char* value;   // Compared numerically when both sides are numbers
+} ccsv_predicate;
+
+// Structure to describe which columns and rows a CSV load keeps
+typedef struct {
+    const size_t* columns;              // Source columns to keep, NULL keeps all
+    size_t num_columns;
+    const ccsv_predicate* predicates;   // Every predicate must hold for a row to be kept
+    size_t num_predicates;
+    int has_header;                     // Keep the first row without filtering it
+} ccsv_query;
+
+// Structure to hold a single CSV row produced by a streaming reader
+typedef struct {
+    char** fields;
+    size_t num_fields;
+} ccsv_row;
+
+enum {CSV_READER_BUFFER_SIZE = 65536};
+
+// Structure to hold the state of a streaming CSV reader
+typedef struct {
+    cstream* stream;
+    char* buffer;           // Chunk of raw bytes read from the stream
+    size_t buffer_length;
+    size_t buffer_pos;
+    char* field_data;       // Storage reused for the fields of the current row
+    size_t field_length;
+    size_t field_capacity;
+    size_t* field_offsets;  // Start of each field inside field_data
+    char** fields;
+    size_t fields_capacity;
+    size_t row_number;
+    int eof;
+} ccsv_reader;
+
+enum {CSV_WRITER_BUFFER_SIZE = 1048576, CSV_WRITER_MIN_BUFFER_SIZE = 64};
+
+// Structure to hold the state of a buffered CSV writer
+typedef struct {
+    cstream* stream;
+    char* buffer;           // Output accumulated until the next flush
+    size_t buffer_size;
+    size_t buffer_length;
+    size_t num_fields;      // Fields written to the current row
+    int error;
+} ccsv_writer;
+
 // =================================================================
 // Create and erase
 // =================================================================
@@ -206,6 +291,19 @@ void fscl_csv_parser_erase(ccsv** data);
  */
 void fscl_csv_parser_parse(FILE* file, ccsv** data);
 
+/**
+ * Parse a CSV file keeping only the requested columns and rows.
+ *
+ * Rows are filtered as they are read and cells of columns that are not
+ * projected are never copied, so memory use is proportional to the result
+ * rather than to the file.
+ *
+ * @param file  Pointer to the FILE structure of the CSV file to be parsed.
+ * @param data  Pointer to the ccsv pointer to store the parsed data.
+ * @param query Pointer to the ccsv_query to apply, or NULL to keep everything.
+ */
+void fscl_csv_parser_parse_query(FILE* file, ccsv** data, const ccsv_query* query);
+
 /**
  * Set the value of a specified cell in the CSV parser instance.
  *
@@ -226,6 +324,279 @@ void fscl_csv_parser_setter(ccsv** data, size_t row, size_t col, const char* upd
  */
 const char* fscl_csv_parser_getter(const ccsv* data, size_t row, size_t col);
 
+// =================================================================
+// Header access
+// =================================================================
+
+/**
+ * Guess whether the first row of a table holds column names.
+ *
+ * A header is assumed when every cell of row 0 is non-empty, non-numeric
+ * and unique, and at least one column is numeric in row 1.
+ *
+ * @param data Pointer to the ccsv structure.
+ * @return     1 if row 0 looks like a header, 0 otherwise.
+ */
+int fscl_csv_detect_header(const ccsv* data);
+
+/**
+ * Mark row 0 as a header (building the name index) or as plain data.
+ *
+ * Tables loaded by fscl_csv_parser_parse detect their header automatically,
+ * so this is only needed to override the guess.
+ *
+ * @param data       Pointer to the ccsv structure.
+ * @param has_header Non-zero if row 0 holds column names.
+ * @return           0 on success, non-zero on failure.
+ */
+int fscl_csv_set_header(ccsv* data, int has_header);
+
+/**
+ * Look up a column by header name (ASCII case-insensitive).
+ *
+ * @param data Pointer to the ccsv structure.
+ * @param name The column name.
+ * @return     The column index, or FSCL_CSV_NO_COLUMN if not found.
+ */
+size_t fscl_csv_column_index(const ccsv* data, const char* name);
+
+/**
+ * Get the value of a cell by row index and header name.
+ *
+ * Row indices are the same as for fscl_csv_parser_getter, so the first data
+ * row of a table with a header is row 1.
+ *
+ * @param data Pointer to the ccsv structure.
+ * @param row  The row index of the cell.
+ * @param name The column name.
+ * @return     The cell value, or NULL if the row or column does not exist.
+ */
+const char* fscl_csv_get_by_name(const ccsv* data, size_t row, const char* name);
+
+// =================================================================
+// Column aggregation
+// =================================================================
+
+/**
+ * Convert a column to doubles for use with the aggregation kernels.
+ *
+ * The header row is skipped, and empty or non-numeric cells become NaN,
+ * which every kernel treats as null.
+ *
+ * @param data   Pointer to the ccsv structure.
+ * @param col    The column index.
+ * @param column Pointer to the ccsv_column to fill.
+ * @return       0 on success, non-zero on failure.
+ */
+int fscl_csv_column_load(const ccsv* data, size_t col, ccsv_column* column);
+
+/**
+ * Free the values of a converted column.
+ *
+ * @param column Pointer to the ccsv_column to be erased.
+ */
+void fscl_csv_column_erase(ccsv_column* column);
+
+/**
+ * Sum the non-null values of a column.
+ *
+ * @param column Pointer to the ccsv_column.
+ * @return       The sum, 0 for an empty column.
+ */
+double fscl_csv_column_sum(const ccsv_column* column);
+
+/**
+ * Find the smallest non-null value of a column.
+ *
+ * @param column Pointer to the ccsv_column.
+ * @return       The minimum, or NaN if the column has no values.
+ */
+double fscl_csv_column_min(const ccsv_column* column);
+
+/**
+ * Find the largest non-null value of a column.
+ *
+ * @param column Pointer to the ccsv_column.
+ * @return       The maximum, or NaN if the column has no values.
+ */
+double fscl_csv_column_max(const ccsv_column* column);
+
+/**
+ * Average the non-null values of a column.
+ *
+ * @param column Pointer to the ccsv_column.
+ * @return       The mean, or NaN if the column has no values.
+ */
+double fscl_csv_column_mean(const ccsv_column* column);
+
+/**
+ * Count the non-null values of a column.
+ *
+ * @param column Pointer to the ccsv_column.
+ * @return       The number of values that are not NaN.
+ */
+size_t fscl_csv_column_count(const ccsv_column* column);
+
+/**
+ * Build an equal-width histogram of the values in [low, high].
+ *
+ * Values outside the range and null values are not counted.
+ *
+ * @param column   Pointer to the ccsv_column.
+ * @param low      Lower bound of the first bin.
+ * @param high     Upper bound of the last bin (inclusive).
+ * @param bins     Array of num_bins counters, cleared before counting.
+ * @param num_bins Number of bins.
+ * @return         0 on success, non-zero on failure.
+ */
+int fscl_csv_column_histogram(const ccsv_column* column, double low, double high, size_t* bins, size_t num_bins);
+
+/**
+ * Group the rows of a table by a key column and aggregate a value column.
+ *
+ * Rows are split across num_threads workers that build partial groups,
+ * which are merged at the end. Groups appear in order of first occurrence.
+ *
+ * @param data        Pointer to the ccsv structure.
+ * @param key_col     The column holding the group keys.
+ * @param value_col   The column holding the values to aggregate.
+ * @param num_threads Number of worker threads (values below 1 use one).
+ * @param groups      Pointer to the ccsv_groups to fill.
+ * @return            0 on success, non-zero on failure.
+ */
+int fscl_csv_group_by(const ccsv* data, size_t key_col, size_t value_col, int num_threads, ccsv_groups* groups);
+
+/**
+ * Free the aggregates of a group-by.
+ *
+ * @param groups Pointer to the ccsv_groups to be erased.
+ */
+void fscl_csv_groups_erase(ccsv_groups* groups);
+
+// =================================================================
+// Streaming reader
+// =================================================================
+
+/**
+ * Create a streaming CSV reader on top of an open stream.
+ *
+ * The reader keeps only one chunk of input and one row in memory, so
+ * tables of any size can be processed row by row. The stream is not
+ * owned by the reader and must stay open until the reader is erased.
+ *
+ * @param stream Pointer to the open cstream to read from.
+ * @return       A pointer to the created ccsv_reader, or NULL on failure.
+ */
+ccsv_reader* fscl_csv_reader_create(cstream* stream);
+
+/**
+ * Erase a streaming CSV reader and free associated memory.
+ *
+ * @param reader Pointer to the ccsv_reader pointer to be erased.
+ */
+void fscl_csv_reader_erase(ccsv_reader** reader);
+
+/**
+ * Read the next row from the stream.
+ *
+ * Quoted fields (including embedded commas, newlines and doubled quotes)
+ * are supported and blank lines are skipped. The fields stored in row
+ * point into the reader and stay valid until the next call.
+ *
+ * @param reader Pointer to the ccsv_reader.
+ * @param row    Pointer to the ccsv_row receiving the fields.
+ * @return       1 if a row was read, 0 at end of input, -1 on failure.
+ */
+int fscl_csv_reader_next(ccsv_reader* reader, ccsv_row* row);
+
+// =================================================================
+// Buffered writer
+// =================================================================
+
+/**
+ * Create a buffered CSV writer on top of an open stream.
+ *
+ * Output is accumulated in memory and handed to fscl_stream_write in
+ * large batches. The stream is not owned by the writer.
+ *
+ * @param stream      Pointer to the open cstream to write to.
+ * @param buffer_size Size of the output buffer, or 0 for CSV_WRITER_BUFFER_SIZE.
+ *                    Smaller sizes are raised to CSV_WRITER_MIN_BUFFER_SIZE.
+ * @return            A pointer to the created ccsv_writer, or NULL on failure.
+ */
+ccsv_writer* fscl_csv_writer_create(cstream* stream, size_t buffer_size);
+
+/**
+ * Flush and erase a buffered CSV writer.
+ *
+ * @param writer Pointer to the ccsv_writer pointer to be erased.
+ */
+void fscl_csv_writer_erase(ccsv_writer** writer);
+
+/**
+ * Write a text field, quoting it only when it contains a comma, a quote
+ * or a line break.
+ *
+ * @param writer Pointer to the ccsv_writer.
+ * @param value  The field text (NULL writes an empty field).
+ * @return       0 on success, non-zero on failure.
+ */
+int fscl_csv_writer_field(ccsv_writer* writer, const char* value);
+
+/**
+ * Write an integer field.
+ *
+ * @param writer Pointer to the ccsv_writer.
+ * @param value  The value to be written.
+ * @return       0 on success, non-zero on failure.
+ */
+int fscl_csv_writer_field_int(ccsv_writer* writer, long long value);
+
+/**
+ * Write a floating point field with a fixed number of decimals.
+ *
+ * @param writer    Pointer to the ccsv_writer.
+ * @param value     The value to be written.
+ * @param precision Number of digits after the decimal point (0 to 9).
+ * @return          0 on success, non-zero on failure.
+ */
+int fscl_csv_writer_field_double(ccsv_writer* writer, double value, int precision);
+
+/**
+ * Terminate the current row.
+ *
+ * @param writer Pointer to the ccsv_writer.
+ * @return       0 on success, non-zero on failure.
+ */
+int fscl_csv_writer_end_row(ccsv_writer* writer);
+
+/**
+ * Write a complete row of text fields.
+ *
+ * @param writer     Pointer to the ccsv_writer.
+ * @param fields     Array of field texts.
+ * @param num_fields Number of fields in the array.
+ * @return           0 on success, non-zero on failure.
+ */
+int fscl_csv_writer_write_row(ccsv_writer* writer, const char* const* fields, size_t num_fields);
+
+/**
+ * Write every row of a parsed CSV table.
+ *
+ * @param writer Pointer to the ccsv_writer.
+ * @param data   Pointer to the ccsv structure to be written.
+ * @return       0 on success, non-zero on failure.
+ */
+int fscl_csv_writer_write_table(ccsv_writer* writer, const ccsv* data);
+
+/**
+ * Write all buffered output to the stream.
+ *
+ * @param writer Pointer to the ccsv_writer.
+ * @return       0 on success, non-zero on failure.
+ */
+int fscl_csv_writer_flush(ccsv_writer* writer);
+
 #ifdef __cplusplus
 }
 #endif
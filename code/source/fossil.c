@@ -11,6 +11,14 @@ Description:
 ==============================================================================
 */
 #include "fossil/xcore/fossil.h"
+#include "fossil/xcore/thread.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 // Global variables for custom names
 char OPEN_BRACE_KEYWORD = '{';
@@ -20,6 +28,12 @@ char* FUNCTION_KEYWORD = "fossil";
 // Global variable to track parse error
 static ParseError parseError = NO_ERRORS;
 
+enum {
+    FOSSIL_ARENA_BLOCK_SIZE = 65536,
+    FOSSIL_ARENA_ALIGNMENT  = 16,
+    FOSSIL_MIN_CHILDREN     = 4
+};
+
 // Function to convert an integer to a string
 char* fscl_fossil_itoa(int value) {
     // Determine the length of the string
@@ -69,70 +83,196 @@ void mark_error(ASTNode* node) {
     }
 }
 
-// Function to read the content of a DSL file
-char* fscl_fossil_read_dsl(const char* filename) {
-    FILE* file = fopen(filename, "r");
+// Read a whole file into a NUL-terminated buffer, or return NULL on failure
+static char* fossil_read_file(const char* filename, size_t* length) {
+    FILE* file = fopen(filename, "rb");
     if (file == NULL) {
-        perror("Error opening file");
-        exit(EXIT_FAILURE);
+        return NULL;
     }
 
     // Get the file size
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    long file_size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        file_size = ftell(file);
+    }
+    if (file_size < 0 || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return NULL;
+    }
 
     // Allocate memory to store the file content
-    char* content = (char*)malloc(file_size + 1);
+    char* content = (char*)malloc((size_t)file_size + 1);
     if (content == NULL) {
-        perror("Error allocating memory");
-        exit(EXIT_FAILURE);
+        fclose(file);
+        return NULL;
     }
 
     // Read the content of the file
-    size_t read_size = fread(content, 1, file_size, file);
+    size_t read_size = fread(content, 1, (size_t)file_size, file);
+    fclose(file);
     if (read_size != (size_t)file_size) {
-        perror("Error reading file");
-        exit(EXIT_FAILURE);
+        free(content);
+        return NULL;
     }
 
     // Null-terminate the content
     content[file_size] = '\0';
+    if (length != NULL) {
+        *length = (size_t)file_size;
+    }
+    return content;
+}
 
-    // Close the file
-    fclose(file);
-
+// Function to read the content of a DSL file
+char* fscl_fossil_read_dsl(const char* filename) {
+    char* content = fossil_read_file(filename, NULL);
+    if (content == NULL) {
+        perror("Error reading file");
+        exit(EXIT_FAILURE);
+    }
     return content;
 }
 
-// Function to create a new AST node
-ASTNode* fscl_fossil_create_node(NodeType type, DataType data_type, OperatorType operator_type, char* value) {
-    ASTNode* node = (ASTNode*)malloc(sizeof(ASTNode));
+// Function to create an arena
+fossil_arena* fscl_fossil_arena_create(size_t block_size) {
+    fossil_arena* arena = (fossil_arena*)malloc(sizeof(fossil_arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    arena->blocks = NULL;
+    arena->block_size = block_size > 0 ? block_size : FOSSIL_ARENA_BLOCK_SIZE;
+    arena->num_allocations = 0;
+    arena->num_adopted = 0;
+    arena->root = NULL;
+    return arena;
+}
+
+// Function to erase an arena and everything allocated from it
+void fscl_fossil_arena_erase(fossil_arena* arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    fossil_arena_block* block = arena->blocks;
+    while (block != NULL) {
+        fossil_arena_block* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(arena);
+}
+
+// Function to allocate memory from an arena
+void* fscl_fossil_arena_alloc(fossil_arena* arena, size_t size) {
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    size = (size + FOSSIL_ARENA_ALIGNMENT - 1) & ~(size_t)(FOSSIL_ARENA_ALIGNMENT - 1);
+    const size_t header = (sizeof(fossil_arena_block) + FOSSIL_ARENA_ALIGNMENT - 1) & ~(size_t)(FOSSIL_ARENA_ALIGNMENT - 1);
+
+    fossil_arena_block* block = arena->blocks;
+    if (block == NULL || block->size - block->used < size) {
+        // Oversized requests get a block of their own
+        size_t capacity = size > arena->block_size ? size : arena->block_size;
+        block = (fossil_arena_block*)malloc(header + capacity);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->size = capacity;
+        block->used = 0;
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    void* memory = (char*)block + header + block->used;
+    block->used += size;
+    arena->num_allocations++;
+    return memory;
+}
+
+// Function to copy a string into an arena
+char* fscl_fossil_arena_strndup(fossil_arena* arena, const char* str, size_t length) {
+    char* copy = (char*)fscl_fossil_arena_alloc(arena, length + 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+// Create a node on the heap or in an arena
+static ASTNode* fossil_new_node(fossil_arena* arena, NodeType type, DataType data_type, OperatorType operator_type, char* value) {
+    ASTNode* node = arena != NULL ? (ASTNode*)fscl_fossil_arena_alloc(arena, sizeof(ASTNode)) : (ASTNode*)malloc(sizeof(ASTNode));
     if (node == NULL) {
         // Handle memory allocation error
         exit(EXIT_FAILURE);
     }
 
+    memset(node, 0, sizeof(ASTNode));
     node->type = type;
     node->data_type = data_type;
     node->operator_type = operator_type;
     node->value = value;
-    node->error_flag = 0;
-    node->num_children = 0;
+    node->arena = arena;
+    node->source_offset = FOSSIL_NO_SOURCE_OFFSET;
 
-    if (type == PLACEHOLDER_NODE) {
-        // Special handling for placeholder nodes
-        // You might customize this based on how you want to represent placeholders
-    } else {
-        // For other node types, create space for children
-        node->children = (ASTNode**)malloc(sizeof(ASTNode*));
-        if (node->children == NULL) {
-            // Handle memory allocation error
-            exit(EXIT_FAILURE);
+    return node;
+}
+
+// Copy a span of the code into the arena (or the heap)
+static char* fossil_copy_span(fossil_arena* arena, const char* str, size_t length) {
+    if (arena != NULL) {
+        return fscl_fossil_arena_strndup(arena, str, length);
+    }
+
+    char* copy = (char*)malloc(length + 1);
+    if (copy != NULL) {
+        memcpy(copy, str, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+// Function to create a new AST node
+ASTNode* fscl_fossil_create_node(NodeType type, DataType data_type, OperatorType operator_type, char* value) {
+    return fossil_new_node(NULL, type, data_type, operator_type, value);
+}
+
+// Function to create a new AST node in an arena
+ASTNode* fscl_fossil_arena_create_node(fossil_arena* arena, NodeType type, DataType data_type, OperatorType operator_type, char* value) {
+    if (arena == NULL) {
+        return NULL;
+    }
+    return fossil_new_node(arena, type, data_type, operator_type, value);
+}
+
+// Append to a node pointer array whose capacity doubles at powers of two
+static int fossil_push_node(fossil_arena* arena, ASTNode*** items, size_t count, ASTNode* item) {
+    if (*items == NULL || (count >= FOSSIL_MIN_CHILDREN && (count & (count - 1)) == 0)) {
+        size_t capacity = count < FOSSIL_MIN_CHILDREN ? FOSSIL_MIN_CHILDREN : count * 2;
+        ASTNode** grown;
+        if (arena != NULL) {
+            // The old array stays in the arena and is reclaimed with it
+            grown = (ASTNode**)fscl_fossil_arena_alloc(arena, capacity * sizeof(ASTNode*));
+            if (grown != NULL && count > 0) {
+                memcpy(grown, *items, count * sizeof(ASTNode*));
+            }
+        } else {
+            grown = (ASTNode**)realloc(*items, capacity * sizeof(ASTNode*));
         }
+        if (grown == NULL) {
+            return 0;
+        }
+        *items = grown;
     }
 
-    return node;
+    (*items)[count] = item;
+    return 1;
 }
 
 // Function to add a child to an AST node
@@ -143,15 +283,18 @@ void fscl_fossil_add_child(ASTNode* parent, ASTNode* child) {
         return;
     }
 
-    parent->children = (ASTNode**)realloc(parent->children, (parent->num_children + 1) * sizeof(ASTNode*));
-    if (parent->children == NULL) {
+    if (!fossil_push_node(parent->arena, &parent->children, parent->num_children, child)) {
         // Handle memory allocation error
         mark_error(parent);
         return;
     }
 
-    parent->children[parent->num_children] = child;
     parent->num_children++;
+
+    // Heap children of arena nodes are freed when the arena is erased
+    if (parent->arena != NULL && child->arena == NULL) {
+        parent->arena->num_adopted++;
+    }
 }
 
 // Function to add multiple children to an AST node
@@ -167,23 +310,460 @@ void fscl_fossil_add_children(ASTNode* parent, size_t num_children, ...) {
     va_end(args);
 }
 
+// Node of a depth-first walk and the index of its next child
+typedef struct {
+    ASTNode* node;
+    size_t next;
+} fossil_walk_frame;
+
+enum {
+    FOSSIL_WALK_INLINE = 64   // Frames kept on the C stack before the heap
+};
+
+// Function to walk a tree depth-first without recursion
+int fscl_fossil_visit(ASTNode* root, fossil_ast_visitor enter, fossil_ast_visitor leave, void* user_data) {
+    if (root == NULL) {
+        return 0;
+    }
+
+    // The frames hold the path from the root, so their count is the depth
+    fossil_walk_frame inline_frames[FOSSIL_WALK_INLINE];
+    fossil_walk_frame* frames = inline_frames;
+    size_t capacity = FOSSIL_WALK_INLINE;
+    size_t depth = 0;
+    int result = 0;
+
+    ASTNode* node = root;
+    while (node != NULL) {
+        // Enter the node and push it unless it is skipped
+        int action = enter != NULL ? enter(node, depth, user_data) : FOSSIL_VISIT_CONTINUE;
+        if (action == FOSSIL_VISIT_STOP) {
+            result = 1;
+            break;
+        }
+
+        if (action != FOSSIL_VISIT_SKIP) {
+            if (depth == capacity) {
+                capacity *= 2;
+                fossil_walk_frame* grown = frames == inline_frames ? (fossil_walk_frame*)malloc(capacity * sizeof(fossil_walk_frame))
+                                                                  : (fossil_walk_frame*)realloc(frames, capacity * sizeof(fossil_walk_frame));
+                if (grown == NULL) {
+                    result = -1;
+                    break;
+                }
+                if (frames == inline_frames) {
+                    memcpy(grown, inline_frames, sizeof(inline_frames));
+                }
+                frames = grown;
+            }
+            frames[depth].node = node;
+            frames[depth].next = 0;
+            depth++;
+        }
+
+        // Leave every finished node on the way back up, then move to the
+        // next child of the nearest unfinished one
+        node = NULL;
+        while (depth > 0) {
+            fossil_walk_frame* top = &frames[depth - 1];
+            if (top->next < top->node->num_children) {
+                // Children cut out by a pass leave a NULL behind
+                node = top->node->children[top->next++];
+                if (node == NULL) {
+                    continue;
+                }
+                break;
+            }
+
+            ASTNode* finished = top->node;
+            depth--;
+            if (leave != NULL && leave(finished, depth, user_data) == FOSSIL_VISIT_STOP) {
+                result = 1;
+                break;
+            }
+        }
+        if (result != 0) {
+            break;
+        }
+    }
+
+    if (frames != inline_frames) {
+        free(frames);
+    }
+    return result;
+}
+
+// Function to walk a tree in pre-order
+int fscl_fossil_visit_preorder(ASTNode* root, fossil_ast_visitor visitor, void* user_data) {
+    return fscl_fossil_visit(root, visitor, NULL, user_data);
+}
+
+// Function to walk a tree in post-order
+int fscl_fossil_visit_postorder(ASTNode* root, fossil_ast_visitor visitor, void* user_data) {
+    return fscl_fossil_visit(root, NULL, visitor, user_data);
+}
+
+// Node waiting in a level-order walk
+typedef struct {
+    ASTNode* node;
+    size_t depth;
+} fossil_walk_entry;
+
+// Function to walk a tree in level order
+int fscl_fossil_visit_level_order(ASTNode* root, fossil_ast_visitor visitor, void* user_data) {
+    if (root == NULL || visitor == NULL) {
+        return 0;
+    }
+
+    size_t capacity = FOSSIL_WALK_INLINE;
+    fossil_walk_entry* queue = (fossil_walk_entry*)malloc(capacity * sizeof(fossil_walk_entry));
+    if (queue == NULL) {
+        return -1;
+    }
+
+    size_t head = 0;
+    size_t tail = 0;
+    queue[tail].node = root;
+    queue[tail].depth = 0;
+    tail++;
+
+    int result = 0;
+    while (head < tail) {
+        fossil_walk_entry entry = queue[head++];
+        int action = visitor(entry.node, entry.depth, user_data);
+        if (action == FOSSIL_VISIT_STOP) {
+            result = 1;
+            break;
+        }
+        if (action == FOSSIL_VISIT_SKIP || entry.node->num_children == 0) {
+            continue;
+        }
+
+        // Reuse the visited front of the queue before growing it
+        size_t needed = tail - head + entry.node->num_children;
+        if (tail + entry.node->num_children > capacity && head > 0) {
+            memmove(queue, queue + head, (tail - head) * sizeof(fossil_walk_entry));
+            tail -= head;
+            head = 0;
+        }
+        if (needed > capacity) {
+            while (capacity < needed) {
+                capacity *= 2;
+            }
+            fossil_walk_entry* grown = (fossil_walk_entry*)realloc(queue, capacity * sizeof(fossil_walk_entry));
+            if (grown == NULL) {
+                result = -1;
+                break;
+            }
+            queue = grown;
+        }
+
+        for (size_t i = 0; i < entry.node->num_children; ++i) {
+            queue[tail].node = entry.node->children[i];
+            queue[tail].depth = entry.depth + 1;
+            tail++;
+        }
+    }
+
+    free(queue);
+    return result;
+}
+
+// Growable text used to format values and dumps
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} fossil_text;
+
+// Append bytes to a text
+static int fossil_text_append(fossil_text* text, const char* data, size_t length) {
+    if (text->length + length + 1 > text->capacity) {
+        size_t capacity = text->capacity == 0 ? 128 : text->capacity;
+        while (capacity < text->length + length + 1) {
+            capacity *= 2;
+        }
+        char* grown = (char*)realloc(text->data, capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        text->data = grown;
+        text->capacity = capacity;
+    }
+    memcpy(text->data + text->length, data, length);
+    text->length += length;
+    text->data[text->length] = '\0';
+    return 0;
+}
+
+static const char* const fossil_node_type_names[] = {
+    "MAIN_FUNCTION_TYPE", "CLASS_DECLARATION_TYPE", "METHOD_DECLARATION_TYPE", "IDENTIFIER_TYPE",
+    "PRINT_STATEMENT_TYPE", "STRING_LITERAL_TYPE", "LINK_STATEMENT_TYPE", "IMPORT_STATEMENT_TYPE",
+    "TAPE_PROGRAM_TYPE", "PROJECT_STATEMENT_TYPE", "STATEMENT_TYPE", "ACTION_STATEMENT_TYPE",
+    "VARIABLE", "CONSTANT", "FUNCTION", "CLASS", "STRUCT", "UNARY_OP", "RELATIONAL_OP", "LOGICAL_OP",
+    "IF_STATEMENT", "WHILE_LOOP", "INCLUDE_FILE", "LINK_LIBRARY", "PLACEHOLDER_NODE", "PUBLIC", "PRIVATE",
+    "INHERITANCE", "ENCAPSULATION", "BLOCK_STATEMENT", "ASSIGNMENT", "RETURN_STATEMENT", "BINARY_OP",
+    "CALL_EXPRESSION", "ARRAY_LITERAL"
+};
+
+// Spelled as in the DSL, so names map back through fscl_fossil_data_type_from_span
+static const char* const fossil_data_type_names[] = {
+    "int", "int8", "int16", "int32", "int64", "uint", "uint8", "uint16", "uint32", "uint64",
+    "float", "string", "array", "map", "bool", "tofu", "char", "hex", "oct", "null",
+    "placeholder", "datetime", "comedy", "error"
+};
+
+static const char* const fossil_operator_names[] = {
+    "ADD", "SUBTRACT", "MULTIPLY", "DIVIDE", "NEGATION", "INCREMENT", "DECREMENT", "EQUALS",
+    "NOT_EQUALS", "LESS_THAN", "GREATER_THAN", "AND", "OR", "MODULO", "NOT", "LESS_EQUAL", "GREATER_EQUAL"
+};
+
+#define FOSSIL_NAME_COUNT(names) (sizeof(names) / sizeof((names)[0]))
+
+// Function to get the symbolic name of a node type
+const char* fscl_fossil_node_type_name(NodeType type) {
+    return (size_t)type < FOSSIL_NAME_COUNT(fossil_node_type_names) ? fossil_node_type_names[type] : "UNKNOWN";
+}
+
+// Function to get the DSL name of a data type
+const char* fscl_fossil_data_type_name(DataType type) {
+    return (size_t)type < FOSSIL_NAME_COUNT(fossil_data_type_names) ? fossil_data_type_names[type] : "unknown";
+}
+
+// Function to get the symbolic name of an operator
+const char* fscl_fossil_operator_name(OperatorType op) {
+    return (size_t)op < FOSSIL_NAME_COUNT(fossil_operator_names) ? fossil_operator_names[op] : "UNKNOWN";
+}
+
+// State of a dump in progress
+typedef struct {
+    fossil_text text;
+    fossil_dump_format format;
+    size_t base_depth;
+    int failed;
+} fossil_dump;
+
+static void fossil_dump_write(fossil_dump* dump, const char* data, size_t length) {
+    if (!dump->failed && fossil_text_append(&dump->text, data, length) != 0) {
+        dump->failed = 1;
+    }
+}
+
+static void fossil_dump_string(fossil_dump* dump, const char* str) {
+    fossil_dump_write(dump, str, strlen(str));
+}
+
+// Append a quoted string, escaping what JSON and S-expressions require
+static void fossil_dump_quoted(fossil_dump* dump, const char* str) {
+    fossil_dump_write(dump, "\"", 1);
+    const char* run = str;
+    for (const char* c = str; *c != '\0'; ++c) {
+        unsigned char ch = (unsigned char)*c;
+        if (ch != '"' && ch != '\\' && ch >= 0x20) {
+            continue;
+        }
+
+        // Copy the plain run before the character in one go
+        fossil_dump_write(dump, run, (size_t)(c - run));
+        run = c + 1;
+        char escape[8];
+        switch (ch) {
+            case '"':  fossil_dump_write(dump, "\\\"", 2); break;
+            case '\\': fossil_dump_write(dump, "\\\\", 2); break;
+            case '\n': fossil_dump_write(dump, "\\n", 2); break;
+            case '\t': fossil_dump_write(dump, "\\t", 2); break;
+            case '\r': fossil_dump_write(dump, "\\r", 2); break;
+            default:
+                snprintf(escape, sizeof(escape), "\\u%04x", ch);
+                fossil_dump_write(dump, escape, 6);
+                break;
+        }
+    }
+    fossil_dump_write(dump, run, strlen(run));
+    fossil_dump_write(dump, "\"", 1);
+}
+
+// Whether the operator of a node type is meaningful
+static int fossil_has_operator(NodeType type) {
+    return type == UNARY_OP || type == BINARY_OP || type == RELATIONAL_OP || type == LOGICAL_OP;
+}
+
+// Open a node: a whole line of text, or the head of a JSON object or list
+static int fossil_dump_enter(ASTNode* node, size_t depth, void* user_data) {
+    fossil_dump* dump = (fossil_dump*)user_data;
+    if (node->error_flag) {
+        return FOSSIL_VISIT_SKIP;
+    }
+
+    switch (dump->format) {
+        case FOSSIL_DUMP_TEXT: {
+            static const char spaces[] = "                                                                ";
+            size_t indent = 2 * (dump->base_depth + depth);
+            while (indent > 0) {
+                size_t chunk = indent < sizeof(spaces) - 1 ? indent : sizeof(spaces) - 1;
+                fossil_dump_write(dump, spaces, chunk);
+                indent -= chunk;
+            }
+            fossil_dump_write(dump, "Type: ", 6);
+            fossil_dump_string(dump, fscl_fossil_node_type_name(node->type));
+            fossil_dump_write(dump, ", Data Type: ", 13);
+            fossil_dump_string(dump, fscl_fossil_data_type_name(node->data_type));
+            fossil_dump_write(dump, ", Operator Type: ", 17);
+            fossil_dump_string(dump, fscl_fossil_operator_name(node->operator_type));
+            fossil_dump_write(dump, ", Value: ", 9);
+            fossil_dump_string(dump, node->value != NULL ? node->value : "(null)");
+            fossil_dump_write(dump, "\n", 1);
+            break;
+        }
+        case FOSSIL_DUMP_JSON:
+            // Siblings are separated unless this is the first child
+            if (depth > 0 && dump->text.data[dump->text.length - 1] != '[') {
+                fossil_dump_write(dump, ",", 1);
+            }
+            fossil_dump_write(dump, "{\"type\":\"", 9);
+            fossil_dump_string(dump, fscl_fossil_node_type_name(node->type));
+            fossil_dump_write(dump, "\",\"data_type\":\"", 15);
+            fossil_dump_string(dump, fscl_fossil_data_type_name(node->data_type));
+            if (fossil_has_operator(node->type)) {
+                fossil_dump_write(dump, "\",\"operator\":\"", 14);
+                fossil_dump_string(dump, fscl_fossil_operator_name(node->operator_type));
+            }
+            fossil_dump_write(dump, "\",\"value\":", 10);
+            if (node->value != NULL) {
+                fossil_dump_quoted(dump, node->value);
+            } else {
+                fossil_dump_write(dump, "null", 4);
+            }
+            fossil_dump_write(dump, ",\"children\":[", 13);
+            break;
+        case FOSSIL_DUMP_SEXPR:
+            fossil_dump_write(dump, depth > 0 ? " (" : "(", depth > 0 ? 2 : 1);
+            fossil_dump_string(dump, fscl_fossil_node_type_name(node->type));
+            fossil_dump_write(dump, " ", 1);
+            fossil_dump_string(dump, fscl_fossil_data_type_name(node->data_type));
+            if (fossil_has_operator(node->type)) {
+                fossil_dump_write(dump, " ", 1);
+                fossil_dump_string(dump, fscl_fossil_operator_name(node->operator_type));
+            }
+            if (node->value != NULL) {
+                fossil_dump_write(dump, " ", 1);
+                fossil_dump_quoted(dump, node->value);
+            }
+            break;
+    }
+    return dump->failed ? FOSSIL_VISIT_STOP : FOSSIL_VISIT_CONTINUE;
+}
+
+// Close a node opened by fossil_dump_enter
+static int fossil_dump_leave(ASTNode* node, size_t depth, void* user_data) {
+    fossil_dump* dump = (fossil_dump*)user_data;
+    (void)node;
+    (void)depth;
+    if (dump->format == FOSSIL_DUMP_JSON) {
+        fossil_dump_write(dump, "]}", 2);
+    } else if (dump->format == FOSSIL_DUMP_SEXPR) {
+        fossil_dump_write(dump, ")", 1);
+    }
+    return dump->failed ? FOSSIL_VISIT_STOP : FOSSIL_VISIT_CONTINUE;
+}
+
+// Render a tree into a fresh text
+static int fossil_dump_render(ASTNode* root, fossil_dump_format format, size_t base_depth, fossil_text* text) {
+    fossil_dump dump;
+    memset(&dump, 0, sizeof(dump));
+    dump.format = format;
+    dump.base_depth = base_depth;
+
+    // Start with an empty string so the result is valid even for no nodes
+    fossil_dump_write(&dump, "", 0);
+    if (root != NULL && fscl_fossil_visit(root, fossil_dump_enter, fossil_dump_leave, &dump) != 0) {
+        dump.failed = 1;
+    }
+    if (format != FOSSIL_DUMP_TEXT && dump.text.length > 0) {
+        fossil_dump_write(&dump, "\n", 1);
+    }
+
+    if (dump.failed) {
+        free(dump.text.data);
+        return -1;
+    }
+    *text = dump.text;
+    return 0;
+}
+
+// Function to render a tree into a string
+char* fscl_fossil_dump_ast(ASTNode* root, fossil_dump_format format, size_t* length) {
+    fossil_text text;
+    if (fossil_dump_render(root, format, 0, &text) != 0) {
+        return NULL;
+    }
+    if (length != NULL) {
+        *length = text.length;
+    }
+    return text.data;
+}
+
+// Function to render a tree and write it with a single call
+int fscl_fossil_write_ast(ASTNode* root, fossil_dump_format format, FILE* file) {
+    fossil_text text;
+    if (file == NULL || fossil_dump_render(root, format, 0, &text) != 0) {
+        return -1;
+    }
+    int result = fwrite(text.data, 1, text.length, file) == text.length ? 0 : -1;
+    free(text.data);
+    return result;
+}
+
 // Function to print the AST in a readable format
 void fscl_fossil_print_ast(ASTNode* root, int depth) {
-    if (root == NULL || root->error_flag) {
+    fossil_text text;
+    if (root == NULL || fossil_dump_render(root, FOSSIL_DUMP_TEXT, depth > 0 ? (size_t)depth : 0, &text) != 0) {
         return;
     }
+    fwrite(text.data, 1, text.length, stdout);
+    free(text.data);
+}
 
-    // Print the current node
-    for (int i = 0; i < depth; ++i) {
-        printf("  ");
+// Erase the heap subtrees hanging below the nodes of one arena
+static int fossil_erase_adopted(ASTNode* node, size_t depth, void* user_data) {
+    (void)depth;
+    if (node->arena == (fossil_arena*)user_data) {
+        return FOSSIL_VISIT_CONTINUE;
     }
+    if (node->arena == NULL) {
+        fscl_fossil_erase_node(node);
+    }
+    return FOSSIL_VISIT_SKIP;
+}
 
-    printf("Type: %d, Data Type: %d, Operator Type: %d, Value: %s\n", root->type, root->data_type, root->operator_type, root->value);
+// Arena nodes are released all at once through the arena root, so the
+// walk only descends into an arena tree to find heap children added to it
+static int fossil_erase_enter(ASTNode* node, size_t depth, void* user_data) {
+    (void)depth;
+    (void)user_data;
+    if (node->arena != NULL) {
+        if (node->arena->root == node) {
+            if (node->arena->num_adopted > 0) {
+                fscl_fossil_visit(node, fossil_erase_adopted, NULL, node->arena);
+            }
+            fscl_fossil_arena_erase(node->arena);
+        }
+        return FOSSIL_VISIT_SKIP;
+    }
+    return FOSSIL_VISIT_CONTINUE;
+}
 
-    // Recursively print children
-    for (size_t i = 0; i < root->num_children; ++i) {
-        fscl_fossil_print_ast(root->children[i], depth + 1);
+// Heap nodes are freed once their children are gone
+static int fossil_erase_leave(ASTNode* node, size_t depth, void* user_data) {
+    (void)depth;
+    (void)user_data;
+    if (node->arena == NULL) {
+        free(node->children);
+        free(node->public_members);
+        free(node->private_members);
+        free(node);
     }
+    return FOSSIL_VISIT_CONTINUE;
 }
 
 // Function to erase an AST node and its children
@@ -192,12 +772,7 @@ void fscl_fossil_erase_node(ASTNode* node) {
         return;
     }
 
-    for (size_t i = 0; i < node->num_children; ++i) {
-        fscl_fossil_erase_node(node->children[i]);
-    }
-
-    free(node->children);
-    free(node);
+    fscl_fossil_visit(node, fossil_erase_enter, fossil_erase_leave, NULL);
 }
 
 // Function to create a new variable node with visibility
@@ -291,328 +866,7008 @@ void fscl_fossil_skip_whitespace(const char* code, size_t* index) {
     }
 }
 
-// Function to parse an identifier in the code
-char* fscl_fossil_parse_identifier(const char* code, size_t* index) {
-    // Implementation of identifier parsing logic
-    // Adjust based on your DSL syntax
+// Parse an identifier, copying it into the arena (or the heap)
+static char* fossil_parse_identifier_in(fossil_arena* arena, const char* code, size_t* index) {
     // For simplicity, assuming an identifier is a sequence of letters and digits
-
     size_t start = *index;
     while (isalnum(code[*index]) || code[*index] == '_') {
         (*index)++;
     }
 
-    // Create a copy of the identifier
-    char* identifier = fscl_fossil_strdup(code + start);
-
-    return identifier;
+    // Create a copy of the identifier only
+    return fossil_copy_span(arena, code + start, *index - start);
 }
 
-// Function to parse a data type in the code
-DataType fscl_fossil_parse_data_type(const char* code, size_t* index) {
-    // Skip whitespace
-    fscl_fossil_skip_whitespace(code, index);
+// Function to parse an identifier in the code
+char* fscl_fossil_parse_identifier(const char* code, size_t* index) {
+    return fossil_parse_identifier_in(NULL, code, index);
+}
 
-    // Parse the identifier (assumed to represent the data type)
-    char* dataTypeString = fscl_fossil_parse_identifier(code, index);
-
-    // Convert the data type string to the corresponding enumeration
-    DataType dataType = FOSSIL_ERROR;  // Default to ERROR
-
-    // Map data type string to the enumeration
-    if (strcmp(dataTypeString, "int") == 0) {
-        dataType = FOSSIL_INT;
-    } else if (strcmp(dataTypeString, "int8") == 0) {
-        dataType = FOSSIL_INT8;
-    } else if (strcmp(dataTypeString, "int16") == 0) {
-        dataType = FOSSIL_INT16;
-    } else if (strcmp(dataTypeString, "int32") == 0) {
-        dataType = FOSSIL_INT32;
-    } else if (strcmp(dataTypeString, "int64") == 0) {
-        dataType = FOSSIL_INT64;
-    } else if (strcmp(dataTypeString, "uint") == 0) {
-        dataType = FOSSIL_UINT;
-    } else if (strcmp(dataTypeString, "uint8") == 0) {
-        dataType = FOSSIL_UINT8;
-    } else if (strcmp(dataTypeString, "uint16") == 0) {
-        dataType = FOSSIL_UINT16;
-    } else if (strcmp(dataTypeString, "uint32") == 0) {
-        dataType = FOSSIL_UINT32;
-    } else if (strcmp(dataTypeString, "uint64") == 0) {
-        dataType = FOSSIL_UINT64;
-    } else if (strcmp(dataTypeString, "float") == 0) {
-        dataType = FOSSIL_FLOAT;
-    } else if (strcmp(dataTypeString, "string") == 0) {
-        dataType = FOSSIL_STRING;
-    } else if (strcmp(dataTypeString, "array") == 0) {
-        dataType = FOSSIL_ARRAY;
-    } else if (strcmp(dataTypeString, "map") == 0) {
-        dataType = FOSSIL_MAP;
-    } else if (strcmp(dataTypeString, "bool") == 0) {
-        dataType = FOSSIL_BOOL;
-    } else if (strcmp(dataTypeString, "tofu") == 0) {
-        dataType = FOSSIL_TOFU;
-    } else if (strcmp(dataTypeString, "char") == 0) {
-        dataType = FOSSIL_CHAR;
-    } else if (strcmp(dataTypeString, "hex") == 0) {
-        dataType = FOSSIL_HEX;
-    } else if (strcmp(dataTypeString, "oct") == 0) {
-        dataType = FOSSIL_OCT;
-    } else if (strcmp(dataTypeString, "null") == 0) {
-        dataType = FOSSIL_NULL_TYPE;
-    } else if (strcmp(dataTypeString, "comedy") == 0) {
-        dataType = FOSSIL_COMEDY_ERROR;
-    } else if (strcmp(dataTypeString, "placeholder") == 0) {
-        dataType = FOSSIL_PLACEHOLDER;
-    } else if (strcmp(dataTypeString, "datetime") == 0) {
-        dataType = FOSSIL_DATETIME;
-    } else {
-        // If the type is not recognized, set it to ERROR
+// Function to map a type name span to a data type without allocating
+DataType fscl_fossil_data_type_from_span(const char* text, size_t length) {
+    if (text == NULL) {
+        return FOSSIL_ERROR;
     }
 
-    free(dataTypeString);  // Free the memory allocated for the data type string
-
-    return dataType;
-}
+    // Dispatch on length and first character, then confirm with one compare
+#define FOSSIL_TYPE_MATCH(name, type) \
+    if (memcmp(text, name, length) == 0) { return type; }
 
-// Function to parse a statement into ASTNode
-ASTNode* fscl_fossil_parse_statement(const char* statement) {
-    // Implementation of statement parsing logic
-    // Adjust based on your DSL syntax
+    switch (length) {
+        case 3:
+            switch (text[0]) {
+                case 'i': FOSSIL_TYPE_MATCH("int", FOSSIL_INT); break;
+                case 'h': FOSSIL_TYPE_MATCH("hex", FOSSIL_HEX); break;
+                case 'o': FOSSIL_TYPE_MATCH("oct", FOSSIL_OCT); break;
+                case 'm': FOSSIL_TYPE_MATCH("map", FOSSIL_MAP); break;
+                default: break;
+            }
+            break;
+        case 4:
+            switch (text[0]) {
+                case 'i': FOSSIL_TYPE_MATCH("int8", FOSSIL_INT8); break;
+                case 'u': FOSSIL_TYPE_MATCH("uint", FOSSIL_UINT); break;
+                case 'b': FOSSIL_TYPE_MATCH("bool", FOSSIL_BOOL); break;
+                case 't': FOSSIL_TYPE_MATCH("tofu", FOSSIL_TOFU); break;
+                case 'c': FOSSIL_TYPE_MATCH("char", FOSSIL_CHAR); break;
+                case 'n': FOSSIL_TYPE_MATCH("null", FOSSIL_NULL_TYPE); break;
+                default: break;
+            }
+            break;
+        case 5:
+            switch (text[0]) {
+                case 'i':
+                    FOSSIL_TYPE_MATCH("int16", FOSSIL_INT16);
+                    FOSSIL_TYPE_MATCH("int32", FOSSIL_INT32);
+                    FOSSIL_TYPE_MATCH("int64", FOSSIL_INT64);
+                    break;
+                case 'u': FOSSIL_TYPE_MATCH("uint8", FOSSIL_UINT8); break;
+                case 'f': FOSSIL_TYPE_MATCH("float", FOSSIL_FLOAT); break;
+                case 'a': FOSSIL_TYPE_MATCH("array", FOSSIL_ARRAY); break;
+                default: break;
+            }
+            break;
+        case 6:
+            switch (text[0]) {
+                case 'u':
+                    FOSSIL_TYPE_MATCH("uint16", FOSSIL_UINT16);
+                    FOSSIL_TYPE_MATCH("uint32", FOSSIL_UINT32);
+                    FOSSIL_TYPE_MATCH("uint64", FOSSIL_UINT64);
+                    break;
+                case 's': FOSSIL_TYPE_MATCH("string", FOSSIL_STRING); break;
+                case 'c': FOSSIL_TYPE_MATCH("comedy", FOSSIL_COMEDY_ERROR); break;
+                default: break;
+            }
+            break;
+        case 8:
+            FOSSIL_TYPE_MATCH("datetime", FOSSIL_DATETIME);
+            break;
+        case 11:
+            FOSSIL_TYPE_MATCH("placeholder", FOSSIL_PLACEHOLDER);
+            break;
+        default:
+            break;
+    }
 
-    // For this example, return a dummy ASTNode
-    ASTNode* statementNode = (ASTNode*)malloc(sizeof(ASTNode));
-    statementNode->type = VARIABLE;
-    statementNode->value = fscl_fossil_strdup(statement);
-    // Initialize other fields as needed
+#undef FOSSIL_TYPE_MATCH
 
-    return statementNode;
+    // If the type is not recognized, set it to ERROR
+    return FOSSIL_ERROR;
 }
 
-// Function to parse a function declaration
-ASTNode* fscl_fossil_parse_function_declaration(const char* code, size_t* index, const char* entryPoint) {
+// Function to parse a data type in the code
+DataType fscl_fossil_parse_data_type(const char* code, size_t* index) {
     // Skip whitespace
     fscl_fossil_skip_whitespace(code, index);
 
-    // Parse function name
-    char* functionName = fscl_fossil_parse_identifier(code, index);
-
-    // Create function node
-    ASTNode* functionNode = fscl_fossil_create_function(FOSSIL_TOFU, functionName);
-
-    // Parse function parameters
-    if (code[*index] == '(') {
-        (*index)++;  // Move past '('
-
-        // Parse each parameter
-        while (code[*index] != ')' && code[*index] != '\0') {
-            // Parse parameter type
-            DataType paramType = fscl_fossil_parse_data_type(code, index);
-
-            // Parse parameter name
-            char* paramName = fscl_fossil_parse_identifier(code, index);
-
-            // Create parameter node
-            ASTNode* paramNode = fscl_fossil_create_variable_with_visibility(paramType, paramName, 0);
+    // The identifier (assumed to represent the data type) is matched in place
+    size_t start = *index;
+    while (isalnum((unsigned char)code[*index]) || code[*index] == '_') {
+        (*index)++;
+    }
 
-            // Check for default value
-            if (code[*index] == '=') {
-                (*index)++;  // Move past '='
+    return fscl_fossil_data_type_from_span(code + start, *index - start);
+}
 
-                // Parse default value (assuming integers for simplicity)
-                int defaultValue = strtol(code + *index, NULL, 10);
-                // You might need a more sophisticated way to parse default values based on your DSL
+// Function to create a new class node with details
+ASTNode* fscl_fossil_create_class(char* class_name) {
+    ASTNode* classNode = fscl_fossil_create_node(CLASS, FOSSIL_TOFU, ADD, class_name);
+    
+    // Initialize class-specific details
+    classNode->public_members = NULL;
+    classNode->private_members = NULL;
+    classNode->num_public_members = 0;
+    classNode->num_private_members = 0;
 
-                // Create a constant node for the default value
-                ASTNode* defaultValueNode = fscl_fossil_create_constant(FOSSIL_INT8, fscl_fossil_itoa(defaultValue));
-                fscl_fossil_add_child(paramNode, defaultValueNode);
+    return classNode;
+}
 
-                // Skip the default value in the code
-                while (isdigit(code[*index])) {
-                    (*index)++;
-                }
-            }
+// Function to add a member to a class with visibility and details
+void fscl_fossil_add_class_member(ASTNode* classNode, ASTNode* member, int is_public) {
+    if (classNode == NULL || member == NULL || classNode->error_flag || member->error_flag) {
+        mark_error(classNode);
+        mark_error(member);
+        return;
+    }
 
-            // Add parameter node to function node
-            fscl_fossil_add_child(functionNode, paramNode);
+    member->is_public = is_public;
+    fscl_fossil_add_child(classNode, member);
 
-            // Skip whitespace and check for a comma (,)
-            fscl_fossil_skip_whitespace(code, index);
-            if (code[*index] == ',') {
-                (*index)++;  // Move past ','
-                fscl_fossil_skip_whitespace(code, index);
-            }
+    // Add the member to the appropriate list based on visibility
+    if (is_public) {
+        if (fossil_push_node(classNode->arena, &classNode->public_members, classNode->num_public_members, member)) {
+            classNode->num_public_members++;
+        }
+    } else {
+        if (fossil_push_node(classNode->arena, &classNode->private_members, classNode->num_private_members, member)) {
+            classNode->num_private_members++;
         }
+    }
+}
 
-        // Skip closing parenthesis ')'
-        if (code[*index] == ')') {
-            (*index)++;
-        } else {
-            // Handle error: Missing closing parenthesis
-            mark_error(functionNode);
-            printf("Error: Missing closing parenthesis in function declaration.\n");
+// =================================================================
+// Lexer
+// =================================================================
+
+// Configurable keywords of one lex, so the globals are read only once
+typedef struct {
+    char open_brace;
+    char close_brace;
+    const char* function;
+} fossil_keywords;
+
+// Keywords currently set through the globals
+static fossil_keywords fossil_global_keywords(void) {
+    fossil_keywords keywords = {OPEN_BRACE_KEYWORD, CLOSE_BRACE_KEYWORD, FUNCTION_KEYWORD};
+    return keywords;
+}
+
+// Classify an identifier span as a keyword or a plain identifier
+static fossil_token_kind fossil_keyword_kind(const fossil_keywords* keywords, const char* text, size_t length) {
+    // The function keyword can be renamed, so it is checked first
+    const char* function = keywords->function;
+    if (function != NULL && text[0] == function[0] && strncmp(text, function, length) == 0 && function[length] == '\0') {
+        return FOSSIL_TOKEN_FUNCTION;
+    }
+
+#define FOSSIL_KEYWORD_MATCH(name, kind) \
+    if (memcmp(text, name, length) == 0) { return kind; }
+
+    switch (length) {
+        case 2:
+            FOSSIL_KEYWORD_MATCH("if", FOSSIL_TOKEN_IF);
+            break;
+        case 4:
+            switch (text[0]) {
+                case 'e': FOSSIL_KEYWORD_MATCH("else", FOSSIL_TOKEN_ELSE); break;
+                case 'l': FOSSIL_KEYWORD_MATCH("link", FOSSIL_TOKEN_LINK); break;
+                case 't': FOSSIL_KEYWORD_MATCH("true", FOSSIL_TOKEN_TRUE); break;
+                case 'n': FOSSIL_KEYWORD_MATCH("null", FOSSIL_TOKEN_NULL); break;
+                default: break;
+            }
+            break;
+        case 5:
+            switch (text[0]) {
+                case 'c': FOSSIL_KEYWORD_MATCH("class", FOSSIL_TOKEN_CLASS); break;
+                case 'w': FOSSIL_KEYWORD_MATCH("while", FOSSIL_TOKEN_WHILE); break;
+                case 'f': FOSSIL_KEYWORD_MATCH("false", FOSSIL_TOKEN_FALSE); break;
+                default: break;
+            }
+            break;
+        case 6:
+            switch (text[0]) {
+                case 'p': FOSSIL_KEYWORD_MATCH("public", FOSSIL_TOKEN_PUBLIC); break;
+                case 'r': FOSSIL_KEYWORD_MATCH("return", FOSSIL_TOKEN_RETURN); break;
+                default: break;
+            }
+            break;
+        case 7:
+            switch (text[0]) {
+                case 'e': FOSSIL_KEYWORD_MATCH("extends", FOSSIL_TOKEN_EXTENDS); break;
+                case 'p': FOSSIL_KEYWORD_MATCH("private", FOSSIL_TOKEN_PRIVATE); break;
+                case 'i': FOSSIL_KEYWORD_MATCH("include", FOSSIL_TOKEN_INCLUDE); break;
+                default: break;
+            }
+            break;
+        default:
+            break;
+    }
+
+#undef FOSSIL_KEYWORD_MATCH
+
+    return FOSSIL_TOKEN_IDENTIFIER;
+}
+
+// Append a token, doubling the array when it is full
+static int fossil_push_token(fossil_token_array* tokens, fossil_token_kind kind, size_t offset, size_t length, uint32_t line, uint32_t column) {
+    if (tokens->count == tokens->capacity) {
+        size_t capacity = tokens->capacity * 2;
+        fossil_token* grown = (fossil_token*)realloc(tokens->tokens, capacity * sizeof(fossil_token));
+        if (grown == NULL) {
+            return -1;
         }
+        tokens->tokens = grown;
+        tokens->capacity = capacity;
+    }
+
+    fossil_token* token = &tokens->tokens[tokens->count++];
+    token->kind = kind;
+    token->offset = (uint32_t)offset;
+    token->length = (uint32_t)length;
+    token->line = line;
+    token->column = column;
+    return 0;
+}
+
+// Tokenize code[begin, end); offsets stay relative to code. line and
+// line_start describe the line that contains begin.
+static int fossil_lex_range(const fossil_keywords* keywords, const char* code, size_t begin, size_t end, uint32_t line, size_t line_start, fossil_token_array* tokens) {
+    if (code == NULL || tokens == NULL || end > UINT32_MAX || begin > end) {
+        return -1;
     }
 
-    // Parse function body (if any)
-    if (code[*index] == OPEN_BRACE_KEYWORD) {
-        (*index)++;  // Move past '{'
+    // Roughly one token per four bytes of source
+    size_t estimate = (end - begin) / 4 + 16;
+    tokens->count = 0;
+    if (tokens->capacity < estimate) {
+        free(tokens->tokens);
+        tokens->capacity = estimate;
+        tokens->tokens = (fossil_token*)malloc(tokens->capacity * sizeof(fossil_token));
+        if (tokens->tokens == NULL) {
+            tokens->capacity = 0;
+            return -1;
+        }
+    }
 
-        // Parse statements within the function body
-        while (code[*index] != CLOSE_BRACE_KEYWORD && code[*index] != '\0') {
-            // Parse statement
-            ASTNode* statementNode = fscl_fossil_parse_statement(code);
+    size_t i = begin;
 
-            // Add statement node to function node
-            fscl_fossil_add_child(functionNode, statementNode);
+    while (i < end) {
+        char c = code[i];
 
-            // Skip whitespace and check for next statement
-            fscl_fossil_skip_whitespace(code, index);
+        // Whitespace and comments
+        if (c == '\n') {
+            ++i;
+            ++line;
+            line_start = i;
+            continue;
+        }
+        if (isspace((unsigned char)c)) {
+            ++i;
+            continue;
+        }
+        if (c == '#' || (c == '/' && i + 1 < end && code[i + 1] == '/')) {
+            while (i < end && code[i] != '\n') {
+                ++i;
+            }
+            continue;
         }
 
-        // Skip closing brace '}'
-        if (code[*index] == CLOSE_BRACE_KEYWORD) {
-            (*index)++;
+        size_t start = i;
+        uint32_t token_line = line;
+        uint32_t column = (uint32_t)(start - line_start + 1);
+        fossil_token_kind kind = FOSSIL_TOKEN_ERROR;
+
+        if (c == '/' && i + 1 < end && code[i + 1] == '*') {
+            i += 2;
+            while (i + 1 < end && !(code[i] == '*' && code[i + 1] == '/')) {
+                if (code[i++] == '\n') {
+                    ++line;
+                    line_start = i;
+                }
+            }
+            if (i + 1 < end) {
+                i += 2;
+                continue;
+            }
+            // Unterminated comment
+            i = end;
+        } else if (c == keywords->open_brace) {
+            kind = FOSSIL_TOKEN_LBRACE;
+            ++i;
+        } else if (c == keywords->close_brace) {
+            kind = FOSSIL_TOKEN_RBRACE;
+            ++i;
+        } else if (isalpha((unsigned char)c) || c == '_') {
+            while (i < end && (isalnum((unsigned char)code[i]) || code[i] == '_')) {
+                ++i;
+            }
+            kind = fossil_keyword_kind(keywords, code + start, i - start);
+        } else if (isdigit((unsigned char)c)) {
+            kind = FOSSIL_TOKEN_INTEGER;
+            if (c == '0' && i + 1 < end && (code[i + 1] == 'x' || code[i + 1] == 'o')) {
+                i += 2;
+                while (i < end && isxdigit((unsigned char)code[i])) {
+                    ++i;
+                }
+            } else {
+                while (i < end && isdigit((unsigned char)code[i])) {
+                    ++i;
+                }
+                if (i + 1 < end && code[i] == '.' && isdigit((unsigned char)code[i + 1])) {
+                    kind = FOSSIL_TOKEN_FLOAT;
+                    for (++i; i < end && isdigit((unsigned char)code[i]); ++i) {
+                    }
+                }
+                if (i < end && (code[i] == 'e' || code[i] == 'E')) {
+                    size_t exponent = i + 1;
+                    if (exponent < end && (code[exponent] == '+' || code[exponent] == '-')) {
+                        ++exponent;
+                    }
+                    if (exponent < end && isdigit((unsigned char)code[exponent])) {
+                        kind = FOSSIL_TOKEN_FLOAT;
+                        for (i = exponent; i < end && isdigit((unsigned char)code[i]); ++i) {
+                        }
+                    }
+                }
+            }
+        } else if (c == '"' || c == '\'') {
+            // String or character literal, escapes are kept verbatim
+            for (++i; i < end && code[i] != c && code[i] != '\n'; ++i) {
+                if (code[i] == '\\' && i + 1 < end) {
+                    ++i;
+                }
+            }
+            if (i < end && code[i] == c) {
+                kind = c == '"' ? FOSSIL_TOKEN_STRING : FOSSIL_TOKEN_CHAR;
+                ++i;
+            }
         } else {
-            // Handle error: Missing closing brace
-            mark_error(functionNode);
-            printf("Error: Missing closing brace in function body.\n");
+            char next = i + 1 < end ? code[i + 1] : '\0';
+            size_t width = 1;
+            switch (c) {
+                case '(': kind = FOSSIL_TOKEN_LPAREN; break;
+                case ')': kind = FOSSIL_TOKEN_RPAREN; break;
+                case '[': kind = FOSSIL_TOKEN_LBRACKET; break;
+                case ']': kind = FOSSIL_TOKEN_RBRACKET; break;
+                case ',': kind = FOSSIL_TOKEN_COMMA; break;
+                case ';': kind = FOSSIL_TOKEN_SEMICOLON; break;
+                case ':': kind = FOSSIL_TOKEN_COLON; break;
+                case '.': kind = FOSSIL_TOKEN_DOT; break;
+                case '*': kind = FOSSIL_TOKEN_STAR; break;
+                case '/': kind = FOSSIL_TOKEN_SLASH; break;
+                case '%': kind = FOSSIL_TOKEN_PERCENT; break;
+                case '+':
+                    kind = next == '+' ? FOSSIL_TOKEN_INCREMENT : FOSSIL_TOKEN_PLUS;
+                    width = next == '+' ? 2 : 1;
+                    break;
+                case '-':
+                    if (next == '-') {
+                        kind = FOSSIL_TOKEN_DECREMENT;
+                        width = 2;
+                    } else if (next == '>') {
+                        kind = FOSSIL_TOKEN_ARROW;
+                        width = 2;
+                    } else {
+                        kind = FOSSIL_TOKEN_MINUS;
+                    }
+                    break;
+                case '=':
+                    kind = next == '=' ? FOSSIL_TOKEN_EQUAL : FOSSIL_TOKEN_ASSIGN;
+                    width = next == '=' ? 2 : 1;
+                    break;
+                case '!':
+                    kind = next == '=' ? FOSSIL_TOKEN_NOT_EQUAL : FOSSIL_TOKEN_NOT;
+                    width = next == '=' ? 2 : 1;
+                    break;
+                case '<':
+                    kind = next == '=' ? FOSSIL_TOKEN_LESS_EQUAL : FOSSIL_TOKEN_LESS;
+                    width = next == '=' ? 2 : 1;
+                    break;
+                case '>':
+                    kind = next == '=' ? FOSSIL_TOKEN_GREATER_EQUAL : FOSSIL_TOKEN_GREATER;
+                    width = next == '=' ? 2 : 1;
+                    break;
+                case '&':
+                    kind = next == '&' ? FOSSIL_TOKEN_AND : FOSSIL_TOKEN_ERROR;
+                    width = next == '&' ? 2 : 1;
+                    break;
+                case '|':
+                    kind = next == '|' ? FOSSIL_TOKEN_OR : FOSSIL_TOKEN_ERROR;
+                    width = next == '|' ? 2 : 1;
+                    break;
+                default:
+                    break;
+            }
+            i += width;
+        }
+
+        if (fossil_push_token(tokens, kind, start, i - start, token_line, column) != 0) {
+            return -1;
         }
     }
 
-    return functionNode;
+    return fossil_push_token(tokens, FOSSIL_TOKEN_EOF, end, 0, line, (uint32_t)(end - line_start + 1));
 }
 
-// Function to create a new class node with details
-ASTNode* fscl_fossil_create_class(char* class_name) {
-    ASTNode* classNode = fscl_fossil_create_node(CLASS, FOSSIL_TOFU, ADD, class_name);
-    
-    // Initialize class-specific details
-    classNode->public_members = NULL;
-    classNode->private_members = NULL;
-    classNode->num_public_members = 0;
-    classNode->num_private_members = 0;
-
-    return classNode;
+// Function to split source code into tokens
+int fscl_fossil_lex(const char* code, size_t length, fossil_token_array* tokens) {
+    fossil_keywords keywords = fossil_global_keywords();
+    return fossil_lex_range(&keywords, code, 0, length, 1, 0, tokens);
 }
 
-// Function to add a member to a class with visibility and details
-void fscl_fossil_add_class_member(ASTNode* classNode, ASTNode* member, int is_public) {
-    if (classNode == NULL || member == NULL || classNode->error_flag || member->error_flag) {
-        mark_error(classNode);
-        mark_error(member);
+// Function to free the storage of a token array
+void fscl_fossil_token_array_erase(fossil_token_array* tokens) {
+    if (tokens == NULL) {
         return;
     }
 
-    member->is_public = is_public;
-    fscl_fossil_add_child(classNode, member);
+    free(tokens->tokens);
+    tokens->tokens = NULL;
+    tokens->count = 0;
+    tokens->capacity = 0;
+}
 
-    // Add the member to the appropriate list based on visibility
-    if (is_public) {
-        classNode->public_members = (ASTNode**)realloc(classNode->public_members, (classNode->num_public_members + 1) * sizeof(ASTNode*));
-        classNode->public_members[classNode->num_public_members] = member;
-        classNode->num_public_members++;
-    } else {
-        classNode->private_members = (ASTNode**)realloc(classNode->private_members, (classNode->num_private_members + 1) * sizeof(ASTNode*));
-        classNode->private_members[classNode->num_private_members] = member;
-        classNode->num_private_members++;
+// =================================================================
+// Parser
+// =================================================================
+
+// State of one parse, nothing here is shared between parses
+typedef struct {
+    const char* code;
+    const fossil_token* tokens;
+    size_t pos;
+    fossil_arena* arena;
+    ParseError error;
+    int quiet;          // Record errors without printing them
+    char message[160];  // First error with its position
+    fossil_diagnostics* diagnostics;  // Every error when recovering, NULL to stop at the first
+    int panic;          // An error was reported and the parse is unwinding to a boundary
+    uint32_t base;      // Added to node offsets (modulo 2^32), to place them in the caller's text
+} fossil_parser;
+
+static ASTNode* fossil_parse_expression(fossil_parser* parser);
+static ASTNode* fossil_parse_statement_node(fossil_parser* parser);
+
+// Current token, the EOF token is never consumed
+static const fossil_token* fossil_peek(const fossil_parser* parser) {
+    return &parser->tokens[parser->pos];
+}
+
+// Token after the current one (EOF when there is none)
+static const fossil_token* fossil_peek_next(const fossil_parser* parser) {
+    const fossil_token* token = &parser->tokens[parser->pos];
+    return token->kind == FOSSIL_TOKEN_EOF ? token : token + 1;
+}
+
+// Consume the current token and return it
+static const fossil_token* fossil_advance(fossil_parser* parser) {
+    const fossil_token* token = &parser->tokens[parser->pos];
+    if (token->kind != FOSSIL_TOKEN_EOF) {
+        parser->pos++;
     }
+    return token;
 }
 
-// Function to parse a class declaration
-ASTNode* fscl_fossil_parse_class_declaration(const char* code, size_t* index) {
-    // Skip whitespace
-    fscl_fossil_skip_whitespace(code, index);
+// Consume the current token if it has the given kind
+static int fossil_accept(fossil_parser* parser, fossil_token_kind kind) {
+    if (fossil_peek(parser)->kind == kind) {
+        fossil_advance(parser);
+        return 1;
+    }
+    return 0;
+}
 
-    // Parse class name
-    char* className = fscl_fossil_parse_identifier(code, index);
+// Append an empty diagnostic, NULL when out of memory
+static fossil_diagnostic* fossil_diagnostics_add(fossil_diagnostics* diagnostics) {
+    if (diagnostics->count == diagnostics->capacity) {
+        size_t capacity = diagnostics->capacity == 0 ? 16 : diagnostics->capacity * 2;
+        fossil_diagnostic* grown = (fossil_diagnostic*)realloc(diagnostics->items, capacity * sizeof(fossil_diagnostic));
+        if (grown == NULL) {
+            return NULL;
+        }
+        diagnostics->items = grown;
+        diagnostics->capacity = capacity;
+    }
 
-    // Create class node
-    ASTNode* classNode = fscl_fossil_create_class(className);
+    fossil_diagnostic* diagnostic = &diagnostics->items[diagnostics->count++];
+    memset(diagnostic, 0, sizeof(*diagnostic));
+    return diagnostic;
+}
 
-    // Parse class body
-    if (code[*index] == OPEN_BRACE_KEYWORD) {
-        (*index)++;  // Move past '{'
+// Record an error at the current token. Without diagnostics only the first
+// error counts; with them every error is kept, except the ones that follow
+// an error before the parser has recovered from it.
+static void fossil_parser_error(fossil_parser* parser, ParseError error, const char* message) {
+    if (parser->panic || (parser->diagnostics == NULL && parser->error != NO_ERRORS)) {
+        return;
+    }
 
-        // Parse members within the class body
-        while (code[*index] != CLOSE_BRACE_KEYWORD && code[*index] != '\0') {
-            // Parse member
-            ASTNode* memberNode = fscl_fossil_parse_statement(code);
+    const fossil_token* token = fossil_peek(parser);
+    if (parser->error == NO_ERRORS) {
+        parser->error = error;
+        snprintf(parser->message, sizeof(parser->message), "%s at line %u, column %u", message, (unsigned)token->line, (unsigned)token->column);
+        if (!parser->quiet) {
+            printf("Error: %s.\n", parser->message);
+        }
+    }
 
-            // Check if the member is a variable with visibility
-            if (memberNode->type == VARIABLE) {
-                int isPublic = memberNode->is_public;
-                free(memberNode);
-                memberNode = fscl_fossil_parse_statement(code);
-                fscl_fossil_add_class_member(classNode, memberNode, isPublic);
+    if (parser->diagnostics != NULL) {
+        parser->panic = 1;
+        fossil_diagnostic* diagnostic = fossil_diagnostics_add(parser->diagnostics);
+        if (diagnostic == NULL) {
+            return;
+        }
+        diagnostic->line = token->line;
+        diagnostic->column = token->column;
+        diagnostic->end_line = token->line;
+        diagnostic->end_column = token->column;
+        for (uint32_t i = 0; i < token->length; ++i) {
+            if (parser->code[token->offset + i] == '\n') {
+                diagnostic->end_line++;
+                diagnostic->end_column = 1;
             } else {
-                // Add member node to class node
-                fscl_fossil_add_class_member(classNode, memberNode, 1);  // Default to public visibility
+                diagnostic->end_column++;
             }
+        }
+        snprintf(diagnostic->message, sizeof(diagnostic->message), "%s", message);
+    }
+}
+
+// Whether a token can start a top-level declaration
+static int fossil_starts_declaration(fossil_token_kind kind) {
+    return kind == FOSSIL_TOKEN_FUNCTION || kind == FOSSIL_TOKEN_CLASS || kind == FOSSIL_TOKEN_INCLUDE || kind == FOSSIL_TOKEN_LINK;
+}
+
+// Skip the tokens of a statement or declaration that failed to parse. Stops
+// before a token that starts a new line outside brackets (or, at top level,
+// before the next declaration keyword on a new line), before a '}' closing
+// the enclosing body, or after a ';'. Always moves past start so the caller
+// makes progress. Returns 1 when parsing can carry on.
+static int fossil_recover(fossil_parser* parser, size_t start, int top_level) {
+    if (parser->diagnostics == NULL) {
+        return 0;
+    }
+
+    size_t depth = 0;
+    while (fossil_peek(parser)->kind != FOSSIL_TOKEN_EOF) {
+        const fossil_token* token = fossil_peek(parser);
+        int moved = parser->pos > start;
+        int new_line = parser->pos > 0 && token->line > parser->tokens[parser->pos - 1].line;
 
-            // Skip whitespace and check for next member
-            fscl_fossil_skip_whitespace(code, index);
+        if (depth == 0 && moved) {
+            if (token->kind == FOSSIL_TOKEN_RBRACE) {
+                break;
+            }
+            if (new_line && (!top_level || fossil_starts_declaration(token->kind))) {
+                break;
+            }
         }
 
-        // Skip closing brace '}'
-        if (code[*index] == CLOSE_BRACE_KEYWORD) {
-            (*index)++;
-        } else {
-            // Handle error: Missing closing brace
-            mark_error(classNode);
-            printf("Error: Missing closing brace in class body.\n");
+        fossil_advance(parser);
+        switch (token->kind) {
+            case FOSSIL_TOKEN_LPAREN:
+            case FOSSIL_TOKEN_LBRACKET:
+            case FOSSIL_TOKEN_LBRACE:
+                depth++;
+                break;
+            case FOSSIL_TOKEN_RPAREN:
+            case FOSSIL_TOKEN_RBRACKET:
+            case FOSSIL_TOKEN_RBRACE:
+                depth -= depth > 0;
+                break;
+            default:
+                break;
+        }
+        if (depth == 0 && token->kind == FOSSIL_TOKEN_SEMICOLON) {
+            break;
         }
     }
 
-    return classNode;
+    // At the end of the input there is nothing left to resume, and the
+    // errors of the enclosing bodies are only consequences of this one
+    if (fossil_peek(parser)->kind == FOSSIL_TOKEN_EOF) {
+        return 0;
+    }
+    parser->panic = 0;
+    return 1;
 }
 
-// Function to parse a DSL file into an AST
-ASTNode* fscl_fossil_parse_dsl_file(const char* filename) {
-    // Read the content of the DSL file
-    char* code = fscl_fossil_read_dsl(filename);
+// Consume a token of the given kind or report an error
+static const fossil_token* fossil_expect(fossil_parser* parser, fossil_token_kind kind, const char* message) {
+    if (fossil_peek(parser)->kind != kind) {
+        fossil_parser_error(parser, PARSING_ERROR, message);
+        return NULL;
+    }
+    return fossil_advance(parser);
+}
 
-    // Initialize parsing error
-    resetParseError();
+// Copy the text of a token into the arena
+static char* fossil_token_text(fossil_parser* parser, const fossil_token* token) {
+    return fscl_fossil_arena_strndup(parser->arena, parser->code + token->offset, token->length);
+}
+
+// Create a node in the parse arena at an offset of parser->code
+static ASTNode* fossil_parser_node(fossil_parser* parser, uint32_t offset, NodeType type, DataType data_type, OperatorType operator_type, char* value) {
+    ASTNode* node = fossil_new_node(parser->arena, type, data_type, operator_type, value);
+    node->source_offset = parser->base + offset;
+    return node;
+}
+
+// Map a type token to a DataType, user-defined names are generic
+static DataType fossil_token_data_type(fossil_parser* parser, const fossil_token* token) {
+    DataType type = fscl_fossil_data_type_from_span(parser->code + token->offset, token->length);
+    return type == FOSSIL_ERROR ? FOSSIL_TOFU : type;
+}
+
+// Parse a type name with an optional [] suffix
+static int fossil_parse_type(fossil_parser* parser, DataType* type) {
+    const fossil_token* token = fossil_peek(parser);
+    if (token->kind != FOSSIL_TOKEN_IDENTIFIER && token->kind != FOSSIL_TOKEN_NULL) {
+        fossil_parser_error(parser, PARSING_ERROR, "Expected a type name");
+        return 0;
+    }
+    fossil_advance(parser);
+    *type = fossil_token_data_type(parser, token);
+
+    if (fossil_accept(parser, FOSSIL_TOKEN_LBRACKET)) {
+        if (fossil_expect(parser, FOSSIL_TOKEN_RBRACKET, "Expected ']' after '['") == NULL) {
+            return 0;
+        }
+        *type = FOSSIL_ARRAY;
+    }
+    return 1;
+}
+
+// A statement ends at ';', ':', a closing brace, the end of input or a new line
+static int fossil_end_statement(fossil_parser* parser) {
+    if (fossil_accept(parser, FOSSIL_TOKEN_SEMICOLON) || fossil_accept(parser, FOSSIL_TOKEN_COLON)) {
+        return 1;
+    }
+
+    const fossil_token* token = fossil_peek(parser);
+    if (token->kind == FOSSIL_TOKEN_RBRACE || token->kind == FOSSIL_TOKEN_EOF || parser->pos == 0 || token->line > parser->tokens[parser->pos - 1].line) {
+        return 1;
+    }
+
+    fossil_parser_error(parser, PARSING_ERROR, "Expected end of statement");
+    return 0;
+}
+
+// Parse a comma-separated list of expressions up to the closing token
+static int fossil_parse_arguments(fossil_parser* parser, ASTNode* node, fossil_token_kind close, const char* message) {
+    if (!fossil_accept(parser, close)) {
+        do {
+            ASTNode* argument = fossil_parse_expression(parser);
+            if (argument == NULL) {
+                return 0;
+            }
+            fscl_fossil_add_child(node, argument);
+        } while (fossil_accept(parser, FOSSIL_TOKEN_COMMA));
+
+        if (fossil_expect(parser, close, message) == NULL) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Parse a name with optional dotted members, such as person.get_name
+static ASTNode* fossil_parse_name(fossil_parser* parser) {
+    const fossil_token* first = fossil_advance(parser);
+    const fossil_token* last = first;
+    size_t length = first->length;
+
+    while (fossil_peek(parser)->kind == FOSSIL_TOKEN_DOT && fossil_peek_next(parser)->kind == FOSSIL_TOKEN_IDENTIFIER) {
+        fossil_advance(parser);
+        last = fossil_advance(parser);
+        length += 1 + last->length;
+    }
 
-    // Create a root node for the AST
-    ASTNode* rootNode = fscl_fossil_create_node(PLACEHOLDER_NODE, FOSSIL_PLACEHOLDER, ADD, NULL);
+    char* name;
+    if (first == last) {
+        name = fossil_token_text(parser, first);
+    } else {
+        // Rebuild the name without any whitespace around the dots
+        name = (char*)fscl_fossil_arena_alloc(parser->arena, length + 1);
+        if (name == NULL) {
+            exit(EXIT_FAILURE);
+        }
+        size_t used = 0;
+        for (const fossil_token* token = first; token <= last; ++token) {
+            memcpy(name + used, parser->code + token->offset, token->length);
+            used += token->length;
+        }
+        name[used] = '\0';
+    }
+
+    return fossil_parser_node(parser, first->offset, VARIABLE, FOSSIL_TOFU, ADD, name);
+}
 
-    size_t index = 0;
+// Parse a literal, name, parenthesized expression or array literal
+static ASTNode* fossil_parse_primary(fossil_parser* parser) {
+    const fossil_token* token = fossil_peek(parser);
 
-    // Parse DSL statements and populate the AST
-    while (code[index] != '\0') {
-        // Parse function declaration
-        if (strncmp(code + index, FUNCTION_KEYWORD, 8) == 0) {
-            ASTNode* functionNode = fscl_fossil_parse_function_declaration(code, &index, NULL);
-            fscl_fossil_add_child(rootNode, functionNode);
+    switch (token->kind) {
+        case FOSSIL_TOKEN_INTEGER: {
+            fossil_advance(parser);
+            DataType type = FOSSIL_INT;
+            if (token->length > 1 && parser->code[token->offset + 1] == 'x') {
+                type = FOSSIL_HEX;
+            } else if (token->length > 1 && parser->code[token->offset + 1] == 'o') {
+                type = FOSSIL_OCT;
+            }
+            return fossil_parser_node(parser, token->offset, CONSTANT, type, ADD, fossil_token_text(parser, token));
         }
-        // Parse class declaration
-        else if (strncmp(code + index, "class", 5) == 0) {
-            ASTNode* classNode = fscl_fossil_parse_class_declaration(code, &index);
-            fscl_fossil_add_child(rootNode, classNode);
+        case FOSSIL_TOKEN_FLOAT:
+            fossil_advance(parser);
+            return fossil_parser_node(parser, token->offset, CONSTANT, FOSSIL_FLOAT, ADD, fossil_token_text(parser, token));
+        case FOSSIL_TOKEN_STRING:
+        case FOSSIL_TOKEN_CHAR: {
+            // The value holds the literal without its quotes
+            fossil_advance(parser);
+            char* text = fscl_fossil_arena_strndup(parser->arena, parser->code + token->offset + 1, token->length - 2);
+            return fossil_parser_node(parser, token->offset, CONSTANT, token->kind == FOSSIL_TOKEN_STRING ? FOSSIL_STRING : FOSSIL_CHAR, ADD, text);
         }
-        // Skip unknown statements
-        else {
-            // Handle unknown keyword error
-            setParseError(UNKNOWN_KEYWORD_ERROR);
-            printf("Error: Unknown keyword encountered during parsing.\n");
+        case FOSSIL_TOKEN_TRUE:
+        case FOSSIL_TOKEN_FALSE:
+            fossil_advance(parser);
+            return fossil_parser_node(parser, token->offset, CONSTANT, FOSSIL_BOOL, ADD, fossil_token_text(parser, token));
+        case FOSSIL_TOKEN_NULL:
+            fossil_advance(parser);
+            return fossil_parser_node(parser, token->offset, CONSTANT, FOSSIL_NULL_TYPE, ADD, fossil_token_text(parser, token));
+        case FOSSIL_TOKEN_IDENTIFIER:
+            return fossil_parse_name(parser);
+        case FOSSIL_TOKEN_LPAREN: {
+            fossil_advance(parser);
+            ASTNode* inner = fossil_parse_expression(parser);
+            if (inner == NULL || fossil_expect(parser, FOSSIL_TOKEN_RPAREN, "Expected ')' after expression") == NULL) {
+                return NULL;
+            }
+            return inner;
+        }
+        case FOSSIL_TOKEN_LBRACKET: {
+            fossil_advance(parser);
+            ASTNode* array = fossil_parser_node(parser, token->offset, ARRAY_LITERAL, FOSSIL_ARRAY, ADD, NULL);
+            if (!fossil_parse_arguments(parser, array, FOSSIL_TOKEN_RBRACKET, "Expected ']' after array elements")) {
+                return NULL;
+            }
+            return array;
+        }
+        case FOSSIL_TOKEN_ERROR:
+            fossil_parser_error(parser, PARSING_ERROR, "Unexpected character");
+            return NULL;
+        default:
+            fossil_parser_error(parser, PARSING_ERROR, "Expected an expression");
+            return NULL;
+    }
+}
+
+// Parse calls and postfix increments
+static ASTNode* fossil_parse_postfix(fossil_parser* parser) {
+    ASTNode* node = fossil_parse_primary(parser);
+
+    while (node != NULL) {
+        const fossil_token* token = fossil_peek(parser);
+        if (token->kind == FOSSIL_TOKEN_LPAREN) {
+            if (node->type != VARIABLE) {
+                fossil_parser_error(parser, PARSING_ERROR, "Expected a function name before '('");
+                return NULL;
+            }
+            fossil_advance(parser);
+            NodeType type = strcmp(node->value, "print") == 0 ? PRINT_STATEMENT_TYPE : CALL_EXPRESSION;
+            ASTNode* call = fossil_parser_node(parser, node->source_offset - parser->base, type, FOSSIL_TOFU, ADD, node->value);
+            if (!fossil_parse_arguments(parser, call, FOSSIL_TOKEN_RPAREN, "Expected ')' after arguments")) {
+                return NULL;
+            }
+            node = call;
+        } else if (token->kind == FOSSIL_TOKEN_INCREMENT || token->kind == FOSSIL_TOKEN_DECREMENT) {
+            fossil_advance(parser);
+            OperatorType op = token->kind == FOSSIL_TOKEN_INCREMENT ? INCREMENT : DECREMENT;
+            ASTNode* unary = fossil_parser_node(parser, token->offset, UNARY_OP, node->data_type, op, fossil_token_text(parser, token));
+            fscl_fossil_add_child(unary, node);
+            node = unary;
+        } else {
             break;
         }
+    }
+
+    return node;
+}
 
-        // Skip whitespace and check for next statement
-        fscl_fossil_skip_whitespace(code, &index);
+// Parse prefix operators
+static ASTNode* fossil_parse_unary(fossil_parser* parser) {
+    const fossil_token* token = fossil_peek(parser);
+    OperatorType op;
+    DataType type = FOSSIL_TOFU;
+
+    switch (token->kind) {
+        case FOSSIL_TOKEN_MINUS: op = NEGATION; break;
+        case FOSSIL_TOKEN_NOT: op = NOT; type = FOSSIL_BOOL; break;
+        case FOSSIL_TOKEN_INCREMENT: op = INCREMENT; break;
+        case FOSSIL_TOKEN_DECREMENT: op = DECREMENT; break;
+        default:
+            return fossil_parse_postfix(parser);
     }
 
-    // Free the memory allocated for the code
-    free(code);
+    fossil_advance(parser);
+    ASTNode* operand = fossil_parse_unary(parser);
+    if (operand == NULL) {
+        return NULL;
+    }
+
+    ASTNode* unary = fossil_parser_node(parser, token->offset, UNARY_OP, type, op, fossil_token_text(parser, token));
+    fscl_fossil_add_child(unary, operand);
+    return unary;
+}
+
+// Binary operator table, lower level binds looser
+typedef struct {
+    int level;
+    NodeType type;
+    OperatorType op;
+} fossil_binary_info;
 
-    // Check for parsing errors
-    if (parseError != NO_ERRORS) {
-        // Erase the partial AST in case of errors
-        fscl_fossil_erase_node(rootNode);
+static fossil_binary_info fossil_binary_operator(fossil_token_kind kind) {
+    switch (kind) {
+        case FOSSIL_TOKEN_OR:            return (fossil_binary_info){1, LOGICAL_OP, OR};
+        case FOSSIL_TOKEN_AND:           return (fossil_binary_info){2, LOGICAL_OP, AND};
+        case FOSSIL_TOKEN_EQUAL:         return (fossil_binary_info){3, RELATIONAL_OP, EQUALS};
+        case FOSSIL_TOKEN_NOT_EQUAL:     return (fossil_binary_info){3, RELATIONAL_OP, NOT_EQUALS};
+        case FOSSIL_TOKEN_LESS:          return (fossil_binary_info){4, RELATIONAL_OP, LESS_THAN};
+        case FOSSIL_TOKEN_LESS_EQUAL:    return (fossil_binary_info){4, RELATIONAL_OP, LESS_EQUAL};
+        case FOSSIL_TOKEN_GREATER:       return (fossil_binary_info){4, RELATIONAL_OP, GREATER_THAN};
+        case FOSSIL_TOKEN_GREATER_EQUAL: return (fossil_binary_info){4, RELATIONAL_OP, GREATER_EQUAL};
+        case FOSSIL_TOKEN_PLUS:          return (fossil_binary_info){5, BINARY_OP, ADD};
+        case FOSSIL_TOKEN_MINUS:         return (fossil_binary_info){5, BINARY_OP, SUBTRACT};
+        case FOSSIL_TOKEN_STAR:          return (fossil_binary_info){6, BINARY_OP, MULTIPLY};
+        case FOSSIL_TOKEN_SLASH:         return (fossil_binary_info){6, BINARY_OP, DIVIDE};
+        case FOSSIL_TOKEN_PERCENT:       return (fossil_binary_info){6, BINARY_OP, MODULO};
+        default:                         return (fossil_binary_info){0, PLACEHOLDER_NODE, ADD};
+    }
+}
+
+// Precedence climbing over the binary operator table
+static ASTNode* fossil_parse_binary(fossil_parser* parser, int min_level) {
+    ASTNode* left = fossil_parse_unary(parser);
+
+    while (left != NULL) {
+        const fossil_token* token = fossil_peek(parser);
+        fossil_binary_info info = fossil_binary_operator(token->kind);
+        if (info.level == 0 || info.level < min_level) {
+            break;
+        }
+
+        fossil_advance(parser);
+        ASTNode* right = fossil_parse_binary(parser, info.level + 1);
+        if (right == NULL) {
+            return NULL;
+        }
+
+        DataType type = info.type == BINARY_OP ? FOSSIL_TOFU : FOSSIL_BOOL;
+        ASTNode* node = fossil_parser_node(parser, token->offset, info.type, type, info.op, fossil_token_text(parser, token));
+        fscl_fossil_add_children(node, 2, left, right);
+        left = node;
+    }
+
+    return left;
+}
+
+// Parse an expression
+static ASTNode* fossil_parse_expression(fossil_parser* parser) {
+    return fossil_parse_binary(parser, 1);
+}
+
+// Parse a body: braces, or ':' followed by one statement or an indented block.
+// Each parsed item is attached to the owner through the add callback.
+static int fossil_parse_body(fossil_parser* parser, uint32_t header_column, ASTNode* owner,
+                             ASTNode* (*item)(fossil_parser*), void (*add)(ASTNode*, ASTNode*)) {
+    if (fossil_accept(parser, FOSSIL_TOKEN_LBRACE)) {
+        while (fossil_peek(parser)->kind != FOSSIL_TOKEN_RBRACE) {
+            if (fossil_peek(parser)->kind == FOSSIL_TOKEN_EOF) {
+                fossil_parser_error(parser, PARSING_ERROR, "Missing closing brace");
+                return 0;
+            }
+            size_t start = parser->pos;
+            ASTNode* node = item(parser);
+            if (node == NULL) {
+                if (!fossil_recover(parser, start, 0)) {
+                    return 0;
+                }
+                continue;
+            }
+            add(owner, node);
+        }
+        fossil_advance(parser);
+        return 1;
+    }
+
+    const fossil_token* colon = fossil_peek(parser);
+    if (fossil_expect(parser, FOSSIL_TOKEN_COLON, "Expected a body") == NULL) {
+        return 0;
+    }
+
+    const fossil_token* token = fossil_peek(parser);
+    if (token->kind != FOSSIL_TOKEN_EOF && token->line == colon->line) {
+        ASTNode* node = item(parser);
+        if (node == NULL) {
+            return 0;
+        }
+        add(owner, node);
+        return 1;
+    }
+
+    // Indented block: everything indented deeper than the header
+    size_t parsed = 0;
+    while (fossil_peek(parser)->kind != FOSSIL_TOKEN_EOF && fossil_peek(parser)->column > header_column) {
+        size_t start = parser->pos;
+        ASTNode* node = item(parser);
+        if (node == NULL) {
+            if (!fossil_recover(parser, start, 0)) {
+                return 0;
+            }
+            parsed++;
+            continue;
+        }
+        add(owner, node);
+        parsed++;
+    }
+
+    if (parsed == 0) {
+        fossil_parser_error(parser, PARSING_ERROR, "Expected an indented block");
+        return 0;
+    }
+    return 1;
+}
+
+// Parse a body into a BLOCK_STATEMENT node
+static ASTNode* fossil_parse_block(fossil_parser* parser, uint32_t header_column) {
+    ASTNode* block = fossil_parser_node(parser, fossil_peek(parser)->offset, BLOCK_STATEMENT, FOSSIL_TOFU, ADD, NULL);
+    if (!fossil_parse_body(parser, header_column, block, fossil_parse_statement_node, fscl_fossil_add_child)) {
         return NULL;
     }
+    return block;
+}
 
-    return rootNode;
+// Parse if/else, the else branch is a block or another IF_STATEMENT
+static ASTNode* fossil_parse_if(fossil_parser* parser) {
+    const fossil_token* keyword = fossil_advance(parser);
+    ASTNode* condition = fossil_parse_expression(parser);
+    if (condition == NULL) {
+        return NULL;
+    }
+
+    ASTNode* then_block = fossil_parse_block(parser, keyword->column);
+    if (then_block == NULL) {
+        return NULL;
+    }
+
+    ASTNode* node = fossil_parser_node(parser, keyword->offset, IF_STATEMENT, FOSSIL_BOOL, ADD, NULL);
+    fscl_fossil_add_children(node, 2, condition, then_block);
+
+    const fossil_token* else_token = fossil_peek(parser);
+    if (fossil_accept(parser, FOSSIL_TOKEN_ELSE)) {
+        ASTNode* else_branch = fossil_peek(parser)->kind == FOSSIL_TOKEN_IF ? fossil_parse_if(parser) : fossil_parse_block(parser, else_token->column);
+        if (else_branch == NULL) {
+            return NULL;
+        }
+        fscl_fossil_add_child(node, else_branch);
+    }
+
+    return node;
+}
+
+// Parse a variable declaration "type name [= value]" or "name: type [= value]"
+static ASTNode* fossil_parse_declaration(fossil_parser* parser) {
+    DataType type = FOSSIL_TOFU;
+    const fossil_token* name;
+
+    if (fossil_peek_next(parser)->kind == FOSSIL_TOKEN_COLON) {
+        name = fossil_advance(parser);
+        fossil_advance(parser);
+        if (!fossil_parse_type(parser, &type)) {
+            return NULL;
+        }
+    } else {
+        if (!fossil_parse_type(parser, &type)) {
+            return NULL;
+        }
+        name = fossil_expect(parser, FOSSIL_TOKEN_IDENTIFIER, "Expected a variable name");
+        if (name == NULL) {
+            return NULL;
+        }
+    }
+
+    ASTNode* variable = fossil_parser_node(parser, name->offset, VARIABLE, type, ADD, fossil_token_text(parser, name));
+    if (fossil_accept(parser, FOSSIL_TOKEN_ASSIGN)) {
+        ASTNode* value = fossil_parse_expression(parser);
+        if (value == NULL) {
+            return NULL;
+        }
+        fscl_fossil_add_child(variable, value);
+    }
+    return variable;
+}
+
+// Check whether the current tokens start a declaration
+static int fossil_at_declaration(const fossil_parser* parser) {
+    const fossil_token* token = fossil_peek(parser);
+    const fossil_token* next = fossil_peek_next(parser);
+    if (token->kind != FOSSIL_TOKEN_IDENTIFIER) {
+        return 0;
+    }
+
+    // "type name", "type[] name" or "name: type" on one line
+    if (next->kind == FOSSIL_TOKEN_IDENTIFIER && next->line == token->line) {
+        return 1;
+    }
+    if (next->kind == FOSSIL_TOKEN_LBRACKET && next[1].kind == FOSSIL_TOKEN_RBRACKET) {
+        return 1;
+    }
+    if (next->kind == FOSSIL_TOKEN_COLON && next[1].kind == FOSSIL_TOKEN_IDENTIFIER && next[1].line == token->line) {
+        return fscl_fossil_data_type_from_span(parser->code + next[1].offset, next[1].length) != FOSSIL_ERROR;
+    }
+    return 0;
+}
+
+// Parse one statement of a body
+static ASTNode* fossil_parse_statement_node(fossil_parser* parser) {
+    const fossil_token* token = fossil_peek(parser);
+    ASTNode* node;
+
+    switch (token->kind) {
+        case FOSSIL_TOKEN_IF:
+            return fossil_parse_if(parser);
+        case FOSSIL_TOKEN_WHILE: {
+            fossil_advance(parser);
+            ASTNode* condition = fossil_parse_expression(parser);
+            ASTNode* body = condition != NULL ? fossil_parse_block(parser, token->column) : NULL;
+            if (body == NULL) {
+                return NULL;
+            }
+            node = fossil_parser_node(parser, token->offset, WHILE_LOOP, FOSSIL_BOOL, ADD, NULL);
+            fscl_fossil_add_children(node, 2, condition, body);
+            return node;
+        }
+        case FOSSIL_TOKEN_LBRACE:
+            return fossil_parse_block(parser, token->column);
+        case FOSSIL_TOKEN_RETURN: {
+            fossil_advance(parser);
+            node = fossil_parser_node(parser, token->offset, RETURN_STATEMENT, FOSSIL_TOFU, ADD, NULL);
+            const fossil_token* next = fossil_peek(parser);
+            if (next->line == token->line && next->kind != FOSSIL_TOKEN_SEMICOLON && next->kind != FOSSIL_TOKEN_COLON &&
+                next->kind != FOSSIL_TOKEN_RBRACE && next->kind != FOSSIL_TOKEN_EOF) {
+                ASTNode* value = fossil_parse_expression(parser);
+                if (value == NULL) {
+                    return NULL;
+                }
+                fscl_fossil_add_child(node, value);
+            }
+            break;
+        }
+        default:
+            if (fossil_at_declaration(parser)) {
+                node = fossil_parse_declaration(parser);
+            } else {
+                node = fossil_parse_expression(parser);
+                if (node != NULL && fossil_peek(parser)->kind == FOSSIL_TOKEN_ASSIGN) {
+                    if (node->type != VARIABLE) {
+                        fossil_parser_error(parser, PARSING_ERROR, "Invalid assignment target");
+                        return NULL;
+                    }
+                    fossil_advance(parser);
+                    ASTNode* value = fossil_parse_expression(parser);
+                    if (value == NULL) {
+                        return NULL;
+                    }
+                    ASTNode* assignment = fossil_parser_node(parser, node->source_offset - parser->base, ASSIGNMENT, FOSSIL_TOFU, ADD, node->value);
+                    fscl_fossil_add_child(assignment, value);
+                    node = assignment;
+                }
+            }
+            if (node == NULL) {
+                return NULL;
+            }
+            break;
+    }
+
+    return fossil_end_statement(parser) ? node : NULL;
+}
+
+// Parse a parameter "type name" or "name: type", with an optional default
+static ASTNode* fossil_parse_parameter(fossil_parser* parser) {
+    if (fossil_peek(parser)->kind != FOSSIL_TOKEN_IDENTIFIER) {
+        fossil_parser_error(parser, PARSING_ERROR, "Expected a parameter");
+        return NULL;
+    }
+    return fossil_parse_declaration(parser);
+}
+
+// Parse the rest of a function once its return type (if any) is known.
+// FUNCTION children are the parameters followed by the BLOCK_STATEMENT body.
+static ASTNode* fossil_parse_function_rest(fossil_parser* parser, uint32_t header_column, DataType return_type) {
+    const fossil_token* name = fossil_expect(parser, FOSSIL_TOKEN_IDENTIFIER, "Expected a function name");
+    if (name == NULL || fossil_expect(parser, FOSSIL_TOKEN_LPAREN, "Expected '(' after function name") == NULL) {
+        return NULL;
+    }
+
+    ASTNode* function = fossil_parser_node(parser, name->offset, FUNCTION, return_type, ADD, fossil_token_text(parser, name));
+
+    if (!fossil_accept(parser, FOSSIL_TOKEN_RPAREN)) {
+        do {
+            ASTNode* parameter = fossil_parse_parameter(parser);
+            if (parameter == NULL) {
+                return NULL;
+            }
+            fscl_fossil_add_child(function, parameter);
+        } while (fossil_accept(parser, FOSSIL_TOKEN_COMMA));
+
+        if (fossil_expect(parser, FOSSIL_TOKEN_RPAREN, "Missing closing parenthesis in function declaration") == NULL) {
+            return NULL;
+        }
+    }
+
+    if (fossil_accept(parser, FOSSIL_TOKEN_ARROW)) {
+        DataType type;
+        if (!fossil_parse_type(parser, &type)) {
+            return NULL;
+        }
+        function->data_type = type;
+    }
+
+    ASTNode* body = fossil_parse_block(parser, header_column);
+    if (body == NULL) {
+        return NULL;
+    }
+    fscl_fossil_add_child(function, body);
+    return function;
+}
+
+// Parse "[fossil] name(params) [-> type] body"
+static ASTNode* fossil_parse_function_node(fossil_parser* parser) {
+    uint32_t header_column = fossil_peek(parser)->column;
+    fossil_accept(parser, FOSSIL_TOKEN_FUNCTION);
+    return fossil_parse_function_rest(parser, header_column, FOSSIL_TOFU);
+}
+
+// Parse one class member: a method or a field, with optional visibility
+static ASTNode* fossil_parse_member(fossil_parser* parser) {
+    const fossil_token* start = fossil_peek(parser);
+    int is_public = 1;  // Default to public visibility
+    if (fossil_accept(parser, FOSSIL_TOKEN_PRIVATE)) {
+        is_public = 0;
+    } else {
+        fossil_accept(parser, FOSSIL_TOKEN_PUBLIC);
+    }
+
+    const fossil_token* token = fossil_peek(parser);
+    const fossil_token* next = fossil_peek_next(parser);
+    ASTNode* member;
+
+    if (token->kind == FOSSIL_TOKEN_FUNCTION || (token->kind == FOSSIL_TOKEN_IDENTIFIER && next->kind == FOSSIL_TOKEN_LPAREN)) {
+        fossil_accept(parser, FOSSIL_TOKEN_FUNCTION);
+        member = fossil_parse_function_rest(parser, start->column, FOSSIL_TOFU);
+    } else if (token->kind == FOSSIL_TOKEN_IDENTIFIER && next->kind == FOSSIL_TOKEN_IDENTIFIER && next[1].kind == FOSSIL_TOKEN_LPAREN) {
+        // C-style method "type name(params) body"
+        fossil_advance(parser);
+        member = fossil_parse_function_rest(parser, start->column, fossil_token_data_type(parser, token));
+    } else if (fossil_at_declaration(parser)) {
+        member = fossil_parse_declaration(parser);
+        if (member != NULL && !fossil_end_statement(parser)) {
+            return NULL;
+        }
+    } else {
+        fossil_parser_error(parser, PARSING_ERROR, "Expected a class member");
+        return NULL;
+    }
+
+    if (member != NULL) {
+        member->is_public = is_public;
+    }
+    return member;
+}
+
+// Attach a parsed member to its class with the parsed visibility
+static void fossil_add_member(ASTNode* classNode, ASTNode* member) {
+    fscl_fossil_add_class_member(classNode, member, member->is_public);
+}
+
+// Parse "[fossil] class Name [extends Parent] body"
+static ASTNode* fossil_parse_class_node(fossil_parser* parser) {
+    uint32_t header_column = fossil_peek(parser)->column;
+    fossil_accept(parser, FOSSIL_TOKEN_FUNCTION);
+    fossil_accept(parser, FOSSIL_TOKEN_CLASS);
+
+    const fossil_token* name = fossil_expect(parser, FOSSIL_TOKEN_IDENTIFIER, "Expected a class name");
+    if (name == NULL) {
+        return NULL;
+    }
+
+    ASTNode* classNode = fossil_parser_node(parser, name->offset, CLASS, FOSSIL_TOFU, ADD, fossil_token_text(parser, name));
+
+    if (fossil_accept(parser, FOSSIL_TOKEN_EXTENDS)) {
+        const fossil_token* parent = fossil_expect(parser, FOSSIL_TOKEN_IDENTIFIER, "Expected a parent class name");
+        if (parent == NULL) {
+            return NULL;
+        }
+        fscl_fossil_add_child(classNode, fossil_parser_node(parser, parent->offset, INHERITANCE, FOSSIL_TOFU, ADD, fossil_token_text(parser, parent)));
+    }
+
+    if (!fossil_parse_body(parser, header_column, classNode, fossil_parse_member, fossil_add_member)) {
+        return NULL;
+    }
+    return classNode;
+}
+
+// Parse one top-level declaration
+static ASTNode* fossil_parse_top_level(fossil_parser* parser) {
+    const fossil_token* token = fossil_peek(parser);
+    const fossil_token* keyword = token;
+    if (token->kind == FOSSIL_TOKEN_FUNCTION) {
+        keyword = fossil_peek_next(parser);
+    }
+
+    switch (keyword->kind) {
+        case FOSSIL_TOKEN_CLASS:
+            return fossil_parse_class_node(parser);
+        case FOSSIL_TOKEN_INCLUDE:
+        case FOSSIL_TOKEN_LINK: {
+            fossil_accept(parser, FOSSIL_TOKEN_FUNCTION);
+            fossil_advance(parser);
+            const fossil_token* path = fossil_expect(parser, FOSSIL_TOKEN_STRING, "Expected a quoted name");
+            if (path == NULL) {
+                return NULL;
+            }
+            char* text = fscl_fossil_arena_strndup(parser->arena, parser->code + path->offset + 1, path->length - 2);
+            NodeType type = keyword->kind == FOSSIL_TOKEN_INCLUDE ? INCLUDE_FILE : LINK_LIBRARY;
+            ASTNode* node = fossil_parser_node(parser, keyword->offset, type, FOSSIL_STRING, ADD, text);
+            return fossil_end_statement(parser) ? node : NULL;
+        }
+        case FOSSIL_TOKEN_IDENTIFIER:
+            if (token->kind == FOSSIL_TOKEN_FUNCTION) {
+                return fossil_parse_function_node(parser);
+            }
+            break;
+        default:
+            break;
+    }
+
+    fossil_parser_error(parser, UNKNOWN_KEYWORD_ERROR, "Unknown keyword encountered during parsing");
+    return NULL;
+}
+
+// Lex code into a fresh arena-backed parser. The token array keeps its
+// storage when it is large enough, so callers may reuse one between parses.
+static int fossil_parser_begin(fossil_parser* parser, fossil_token_array* tokens, const fossil_keywords* keywords, const char* code, size_t length, size_t block_size) {
+    memset(parser, 0, sizeof(*parser));
+    parser->code = code;
+    parser->error = NO_ERRORS;
+
+    if (fossil_lex_range(keywords, code, 0, length, 1, 0, tokens) != 0) {
+        fscl_fossil_token_array_erase(tokens);
+        return 0;
+    }
+    parser->tokens = tokens->tokens;
+
+    parser->arena = fscl_fossil_arena_create(block_size);
+    if (parser->arena == NULL) {
+        fscl_fossil_token_array_erase(tokens);
+        return 0;
+    }
+    return 1;
+}
+
+// Hand the result to its arena, or drop the arena on error
+static ASTNode* fossil_parser_finish(fossil_parser* parser, ASTNode* result) {
+    if (parser->error != NO_ERRORS || result == NULL) {
+        if (!parser->quiet) {
+            setParseError(parser->error != NO_ERRORS ? parser->error : PARSING_ERROR);
+        }
+        fscl_fossil_arena_erase(parser->arena);
+        return NULL;
+    }
+
+    parser->arena->root = result;
+    return result;
+}
+
+// Parse a single declaration starting at *index and move *index past it
+static ASTNode* fossil_parse_declaration_at(const char* code, size_t* index, ASTNode* (*parse)(fossil_parser*)) {
+    fossil_parser parser;
+    fossil_token_array tokens = {NULL, 0, 0};
+    fossil_keywords keywords = fossil_global_keywords();
+    const char* start = code + *index;
+    size_t length = strlen(start);
+    if (length > UINT32_MAX - *index) {
+        return NULL;
+    }
+
+    if (!fossil_parser_begin(&parser, &tokens, &keywords, start, length, 0)) {
+        return NULL;
+    }
+    parser.base = (uint32_t)*index;
+
+    ASTNode* node = parse(&parser);
+    if (node != NULL && parser.pos > 0) {
+        const fossil_token* last = &parser.tokens[parser.pos - 1];
+        *index += last->offset + last->length;
+    }
+    fscl_fossil_token_array_erase(&tokens);
+    return fossil_parser_finish(&parser, node);
+}
+
+// Function to parse a statement into ASTNode
+ASTNode* fscl_fossil_parse_statement(const char* statement) {
+    if (statement == NULL) {
+        return NULL;
+    }
+
+    fossil_parser parser;
+    fossil_token_array tokens = {NULL, 0, 0};
+    fossil_keywords keywords = fossil_global_keywords();
+    if (!fossil_parser_begin(&parser, &tokens, &keywords, statement, strlen(statement), 0)) {
+        return NULL;
+    }
+
+    ASTNode* node = fossil_parse_statement_node(&parser);
+    fscl_fossil_token_array_erase(&tokens);
+    return fossil_parser_finish(&parser, node);
+}
+
+// Function to parse a function declaration
+ASTNode* fscl_fossil_parse_function_declaration(const char* code, size_t* index, const char* entryPoint) {
+    (void)entryPoint;
+    if (code == NULL || index == NULL) {
+        return NULL;
+    }
+    return fossil_parse_declaration_at(code, index, fossil_parse_function_node);
+}
+
+// Function to parse a class declaration
+ASTNode* fscl_fossil_parse_class_declaration(const char* code, size_t* index) {
+    if (code == NULL || index == NULL) {
+        return NULL;
+    }
+    return fossil_parse_declaration_at(code, index, fossil_parse_class_node);
+}
+
+// Parse a whole source into a root owned by its arena, using the keywords,
+// token buffer and diagnostics of ctx and leaving the outcome there. Quiet
+// parses leave the global error state alone. With diagnostics the parse
+// recovers from errors, records all of them and returns whatever parsed.
+static ASTNode* fossil_parse_source(fossil_parser_ctx* ctx, const char* code, size_t length, int quiet) {
+    fossil_keywords keywords = {ctx->open_brace, ctx->close_brace, ctx->function_keyword};
+    ctx->arena = NULL;
+    ctx->error = NO_ERRORS;
+    ctx->message[0] = '\0';
+
+    fossil_parser parser;
+    if (!fossil_parser_begin(&parser, &ctx->tokens, &keywords, code, length, ctx->arena_block_size)) {
+        ctx->error = PARSING_ERROR;
+        snprintf(ctx->message, sizeof(ctx->message), "Out of memory");
+        if (!quiet) {
+            setParseError(PARSING_ERROR);
+        }
+        return NULL;
+    }
+    parser.quiet = quiet;
+    parser.diagnostics = ctx->diagnostics;
+
+    // Every node and string of this parse lives in one arena owned by the root
+    ASTNode* rootNode = fossil_parser_node(&parser, 0, PLACEHOLDER_NODE, FOSSIL_PLACEHOLDER, ADD, NULL);
+
+    while (fossil_peek(&parser)->kind != FOSSIL_TOKEN_EOF) {
+        if (fossil_accept(&parser, FOSSIL_TOKEN_SEMICOLON)) {
+            continue;
+        }
+
+        size_t start = parser.pos;
+        ASTNode* node = fossil_parse_top_level(&parser);
+        if (node == NULL) {
+            if (!fossil_recover(&parser, start, 1)) {
+                break;
+            }
+            continue;
+        }
+        fscl_fossil_add_child(rootNode, node);
+    }
+
+    ctx->error = parser.error;
+    snprintf(ctx->message, sizeof(ctx->message), "%s", parser.message);
+    if (parser.diagnostics != NULL && rootNode != NULL) {
+        parser.arena->root = rootNode;
+        ctx->arena = parser.arena;
+        return rootNode;
+    }
+
+    rootNode = fossil_parser_finish(&parser, rootNode);
+    ctx->arena = rootNode != NULL ? rootNode->arena : NULL;
+    return rootNode;
+}
+
+// Function to parse DSL source held in memory into an AST
+ASTNode* fscl_fossil_parse_dsl_string(const char* code) {
+    if (code == NULL) {
+        return NULL;
+    }
+
+    // Initialize parsing error
+    resetParseError();
+
+    fossil_parser_ctx ctx;
+    fscl_fossil_parser_ctx_init(&ctx);
+    ASTNode* rootNode = fossil_parse_source(&ctx, code, strlen(code), 0);
+    fscl_fossil_parser_ctx_erase(&ctx);
+    return rootNode;
+}
+
+// Function to parse DSL source and collect every error
+ASTNode* fscl_fossil_parse_dsl_recover(const char* code, fossil_diagnostics* diagnostics) {
+    if (code == NULL || diagnostics == NULL) {
+        return NULL;
+    }
+
+    fossil_parser_ctx ctx;
+    fscl_fossil_parser_ctx_init(&ctx);
+    ctx.diagnostics = diagnostics;
+    ASTNode* rootNode = fscl_fossil_parser_ctx_parse(&ctx, code, strlen(code));
+    fscl_fossil_parser_ctx_erase(&ctx);
+    return rootNode;
+}
+
+// Function to initialize a parser context from the global keywords
+void fscl_fossil_parser_ctx_init(fossil_parser_ctx* ctx) {
+    if (ctx == NULL) {
+        return;
+    }
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->open_brace = OPEN_BRACE_KEYWORD;
+    ctx->close_brace = CLOSE_BRACE_KEYWORD;
+    ctx->function_keyword = FUNCTION_KEYWORD;
+    ctx->error = NO_ERRORS;
+}
+
+// Function to parse DSL source with a parser context
+ASTNode* fscl_fossil_parser_ctx_parse(fossil_parser_ctx* ctx, const char* code, size_t length) {
+    if (ctx == NULL || code == NULL) {
+        return NULL;
+    }
+    return fossil_parse_source(ctx, code, length, 1);
+}
+
+// Function to parse a DSL file with a parser context
+ASTNode* fscl_fossil_parser_ctx_parse_file(fossil_parser_ctx* ctx, const char* filename) {
+    if (ctx == NULL || filename == NULL) {
+        return NULL;
+    }
+
+    size_t length;
+    char* code = fossil_read_file(filename, &length);
+    if (code == NULL) {
+        ctx->arena = NULL;
+        ctx->error = PARSING_ERROR;
+        snprintf(ctx->message, sizeof(ctx->message), "Cannot read '%s'", filename);
+        return NULL;
+    }
+
+    ASTNode* rootNode = fossil_parse_source(ctx, code, length, 1);
+    free(code);
+    return rootNode;
+}
+
+// Function to free the buffers of a parser context
+void fscl_fossil_parser_ctx_erase(fossil_parser_ctx* ctx) {
+    if (ctx == NULL) {
+        return;
+    }
+
+    fscl_fossil_token_array_erase(&ctx->tokens);
+    ctx->arena = NULL;
+}
+
+// Function to parse a DSL file into an AST
+ASTNode* fscl_fossil_parse_dsl_file(const char* filename) {
+    // Read the content of the DSL file
+    size_t length;
+    char* code = fossil_read_file(filename, &length);
+    if (code == NULL) {
+        perror("Error reading file");
+        exit(EXIT_FAILURE);
+    }
+
+    // Initialize parsing error
+    resetParseError();
+
+    // Unchanged sources are loaded from the parse cache when one is set
+    const char* cache = fscl_fossil_get_cache_directory();
+    uint64_t key = cache != NULL ? fscl_fossil_source_key(code, length) : 0;
+    ASTNode* rootNode = cache != NULL ? fscl_fossil_cache_load(cache, key) : NULL;
+    if (rootNode == NULL) {
+        fossil_parser_ctx ctx;
+        fscl_fossil_parser_ctx_init(&ctx);
+        rootNode = fossil_parse_source(&ctx, code, length, 0);
+        fscl_fossil_parser_ctx_erase(&ctx);
+        if (rootNode != NULL && cache != NULL) {
+            fscl_fossil_cache_store(cache, key, rootNode);
+        }
+    }
+
+    // Free the memory allocated for the code, the AST holds its own copies
+    free(code);
+
+    return rootNode;
+}
+
+// =================================================================
+// Incremental documents
+// =================================================================
+
+// Declarations parsed from one range of a document
+typedef struct {
+    ASTNode** nodes;
+    fossil_span* spans;
+    size_t count;
+    size_t capacity;
+} fossil_parsed_range;
+
+// Erase the declarations of a parsed range and its arrays
+static void fossil_parsed_range_erase(fossil_parsed_range* range) {
+    for (size_t i = 0; i < range->count; ++i) {
+        fscl_fossil_erase_node(range->nodes[i]);
+    }
+    free(range->nodes);
+    free(range->spans);
+    memset(range, 0, sizeof(*range));
+}
+
+// Parse the top-level declarations in code[begin, end), each into its own
+// arena so they can later be replaced one by one. Returns 0 on success.
+static int fossil_parse_range(const char* code, size_t begin, size_t end, uint32_t line, size_t line_start, int quiet, fossil_parsed_range* range) {
+    fossil_token_array tokens = {NULL, 0, 0};
+    memset(range, 0, sizeof(*range));
+
+    fossil_keywords keywords = fossil_global_keywords();
+    if (fossil_lex_range(&keywords, code, begin, end, line, line_start, &tokens) != 0) {
+        fscl_fossil_token_array_erase(&tokens);
+        return -1;
+    }
+
+    fossil_parser parser;
+    memset(&parser, 0, sizeof(parser));
+    parser.code = code;
+    parser.tokens = tokens.tokens;
+    parser.error = NO_ERRORS;
+    parser.quiet = quiet;
+
+    while (parser.error == NO_ERRORS && fossil_peek(&parser)->kind != FOSSIL_TOKEN_EOF) {
+        if (fossil_accept(&parser, FOSSIL_TOKEN_SEMICOLON)) {
+            continue;
+        }
+
+        if (range->count == range->capacity) {
+            size_t capacity = range->capacity == 0 ? 16 : range->capacity * 2;
+            ASTNode** nodes = (ASTNode**)realloc(range->nodes, capacity * sizeof(ASTNode*));
+            fossil_span* spans = nodes != NULL ? (fossil_span*)realloc(range->spans, capacity * sizeof(fossil_span)) : NULL;
+            if (nodes != NULL) {
+                range->nodes = nodes;
+            }
+            if (spans == NULL) {
+                parser.error = PARSING_ERROR;
+                break;
+            }
+            range->spans = spans;
+            range->capacity = capacity;
+        }
+
+        parser.arena = fscl_fossil_arena_create(0);
+        if (parser.arena == NULL) {
+            parser.error = PARSING_ERROR;
+            break;
+        }
+
+        // Offsets are relative to the declaration, so edits before it leave its nodes alone
+        const fossil_token* first = fossil_peek(&parser);
+        parser.base = 0u - first->offset;
+        ASTNode* node = fossil_parse_top_level(&parser);
+        if (node == NULL) {
+            fscl_fossil_arena_erase(parser.arena);
+            break;
+        }
+        parser.arena->root = node;
+
+        const fossil_token* last = &parser.tokens[parser.pos - 1];
+        range->nodes[range->count] = node;
+        range->spans[range->count].start = first->offset;
+        range->spans[range->count].end = last->offset + last->length;
+        range->spans[range->count].line = first->line;
+        range->spans[range->count].end_line = last->line;
+        range->count++;
+    }
+
+    fscl_fossil_token_array_erase(&tokens);
+    if (parser.error != NO_ERRORS) {
+        if (!quiet) {
+            setParseError(parser.error);
+        }
+        fossil_parsed_range_erase(range);
+        return -1;
+    }
+    return 0;
+}
+
+// Offset of the first character of the line containing offset
+static size_t fossil_line_start(const char* code, size_t offset) {
+    while (offset > 0 && code[offset - 1] != '\n') {
+        offset--;
+    }
+    return offset;
+}
+
+// Count the newlines in a span
+static uint32_t fossil_count_lines(const char* text, size_t length) {
+    uint32_t lines = 0;
+    for (size_t i = 0; i < length; ++i) {
+        lines += text[i] == '\n';
+    }
+    return lines;
+}
+
+// Replace children [first, last) of the document root with a parsed range
+static int fossil_document_splice(fossil_document* doc, size_t first, size_t last, fossil_parsed_range* range) {
+    size_t old_count = doc->root->num_children;
+    size_t new_count = old_count - (last - first) + range->count;
+
+    // Rebuild the children through fscl_fossil_add_child so the root keeps
+    // its normal growth policy
+    ASTNode** old_children = doc->root->children;
+    fossil_span* spans = (fossil_span*)malloc((new_count > 0 ? new_count : 1) * sizeof(fossil_span));
+    if (spans == NULL) {
+        return -1;
+    }
+
+    doc->root->children = NULL;
+    doc->root->num_children = 0;
+    size_t used = 0;
+    for (size_t i = 0; i < first; ++i) {
+        fscl_fossil_add_child(doc->root, old_children[i]);
+        spans[used++] = doc->spans[i];
+    }
+    for (size_t i = 0; i < range->count; ++i) {
+        fscl_fossil_add_child(doc->root, range->nodes[i]);
+        spans[used++] = range->spans[i];
+    }
+    for (size_t i = last; i < old_count; ++i) {
+        fscl_fossil_add_child(doc->root, old_children[i]);
+        spans[used++] = doc->spans[i];
+    }
+    for (size_t i = first; i < last; ++i) {
+        fscl_fossil_erase_node(old_children[i]);
+    }
+
+    free(old_children);
+    free(doc->spans);
+    doc->spans = spans;
+
+    // The nodes now belong to the root
+    free(range->nodes);
+    free(range->spans);
+    memset(range, 0, sizeof(*range));
+
+    if (doc->root->error_flag || doc->root->num_children != new_count) {
+        return -1;
+    }
+    return 0;
+}
+
+// Parse the whole text, replacing any previous tree
+static int fossil_document_parse_all(fossil_document* doc) {
+    fscl_fossil_erase_node(doc->root);
+    free(doc->spans);
+    doc->root = NULL;
+    doc->spans = NULL;
+    doc->reparsed = 0;
+
+    fossil_parsed_range range;
+    if (fossil_parse_range(doc->code, 0, doc->length, 1, 0, 0, &range) != 0) {
+        return -1;
+    }
+
+    doc->root = fscl_fossil_create_node(PLACEHOLDER_NODE, FOSSIL_PLACEHOLDER, ADD, NULL);
+    doc->reparsed = range.count;
+    if (fossil_document_splice(doc, 0, 0, &range) != 0) {
+        fossil_parsed_range_erase(&range);
+        fscl_fossil_erase_node(doc->root);
+        doc->root = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Function to open a document from source text
+int fscl_fossil_document_open(fossil_document* doc, const char* code) {
+    if (doc == NULL || code == NULL) {
+        return -1;
+    }
+    memset(doc, 0, sizeof(*doc));
+
+    // Initialize parsing error
+    resetParseError();
+
+    doc->length = strlen(code);
+    doc->code = fossil_copy_span(NULL, code, doc->length);
+    if (doc->code == NULL) {
+        return -1;
+    }
+    return fossil_document_parse_all(doc);
+}
+
+// Function to open a document from a DSL file
+int fscl_fossil_document_load(fossil_document* doc, const char* filename) {
+    if (doc == NULL || filename == NULL) {
+        return -1;
+    }
+
+    memset(doc, 0, sizeof(*doc));
+
+    // A missing or unreadable file leaves an empty document behind
+    size_t length;
+    char* code = fossil_read_file(filename, &length);
+    if (code == NULL) {
+        return -1;
+    }
+
+    // Initialize parsing error
+    resetParseError();
+
+    // The document keeps the text it was read into
+    doc->code = code;
+    doc->length = length;
+    return fossil_document_parse_all(doc);
+}
+
+// Function to apply an edit and reparse only the declarations it touches
+int fscl_fossil_document_edit(fossil_document* doc, size_t offset, size_t removed, const char* text, size_t text_length) {
+    if (doc == NULL || doc->code == NULL || offset > doc->length || removed > doc->length - offset || (text == NULL && text_length > 0)) {
+        return -1;
+    }
+
+    // Apply the edit to the text
+    size_t new_length = doc->length - removed + text_length;
+    if (new_length > UINT32_MAX) {
+        return -1;
+    }
+    char* code = (char*)malloc(new_length + 1);
+    if (code == NULL) {
+        return -1;
+    }
+    memcpy(code, doc->code, offset);
+    if (text_length > 0) {
+        memcpy(code + offset, text, text_length);
+    }
+    memcpy(code + offset + text_length, doc->code + offset + removed, doc->length - offset - removed + 1);
+
+    int64_t delta = (int64_t)text_length - (int64_t)removed;
+    int64_t line_delta = (int64_t)fossil_count_lines(text, text_length) - (int64_t)fossil_count_lines(doc->code + offset, removed);
+    free(doc->code);
+    doc->code = code;
+    doc->length = new_length;
+
+    resetParseError();
+
+    // Without a tree to reuse there is nothing to be incremental about
+    size_t count = doc->root != NULL ? doc->root->num_children : 0;
+    if (count == 0) {
+        return fossil_document_parse_all(doc);
+    }
+
+    // First declaration that may change: the one the edit touches, or the one
+    // before a gap, since new indented lines there extend its body
+    size_t first = 0;
+    while (first < count && doc->spans[first].end < offset) {
+        first++;
+    }
+    if (first > 0 && (first == count || doc->spans[first].start > offset)) {
+        first--;
+    }
+
+    // Declarations starting after the edit are unchanged apart from their position
+    size_t after = first;
+    while (after < count && doc->spans[after].start <= offset + removed) {
+        after++;
+    }
+
+    size_t begin = first > 0 ? doc->spans[first - 1].end : 0;
+    uint32_t line = first > 0 ? doc->spans[first - 1].end_line : 1;
+    size_t line_start = fossil_line_start(code, begin);
+
+    // Reparse up to the next unchanged declaration; if the range does not end
+    // on a declaration boundary there, widen it and try again
+    fossil_parsed_range range;
+    size_t resume = after;
+    size_t step = 1;
+    for (;;) {
+        size_t end = resume < count ? (size_t)((int64_t)doc->spans[resume].start + delta) : new_length;
+        if (fossil_parse_range(code, begin, end, line, line_start, resume < count, &range) == 0) {
+            break;
+        }
+        if (resume == count) {
+            // The text does not parse; the next edit starts from scratch
+            fscl_fossil_erase_node(doc->root);
+            free(doc->spans);
+            doc->root = NULL;
+            doc->spans = NULL;
+            doc->reparsed = 0;
+            return -1;
+        }
+        resume = resume + step < count ? resume + step : count;
+        step *= 2;
+    }
+
+    // Shift the reused declarations
+    for (size_t i = resume; i < count; ++i) {
+        doc->spans[i].start = (uint32_t)((int64_t)doc->spans[i].start + delta);
+        doc->spans[i].end = (uint32_t)((int64_t)doc->spans[i].end + delta);
+        doc->spans[i].line = (uint32_t)((int64_t)doc->spans[i].line + line_delta);
+        doc->spans[i].end_line = (uint32_t)((int64_t)doc->spans[i].end_line + line_delta);
+    }
+
+    doc->reparsed = range.count;
+    if (fossil_document_splice(doc, first, resume, &range) != 0) {
+        fossil_parsed_range_erase(&range);
+        return fossil_document_parse_all(doc);
+    }
+    return 0;
+}
+
+// Function to free a document and its tree
+void fscl_fossil_document_erase(fossil_document* doc) {
+    if (doc == NULL) {
+        return;
+    }
+
+    fscl_fossil_erase_node(doc->root);
+    free(doc->spans);
+    free(doc->code);
+    memset(doc, 0, sizeof(*doc));
+}
+
+// =================================================================
+// Flat AST
+// =================================================================
+
+// Grow every column of a flat AST to hold at least one more node
+static int fossil_flat_reserve(fossil_flat_ast* flat) {
+    if (flat->count < flat->capacity) {
+        return 0;
+    }
+    if (flat->capacity >= UINT32_MAX / 2) {
+        return -1;
+    }
+
+    uint32_t capacity = flat->capacity == 0 ? 64 : flat->capacity * 2;
+#define FOSSIL_FLAT_GROW(column, type) \
+    do { \
+        type* grown = (type*)realloc(flat->column, capacity * sizeof(type)); \
+        if (grown == NULL) { return -1; } \
+        flat->column = grown; \
+    } while (0)
+
+    FOSSIL_FLAT_GROW(kinds, uint8_t);
+    FOSSIL_FLAT_GROW(types, uint8_t);
+    FOSSIL_FLAT_GROW(operators, uint8_t);
+    FOSSIL_FLAT_GROW(flags, uint8_t);
+    FOSSIL_FLAT_GROW(first_child, uint32_t);
+    FOSSIL_FLAT_GROW(next_sibling, uint32_t);
+    FOSSIL_FLAT_GROW(value_offset, uint32_t);
+    FOSSIL_FLAT_GROW(value_length, uint32_t);
+
+#undef FOSSIL_FLAT_GROW
+    flat->capacity = capacity;
+    return 0;
+}
+
+// Copy a value into the string pool of a flat AST
+static int fossil_flat_intern(fossil_flat_ast* flat, const char* value, uint32_t* offset, uint32_t* length) {
+    size_t size = strlen(value);
+    if (size >= UINT32_MAX - flat->strings_length - 1) {
+        return -1;
+    }
+
+    if (flat->strings_length + size + 1 > flat->strings_capacity) {
+        size_t capacity = flat->strings_capacity == 0 ? 1024 : (size_t)flat->strings_capacity * 2;
+        while (capacity < flat->strings_length + size + 1) {
+            capacity *= 2;
+        }
+        if (capacity > UINT32_MAX) {
+            capacity = UINT32_MAX;
+        }
+        char* grown = (char*)realloc(flat->strings, capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        flat->strings = grown;
+        flat->strings_capacity = (uint32_t)capacity;
+    }
+
+    *offset = flat->strings_length;
+    *length = (uint32_t)size;
+    memcpy(flat->strings + flat->strings_length, value, size + 1);
+    flat->strings_length += (uint32_t)size + 1;
+    return 0;
+}
+
+// Function to free the storage of a flat AST
+void fscl_fossil_flat_erase(fossil_flat_ast* flat) {
+    if (flat == NULL) {
+        return;
+    }
+
+    free(flat->kinds);
+    free(flat->types);
+    free(flat->operators);
+    free(flat->flags);
+    free(flat->first_child);
+    free(flat->next_sibling);
+    free(flat->value_offset);
+    free(flat->value_length);
+    free(flat->strings);
+    memset(flat, 0, sizeof(*flat));
+}
+
+// Function to convert a pointer-based AST into a flat AST
+int fscl_fossil_flat_from_ast(const ASTNode* root, fossil_flat_ast* flat) {
+    if (root == NULL || flat == NULL) {
+        return -1;
+    }
+    memset(flat, 0, sizeof(*flat));
+
+    // Explicit stack of (node, flat parent); children are pushed in reverse
+    // so they pop in order and the arrays come out in pre-order.
+    typedef struct {
+        const ASTNode* node;
+        uint32_t parent;
+    } fossil_flat_pending;
+
+    size_t stack_capacity = 64;
+    size_t stack_size = 0;
+    fossil_flat_pending* stack = (fossil_flat_pending*)malloc(stack_capacity * sizeof(fossil_flat_pending));
+    uint32_t* last_child = NULL;
+    uint32_t last_capacity = 0;
+    int result = stack == NULL ? -1 : 0;
+
+    if (stack != NULL) {
+        stack[stack_size++] = (fossil_flat_pending){root, FOSSIL_FLAT_NONE};
+    }
+
+    while (result == 0 && stack_size > 0) {
+        fossil_flat_pending pending = stack[--stack_size];
+        const ASTNode* node = pending.node;
+
+        if (fossil_flat_reserve(flat) != 0) {
+            result = -1;
+            break;
+        }
+        if (last_capacity < flat->capacity) {
+            uint32_t* grown = (uint32_t*)realloc(last_child, flat->capacity * sizeof(uint32_t));
+            if (grown == NULL) {
+                result = -1;
+                break;
+            }
+            last_child = grown;
+            last_capacity = flat->capacity;
+        }
+
+        uint32_t index = flat->count++;
+        flat->kinds[index] = (uint8_t)node->type;
+        flat->types[index] = (uint8_t)node->data_type;
+        flat->operators[index] = (uint8_t)node->operator_type;
+        flat->flags[index] = (uint8_t)((node->is_public ? FOSSIL_FLAT_PUBLIC : 0) | (node->error_flag ? FOSSIL_FLAT_ERROR : 0));
+        flat->first_child[index] = FOSSIL_FLAT_NONE;
+        flat->next_sibling[index] = FOSSIL_FLAT_NONE;
+        flat->value_offset[index] = 0;
+        flat->value_length[index] = 0;
+        last_child[index] = FOSSIL_FLAT_NONE;
+
+        if (node->value != NULL) {
+            if (fossil_flat_intern(flat, node->value, &flat->value_offset[index], &flat->value_length[index]) != 0) {
+                result = -1;
+                break;
+            }
+            flat->flags[index] |= FOSSIL_FLAT_HAS_VALUE;
+        }
+
+        // Link the node after the previous child of its parent
+        if (pending.parent != FOSSIL_FLAT_NONE) {
+            if (last_child[pending.parent] == FOSSIL_FLAT_NONE) {
+                flat->first_child[pending.parent] = index;
+            } else {
+                flat->next_sibling[last_child[pending.parent]] = index;
+            }
+            last_child[pending.parent] = index;
+        }
+
+        if (stack_size + node->num_children > stack_capacity) {
+            while (stack_size + node->num_children > stack_capacity) {
+                stack_capacity *= 2;
+            }
+            fossil_flat_pending* grown = (fossil_flat_pending*)realloc(stack, stack_capacity * sizeof(fossil_flat_pending));
+            if (grown == NULL) {
+                result = -1;
+                break;
+            }
+            stack = grown;
+        }
+        for (size_t i = node->num_children; i > 0; --i) {
+            if (node->children[i - 1] != NULL) {
+                stack[stack_size++] = (fossil_flat_pending){node->children[i - 1], index};
+            }
+        }
+    }
+
+    free(stack);
+    free(last_child);
+    if (result != 0) {
+        fscl_fossil_flat_erase(flat);
+    }
+    return result;
+}
+
+// Function to get the value of a node in a flat AST
+const char* fscl_fossil_flat_value(const fossil_flat_ast* flat, uint32_t index) {
+    if (flat == NULL || index >= flat->count || !(flat->flags[index] & FOSSIL_FLAT_HAS_VALUE)) {
+        return NULL;
+    }
+    return flat->strings + flat->value_offset[index];
+}
+
+// Function to count the children of a node in a flat AST
+uint32_t fscl_fossil_flat_num_children(const fossil_flat_ast* flat, uint32_t index) {
+    if (flat == NULL || index >= flat->count) {
+        return 0;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t child = flat->first_child[index]; child != FOSSIL_FLAT_NONE; child = flat->next_sibling[child]) {
+        count++;
+    }
+    return count;
+}
+
+// Function to walk a flat subtree depth-first in pre-order
+int fscl_fossil_flat_visit(const fossil_flat_ast* flat, uint32_t index, fossil_flat_visitor visitor, void* user_data) {
+    if (flat == NULL || visitor == NULL || index >= flat->count) {
+        return 0;
+    }
+
+    // The stack holds the ancestors of the current node, so its size is the depth
+    size_t capacity = 64;
+    uint32_t* ancestors = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    if (ancestors == NULL) {
+        return -1;
+    }
+
+    size_t depth = 0;
+    uint32_t node = index;
+    int result = 0;
+
+    for (;;) {
+        if (visitor(flat, node, (uint32_t)depth, user_data) != 0) {
+            result = 1;
+            break;
+        }
+
+        // Descend into the first child
+        if (flat->first_child[node] != FOSSIL_FLAT_NONE) {
+            if (depth == capacity) {
+                capacity *= 2;
+                uint32_t* grown = (uint32_t*)realloc(ancestors, capacity * sizeof(uint32_t));
+                if (grown == NULL) {
+                    result = -1;
+                    break;
+                }
+                ancestors = grown;
+            }
+            ancestors[depth++] = node;
+            node = flat->first_child[node];
+            continue;
+        }
+
+        // Otherwise move to the next sibling of the nearest ancestor that has one
+        while (depth > 0 && flat->next_sibling[node] == FOSSIL_FLAT_NONE) {
+            node = ancestors[--depth];
+        }
+        if (depth == 0) {
+            break;
+        }
+        node = flat->next_sibling[node];
+    }
+
+    free(ancestors);
+    return result;
+}
+
+// Function to visit every node of a flat AST in storage order
+int fscl_fossil_flat_for_each(const fossil_flat_ast* flat, fossil_flat_visitor visitor, void* user_data) {
+    if (flat == NULL || visitor == NULL) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < flat->count; ++i) {
+        if (visitor(flat, i, 0, user_data) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// =================================================================
+// Optimization
+// =================================================================
+
+enum {
+    FOSSIL_PASS_FOLD = 1,
+    FOSSIL_PASS_DEAD_CODE = 2
+};
+
+// Numeric view of a CONSTANT node
+typedef struct {
+    int is_float;
+    int64_t integer;
+    double number;
+} fossil_fold_number;
+
+// Read a numeric constant, returning 0 when the node is not one
+static int fossil_fold_read_number(const ASTNode* node, fossil_fold_number* number) {
+    if (node == NULL || node->type != CONSTANT || node->value == NULL) {
+        return 0;
+    }
+
+    number->is_float = 0;
+    switch (node->data_type) {
+        case FOSSIL_INT: case FOSSIL_INT8: case FOSSIL_INT16: case FOSSIL_INT32: case FOSSIL_INT64:
+        case FOSSIL_UINT: case FOSSIL_UINT8: case FOSSIL_UINT16: case FOSSIL_UINT32: case FOSSIL_UINT64:
+            number->integer = strtoll(node->value, NULL, 10);
+            break;
+        case FOSSIL_HEX:
+        case FOSSIL_OCT:
+            number->integer = strlen(node->value) > 2 ? strtoll(node->value + 2, NULL, node->data_type == FOSSIL_HEX ? 16 : 8) : 0;
+            break;
+        case FOSSIL_FLOAT:
+            number->is_float = 1;
+            number->number = strtod(node->value, NULL);
+            return 1;
+        default:
+            return 0;
+    }
+    number->number = (double)number->integer;
+    return 1;
+}
+
+// Truth value of a constant, matching the virtual machine; -1 if unknown
+static int fossil_fold_truth(const ASTNode* node) {
+    fossil_fold_number number;
+    if (node == NULL || node->type != CONSTANT) {
+        return -1;
+    }
+    if (fossil_fold_read_number(node, &number)) {
+        return number.is_float ? number.number != 0.0 : number.integer != 0;
+    }
+
+    const char* text = node->value != NULL ? node->value : "";
+    switch (node->data_type) {
+        case FOSSIL_BOOL:      return strcmp(text, "true") == 0;
+        case FOSSIL_NULL_TYPE: return 0;
+        case FOSSIL_STRING:
+        case FOSSIL_CHAR:      return text[0] != '\0';
+        default:               return -1;
+    }
+}
+
+// Create a folded constant next to the node it replaces. Heap constants
+// carry their text in the same allocation, so erasing the node frees both.
+static ASTNode* fossil_fold_constant(const ASTNode* like, DataType data_type, const char* text, size_t length) {
+    ASTNode* node;
+    char* value;
+
+    if (like->arena != NULL) {
+        node = fossil_new_node(like->arena, CONSTANT, data_type, ADD, NULL);
+        value = fscl_fossil_arena_strndup(like->arena, text, length);
+        if (value == NULL) {
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        node = (ASTNode*)malloc(sizeof(ASTNode) + length + 1);
+        if (node == NULL) {
+            exit(EXIT_FAILURE);
+        }
+        memset(node, 0, sizeof(ASTNode));
+        node->type = CONSTANT;
+        node->data_type = data_type;
+        node->operator_type = ADD;
+        value = (char*)(node + 1);
+        memcpy(value, text, length);
+        value[length] = '\0';
+    }
+
+    node->value = value;
+    node->source_offset = like->source_offset;
+    return node;
+}
+
+// Create a folded number constant
+static ASTNode* fossil_fold_number_node(const ASTNode* like, const fossil_fold_number* number) {
+    char digits[32];
+    int length = number->is_float ? snprintf(digits, sizeof(digits), "%.17g", number->number)
+                                   : snprintf(digits, sizeof(digits), "%lld", (long long)number->integer);
+    return fossil_fold_constant(like, number->is_float ? FOSSIL_FLOAT : FOSSIL_INT, digits, (size_t)length);
+}
+
+// Create a folded bool constant
+static ASTNode* fossil_fold_bool_node(const ASTNode* like, int value) {
+    return value ? fossil_fold_constant(like, FOSSIL_BOOL, "true", 4) : fossil_fold_constant(like, FOSSIL_BOOL, "false", 5);
+}
+
+// Fold an arithmetic operation on two numbers, returning 0 if it must stay
+static int fossil_fold_arith(OperatorType op, const fossil_fold_number* a, const fossil_fold_number* b, fossil_fold_number* out) {
+    if (!a->is_float && !b->is_float) {
+        uint64_t x = (uint64_t)a->integer;
+        uint64_t y = (uint64_t)b->integer;
+        out->is_float = 0;
+        switch (op) {
+            case ADD:      out->integer = (int64_t)(x + y); return 1;
+            case SUBTRACT: out->integer = (int64_t)(x - y); return 1;
+            case MULTIPLY: out->integer = (int64_t)(x * y); return 1;
+            case DIVIDE:
+            case MODULO:
+                if (b->integer == 0) {
+                    return 0;
+                }
+                if (b->integer == -1) {
+                    out->integer = op == DIVIDE ? (int64_t)(0 - x) : 0;
+                } else {
+                    out->integer = op == DIVIDE ? a->integer / b->integer : a->integer % b->integer;
+                }
+                return 1;
+            default:
+                return 0;
+        }
+    }
+
+    out->is_float = 1;
+    switch (op) {
+        case ADD:      out->number = a->number + b->number; break;
+        case SUBTRACT: out->number = a->number - b->number; break;
+        case MULTIPLY: out->number = a->number * b->number; break;
+        case DIVIDE:
+            if (b->number == 0.0) {
+                return 0;
+            }
+            out->number = a->number / b->number;
+            break;
+        default:
+            return 0;
+    }
+
+    // Infinities and NaN have no literal, so they are left for run time
+    return out->number - out->number == 0.0;
+}
+
+// Fold a relational operation on two constants, returning -1 if it must stay
+static int fossil_fold_compare(OperatorType op, const ASTNode* left, const ASTNode* right) {
+    fossil_fold_number a;
+    fossil_fold_number b;
+    int order;
+
+    if (fossil_fold_read_number(left, &a) && fossil_fold_read_number(right, &b)) {
+        if (!a.is_float && !b.is_float) {
+            order = (a.integer > b.integer) - (a.integer < b.integer);
+        } else {
+            order = (a.number > b.number) - (a.number < b.number);
+        }
+    } else if (left->data_type == FOSSIL_STRING && right->data_type == FOSSIL_STRING && left->value != NULL && right->value != NULL) {
+        order = strcmp(left->value, right->value);
+    } else {
+        return -1;
+    }
+
+    switch (op) {
+        case EQUALS:        return order == 0;
+        case NOT_EQUALS:    return order != 0;
+        case LESS_THAN:     return order < 0;
+        case LESS_EQUAL:    return order <= 0;
+        case GREATER_THAN:  return order > 0;
+        case GREATER_EQUAL: return order >= 0;
+        default:            return -1;
+    }
+}
+
+// Fold an operation node whose operands are already folded; NULL if it must stay
+static ASTNode* fossil_fold_node(ASTNode* node) {
+    ASTNode* left = node->num_children > 0 ? node->children[0] : NULL;
+    ASTNode* right = node->num_children > 1 ? node->children[1] : NULL;
+    fossil_fold_number a;
+    fossil_fold_number b;
+    fossil_fold_number result;
+
+    switch (node->type) {
+        case BINARY_OP:
+            if (node->num_children != 2) {
+                return NULL;
+            }
+            if (fossil_fold_read_number(left, &a) && fossil_fold_read_number(right, &b)) {
+                return fossil_fold_arith(node->operator_type, &a, &b, &result) ? fossil_fold_number_node(node, &result) : NULL;
+            }
+            if (node->operator_type == ADD && left->type == CONSTANT && right->type == CONSTANT &&
+                left->data_type == FOSSIL_STRING && right->data_type == FOSSIL_STRING) {
+                size_t left_length = strlen(left->value);
+                size_t right_length = strlen(right->value);
+                char* joined = (char*)malloc(left_length + right_length + 1);
+                if (joined == NULL) {
+                    return NULL;
+                }
+                memcpy(joined, left->value, left_length);
+                memcpy(joined + left_length, right->value, right_length + 1);
+                ASTNode* folded = fossil_fold_constant(node, FOSSIL_STRING, joined, left_length + right_length);
+                free(joined);
+                return folded;
+            }
+            return NULL;
+        case RELATIONAL_OP: {
+            if (node->num_children != 2 || left->type != CONSTANT || right->type != CONSTANT) {
+                return NULL;
+            }
+            int value = fossil_fold_compare(node->operator_type, left, right);
+            return value < 0 ? NULL : fossil_fold_bool_node(node, value);
+        }
+        case UNARY_OP:
+            if (node->num_children != 1) {
+                return NULL;
+            }
+            if (node->operator_type == NEGATION && fossil_fold_read_number(left, &a)) {
+                result = a;
+                if (a.is_float) {
+                    result.number = -a.number;
+                } else {
+                    result.integer = (int64_t)(0 - (uint64_t)a.integer);
+                }
+                return fossil_fold_number_node(node, &result);
+            }
+            if (node->operator_type == NOT) {
+                int truth = fossil_fold_truth(left);
+                return truth < 0 ? NULL : fossil_fold_bool_node(node, !truth);
+            }
+            return NULL;
+        default:
+            return NULL;
+    }
+}
+
+// Detach a child so erasing its old parent leaves it alone
+static ASTNode* fossil_detach_child(ASTNode* parent, size_t index) {
+    ASTNode* child = parent->children[index];
+    parent->children[index] = NULL;
+    return child;
+}
+
+// Erase a subtree that was cut out of the tree
+static void fossil_discard(ASTNode* node) {
+    // Arena nodes are reclaimed with their arena, heap nodes below them are not
+    if (node != NULL && node->arena == NULL) {
+        fscl_fossil_erase_node(node);
+    } else if (node != NULL && node->arena->num_adopted > 0) {
+        fscl_fossil_visit(node, fossil_erase_adopted, NULL, node->arena);
+    }
+}
+
+// Optimize the children of a node, then the node itself. Returns the node,
+// its replacement, or NULL when it should be removed.
+static ASTNode* fossil_optimize_node(ASTNode* node, int passes, size_t* changes) {
+    for (size_t i = 0; i < node->num_children; ++i) {
+        ASTNode* child = node->children[i];
+        if (child == NULL) {
+            continue;
+        }
+
+        uint32_t offset = child->source_offset;
+        ASTNode* replacement = fossil_optimize_node(child, passes, changes);
+        if (replacement == child) {
+            continue;
+        }
+        if (replacement != NULL) {
+            node->children[i] = replacement;
+            continue;
+        }
+
+        // Removed: drop it from blocks and else branches, elsewhere keep an empty block
+        if (node->type == BLOCK_STATEMENT || (node->type == IF_STATEMENT && i == 2)) {
+            memmove(&node->children[i], &node->children[i + 1], (node->num_children - i - 1) * sizeof(ASTNode*));
+            node->num_children--;
+            --i;
+        } else {
+            node->children[i] = fossil_new_node(node->arena, BLOCK_STATEMENT, FOSSIL_TOFU, ADD, NULL);
+            node->children[i]->source_offset = offset;
+        }
+    }
+
+    if (passes & FOSSIL_PASS_DEAD_CODE) {
+        // Nothing after a return in the same block can run
+        if (node->type == BLOCK_STATEMENT) {
+            for (size_t i = 0; i + 1 < node->num_children; ++i) {
+                if (node->children[i] != NULL && node->children[i]->type == RETURN_STATEMENT) {
+                    for (size_t j = i + 1; j < node->num_children; ++j) {
+                        fossil_discard(node->children[j]);
+                        (*changes)++;
+                    }
+                    node->num_children = i + 1;
+                    break;
+                }
+            }
+        }
+
+        if (node->type == IF_STATEMENT && node->num_children >= 2) {
+            int truth = fossil_fold_truth(node->children[0]);
+            if (truth >= 0) {
+                ASTNode* branch = truth ? fossil_detach_child(node, 1) : node->num_children > 2 ? fossil_detach_child(node, 2) : NULL;
+                fossil_discard(node);
+                (*changes)++;
+                return branch;
+            }
+        }
+
+        if (node->type == WHILE_LOOP && node->num_children >= 1 && fossil_fold_truth(node->children[0]) == 0) {
+            fossil_discard(node);
+            (*changes)++;
+            return NULL;
+        }
+    }
+
+    if (passes & FOSSIL_PASS_FOLD) {
+        ASTNode* folded = fossil_fold_node(node);
+        if (folded != NULL) {
+            fossil_discard(node);
+            (*changes)++;
+            return folded;
+        }
+
+        // Short circuit on a constant left side, keeping the machine's value semantics
+        if (node->type == LOGICAL_OP && node->num_children == 2) {
+            int truth = fossil_fold_truth(node->children[0]);
+            if (truth >= 0) {
+                int keep_left = node->operator_type == AND ? !truth : truth;
+                ASTNode* result = fossil_detach_child(node, keep_left ? 0 : 1);
+                fossil_discard(node);
+                (*changes)++;
+                return result;
+            }
+        }
+    }
+
+    return node;
+}
+
+// Run the given passes over every child of the root
+static size_t fossil_optimize_root(ASTNode* root, int passes) {
+    if (root == NULL) {
+        return 0;
+    }
+
+    size_t changes = 0;
+    for (size_t i = 0; i < root->num_children; ++i) {
+        ASTNode* child = root->children[i];
+        if (child == NULL) {
+            continue;
+        }
+        ASTNode* replacement = fossil_optimize_node(child, passes, &changes);
+        if (replacement == NULL) {
+            memmove(&root->children[i], &root->children[i + 1], (root->num_children - i - 1) * sizeof(ASTNode*));
+            root->num_children--;
+            --i;
+        } else {
+            root->children[i] = replacement;
+        }
+    }
+    return changes;
+}
+
+// Function to fold constant expressions in place
+size_t fscl_fossil_fold_constants(ASTNode* root) {
+    return fossil_optimize_root(root, FOSSIL_PASS_FOLD);
+}
+
+// Function to remove dead code in place
+size_t fscl_fossil_eliminate_dead_code(ASTNode* root) {
+    return fossil_optimize_root(root, FOSSIL_PASS_DEAD_CODE);
+}
+
+// Function to run folding and dead-code elimination until nothing changes
+size_t fscl_fossil_optimize(ASTNode* root) {
+    size_t total = 0;
+    size_t changes;
+    do {
+        changes = fossil_optimize_root(root, FOSSIL_PASS_FOLD | FOSSIL_PASS_DEAD_CODE);
+        total += changes;
+    } while (changes > 0);
+    return total;
+}
+
+// =================================================================
+// Bytecode compiler
+// =================================================================
+
+enum {
+    FOSSIL_VM_MAX_FRAMES = 1024
+};
+
+// Local variable visible in the current scope
+typedef struct {
+    const char* name;
+    uint32_t slot;
+} fossil_local;
+
+// State of one compilation
+typedef struct {
+    fossil_program* program;
+    const ASTNode** declarations;  // FUNCTION node of each function index
+    fossil_local* locals;
+    size_t num_locals;
+    size_t locals_capacity;
+    uint32_t next_slot;
+    int depth;
+    int max_depth;
+    int failed;
+} fossil_compiler;
+
+// Record the first compile error
+static void fossil_compile_error(fossil_compiler* compiler, const char* format, const char* name) {
+    if (!compiler->failed) {
+        snprintf(compiler->program->error, sizeof(compiler->program->error), format, name != NULL ? name : "");
+        compiler->failed = 1;
+    }
+}
+
+// Append one word to the code
+static void fossil_emit_word(fossil_compiler* compiler, uint32_t word) {
+    fossil_program* program = compiler->program;
+    if (program->code_size == program->code_capacity) {
+        size_t capacity = program->code_capacity == 0 ? 256 : program->code_capacity * 2;
+        uint32_t* grown = (uint32_t*)realloc(program->code, capacity * sizeof(uint32_t));
+        if (grown == NULL) {
+            fossil_compile_error(compiler, "Out of memory%s", NULL);
+            return;
+        }
+        program->code = grown;
+        program->code_capacity = capacity;
+    }
+    program->code[program->code_size++] = word;
+}
+
+// Append an opcode and track the operand stack depth
+static void fossil_emit_op(fossil_compiler* compiler, fossil_opcode op, int effect) {
+    fossil_emit_word(compiler, (uint32_t)op);
+    compiler->depth += effect;
+    if (compiler->depth > compiler->max_depth) {
+        compiler->max_depth = compiler->depth;
+    }
+}
+
+// Emit a jump with an unknown target and return the operand position
+static size_t fossil_emit_jump(fossil_compiler* compiler, fossil_opcode op, int effect) {
+    fossil_emit_op(compiler, op, effect);
+    fossil_emit_word(compiler, 0);
+    return compiler->program->code_size - 1;
+}
+
+// Point a previously emitted jump at the current position
+static void fossil_patch_jump(fossil_compiler* compiler, size_t operand) {
+    if (!compiler->failed) {
+        compiler->program->code[operand] = (uint32_t)compiler->program->code_size;
+    }
+}
+
+// Add a constant to the pool and return its index
+static uint32_t fossil_add_constant(fossil_compiler* compiler, fossil_value value) {
+    fossil_program* program = compiler->program;
+    if (program->num_constants == program->constants_capacity) {
+        size_t capacity = program->constants_capacity == 0 ? 32 : program->constants_capacity * 2;
+        fossil_value* grown = (fossil_value*)realloc(program->constants, capacity * sizeof(fossil_value));
+        if (grown == NULL) {
+            if (value.kind == FOSSIL_VALUE_STRING) {
+                free((char*)value.as.string);
+            }
+            fossil_compile_error(compiler, "Out of memory%s", NULL);
+            return 0;
+        }
+        program->constants = grown;
+        program->constants_capacity = capacity;
+    }
+    program->constants[program->num_constants] = value;
+    return (uint32_t)program->num_constants++;
+}
+
+// Copy a string literal, resolving the common escapes
+static char* fossil_unescape(const char* text) {
+    size_t length = strlen(text);
+    char* copy = (char*)malloc(length + 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    size_t used = 0;
+    for (size_t i = 0; i < length; ++i) {
+        char c = text[i];
+        if (c == '\\' && i + 1 < length) {
+            switch (text[++i]) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case '0': c = '\0'; break;
+                default: c = text[i]; break;
+            }
+        }
+        copy[used++] = c;
+    }
+    copy[used] = '\0';
+    return copy;
+}
+
+// Turn a CONSTANT node into a runtime value
+static int fossil_constant_value(const ASTNode* node, fossil_value* value) {
+    const char* text = node->value != NULL ? node->value : "";
+    switch (node->data_type) {
+        case FOSSIL_NULL_TYPE:
+            value->kind = FOSSIL_VALUE_NULL;
+            return 0;
+        case FOSSIL_BOOL:
+            value->kind = FOSSIL_VALUE_BOOL;
+            value->as.boolean = strcmp(text, "true") == 0;
+            return 0;
+        case FOSSIL_FLOAT:
+            value->kind = FOSSIL_VALUE_FLOAT;
+            value->as.number = strtod(text, NULL);
+            return 0;
+        case FOSSIL_HEX:
+        case FOSSIL_OCT:
+            value->kind = FOSSIL_VALUE_INT;
+            value->as.integer = strlen(text) > 2 ? strtoll(text + 2, NULL, node->data_type == FOSSIL_HEX ? 16 : 8) : 0;
+            return 0;
+        case FOSSIL_STRING:
+        case FOSSIL_CHAR:
+        case FOSSIL_DATETIME:
+            value->kind = FOSSIL_VALUE_STRING;
+            value->as.string = fossil_unescape(text);
+            return value->as.string != NULL ? 0 : -1;
+        default:
+            value->kind = FOSSIL_VALUE_INT;
+            value->as.integer = strtoll(text, NULL, 10);
+            return 0;
+    }
+}
+
+// Find a local by name, innermost first
+static int fossil_find_local(const fossil_compiler* compiler, const char* name, uint32_t* slot) {
+    for (size_t i = compiler->num_locals; i > 0; --i) {
+        if (strcmp(compiler->locals[i - 1].name, name) == 0) {
+            *slot = compiler->locals[i - 1].slot;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Declare a local in the current scope and return its slot
+static uint32_t fossil_declare_local(fossil_compiler* compiler, const char* name) {
+    if (compiler->num_locals == compiler->locals_capacity) {
+        size_t capacity = compiler->locals_capacity == 0 ? 16 : compiler->locals_capacity * 2;
+        fossil_local* grown = (fossil_local*)realloc(compiler->locals, capacity * sizeof(fossil_local));
+        if (grown == NULL) {
+            fossil_compile_error(compiler, "Out of memory%s", NULL);
+            return 0;
+        }
+        compiler->locals = grown;
+        compiler->locals_capacity = capacity;
+    }
+    compiler->locals[compiler->num_locals].name = name;
+    compiler->locals[compiler->num_locals].slot = compiler->next_slot;
+    compiler->num_locals++;
+    return compiler->next_slot++;
+}
+
+static void fossil_compile_expression(fossil_compiler* compiler, const ASTNode* node);
+static void fossil_compile_statement(fossil_compiler* compiler, const ASTNode* node);
+
+// Number of parameters of a FUNCTION node (its last child is the body)
+static size_t fossil_function_arity(const ASTNode* function) {
+    size_t count = function->num_children;
+    if (count > 0 && function->children[count - 1]->type == BLOCK_STATEMENT) {
+        count--;
+    }
+    return count;
+}
+
+// Compile a call to a user function, filling in parameter defaults
+static void fossil_compile_call(fossil_compiler* compiler, const ASTNode* node) {
+    int index = fscl_fossil_program_find(compiler->program, node->value);
+    if (index < 0) {
+        fossil_compile_error(compiler, "Unknown function '%s'", node->value);
+        return;
+    }
+
+    const ASTNode* callee = compiler->declarations[index];
+    size_t arity = fossil_function_arity(callee);
+    if (node->num_children > arity) {
+        fossil_compile_error(compiler, "Too many arguments to '%s'", node->value);
+        return;
+    }
+
+    for (size_t i = 0; i < arity; ++i) {
+        const ASTNode* parameter = callee->children[i];
+        if (i < node->num_children) {
+            fossil_compile_expression(compiler, node->children[i]);
+        } else if (parameter->num_children > 0) {
+            fossil_compile_expression(compiler, parameter->children[0]);
+        } else {
+            fossil_compile_error(compiler, "Missing argument in call to '%s'", node->value);
+            return;
+        }
+    }
+
+    fossil_emit_op(compiler, FOSSIL_OP_CALL, 1 - (int)arity);
+    fossil_emit_word(compiler, (uint32_t)index);
+    fossil_emit_word(compiler, (uint32_t)arity);
+}
+
+// Compile ++/-- on a variable, leaving the updated value on the stack
+static void fossil_compile_step(fossil_compiler* compiler, const ASTNode* node) {
+    const ASTNode* target = node->num_children > 0 ? node->children[0] : NULL;
+    uint32_t slot;
+    if (target == NULL || target->type != VARIABLE || !fossil_find_local(compiler, target->value, &slot)) {
+        fossil_compile_error(compiler, "Invalid operand for '%s'", node->value);
+        return;
+    }
+
+    fossil_value one = {FOSSIL_VALUE_INT, {.integer = 1}};
+    fossil_emit_op(compiler, FOSSIL_OP_LOAD, 1);
+    fossil_emit_word(compiler, slot);
+    fossil_emit_op(compiler, FOSSIL_OP_CONST, 1);
+    fossil_emit_word(compiler, fossil_add_constant(compiler, one));
+    fossil_emit_op(compiler, node->operator_type == INCREMENT ? FOSSIL_OP_ADD : FOSSIL_OP_SUB, -1);
+    fossil_emit_op(compiler, FOSSIL_OP_DUP, 1);
+    fossil_emit_op(compiler, FOSSIL_OP_STORE, -1);
+    fossil_emit_word(compiler, slot);
+}
+
+// Map a binary operator to its opcode
+static fossil_opcode fossil_binary_opcode(OperatorType op) {
+    switch (op) {
+        case ADD:           return FOSSIL_OP_ADD;
+        case SUBTRACT:      return FOSSIL_OP_SUB;
+        case MULTIPLY:      return FOSSIL_OP_MUL;
+        case DIVIDE:        return FOSSIL_OP_DIV;
+        case MODULO:        return FOSSIL_OP_MOD;
+        case EQUALS:        return FOSSIL_OP_EQ;
+        case NOT_EQUALS:    return FOSSIL_OP_NE;
+        case LESS_THAN:     return FOSSIL_OP_LT;
+        case LESS_EQUAL:    return FOSSIL_OP_LE;
+        case GREATER_THAN:  return FOSSIL_OP_GT;
+        case GREATER_EQUAL: return FOSSIL_OP_GE;
+        default:            return FOSSIL_OP_COUNT;
+    }
+}
+
+// Compile an expression, leaving exactly one value on the stack
+static void fossil_compile_expression(fossil_compiler* compiler, const ASTNode* node) {
+    if (compiler->failed) {
+        return;
+    }
+
+    switch (node->type) {
+        case CONSTANT: {
+            fossil_value value;
+            if (fossil_constant_value(node, &value) != 0) {
+                fossil_compile_error(compiler, "Out of memory%s", NULL);
+                return;
+            }
+            fossil_emit_op(compiler, FOSSIL_OP_CONST, 1);
+            fossil_emit_word(compiler, fossil_add_constant(compiler, value));
+            return;
+        }
+        case VARIABLE: {
+            uint32_t slot;
+            if (!fossil_find_local(compiler, node->value, &slot)) {
+                fossil_compile_error(compiler, "Undefined variable '%s'", node->value);
+                return;
+            }
+            fossil_emit_op(compiler, FOSSIL_OP_LOAD, 1);
+            fossil_emit_word(compiler, slot);
+            return;
+        }
+        case BINARY_OP:
+        case RELATIONAL_OP: {
+            fossil_opcode op = fossil_binary_opcode(node->operator_type);
+            if (node->num_children != 2 || op == FOSSIL_OP_COUNT) {
+                fossil_compile_error(compiler, "Invalid operator '%s'", node->value);
+                return;
+            }
+            fossil_compile_expression(compiler, node->children[0]);
+            fossil_compile_expression(compiler, node->children[1]);
+            fossil_emit_op(compiler, op, -1);
+            return;
+        }
+        case LOGICAL_OP: {
+            if (node->num_children != 2 || (node->operator_type != AND && node->operator_type != OR)) {
+                fossil_compile_error(compiler, "Invalid operator '%s'", node->value);
+                return;
+            }
+            // Short circuit: the left value is the result when it decides
+            fossil_compile_expression(compiler, node->children[0]);
+            size_t jump = fossil_emit_jump(compiler, node->operator_type == AND ? FOSSIL_OP_AND : FOSSIL_OP_OR, -1);
+            fossil_compile_expression(compiler, node->children[1]);
+            fossil_patch_jump(compiler, jump);
+            return;
+        }
+        case UNARY_OP:
+            if (node->operator_type == INCREMENT || node->operator_type == DECREMENT) {
+                fossil_compile_step(compiler, node);
+                return;
+            }
+            if (node->num_children != 1 || (node->operator_type != NEGATION && node->operator_type != NOT)) {
+                fossil_compile_error(compiler, "Invalid operator '%s'", node->value);
+                return;
+            }
+            fossil_compile_expression(compiler, node->children[0]);
+            fossil_emit_op(compiler, node->operator_type == NEGATION ? FOSSIL_OP_NEG : FOSSIL_OP_NOT, 0);
+            return;
+        case CALL_EXPRESSION:
+            fossil_compile_call(compiler, node);
+            return;
+        case PRINT_STATEMENT_TYPE:
+            for (size_t i = 0; i < node->num_children; ++i) {
+                fossil_compile_expression(compiler, node->children[i]);
+            }
+            fossil_emit_op(compiler, FOSSIL_OP_PRINT, 1 - (int)node->num_children);
+            fossil_emit_word(compiler, (uint32_t)node->num_children);
+            return;
+        case ARRAY_LITERAL:
+            for (size_t i = 0; i < node->num_children; ++i) {
+                fossil_compile_expression(compiler, node->children[i]);
+            }
+            fossil_emit_op(compiler, FOSSIL_OP_ARRAY, 1 - (int)node->num_children);
+            fossil_emit_word(compiler, (uint32_t)node->num_children);
+            return;
+        default:
+            fossil_compile_error(compiler, "Unsupported expression%s", NULL);
+            return;
+    }
+}
+
+// Compile the statements of a block in their own scope
+static void fossil_compile_block(fossil_compiler* compiler, const ASTNode* block) {
+    size_t scope = compiler->num_locals;
+    if (block->type == BLOCK_STATEMENT) {
+        for (size_t i = 0; i < block->num_children; ++i) {
+            fossil_compile_statement(compiler, block->children[i]);
+        }
+    } else {
+        fossil_compile_statement(compiler, block);
+    }
+    compiler->num_locals = scope;
+}
+
+// Compile a statement, leaving the stack as it found it
+static void fossil_compile_statement(fossil_compiler* compiler, const ASTNode* node) {
+    if (compiler->failed) {
+        return;
+    }
+
+    switch (node->type) {
+        case VARIABLE: {
+            // A declaration, unless it is a bare reference to a known name
+            uint32_t slot;
+            if (node->num_children == 0 && fossil_find_local(compiler, node->value, &slot)) {
+                return;
+            }
+            if (node->num_children > 0) {
+                fossil_compile_expression(compiler, node->children[0]);
+            } else {
+                fossil_emit_op(compiler, FOSSIL_OP_NULL, 1);
+            }
+            slot = fossil_declare_local(compiler, node->value);
+            fossil_emit_op(compiler, FOSSIL_OP_STORE, -1);
+            fossil_emit_word(compiler, slot);
+            return;
+        }
+        case ASSIGNMENT: {
+            if (node->num_children != 1) {
+                fossil_compile_error(compiler, "Invalid assignment to '%s'", node->value);
+                return;
+            }
+            fossil_compile_expression(compiler, node->children[0]);
+            // Assigning an unknown name declares it
+            uint32_t slot;
+            if (!fossil_find_local(compiler, node->value, &slot)) {
+                slot = fossil_declare_local(compiler, node->value);
+            }
+            fossil_emit_op(compiler, FOSSIL_OP_STORE, -1);
+            fossil_emit_word(compiler, slot);
+            return;
+        }
+        case RETURN_STATEMENT:
+            if (node->num_children > 0) {
+                fossil_compile_expression(compiler, node->children[0]);
+            } else {
+                fossil_emit_op(compiler, FOSSIL_OP_NULL, 1);
+            }
+            fossil_emit_op(compiler, FOSSIL_OP_RETURN, -1);
+            return;
+        case IF_STATEMENT: {
+            if (node->num_children < 2) {
+                fossil_compile_error(compiler, "Invalid if statement%s", NULL);
+                return;
+            }
+            fossil_compile_expression(compiler, node->children[0]);
+            size_t skip_then = fossil_emit_jump(compiler, FOSSIL_OP_JUMP_IF_FALSE, -1);
+            fossil_compile_block(compiler, node->children[1]);
+            if (node->num_children > 2) {
+                size_t skip_else = fossil_emit_jump(compiler, FOSSIL_OP_JUMP, 0);
+                fossil_patch_jump(compiler, skip_then);
+                fossil_compile_block(compiler, node->children[2]);
+                fossil_patch_jump(compiler, skip_else);
+            } else {
+                fossil_patch_jump(compiler, skip_then);
+            }
+            return;
+        }
+        case WHILE_LOOP: {
+            if (node->num_children != 2) {
+                fossil_compile_error(compiler, "Invalid while loop%s", NULL);
+                return;
+            }
+            uint32_t start = (uint32_t)compiler->program->code_size;
+            fossil_compile_expression(compiler, node->children[0]);
+            size_t exit = fossil_emit_jump(compiler, FOSSIL_OP_JUMP_IF_FALSE, -1);
+            fossil_compile_block(compiler, node->children[1]);
+            fossil_emit_op(compiler, FOSSIL_OP_JUMP, 0);
+            fossil_emit_word(compiler, start);
+            fossil_patch_jump(compiler, exit);
+            return;
+        }
+        case BLOCK_STATEMENT:
+            fossil_compile_block(compiler, node);
+            return;
+        default:
+            // Expression statement, its value is discarded
+            fossil_compile_expression(compiler, node);
+            fossil_emit_op(compiler, FOSSIL_OP_POP, -1);
+            return;
+    }
+}
+
+// Compile one FUNCTION node into the function table slot
+static void fossil_compile_function(fossil_compiler* compiler, size_t index) {
+    const ASTNode* function = compiler->declarations[index];
+    fossil_function_info* info = &compiler->program->functions[index];
+    size_t arity = fossil_function_arity(function);
+
+    compiler->num_locals = 0;
+    compiler->next_slot = 0;
+    compiler->depth = 0;
+    compiler->max_depth = 0;
+
+    for (size_t i = 0; i < arity; ++i) {
+        fossil_declare_local(compiler, function->children[i]->value);
+    }
+
+    info->entry = (uint32_t)compiler->program->code_size;
+    if (arity < function->num_children) {
+        fossil_compile_block(compiler, function->children[arity]);
+    }
+
+    // Falling off the end returns null
+    fossil_emit_op(compiler, FOSSIL_OP_NULL, 1);
+    fossil_emit_op(compiler, FOSSIL_OP_RETURN, -1);
+
+    info->num_locals = compiler->next_slot;
+    info->max_stack = (uint32_t)compiler->max_depth;
+}
+
+// Function to compile a parsed program to bytecode
+int fscl_fossil_compile(const ASTNode* root, fossil_program* program) {
+    if (root == NULL || program == NULL) {
+        return -1;
+    }
+    memset(program, 0, sizeof(*program));
+
+    fossil_compiler compiler;
+    memset(&compiler, 0, sizeof(compiler));
+    compiler.program = program;
+
+    // Collect every function first so calls can refer forward
+    program->functions = (fossil_function_info*)calloc(root->num_children + 1, sizeof(fossil_function_info));
+    compiler.declarations = (const ASTNode**)calloc(root->num_children + 1, sizeof(ASTNode*));
+    if (program->functions == NULL || compiler.declarations == NULL) {
+        fossil_compile_error(&compiler, "Out of memory%s", NULL);
+    }
+
+    for (size_t i = 0; !compiler.failed && i < root->num_children; ++i) {
+        const ASTNode* child = root->children[i];
+        if (child == NULL || child->type != FUNCTION) {
+            continue;
+        }
+        if (fscl_fossil_program_find(program, child->value) >= 0) {
+            fossil_compile_error(&compiler, "Duplicate function '%s'", child->value);
+            break;
+        }
+        fossil_function_info* info = &program->functions[program->num_functions];
+        info->name = fscl_fossil_strdup(child->value);
+        info->arity = (uint32_t)fossil_function_arity(child);
+        compiler.declarations[program->num_functions++] = child;
+        if (info->name == NULL) {
+            fossil_compile_error(&compiler, "Out of memory%s", NULL);
+        }
+    }
+
+    for (size_t i = 0; !compiler.failed && i < program->num_functions; ++i) {
+        fossil_compile_function(&compiler, i);
+    }
+
+    free(compiler.declarations);
+    free(compiler.locals);
+
+    if (compiler.failed) {
+        char message[sizeof(program->error)];
+        memcpy(message, program->error, sizeof(message));
+        fscl_fossil_program_erase(program);
+        memcpy(program->error, message, sizeof(message));
+        return -1;
+    }
+    return 0;
+}
+
+// Function to free the storage of a compiled program
+void fscl_fossil_program_erase(fossil_program* program) {
+    if (program == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < program->num_constants; ++i) {
+        if (program->constants[i].kind == FOSSIL_VALUE_STRING) {
+            free((char*)program->constants[i].as.string);
+        }
+    }
+    for (size_t i = 0; i < program->num_functions; ++i) {
+        free(program->functions[i].name);
+    }
+
+    free(program->code);
+    free(program->constants);
+    free(program->functions);
+    memset(program, 0, sizeof(*program));
+}
+
+// Function to find a compiled function by name
+int fscl_fossil_program_find(const fossil_program* program, const char* name) {
+    if (program == NULL || name == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < program->num_functions; ++i) {
+        if (program->functions[i].name != NULL && strcmp(program->functions[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// =================================================================
+// Virtual machine
+// =================================================================
+
+// Header of a runtime allocation owned by the machine
+typedef struct fossil_vm_object {
+    struct fossil_vm_object* next;
+} fossil_vm_object;
+
+// Allocate memory that lives until the machine is erased
+static void* fossil_vm_allocate(fossil_vm* vm, size_t size) {
+    const size_t header = (sizeof(fossil_vm_object) + FOSSIL_ARENA_ALIGNMENT - 1) & ~(size_t)(FOSSIL_ARENA_ALIGNMENT - 1);
+    fossil_vm_object* object = (fossil_vm_object*)malloc(header + size);
+    if (object == NULL) {
+        return NULL;
+    }
+    object->next = (fossil_vm_object*)vm->objects;
+    vm->objects = object;
+    return (char*)object + header;
+}
+
+// Append the printed form of a value to a text
+static int fossil_text_value(fossil_text* text, const fossil_value* value) {
+    char digits[32];
+    int length;
+
+    switch (value->kind) {
+        case FOSSIL_VALUE_NULL:
+            return fossil_text_append(text, "null", 4);
+        case FOSSIL_VALUE_BOOL:
+            return value->as.boolean ? fossil_text_append(text, "true", 4) : fossil_text_append(text, "false", 5);
+        case FOSSIL_VALUE_INT:
+            length = snprintf(digits, sizeof(digits), "%lld", (long long)value->as.integer);
+            return fossil_text_append(text, digits, (size_t)length);
+        case FOSSIL_VALUE_FLOAT:
+            length = snprintf(digits, sizeof(digits), "%g", value->as.number);
+            return fossil_text_append(text, digits, (size_t)length);
+        case FOSSIL_VALUE_STRING:
+            return fossil_text_append(text, value->as.string, strlen(value->as.string));
+        case FOSSIL_VALUE_ARRAY:
+            if (fossil_text_append(text, "[", 1) != 0) {
+                return -1;
+            }
+            for (size_t i = 0; i < value->as.array->count; ++i) {
+                if ((i > 0 && fossil_text_append(text, ", ", 2) != 0) || fossil_text_value(text, &value->as.array->items[i]) != 0) {
+                    return -1;
+                }
+            }
+            return fossil_text_append(text, "]", 1);
+    }
+    return -1;
+}
+
+// Truth value of a runtime value
+static int fossil_vm_truthy(const fossil_value* value) {
+    switch (value->kind) {
+        case FOSSIL_VALUE_BOOL:   return value->as.boolean;
+        case FOSSIL_VALUE_INT:    return value->as.integer != 0;
+        case FOSSIL_VALUE_FLOAT:  return value->as.number != 0.0;
+        case FOSSIL_VALUE_STRING: return value->as.string[0] != '\0';
+        case FOSSIL_VALUE_ARRAY:  return value->as.array->count > 0;
+        default:                  return 0;
+    }
+}
+
+// Record a runtime error
+static void fossil_vm_error(fossil_vm* vm, const char* message) {
+    snprintf(vm->error, sizeof(vm->error), "%s", message);
+}
+
+// Arithmetic that is not int op int, or that can fail; the result replaces a
+static int fossil_vm_arith(fossil_vm* vm, fossil_opcode op, fossil_value* a, const fossil_value* b, fossil_text* text) {
+    if (op == FOSSIL_OP_ADD && (a->kind == FOSSIL_VALUE_STRING || b->kind == FOSSIL_VALUE_STRING)) {
+        text->length = 0;
+        if (fossil_text_value(text, a) != 0 || fossil_text_value(text, b) != 0) {
+            fossil_vm_error(vm, "Out of memory");
+            return -1;
+        }
+        char* joined = (char*)fossil_vm_allocate(vm, text->length + 1);
+        if (joined == NULL) {
+            fossil_vm_error(vm, "Out of memory");
+            return -1;
+        }
+        memcpy(joined, text->data, text->length + 1);
+        a->kind = FOSSIL_VALUE_STRING;
+        a->as.string = joined;
+        return 0;
+    }
+
+    if (a->kind == FOSSIL_VALUE_INT && b->kind == FOSSIL_VALUE_INT) {
+        int64_t x = a->as.integer;
+        int64_t y = b->as.integer;
+        if (y == 0) {
+            fossil_vm_error(vm, "Division by zero");
+            return -1;
+        }
+        // y == -1 would overflow for the smallest integer
+        if (op == FOSSIL_OP_DIV) {
+            a->as.integer = y == -1 ? (int64_t)(0 - (uint64_t)x) : x / y;
+        } else {
+            a->as.integer = y == -1 ? 0 : x % y;
+        }
+        return 0;
+    }
+
+    int numeric = (a->kind == FOSSIL_VALUE_INT || a->kind == FOSSIL_VALUE_FLOAT) && (b->kind == FOSSIL_VALUE_INT || b->kind == FOSSIL_VALUE_FLOAT);
+    if (!numeric || op == FOSSIL_OP_MOD) {
+        fossil_vm_error(vm, op == FOSSIL_OP_MOD && numeric ? "Modulo requires integers" : "Invalid operands for arithmetic");
+        return -1;
+    }
+
+    double x = a->kind == FOSSIL_VALUE_INT ? (double)a->as.integer : a->as.number;
+    double y = b->kind == FOSSIL_VALUE_INT ? (double)b->as.integer : b->as.number;
+    switch (op) {
+        case FOSSIL_OP_ADD: x += y; break;
+        case FOSSIL_OP_SUB: x -= y; break;
+        case FOSSIL_OP_MUL: x *= y; break;
+        default:            x /= y; break;
+    }
+    a->kind = FOSSIL_VALUE_FLOAT;
+    a->as.number = x;
+    return 0;
+}
+
+// Compare two values, returning 0 and the order in *order when they are comparable
+static int fossil_vm_compare(const fossil_value* a, const fossil_value* b, int* order) {
+    if (a->kind == FOSSIL_VALUE_INT && b->kind == FOSSIL_VALUE_INT) {
+        *order = (a->as.integer > b->as.integer) - (a->as.integer < b->as.integer);
+        return 0;
+    }
+    if ((a->kind == FOSSIL_VALUE_INT || a->kind == FOSSIL_VALUE_FLOAT) && (b->kind == FOSSIL_VALUE_INT || b->kind == FOSSIL_VALUE_FLOAT)) {
+        double x = a->kind == FOSSIL_VALUE_INT ? (double)a->as.integer : a->as.number;
+        double y = b->kind == FOSSIL_VALUE_INT ? (double)b->as.integer : b->as.number;
+        *order = (x > y) - (x < y);
+        return 0;
+    }
+    if (a->kind == FOSSIL_VALUE_STRING && b->kind == FOSSIL_VALUE_STRING) {
+        *order = strcmp(a->as.string, b->as.string);
+        return 0;
+    }
+    return -1;
+}
+
+// Equality across all kinds, arrays compare by identity
+static int fossil_vm_equal(const fossil_value* a, const fossil_value* b) {
+    int order;
+    if (fossil_vm_compare(a, b, &order) == 0) {
+        return order == 0;
+    }
+    if (a->kind != b->kind) {
+        return 0;
+    }
+    switch (a->kind) {
+        case FOSSIL_VALUE_NULL:  return 1;
+        case FOSSIL_VALUE_BOOL:  return a->as.boolean == b->as.boolean;
+        case FOSSIL_VALUE_ARRAY: return a->as.array == b->as.array;
+        default:                 return 0;
+    }
+}
+
+// Make room for at least size values on the stack
+static int fossil_vm_reserve(fossil_vm* vm, size_t size) {
+    if (size <= vm->stack_capacity) {
+        return 0;
+    }
+
+    size_t capacity = vm->stack_capacity == 0 ? 256 : vm->stack_capacity;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    fossil_value* grown = (fossil_value*)realloc(vm->stack, capacity * sizeof(fossil_value));
+    if (grown == NULL) {
+        return -1;
+    }
+    vm->stack = grown;
+    vm->stack_capacity = capacity;
+    return 0;
+}
+
+// Function to initialize a virtual machine
+void fscl_fossil_vm_init(fossil_vm* vm, FILE* output) {
+    if (vm == NULL) {
+        return;
+    }
+    memset(vm, 0, sizeof(*vm));
+    vm->output = output;
+}
+
+// Function to free the stacks of a machine and every value it created
+void fscl_fossil_vm_erase(fossil_vm* vm) {
+    if (vm == NULL) {
+        return;
+    }
+
+    fossil_vm_object* object = (fossil_vm_object*)vm->objects;
+    while (object != NULL) {
+        fossil_vm_object* next = object->next;
+        free(object);
+        object = next;
+    }
+
+    free(vm->stack);
+    free(vm->frames);
+    memset(vm, 0, sizeof(*vm));
+}
+
+// Labels-as-values dispatch where the compiler supports it, a switch otherwise
+#if defined(__GNUC__) || defined(__clang__)
+#define FOSSIL_VM_COMPUTED_GOTO 1
+#endif
+
+// Function to run a function of a compiled program
+int fscl_fossil_vm_run(fossil_vm* vm, const fossil_program* program, const char* function, fossil_value* result) {
+    if (vm == NULL || program == NULL || function == NULL) {
+        return -1;
+    }
+    vm->error[0] = '\0';
+
+    int index = fscl_fossil_program_find(program, function);
+    if (index < 0) {
+        fossil_vm_error(vm, "Unknown function");
+        return -1;
+    }
+
+    if (vm->frames == NULL) {
+        vm->frames = (fossil_vm_frame*)malloc(FOSSIL_VM_MAX_FRAMES * sizeof(fossil_vm_frame));
+        vm->frames_capacity = vm->frames != NULL ? FOSSIL_VM_MAX_FRAMES : 0;
+    }
+
+    const fossil_function_info* entry = &program->functions[index];
+    if (vm->frames == NULL || fossil_vm_reserve(vm, (size_t)entry->num_locals + entry->max_stack) != 0) {
+        fossil_vm_error(vm, "Out of memory");
+        return -1;
+    }
+
+    const uint32_t* code = program->code;
+    const fossil_value* constants = program->constants;
+    FILE* output = vm->output != NULL ? vm->output : stdout;
+    fossil_value* stack = vm->stack;
+    fossil_vm_frame* frames = vm->frames;
+    fossil_text text = {NULL, 0, 0};
+    size_t frame_count = 1;
+    size_t base = 0;
+    size_t sp = entry->num_locals;
+    size_t ip = entry->entry;
+    int status = 0;
+
+    for (size_t i = 0; i < sp; ++i) {
+        stack[i].kind = FOSSIL_VALUE_NULL;
+    }
+    frames[0].function = entry;
+    frames[0].return_ip = 0;
+    frames[0].base = 0;
+
+#ifdef FOSSIL_VM_COMPUTED_GOTO
+    static void* const dispatch[FOSSIL_OP_COUNT] = {
+        [FOSSIL_OP_CONST] = &&vm_op_CONST,
+        [FOSSIL_OP_NULL] = &&vm_op_NULL,
+        [FOSSIL_OP_POP] = &&vm_op_POP,
+        [FOSSIL_OP_DUP] = &&vm_op_DUP,
+        [FOSSIL_OP_LOAD] = &&vm_op_LOAD,
+        [FOSSIL_OP_STORE] = &&vm_op_STORE,
+        [FOSSIL_OP_ADD] = &&vm_op_ADD,
+        [FOSSIL_OP_SUB] = &&vm_op_SUB,
+        [FOSSIL_OP_MUL] = &&vm_op_MUL,
+        [FOSSIL_OP_DIV] = &&vm_op_DIV,
+        [FOSSIL_OP_MOD] = &&vm_op_MOD,
+        [FOSSIL_OP_NEG] = &&vm_op_NEG,
+        [FOSSIL_OP_NOT] = &&vm_op_NOT,
+        [FOSSIL_OP_EQ] = &&vm_op_EQ,
+        [FOSSIL_OP_NE] = &&vm_op_NE,
+        [FOSSIL_OP_LT] = &&vm_op_LT,
+        [FOSSIL_OP_LE] = &&vm_op_LE,
+        [FOSSIL_OP_GT] = &&vm_op_GT,
+        [FOSSIL_OP_GE] = &&vm_op_GE,
+        [FOSSIL_OP_JUMP] = &&vm_op_JUMP,
+        [FOSSIL_OP_JUMP_IF_FALSE] = &&vm_op_JUMP_IF_FALSE,
+        [FOSSIL_OP_AND] = &&vm_op_AND,
+        [FOSSIL_OP_OR] = &&vm_op_OR,
+        [FOSSIL_OP_CALL] = &&vm_op_CALL,
+        [FOSSIL_OP_PRINT] = &&vm_op_PRINT,
+        [FOSSIL_OP_ARRAY] = &&vm_op_ARRAY,
+        [FOSSIL_OP_RETURN] = &&vm_op_RETURN
+    };
+#define VM_CASE(op) vm_op_##op
+#define VM_DISPATCH() goto *dispatch[code[ip++]]
+    VM_DISPATCH();
+    {
+#else
+#define VM_CASE(op) case FOSSIL_OP_##op
+#define VM_DISPATCH() goto vm_dispatch
+vm_dispatch:
+    switch (code[ip++]) {
+#endif
+
+    VM_CASE(CONST):
+        stack[sp++] = constants[code[ip++]];
+        VM_DISPATCH();
+
+    VM_CASE(NULL):
+        stack[sp++].kind = FOSSIL_VALUE_NULL;
+        VM_DISPATCH();
+
+    VM_CASE(POP):
+        sp--;
+        VM_DISPATCH();
+
+    VM_CASE(DUP):
+        stack[sp] = stack[sp - 1];
+        sp++;
+        VM_DISPATCH();
+
+    VM_CASE(LOAD):
+        stack[sp++] = stack[base + code[ip++]];
+        VM_DISPATCH();
+
+    VM_CASE(STORE):
+        stack[base + code[ip++]] = stack[--sp];
+        VM_DISPATCH();
+
+    VM_CASE(ADD):
+        if (stack[sp - 2].kind == FOSSIL_VALUE_INT && stack[sp - 1].kind == FOSSIL_VALUE_INT) {
+            stack[sp - 2].as.integer = (int64_t)((uint64_t)stack[sp - 2].as.integer + (uint64_t)stack[sp - 1].as.integer);
+        } else if (fossil_vm_arith(vm, FOSSIL_OP_ADD, &stack[sp - 2], &stack[sp - 1], &text) != 0) {
+            goto vm_failure;
+        }
+        sp--;
+        VM_DISPATCH();
+
+    VM_CASE(SUB):
+        if (stack[sp - 2].kind == FOSSIL_VALUE_INT && stack[sp - 1].kind == FOSSIL_VALUE_INT) {
+            stack[sp - 2].as.integer = (int64_t)((uint64_t)stack[sp - 2].as.integer - (uint64_t)stack[sp - 1].as.integer);
+        } else if (fossil_vm_arith(vm, FOSSIL_OP_SUB, &stack[sp - 2], &stack[sp - 1], &text) != 0) {
+            goto vm_failure;
+        }
+        sp--;
+        VM_DISPATCH();
+
+    VM_CASE(MUL):
+        if (stack[sp - 2].kind == FOSSIL_VALUE_INT && stack[sp - 1].kind == FOSSIL_VALUE_INT) {
+            stack[sp - 2].as.integer = (int64_t)((uint64_t)stack[sp - 2].as.integer * (uint64_t)stack[sp - 1].as.integer);
+        } else if (fossil_vm_arith(vm, FOSSIL_OP_MUL, &stack[sp - 2], &stack[sp - 1], &text) != 0) {
+            goto vm_failure;
+        }
+        sp--;
+        VM_DISPATCH();
+
+    VM_CASE(DIV):
+        if (fossil_vm_arith(vm, FOSSIL_OP_DIV, &stack[sp - 2], &stack[sp - 1], &text) != 0) {
+            goto vm_failure;
+        }
+        sp--;
+        VM_DISPATCH();
+
+    VM_CASE(MOD):
+        if (fossil_vm_arith(vm, FOSSIL_OP_MOD, &stack[sp - 2], &stack[sp - 1], &text) != 0) {
+            goto vm_failure;
+        }
+        sp--;
+        VM_DISPATCH();
+
+    VM_CASE(NEG):
+        if (stack[sp - 1].kind == FOSSIL_VALUE_INT) {
+            stack[sp - 1].as.integer = (int64_t)(0 - (uint64_t)stack[sp - 1].as.integer);
+        } else if (stack[sp - 1].kind == FOSSIL_VALUE_FLOAT) {
+            stack[sp - 1].as.number = -stack[sp - 1].as.number;
+        } else {
+            fossil_vm_error(vm, "Invalid operand for negation");
+            goto vm_failure;
+        }
+        VM_DISPATCH();
+
+    VM_CASE(NOT):
+        stack[sp - 1].as.boolean = !fossil_vm_truthy(&stack[sp - 1]);
+        stack[sp - 1].kind = FOSSIL_VALUE_BOOL;
+        VM_DISPATCH();
+
+    VM_CASE(EQ):
+    VM_CASE(NE): {
+        int equal = fossil_vm_equal(&stack[sp - 2], &stack[sp - 1]);
+        sp--;
+        stack[sp - 1].kind = FOSSIL_VALUE_BOOL;
+        stack[sp - 1].as.boolean = code[ip - 1] == FOSSIL_OP_EQ ? equal : !equal;
+        VM_DISPATCH();
+    }
+
+    VM_CASE(LT):
+    VM_CASE(LE):
+    VM_CASE(GT):
+    VM_CASE(GE): {
+        int order;
+        if (fossil_vm_compare(&stack[sp - 2], &stack[sp - 1], &order) != 0) {
+            fossil_vm_error(vm, "Invalid operands for comparison");
+            goto vm_failure;
+        }
+        uint32_t op = code[ip - 1];
+        sp--;
+        stack[sp - 1].kind = FOSSIL_VALUE_BOOL;
+        stack[sp - 1].as.boolean = op == FOSSIL_OP_LT ? order < 0 : op == FOSSIL_OP_LE ? order <= 0 : op == FOSSIL_OP_GT ? order > 0 : order >= 0;
+        VM_DISPATCH();
+    }
+
+    VM_CASE(JUMP):
+        ip = code[ip];
+        VM_DISPATCH();
+
+    VM_CASE(JUMP_IF_FALSE):
+        ip = fossil_vm_truthy(&stack[--sp]) ? ip + 1 : code[ip];
+        VM_DISPATCH();
+
+    VM_CASE(AND):
+        if (!fossil_vm_truthy(&stack[sp - 1])) {
+            ip = code[ip];
+        } else {
+            sp--;
+            ip++;
+        }
+        VM_DISPATCH();
+
+    VM_CASE(OR):
+        if (fossil_vm_truthy(&stack[sp - 1])) {
+            ip = code[ip];
+        } else {
+            sp--;
+            ip++;
+        }
+        VM_DISPATCH();
+
+    VM_CASE(CALL): {
+        const fossil_function_info* callee = &program->functions[code[ip]];
+        size_t argc = code[ip + 1];
+        ip += 2;
+        if (frame_count == FOSSIL_VM_MAX_FRAMES) {
+            fossil_vm_error(vm, "Call stack overflow");
+            goto vm_failure;
+        }
+
+        base = sp - argc;
+        if (fossil_vm_reserve(vm, base + callee->num_locals + callee->max_stack) != 0) {
+            fossil_vm_error(vm, "Out of memory");
+            goto vm_failure;
+        }
+        stack = vm->stack;
+        for (; sp < base + callee->num_locals; ++sp) {
+            stack[sp].kind = FOSSIL_VALUE_NULL;
+        }
+
+        frames[frame_count].function = callee;
+        frames[frame_count].return_ip = ip;
+        frames[frame_count].base = base;
+        frame_count++;
+        ip = callee->entry;
+        VM_DISPATCH();
+    }
+
+    VM_CASE(PRINT): {
+        // Arguments are separated by spaces and followed by a newline
+        size_t argc = code[ip++];
+        text.length = 0;
+        for (size_t i = sp - argc; i < sp; ++i) {
+            if ((i > sp - argc && fossil_text_append(&text, " ", 1) != 0) || fossil_text_value(&text, &stack[i]) != 0) {
+                fossil_vm_error(vm, "Out of memory");
+                goto vm_failure;
+            }
+        }
+        if (fossil_text_append(&text, "\n", 1) != 0) {
+            fossil_vm_error(vm, "Out of memory");
+            goto vm_failure;
+        }
+        fwrite(text.data, 1, text.length, output);
+        sp -= argc;
+        stack[sp++].kind = FOSSIL_VALUE_NULL;
+        VM_DISPATCH();
+    }
+
+    VM_CASE(ARRAY): {
+        size_t count = code[ip++];
+        fossil_value_array* array = (fossil_value_array*)fossil_vm_allocate(vm, sizeof(fossil_value_array) + count * sizeof(fossil_value));
+        if (array == NULL) {
+            fossil_vm_error(vm, "Out of memory");
+            goto vm_failure;
+        }
+        array->count = count;
+        array->items = (fossil_value*)(array + 1);
+        sp -= count;
+        if (count > 0) {
+            memcpy(array->items, &stack[sp], count * sizeof(fossil_value));
+        }
+        stack[sp].kind = FOSSIL_VALUE_ARRAY;
+        stack[sp].as.array = array;
+        sp++;
+        VM_DISPATCH();
+    }
+
+    VM_CASE(RETURN): {
+        fossil_value value = stack[sp - 1];
+        frame_count--;
+        sp = frames[frame_count].base;
+        if (frame_count == 0) {
+            if (result != NULL) {
+                *result = value;
+            }
+            goto vm_done;
+        }
+        ip = frames[frame_count].return_ip;
+        base = frames[frame_count - 1].base;
+        stack[sp++] = value;
+        VM_DISPATCH();
+    }
+
+#ifndef FOSSIL_VM_COMPUTED_GOTO
+    default:
+        fossil_vm_error(vm, "Invalid instruction");
+        goto vm_failure;
+#endif
+    }
+
+#undef VM_CASE
+#undef VM_DISPATCH
+
+vm_failure:
+    status = -1;
+vm_done:
+    free(text.data);
+    return status;
+}
+
+// Function to apply a binary or relational operator to two values
+int fscl_fossil_vm_binary(fossil_vm* vm, OperatorType op, fossil_value* a, const fossil_value* b) {
+    if (vm == NULL || a == NULL || b == NULL) {
+        return -1;
+    }
+
+    fossil_opcode code = fossil_binary_opcode(op);
+    switch (code) {
+        case FOSSIL_OP_ADD:
+        case FOSSIL_OP_SUB:
+        case FOSSIL_OP_MUL:
+            if (a->kind == FOSSIL_VALUE_INT && b->kind == FOSSIL_VALUE_INT) {
+                uint64_t x = (uint64_t)a->as.integer;
+                uint64_t y = (uint64_t)b->as.integer;
+                a->as.integer = (int64_t)(code == FOSSIL_OP_ADD ? x + y : code == FOSSIL_OP_SUB ? x - y : x * y);
+                return 0;
+            }
+            // Fall through
+        case FOSSIL_OP_DIV:
+        case FOSSIL_OP_MOD: {
+            fossil_text text = {NULL, 0, 0};
+            int status = fossil_vm_arith(vm, code, a, b, &text);
+            free(text.data);
+            return status;
+        }
+        case FOSSIL_OP_EQ:
+        case FOSSIL_OP_NE: {
+            int equal = fossil_vm_equal(a, b);
+            a->kind = FOSSIL_VALUE_BOOL;
+            a->as.boolean = code == FOSSIL_OP_EQ ? equal : !equal;
+            return 0;
+        }
+        case FOSSIL_OP_LT:
+        case FOSSIL_OP_LE:
+        case FOSSIL_OP_GT:
+        case FOSSIL_OP_GE: {
+            int order;
+            if (fossil_vm_compare(a, b, &order) != 0) {
+                fossil_vm_error(vm, "Invalid operands for comparison");
+                return -1;
+            }
+            a->kind = FOSSIL_VALUE_BOOL;
+            a->as.boolean = code == FOSSIL_OP_LT ? order < 0 : code == FOSSIL_OP_LE ? order <= 0 : code == FOSSIL_OP_GT ? order > 0 : order >= 0;
+            return 0;
+        }
+        default:
+            fossil_vm_error(vm, "Invalid operator");
+            return -1;
+    }
+}
+
+// Function to apply a negation or logical not to a value
+int fscl_fossil_vm_unary(fossil_vm* vm, OperatorType op, fossil_value* value) {
+    if (vm == NULL || value == NULL) {
+        return -1;
+    }
+
+    if (op == NOT) {
+        value->as.boolean = !fossil_vm_truthy(value);
+        value->kind = FOSSIL_VALUE_BOOL;
+        return 0;
+    }
+    if (op == NEGATION && value->kind == FOSSIL_VALUE_INT) {
+        value->as.integer = (int64_t)(0 - (uint64_t)value->as.integer);
+        return 0;
+    }
+    if (op == NEGATION && value->kind == FOSSIL_VALUE_FLOAT) {
+        value->as.number = -value->as.number;
+        return 0;
+    }
+    fossil_vm_error(vm, op == NEGATION ? "Invalid operand for negation" : "Invalid operator");
+    return -1;
+}
+
+// Function to get the truth value of a value
+int fscl_fossil_vm_truthy(const fossil_value* value) {
+    return value != NULL && fossil_vm_truthy(value);
+}
+
+// Function to print values the way the print statement does
+int fscl_fossil_vm_print(fossil_vm* vm, const fossil_value* values, size_t count) {
+    if (vm == NULL || (values == NULL && count > 0)) {
+        return -1;
+    }
+
+    fossil_text text = {NULL, 0, 0};
+    int status = 0;
+    for (size_t i = 0; status == 0 && i < count; ++i) {
+        if ((i > 0 && fossil_text_append(&text, " ", 1) != 0) || fossil_text_value(&text, &values[i]) != 0) {
+            status = -1;
+        }
+    }
+    if (status != 0 || fossil_text_append(&text, "\n", 1) != 0) {
+        free(text.data);
+        fossil_vm_error(vm, "Out of memory");
+        return -1;
+    }
+
+    fwrite(text.data, 1, text.length, vm->output != NULL ? vm->output : stdout);
+    free(text.data);
+    return 0;
+}
+
+// Function to create an array value owned by the machine
+int fscl_fossil_vm_array(fossil_vm* vm, const fossil_value* items, size_t count, fossil_value* result) {
+    if (vm == NULL || result == NULL || (items == NULL && count > 0)) {
+        return -1;
+    }
+
+    fossil_value_array* array = (fossil_value_array*)fossil_vm_allocate(vm, sizeof(fossil_value_array) + count * sizeof(fossil_value));
+    if (array == NULL) {
+        fossil_vm_error(vm, "Out of memory");
+        return -1;
+    }
+    array->count = count;
+    array->items = (fossil_value*)(array + 1);
+    if (count > 0) {
+        memcpy(array->items, items, count * sizeof(fossil_value));
+    }
+    result->kind = FOSSIL_VALUE_ARRAY;
+    result->as.array = array;
+    return 0;
+}
+
+// =================================================================
+// Projects
+// =================================================================
+
+// Work shared by the threads parsing one wave of project files
+typedef struct {
+    fossil_project* project;
+    cmutex* lock;
+    size_t* next;
+    size_t end;
+    const fossil_parser_ctx* config;  // Keywords every thread copies into its own context
+} fossil_project_task;
+
+static int fossil_path_separator(char c) {
+    return c == '/' || c == '\\';
+}
+
+// Length of the root prefix of a path ("/", "C:" or "C:/"), 0 if relative
+static size_t fossil_path_root(const char* path) {
+    if (isalpha((unsigned char)path[0]) && path[1] == ':') {
+        return fossil_path_separator(path[2]) ? 3 : 2;
+    }
+    return fossil_path_separator(path[0]) ? 1 : 0;
+}
+
+// Resolve path against the directory of base (if any and path is relative)
+// and drop "." and ".." segments textually. Returns a heap string.
+static char* fossil_path_resolve(const char* base, const char* path) {
+    size_t base_length = 0;
+    if (base != NULL && fossil_path_root(path) == 0) {
+        // Keep the directory part of base, separator included
+        for (size_t i = strlen(base); i > 0; --i) {
+            if (fossil_path_separator(base[i - 1])) {
+                base_length = i;
+                break;
+            }
+        }
+    }
+
+    size_t path_length = strlen(path);
+    char* joined = (char*)malloc(base_length + path_length + 1);
+    char* result = (char*)malloc(base_length + path_length + 2);
+    if (joined == NULL || result == NULL) {
+        free(joined);
+        free(result);
+        return NULL;
+    }
+    if (base_length > 0) {
+        memcpy(joined, base, base_length);
+    }
+    memcpy(joined + base_length, path, path_length + 1);
+
+    // Copy the root as is, then append segments one by one
+    size_t root = fossil_path_root(joined);
+    size_t used = 0;
+    for (size_t i = 0; i < root; ++i) {
+        result[used++] = fossil_path_separator(joined[i]) ? '/' : joined[i];
+    }
+    size_t floor = used;
+
+    const char* cursor = joined + root;
+    while (*cursor != '\0') {
+        const char* end = cursor;
+        while (*end != '\0' && !fossil_path_separator(*end)) {
+            end++;
+        }
+        size_t length = (size_t)(end - cursor);
+
+        if (length == 2 && cursor[0] == '.' && cursor[1] == '.') {
+            // Step back one segment unless there is none or it is ".." too
+            size_t last = used;
+            while (last > floor && result[last - 1] != '/') {
+                last--;
+            }
+            if (used > floor && !(used - last == 2 && result[last] == '.' && result[last + 1] == '.')) {
+                used = last > floor ? last - 1 : floor;
+            } else if (root == 0) {
+                if (used > floor) {
+                    result[used++] = '/';
+                }
+                result[used++] = '.';
+                result[used++] = '.';
+            }
+        } else if (length > 0 && !(length == 1 && cursor[0] == '.')) {
+            if (used > floor) {
+                result[used++] = '/';
+            }
+            memcpy(result + used, cursor, length);
+            used += length;
+        }
+
+        cursor = *end != '\0' ? end + 1 : end;
+    }
+    result[used] = '\0';
+
+    free(joined);
+    return result;
+}
+
+// Find a file by normalized path, or add it. Returns the index or SIZE_MAX.
+static size_t fossil_project_file_index(fossil_project* project, char* path) {
+    for (size_t i = 0; i < project->num_files; ++i) {
+        if (strcmp(project->files[i].path, path) == 0) {
+            free(path);
+            return i;
+        }
+    }
+
+    if (project->num_files == project->files_capacity) {
+        size_t capacity = project->files_capacity == 0 ? 8 : project->files_capacity * 2;
+        fossil_project_file* files = (fossil_project_file*)realloc(project->files, capacity * sizeof(fossil_project_file));
+        if (files == NULL) {
+            free(path);
+            return SIZE_MAX;
+        }
+        project->files = files;
+        project->files_capacity = capacity;
+    }
+
+    fossil_project_file* file = &project->files[project->num_files];
+    memset(file, 0, sizeof(*file));
+    file->path = path;
+    return project->num_files++;
+}
+
+// Record a link name unless it is already known
+static int fossil_project_add_library(fossil_project* project, const char* name) {
+    for (size_t i = 0; i < project->num_libraries; ++i) {
+        if (strcmp(project->libraries[i], name) == 0) {
+            return 0;
+        }
+    }
+
+    char** libraries = (char**)realloc(project->libraries, (project->num_libraries + 1) * sizeof(char*));
+    if (libraries == NULL) {
+        return -1;
+    }
+    project->libraries = libraries;
+    project->libraries[project->num_libraries] = fscl_fossil_strdup(name);
+    if (project->libraries[project->num_libraries] == NULL) {
+        return -1;
+    }
+    project->num_libraries++;
+    return 0;
+}
+
+// Read and parse one file; failures stay in the file's message
+static void fossil_project_parse_file(fossil_parser_ctx* ctx, fossil_project_file* file) {
+    size_t length;
+    char* code = fossil_read_file(file->path, &length);
+    if (code == NULL) {
+        snprintf(file->error, sizeof(file->error), "Cannot read file");
+        return;
+    }
+
+    file->root = fscl_fossil_parser_ctx_parse(ctx, code, length);
+    if (file->root == NULL) {
+        snprintf(file->error, sizeof(file->error), "%s", ctx->message[0] != '\0' ? ctx->message : "Parsing failed");
+    }
+    free(code);
+}
+
+// Take files of the wave one at a time until none are left; files differ
+// in size, so a shared cursor balances better than fixed ranges
+static cthread_task(fossil_project_worker, arg) {
+    fossil_project_task* task = (fossil_project_task*)arg;
+
+    // Each thread parses with its own context and token buffer
+    fossil_parser_ctx ctx = *task->config;
+    memset(&ctx.tokens, 0, sizeof(ctx.tokens));
+
+    for (;;) {
+        fscl_mutex_lock(task->lock);
+        size_t index = (*task->next)++;
+        fscl_mutex_unlock(task->lock);
+
+        if (index >= task->end) {
+            break;
+        }
+        fossil_project_parse_file(&ctx, &task->project->files[index]);
+    }
+
+    fscl_fossil_parser_ctx_erase(&ctx);
+    return CTHREAD_CNULLPTR;
+}
+
+// Parse files [begin, end) on up to num_threads threads
+static void fossil_project_parse_wave(fossil_project* project, size_t begin, size_t end, size_t num_threads) {
+    size_t workers = num_threads < 1 ? 1 : num_threads;
+    if (workers > end - begin) {
+        workers = end - begin;
+    }
+
+    // The keywords are read once here, not by every thread
+    fossil_parser_ctx config;
+    fscl_fossil_parser_ctx_init(&config);
+
+    cthread* threads = workers > 1 ? (cthread*)calloc(workers, sizeof(cthread)) : NULL;
+    if (threads == NULL) {
+        for (size_t i = begin; i < end; ++i) {
+            fossil_project_parse_file(&config, &project->files[i]);
+        }
+        fscl_fossil_parser_ctx_erase(&config);
+        return;
+    }
+
+    cmutex lock;
+    fscl_mutex_create(&lock);
+    size_t next = begin;
+    fossil_project_task task = {project, &lock, &next, end, &config};
+
+    // The calling thread takes files itself
+    for (size_t t = 1; t < workers; ++t) {
+        threads[t] = fscl_thread_create(fossil_project_worker, &task);
+    }
+    fossil_project_worker(&task);
+    for (size_t t = 1; t < workers; ++t) {
+        if (threads[t]) {
+            fscl_thread_join(threads[t]);
+            fscl_thread_erase(threads[t]);
+        }
+    }
+
+    fscl_mutex_erase(&lock);
+    free(threads);
+}
+
+// Resolve the includes and links of a parsed file
+static int fossil_project_scan(fossil_project* project, size_t index) {
+    ASTNode* root = project->files[index].root;
+
+    for (size_t i = 0; i < root->num_children; ++i) {
+        ASTNode* child = root->children[i];
+        if (child->type == LINK_LIBRARY) {
+            if (fossil_project_add_library(project, child->value) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        if (child->type != INCLUDE_FILE) {
+            continue;
+        }
+
+        char* path = fossil_path_resolve(project->files[index].path, child->value);
+        size_t included = path != NULL ? fossil_project_file_index(project, path) : SIZE_MAX;
+        if (included == SIZE_MAX) {
+            return -1;
+        }
+
+        // The files array may have moved
+        fossil_project_file* file = &project->files[index];
+        size_t* includes = (size_t*)realloc(file->includes, (file->num_includes + 1) * sizeof(size_t));
+        if (includes == NULL) {
+            return -1;
+        }
+        file->includes = includes;
+        file->includes[file->num_includes++] = included;
+    }
+    return 0;
+}
+
+// Add the declarations of every file to the merged root, each file after
+// the files it includes; include cycles are cut where they close
+static int fossil_project_merge(fossil_project* project) {
+    size_t count = project->num_files;
+    unsigned char* state = (unsigned char*)calloc(count, 1);
+    size_t* cursor = (size_t*)calloc(count, sizeof(size_t));
+    size_t* stack = (size_t*)malloc(count * sizeof(size_t));
+    project->root = fscl_fossil_create_node(PLACEHOLDER_NODE, FOSSIL_PLACEHOLDER, ADD, NULL);
+    if (state == NULL || cursor == NULL || stack == NULL || project->root == NULL) {
+        free(state);
+        free(cursor);
+        free(stack);
+        return -1;
+    }
+
+    size_t depth = 0;
+    stack[depth++] = 0;
+    state[0] = 1;
+    while (depth > 0) {
+        fossil_project_file* file = &project->files[stack[depth - 1]];
+        if (cursor[stack[depth - 1]] < file->num_includes) {
+            size_t next = file->includes[cursor[stack[depth - 1]]++];
+            if (!state[next]) {
+                state[next] = 1;
+                stack[depth++] = next;
+            }
+            continue;
+        }
+
+        depth--;
+        for (size_t i = 0; i < file->root->num_children; ++i) {
+            ASTNode* child = file->root->children[i];
+            if (child->type != INCLUDE_FILE && child->type != LINK_LIBRARY) {
+                fscl_fossil_add_child(project->root, child);
+            }
+        }
+    }
+
+    free(state);
+    free(cursor);
+    free(stack);
+    return project->root->error_flag ? -1 : 0;
+}
+
+// Function to load a project from its entry file
+int fscl_fossil_project_load(fossil_project* project, const char* entry_path, size_t num_threads) {
+    if (project == NULL) {
+        return -1;
+    }
+    memset(project, 0, sizeof(*project));
+    if (entry_path == NULL) {
+        snprintf(project->error, sizeof(project->error), "No entry file");
+        return -1;
+    }
+
+    char* path = fossil_path_resolve(NULL, entry_path);
+    int failed = path == NULL || fossil_project_file_index(project, path) == SIZE_MAX;
+
+    // Parse breadth first: every file found by one wave is parsed by the next
+    size_t begin = 0;
+    while (!failed && begin < project->num_files) {
+        size_t end = project->num_files;
+        fossil_project_parse_wave(project, begin, end, num_threads);
+
+        for (size_t i = begin; i < end; ++i) {
+            if (project->files[i].root == NULL) {
+                snprintf(project->error, sizeof(project->error), "%s: %s", project->files[i].path, project->files[i].error);
+                break;
+            }
+            if (fossil_project_scan(project, i) != 0) {
+                snprintf(project->error, sizeof(project->error), "%s: Out of memory", project->files[i].path);
+                break;
+            }
+        }
+        failed = project->error[0] != '\0';
+        begin = end;
+    }
+
+    if (!failed && fossil_project_merge(project) != 0) {
+        snprintf(project->error, sizeof(project->error), "Out of memory");
+        failed = 1;
+    }
+
+    if (failed) {
+        char error[sizeof(project->error)];
+        memcpy(error, project->error, sizeof(error));
+        if (error[0] == '\0') {
+            snprintf(error, sizeof(error), "Out of memory");
+        }
+        fscl_fossil_project_erase(project);
+        memcpy(project->error, error, sizeof(error));
+        return -1;
+    }
+    return 0;
+}
+
+// Function to free a project
+void fscl_fossil_project_erase(fossil_project* project) {
+    if (project == NULL) {
+        return;
+    }
+
+    // The merged root only borrows nodes owned by the file arenas
+    fscl_fossil_erase_node(project->root);
+    for (size_t i = 0; i < project->num_files; ++i) {
+        fscl_fossil_erase_node(project->files[i].root);
+        free(project->files[i].includes);
+        free(project->files[i].path);
+    }
+    for (size_t i = 0; i < project->num_libraries; ++i) {
+        free(project->libraries[i]);
+    }
+    free(project->files);
+    free(project->libraries);
+    memset(project, 0, sizeof(*project));
+}
+
+// =================================================================
+// Serialization and parse cache
+// =================================================================
+
+enum {
+    FOSSIL_SERIAL_VERSION     = 2,
+    FOSSIL_SERIAL_HEADER_SIZE = 24,
+    FOSSIL_SERIAL_RECORD_SIZE = 20,
+    FOSSIL_SERIAL_PUBLIC      = 1,
+    FOSSIL_SERIAL_HAS_VALUE   = 2,
+    FOSSIL_SERIAL_MEMBER      = 4
+};
+
+static const unsigned char fossil_serial_magic[4] = {'F', 'S', 'A', 'T'};
+
+// Directory of the parse cache, NULL when caching is off
+static char* fossil_cache_directory = NULL;
+
+static void fossil_put_u32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static uint32_t fossil_get_u32(const unsigned char* in) {
+    return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+static void fossil_put_u64(unsigned char* out, uint64_t value) {
+    fossil_put_u32(out, (uint32_t)value);
+    fossil_put_u32(out + 4, (uint32_t)(value >> 32));
+}
+
+static uint64_t fossil_get_u64(const unsigned char* in) {
+    return (uint64_t)fossil_get_u32(in) | (uint64_t)fossil_get_u32(in + 4) << 32;
+}
+
+// FNV-1a over a span, continuing from hash
+static uint64_t fossil_hash_bytes(uint64_t hash, const void* data, size_t length) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Capacity fscl_fossil_add_child assumes for a node array of count items
+static size_t fossil_node_capacity(size_t count) {
+    size_t capacity = FOSSIL_MIN_CHILDREN;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+// Whether a child is listed among the members of its class
+static int fossil_is_member(const ASTNode* parent, const ASTNode* child) {
+    ASTNode** members = child->is_public ? parent->public_members : parent->private_members;
+    size_t count = child->is_public ? parent->num_public_members : parent->num_private_members;
+    for (size_t i = 0; i < count; ++i) {
+        if (members[i] == child) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Count the nodes and value bytes of a tree
+static void fossil_serial_measure(const ASTNode* node, size_t* nodes, size_t* strings) {
+    (*nodes)++;
+    if (node->value != NULL) {
+        *strings += strlen(node->value);
+    }
+    for (size_t i = 0; i < node->num_children; ++i) {
+        fossil_serial_measure(node->children[i], nodes, strings);
+    }
+}
+
+// Write the records of a tree in pre-order, values into the string pool
+static void fossil_serial_write(const ASTNode* node, const ASTNode* parent, unsigned char** record, unsigned char* pool, size_t* used) {
+    unsigned char* out = *record;
+    unsigned flags = node->is_public ? FOSSIL_SERIAL_PUBLIC : 0;
+    size_t length = 0;
+    if (node->value != NULL) {
+        flags |= FOSSIL_SERIAL_HAS_VALUE;
+        length = strlen(node->value);
+    }
+    if (parent != NULL && fossil_is_member(parent, node)) {
+        flags |= FOSSIL_SERIAL_MEMBER;
+    }
+
+    out[0] = (unsigned char)node->type;
+    out[1] = (unsigned char)node->data_type;
+    out[2] = (unsigned char)node->operator_type;
+    out[3] = (unsigned char)flags;
+    fossil_put_u32(out + 4, (uint32_t)node->num_children);
+    fossil_put_u32(out + 8, (uint32_t)*used);
+    fossil_put_u32(out + 12, (uint32_t)length);
+    fossil_put_u32(out + 16, node->source_offset);
+    if (length > 0) {
+        memcpy(pool + *used, node->value, length);
+        *used += length;
+    }
+    *record += FOSSIL_SERIAL_RECORD_SIZE;
+
+    for (size_t i = 0; i < node->num_children; ++i) {
+        fossil_serial_write(node->children[i], node, record, pool, used);
+    }
+}
+
+// Function to compute the parse cache key of a source
+uint64_t fscl_fossil_source_key(const char* code, size_t length) {
+    // The keywords change how the same text parses
+    char braces[2] = {OPEN_BRACE_KEYWORD, CLOSE_BRACE_KEYWORD};
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = fossil_hash_bytes(hash, braces, sizeof(braces));
+    if (FUNCTION_KEYWORD != NULL) {
+        hash = fossil_hash_bytes(hash, FUNCTION_KEYWORD, strlen(FUNCTION_KEYWORD) + 1);
+    }
+    return fossil_hash_bytes(hash, code, length);
+}
+
+// Function to serialize a tree to a binary blob
+int fscl_fossil_serialize(const ASTNode* root, uint64_t key, unsigned char** data, size_t* size) {
+    if (root == NULL || data == NULL || size == NULL) {
+        return -1;
+    }
+    *data = NULL;
+    *size = 0;
+
+    size_t nodes = 0;
+    size_t strings = 0;
+    fossil_serial_measure(root, &nodes, &strings);
+    if (nodes > UINT32_MAX / FOSSIL_SERIAL_RECORD_SIZE || strings > UINT32_MAX) {
+        return -1;
+    }
+
+    size_t total = FOSSIL_SERIAL_HEADER_SIZE + nodes * FOSSIL_SERIAL_RECORD_SIZE + strings;
+    unsigned char* blob = (unsigned char*)malloc(total);
+    if (blob == NULL) {
+        return -1;
+    }
+
+    memcpy(blob, fossil_serial_magic, sizeof(fossil_serial_magic));
+    fossil_put_u32(blob + 4, FOSSIL_SERIAL_VERSION);
+    fossil_put_u64(blob + 8, key);
+    fossil_put_u32(blob + 16, (uint32_t)nodes);
+    fossil_put_u32(blob + 20, (uint32_t)strings);
+
+    unsigned char* record = blob + FOSSIL_SERIAL_HEADER_SIZE;
+    unsigned char* pool = record + nodes * FOSSIL_SERIAL_RECORD_SIZE;
+    size_t used = 0;
+    fossil_serial_write(root, NULL, &record, pool, &used);
+
+    *data = blob;
+    *size = total;
+    return 0;
+}
+
+// Function to rebuild a tree from a binary blob
+ASTNode* fscl_fossil_deserialize(const void* data, size_t size, uint64_t key) {
+    const unsigned char* blob = (const unsigned char*)data;
+    if (blob == NULL || size < FOSSIL_SERIAL_HEADER_SIZE || memcmp(blob, fossil_serial_magic, sizeof(fossil_serial_magic)) != 0 ||
+        fossil_get_u32(blob + 4) != FOSSIL_SERIAL_VERSION || fossil_get_u64(blob + 8) != key) {
+        return NULL;
+    }
+
+    size_t nodes = fossil_get_u32(blob + 16);
+    size_t strings = fossil_get_u32(blob + 20);
+    if (nodes == 0 || nodes > (size - FOSSIL_SERIAL_HEADER_SIZE) / FOSSIL_SERIAL_RECORD_SIZE ||
+        size - FOSSIL_SERIAL_HEADER_SIZE - nodes * FOSSIL_SERIAL_RECORD_SIZE != strings) {
+        return NULL;
+    }
+    const unsigned char* records = blob + FOSSIL_SERIAL_HEADER_SIZE;
+    const char* pool = (const char*)(records + nodes * FOSSIL_SERIAL_RECORD_SIZE);
+
+    // Size one arena block for the whole tree so it takes a single allocation
+    size_t total = 0;
+    for (size_t i = 0; i < nodes; ++i) {
+        const unsigned char* in = records + i * FOSSIL_SERIAL_RECORD_SIZE;
+        size_t children = fossil_get_u32(in + 4);
+        if (children >= nodes || fossil_get_u32(in + 8) > strings || fossil_get_u32(in + 12) > strings - fossil_get_u32(in + 8)) {
+            return NULL;
+        }
+        total += (sizeof(ASTNode) + FOSSIL_ARENA_ALIGNMENT) + (fossil_get_u32(in + 12) + FOSSIL_ARENA_ALIGNMENT);
+        if (children > 0) {
+            // Children, and public and private members for a class
+            total += 3 * (fossil_node_capacity(children) * sizeof(ASTNode*) + FOSSIL_ARENA_ALIGNMENT);
+        }
+    }
+
+    fossil_arena* arena = fscl_fossil_arena_create(total);
+    ASTNode** stack = (ASTNode**)malloc(nodes * sizeof(ASTNode*));
+    size_t* expected = (size_t*)malloc(nodes * sizeof(size_t));
+    if (arena == NULL || stack == NULL || expected == NULL) {
+        fscl_fossil_arena_erase(arena);
+        free(stack);
+        free(expected);
+        return NULL;
+    }
+
+    // Records are in pre-order: each node follows its parent, and a parent
+    // leaves the stack once all of its children have been attached
+    ASTNode* root = NULL;
+    size_t depth = 0;
+    int failed = 0;
+    for (size_t i = 0; i < nodes && !failed; ++i) {
+        const unsigned char* in = records + i * FOSSIL_SERIAL_RECORD_SIZE;
+        unsigned flags = in[3];
+        size_t children = fossil_get_u32(in + 4);
+
+        char* value = NULL;
+        if (flags & FOSSIL_SERIAL_HAS_VALUE) {
+            value = fscl_fossil_arena_strndup(arena, pool + fossil_get_u32(in + 8), fossil_get_u32(in + 12));
+        }
+        ASTNode* node = fossil_new_node(arena, (NodeType)in[0], (DataType)in[1], (OperatorType)in[2], value);
+        node->is_public = (flags & FOSSIL_SERIAL_PUBLIC) != 0;
+        node->source_offset = fossil_get_u32(in + 16);
+        if (children > 0) {
+            node->children = (ASTNode**)fscl_fossil_arena_alloc(arena, fossil_node_capacity(children) * sizeof(ASTNode*));
+            failed |= node->children == NULL;
+        }
+
+        if (root == NULL) {
+            root = node;
+        } else if (depth == 0) {
+            failed = 1;
+        } else {
+            ASTNode* parent = stack[depth - 1];
+            parent->children[parent->num_children++] = node;
+            if (flags & FOSSIL_SERIAL_MEMBER) {
+                // Member arrays get the capacity of the children array, which
+                // is never less than fossil_push_node expects
+                ASTNode*** members = node->is_public ? &parent->public_members : &parent->private_members;
+                size_t* count = node->is_public ? &parent->num_public_members : &parent->num_private_members;
+                if (*members == NULL) {
+                    *members = (ASTNode**)fscl_fossil_arena_alloc(arena, fossil_node_capacity(expected[depth - 1]) * sizeof(ASTNode*));
+                }
+                if (*members == NULL) {
+                    failed = 1;
+                } else {
+                    (*members)[(*count)++] = node;
+                }
+            }
+            if (parent->num_children == expected[depth - 1]) {
+                depth--;
+            }
+        }
+
+        if (children > 0) {
+            expected[depth] = children;
+            stack[depth++] = node;
+        }
+    }
+    free(stack);
+    free(expected);
+
+    if (failed || depth != 0) {
+        fscl_fossil_arena_erase(arena);
+        return NULL;
+    }
+    arena->root = root;
+    return root;
+}
+
+// Path of the cache entry for a key
+static char* fossil_cache_path(const char* directory, uint64_t key) {
+    size_t length = strlen(directory);
+    char* path = (char*)malloc(length + 32);
+    if (path != NULL) {
+        const char* separator = length > 0 && !fossil_path_separator(directory[length - 1]) ? "/" : "";
+        snprintf(path, length + 32, "%s%s%016llx.fossilc", directory, separator, (unsigned long long)key);
+    }
+    return path;
+}
+
+// Function to set the directory of the parse cache
+int fscl_fossil_set_cache_directory(const char* directory) {
+    char* copy = NULL;
+    if (directory != NULL) {
+        copy = fscl_fossil_strdup(directory);
+        if (copy == NULL) {
+            return -1;
+        }
+    }
+    free(fossil_cache_directory);
+    fossil_cache_directory = copy;
+    return 0;
+}
+
+// Function to get the directory of the parse cache
+const char* fscl_fossil_get_cache_directory(void) {
+    return fossil_cache_directory;
+}
+
+// Function to write a tree to the parse cache
+int fscl_fossil_cache_store(const char* directory, uint64_t key, const ASTNode* root) {
+    if (directory == NULL || root == NULL) {
+        return -1;
+    }
+
+    unsigned char* data;
+    size_t size;
+    if (fscl_fossil_serialize(root, key, &data, &size) != 0) {
+        return -1;
+    }
+
+    // Write beside the entry and rename, so readers never see half a file
+    char* path = fossil_cache_path(directory, key);
+    size_t path_length = path != NULL ? strlen(path) : 0;
+    char* temp = path != NULL ? (char*)malloc(path_length + 5) : NULL;
+    int result = -1;
+    if (temp != NULL) {
+        snprintf(temp, path_length + 5, "%s.tmp", path);
+        FILE* file = fopen(temp, "wb");
+        if (file != NULL) {
+            int written = fwrite(data, 1, size, file) == size;
+            if (fclose(file) == 0 && written) {
+#ifdef _WIN32
+                // rename does not replace an existing file here
+                remove(path);
+#endif
+                result = rename(temp, path) == 0 ? 0 : -1;
+            }
+            if (result != 0) {
+                remove(temp);
+            }
+        }
+    }
+
+    free(temp);
+    free(path);
+    free(data);
+    return result;
+}
+
+// Function to read a tree from the parse cache
+ASTNode* fscl_fossil_cache_load(const char* directory, uint64_t key) {
+    if (directory == NULL) {
+        return NULL;
+    }
+
+    char* path = fossil_cache_path(directory, key);
+    if (path == NULL) {
+        return NULL;
+    }
+
+    ASTNode* root = NULL;
+#ifdef _WIN32
+    size_t size;
+    char* data = fossil_read_file(path, &size);
+    if (data != NULL) {
+        root = fscl_fossil_deserialize(data, size, key);
+        free(data);
+    }
+#else
+    // Map the entry instead of copying it; the tree is rebuilt straight
+    // from the mapping into one arena block
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            root = fscl_fossil_deserialize(data, (size_t)info.st_size, key);
+            munmap(data, (size_t)info.st_size);
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+#endif
+
+    free(path);
+    return root;
+}
+
+// =================================================================
+// Symbol tables
+// =================================================================
+
+// Hash of a pointer for the pointer-keyed tables
+static size_t fossil_hash_pointer(const void* pointer) {
+    uint64_t value = (uint64_t)(uintptr_t)pointer;
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    return (size_t)value;
+}
+
+// Find the interned copy of a name without adding it
+static const char* fossil_intern_find(const fossil_symbol_table* table, const char* name, size_t* slot) {
+    size_t mask = table->names_capacity - 1;
+    size_t index = table->names_capacity > 0 ? (size_t)fossil_hash_bytes(0xcbf29ce484222325ULL, name, strlen(name)) & mask : 0;
+    for (size_t i = 0; i < table->names_capacity; ++i) {
+        const char* entry = table->names[index];
+        if (entry == NULL || strcmp(entry, name) == 0) {
+            if (slot != NULL) {
+                *slot = index;
+            }
+            return entry;
+        }
+        index = (index + 1) & mask;
+    }
+    return NULL;
+}
+
+// Intern a name, so equal names become equal pointers
+static const char* fossil_intern(fossil_symbol_table* table, const char* name) {
+    if ((table->num_names + 1) * 4 > table->names_capacity * 3) {
+        size_t capacity = table->names_capacity == 0 ? 64 : table->names_capacity * 2;
+        const char** old = table->names;
+        size_t old_capacity = table->names_capacity;
+        table->names = (const char**)calloc(capacity, sizeof(const char*));
+        if (table->names == NULL) {
+            table->names = old;
+            return NULL;
+        }
+        table->names_capacity = capacity;
+        for (size_t i = 0; i < old_capacity; ++i) {
+            size_t slot;
+            if (old[i] != NULL && fossil_intern_find(table, old[i], &slot) == NULL) {
+                table->names[slot] = old[i];
+            }
+        }
+        free((void*)old);
+    }
+
+    size_t slot;
+    const char* entry = fossil_intern_find(table, name, &slot);
+    if (entry == NULL) {
+        entry = fscl_fossil_arena_strndup(table->arena, name, strlen(name));
+        if (entry == NULL) {
+            return NULL;
+        }
+        table->names[slot] = entry;
+        table->num_names++;
+    }
+    return entry;
+}
+
+// Find a symbol of one scope by interned name
+static fossil_symbol* fossil_scope_find(const fossil_scope* scope, const char* name, size_t* slot) {
+    size_t mask = scope->capacity - 1;
+    size_t index = scope->capacity > 0 ? fossil_hash_pointer(name) & mask : 0;
+    for (size_t i = 0; i < scope->capacity; ++i) {
+        fossil_symbol* entry = scope->slots[index];
+        if (entry == NULL || entry->name == name) {
+            if (slot != NULL) {
+                *slot = index;
+            }
+            return entry;
+        }
+        index = (index + 1) & mask;
+    }
+    return NULL;
+}
+
+// Slot of an owner node in the scope map
+static size_t fossil_scope_slot(const fossil_symbol_table* table, const ASTNode* owner) {
+    size_t mask = table->scopes_capacity - 1;
+    size_t index = fossil_hash_pointer(owner) & mask;
+    while (table->scope_owners[index] != NULL && table->scope_owners[index] != owner) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+// Map an owner node to the scope it opens
+static int fossil_scope_map(fossil_symbol_table* table, const ASTNode* owner, fossil_scope* scope) {
+    if ((table->num_scopes + 1) * 4 > table->scopes_capacity * 3) {
+        const ASTNode** old_owners = table->scope_owners;
+        fossil_scope** old_scopes = table->scopes;
+        size_t old_capacity = table->scopes_capacity;
+        size_t capacity = old_capacity == 0 ? 64 : old_capacity * 2;
+
+        table->scope_owners = (const ASTNode**)calloc(capacity, sizeof(ASTNode*));
+        table->scopes = (fossil_scope**)calloc(capacity, sizeof(fossil_scope*));
+        if (table->scope_owners == NULL || table->scopes == NULL) {
+            free((void*)table->scope_owners);
+            free(table->scopes);
+            table->scope_owners = old_owners;
+            table->scopes = old_scopes;
+            return -1;
+        }
+        table->scopes_capacity = capacity;
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_owners[i] != NULL) {
+                size_t slot = fossil_scope_slot(table, old_owners[i]);
+                table->scope_owners[slot] = old_owners[i];
+                table->scopes[slot] = old_scopes[i];
+            }
+        }
+        free((void*)old_owners);
+        free(old_scopes);
+    }
+
+    size_t slot = fossil_scope_slot(table, owner);
+    if (table->scope_owners[slot] == NULL) {
+        table->num_scopes++;
+    }
+    table->scope_owners[slot] = owner;
+    table->scopes[slot] = scope;
+    return 0;
+}
+
+// Open a scope for an owner node
+static fossil_scope* fossil_scope_open(fossil_symbol_table* table, fossil_scope* parent, ASTNode* owner) {
+    fossil_scope* scope = (fossil_scope*)fscl_fossil_arena_alloc(table->arena, sizeof(fossil_scope));
+    if (scope == NULL) {
+        return NULL;
+    }
+    memset(scope, 0, sizeof(*scope));
+    scope->parent = parent;
+    scope->owner = owner;
+    if (owner != NULL && fossil_scope_map(table, owner, scope) != 0) {
+        return NULL;
+    }
+    return scope;
+}
+
+// Record a name declared twice in one scope
+static int fossil_symbols_duplicate(fossil_symbol_table* table, ASTNode* node, ASTNode* previous) {
+    if (table->num_duplicates == table->duplicates_capacity) {
+        size_t capacity = table->duplicates_capacity == 0 ? 8 : table->duplicates_capacity * 2;
+        fossil_duplicate* duplicates = (fossil_duplicate*)realloc(table->duplicates, capacity * sizeof(fossil_duplicate));
+        if (duplicates == NULL) {
+            return -1;
+        }
+        table->duplicates = duplicates;
+        table->duplicates_capacity = capacity;
+    }
+    table->duplicates[table->num_duplicates].node = node;
+    table->duplicates[table->num_duplicates].previous = previous;
+    table->num_duplicates++;
+    return 0;
+}
+
+// Declare the name of a node in a scope. A duplicate still gets a symbol,
+// so its body can be walked, but the first declaration keeps the name.
+static fossil_symbol* fossil_symbols_declare(fossil_symbol_table* table, fossil_scope* scope, fossil_symbol_kind kind, ASTNode* node) {
+    const char* name = fossil_intern(table, node->value);
+    fossil_symbol* symbol = name != NULL ? (fossil_symbol*)fscl_fossil_arena_alloc(table->arena, sizeof(fossil_symbol)) : NULL;
+    if (symbol == NULL) {
+        return NULL;
+    }
+    symbol->name = name;
+    symbol->kind = kind;
+    symbol->node = node;
+    symbol->scope = scope;
+    symbol->body = NULL;
+
+    if ((scope->count + 1) * 4 > scope->capacity * 3) {
+        fossil_symbol** old = scope->slots;
+        size_t old_capacity = scope->capacity;
+        size_t capacity = old_capacity == 0 ? 8 : old_capacity * 2;
+        scope->slots = (fossil_symbol**)calloc(capacity, sizeof(fossil_symbol*));
+        if (scope->slots == NULL) {
+            scope->slots = old;
+            return NULL;
+        }
+        scope->capacity = capacity;
+        for (size_t i = 0; i < old_capacity; ++i) {
+            size_t slot;
+            if (old[i] != NULL && fossil_scope_find(scope, old[i]->name, &slot) == NULL) {
+                scope->slots[slot] = old[i];
+            }
+        }
+        free(old);
+    }
+
+    size_t slot;
+    fossil_symbol* previous = fossil_scope_find(scope, name, &slot);
+    if (previous != NULL) {
+        return fossil_symbols_duplicate(table, node, previous->node) == 0 ? symbol : NULL;
+    }
+    scope->slots[slot] = symbol;
+    scope->count++;
+    return symbol;
+}
+
+// Resolve an interned name from a scope outwards
+static fossil_symbol* fossil_symbols_lookup(const fossil_scope* scope, const char* name) {
+    for (; scope != NULL; scope = scope->parent) {
+        for (const fossil_scope* level = scope; level != NULL; level = level->base) {
+            fossil_symbol* symbol = fossil_scope_find(level, name, NULL);
+            if (symbol != NULL) {
+                return symbol;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Whether a name is declared, as seen from a scope
+static int fossil_symbols_known(const fossil_symbol_table* table, const fossil_scope* scope, const char* name) {
+    const char* interned = fossil_intern_find(table, name, NULL);
+    return interned != NULL && fossil_symbols_lookup(scope, interned) != NULL;
+}
+
+static int fossil_symbols_statement(fossil_symbol_table* table, fossil_scope* scope, ASTNode* node);
+
+// Declare the statements of a block in a scope
+static int fossil_symbols_block(fossil_symbol_table* table, fossil_scope* scope, ASTNode* block) {
+    for (size_t i = 0; i < block->num_children; ++i) {
+        if (fossil_symbols_statement(table, scope, block->children[i]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Declare the locals of a statement, opening scopes for nested blocks
+static int fossil_symbols_statement(fossil_symbol_table* table, fossil_scope* scope, ASTNode* node) {
+    switch (node->type) {
+        case VARIABLE:
+        case ASSIGNMENT:
+            // A declaration, unless it is a bare reference to or an
+            // assignment of a known name, as in the compiler
+            if (node->value == NULL || strchr(node->value, '.') != NULL) {
+                return 0;
+            }
+            if ((node->type == ASSIGNMENT || node->num_children == 0) && fossil_symbols_known(table, scope, node->value)) {
+                return 0;
+            }
+            return fossil_symbols_declare(table, scope, FOSSIL_SYMBOL_VARIABLE, node) != NULL ? 0 : -1;
+        case BLOCK_STATEMENT: {
+            fossil_scope* inner = fossil_scope_open(table, scope, node);
+            return inner != NULL ? fossil_symbols_block(table, inner, node) : -1;
+        }
+        case IF_STATEMENT:
+        case WHILE_LOOP:
+            for (size_t i = 1; i < node->num_children; ++i) {
+                if (fossil_symbols_statement(table, scope, node->children[i]) != 0) {
+                    return -1;
+                }
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+// Declare a class, function or method and open its scope
+static int fossil_symbols_declare_scoped(fossil_symbol_table* table, fossil_scope* scope, fossil_symbol_kind kind, ASTNode* node) {
+    fossil_symbol* symbol = fossil_symbols_declare(table, scope, kind, node);
+    if (symbol == NULL) {
+        return -1;
+    }
+    symbol->body = fossil_scope_open(table, scope, node);
+    return symbol->body != NULL ? 0 : -1;
+}
+
+// Declare the parameters and locals of a function whose scope is open
+static int fossil_symbols_function_body(fossil_symbol_table* table, ASTNode* node) {
+    fossil_scope* scope = fscl_fossil_symbols_scope(table, node);
+    for (size_t i = 0; i < node->num_children; ++i) {
+        ASTNode* child = node->children[i];
+        if (child->type == VARIABLE) {
+            if (fossil_symbols_declare(table, scope, FOSSIL_SYMBOL_PARAMETER, child) == NULL) {
+                return -1;
+            }
+        } else if (child->type == BLOCK_STATEMENT) {
+            // The body shares the scope of the parameters
+            if (fossil_scope_map(table, child, scope) != 0 || fossil_symbols_block(table, scope, child) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Link a class scope to the scope of the class it extends
+static void fossil_symbols_link(fossil_symbol_table* table, ASTNode* classNode) {
+    fossil_scope* scope = fscl_fossil_symbols_scope(table, classNode);
+    for (size_t i = 0; i < classNode->num_children; ++i) {
+        ASTNode* inheritance = classNode->children[i];
+        if (inheritance->type != INHERITANCE || inheritance->value == NULL) {
+            continue;
+        }
+
+        const char* name = fossil_intern_find(table, inheritance->value, NULL);
+        fossil_symbol* base = name != NULL ? fossil_scope_find(table->global, name, NULL) : NULL;
+        if (base == NULL || base->kind != FOSSIL_SYMBOL_CLASS) {
+            return;
+        }
+
+        // Leave a cycle open where it would close
+        for (fossil_scope* level = base->body; level != NULL; level = level->base) {
+            if (level == scope) {
+                return;
+            }
+        }
+        scope->base = base->body;
+        inheritance->parent_class = base->node;
+        return;
+    }
+}
+
+// Function to build the symbol table of a tree
+int fscl_fossil_symbols_build(ASTNode* root, fossil_symbol_table* table) {
+    if (table == NULL) {
+        return -1;
+    }
+    memset(table, 0, sizeof(*table));
+    if (root == NULL) {
+        return -1;
+    }
+
+    table->arena = fscl_fossil_arena_create(0);
+    table->global = table->arena != NULL ? fossil_scope_open(table, NULL, NULL) : NULL;
+    int failed = table->global == NULL;
+
+    // Top-level names first, so bodies and parents may refer to later ones
+    for (size_t i = 0; !failed && i < root->num_children; ++i) {
+        ASTNode* node = root->children[i];
+        if (node->type == CLASS) {
+            failed = fossil_symbols_declare_scoped(table, table->global, FOSSIL_SYMBOL_CLASS, node) != 0;
+        } else if (node->type == FUNCTION) {
+            failed = fossil_symbols_declare_scoped(table, table->global, FOSSIL_SYMBOL_FUNCTION, node) != 0;
+        }
+    }
+    for (size_t i = 0; !failed && i < root->num_children; ++i) {
+        if (root->children[i]->type == CLASS) {
+            fossil_symbols_link(table, root->children[i]);
+        }
+    }
+
+    for (size_t i = 0; !failed && i < root->num_children; ++i) {
+        ASTNode* node = root->children[i];
+        if (node->type == FUNCTION) {
+            failed = fossil_symbols_function_body(table, node) != 0;
+            continue;
+        }
+        if (node->type != CLASS) {
+            continue;
+        }
+
+        // Members before method bodies, so methods see every field
+        fossil_scope* scope = fscl_fossil_symbols_scope(table, node);
+        for (size_t m = 0; !failed && m < node->num_children; ++m) {
+            ASTNode* member = node->children[m];
+            if (member->type == FUNCTION) {
+                failed = fossil_symbols_declare_scoped(table, scope, FOSSIL_SYMBOL_METHOD, member) != 0;
+            } else if (member->type == VARIABLE) {
+                failed = fossil_symbols_declare(table, scope, FOSSIL_SYMBOL_FIELD, member) == NULL;
+            }
+        }
+        for (size_t m = 0; !failed && m < node->num_children; ++m) {
+            if (node->children[m]->type == FUNCTION) {
+                failed = fossil_symbols_function_body(table, node->children[m]) != 0;
+            }
+        }
+    }
+
+    if (failed) {
+        fscl_fossil_symbols_erase(table);
+        return -1;
+    }
+    return 0;
+}
+
+// Function to free a symbol table
+void fscl_fossil_symbols_erase(fossil_symbol_table* table) {
+    if (table == NULL) {
+        return;
+    }
+
+    // A function body is mapped to the function's scope; free that once
+    for (size_t i = 0; i < table->scopes_capacity; ++i) {
+        if (table->scope_owners[i] != NULL && table->scopes[i]->owner == table->scope_owners[i]) {
+            free(table->scopes[i]->slots);
+        }
+    }
+    if (table->global != NULL) {
+        free(table->global->slots);
+    }
+
+    free((void*)table->names);
+    free((void*)table->scope_owners);
+    free(table->scopes);
+    free(table->duplicates);
+    fscl_fossil_arena_erase(table->arena);
+    memset(table, 0, sizeof(*table));
+}
+
+// Function to get the scope opened by a node
+fossil_scope* fscl_fossil_symbols_scope(const fossil_symbol_table* table, const ASTNode* owner) {
+    if (table == NULL || owner == NULL || table->scopes_capacity == 0) {
+        return NULL;
+    }
+    size_t slot = fossil_scope_slot(table, owner);
+    return table->scope_owners[slot] != NULL ? table->scopes[slot] : NULL;
+}
+
+// Function to resolve a name from a scope outwards
+fossil_symbol* fscl_fossil_symbols_resolve(const fossil_symbol_table* table, const fossil_scope* scope, const char* name) {
+    if (table == NULL || name == NULL) {
+        return NULL;
+    }
+    const char* interned = fossil_intern_find(table, name, NULL);
+    return interned != NULL ? fossil_symbols_lookup(scope != NULL ? scope : table->global, interned) : NULL;
+}
+
+// Function to find a member of a class or of its parent classes
+fossil_symbol* fscl_fossil_symbols_find_member(const fossil_symbol_table* table, const char* class_name, const char* name) {
+    fossil_symbol* owner = fscl_fossil_symbols_resolve(table, NULL, class_name);
+    const char* interned = name != NULL ? fossil_intern_find(table, name, NULL) : NULL;
+    if (owner == NULL || owner->kind != FOSSIL_SYMBOL_CLASS || interned == NULL) {
+        return NULL;
+    }
+
+    for (const fossil_scope* level = owner->body; level != NULL; level = level->base) {
+        fossil_symbol* symbol = fossil_scope_find(level, interned, NULL);
+        if (symbol != NULL) {
+            return symbol;
+        }
+    }
+    return NULL;
+}
+
+// Set of symbols, hashed by address
+typedef struct {
+    const fossil_symbol** slots;
+    size_t capacity;
+    size_t count;
+} fossil_symbol_set;
+
+// Slot of a symbol in a set, or of the empty slot where it would go
+static size_t fossil_symbol_set_slot(const fossil_symbol_set* set, const fossil_symbol* symbol) {
+    size_t mask = set->capacity - 1;
+    size_t index = fossil_hash_pointer(symbol) & mask;
+    while (set->slots[index] != NULL && set->slots[index] != symbol) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+// Whether a set holds a symbol
+static int fossil_symbol_set_contains(const fossil_symbol_set* set, const fossil_symbol* symbol) {
+    return set->capacity > 0 && set->slots[fossil_symbol_set_slot(set, symbol)] != NULL;
+}
+
+// Add a symbol to a set, returning 0 on success
+static int fossil_symbol_set_add(fossil_symbol_set* set, const fossil_symbol* symbol) {
+    if ((set->count + 1) * 4 > set->capacity * 3) {
+        fossil_symbol_set grown = {NULL, set->capacity == 0 ? 64 : set->capacity * 2, set->count};
+        grown.slots = (const fossil_symbol**)calloc(grown.capacity, sizeof(fossil_symbol*));
+        if (grown.slots == NULL) {
+            return -1;
+        }
+        for (size_t i = 0; i < set->capacity; ++i) {
+            if (set->slots[i] != NULL) {
+                grown.slots[fossil_symbol_set_slot(&grown, set->slots[i])] = set->slots[i];
+            }
+        }
+        free((void*)set->slots);
+        *set = grown;
+    }
+
+    size_t slot = fossil_symbol_set_slot(set, symbol);
+    if (set->slots[slot] == NULL) {
+        set->slots[slot] = symbol;
+        set->count++;
+    }
+    return 0;
+}
+
+// Free the slots of a set
+static void fossil_symbol_set_erase(fossil_symbol_set* set) {
+    free((void*)set->slots);
+    memset(set, 0, sizeof(*set));
+}
+
+// Resolve a name for a pass that walks statements in order. A local whose
+// declaration is not in reached yet is not visible, as in the compiler, so
+// the search goes on in the enclosing scopes.
+static fossil_symbol* fossil_symbols_resolve_reached(const fossil_symbol_table* table, const fossil_scope* scope, const fossil_symbol_set* reached, const char* name) {
+    fossil_symbol* symbol = fscl_fossil_symbols_resolve(table, scope, name);
+    while (symbol != NULL && symbol->kind == FOSSIL_SYMBOL_VARIABLE && !fossil_symbol_set_contains(reached, symbol)) {
+        fossil_scope* parent = symbol->scope->parent;
+        symbol = parent != NULL ? fscl_fossil_symbols_resolve(table, parent, name) : NULL;
+    }
+    return symbol;
+}
+
+// =================================================================
+// C code generation
+// =================================================================
+
+// Support code at the top of every generated translation unit. Values stay
+// dynamic as in the virtual machine: the int cases are inlined here and the
+// rest goes through the runtime functions of the machine.
+static const char fossil_codegen_prelude[] =
+    "#include \"fossil/xcore/fossil.h\"\n"
+    "#include <math.h>\n"
+    "\n"
+    "static fossil_vm rt_vm;\n"
+    "\n"
+    "static inline void rt_fail(void) {\n"
+    "    fprintf(stderr, \"%s\\n\", rt_vm.error);\n"
+    "    exit(EXIT_FAILURE);\n"
+    "}\n"
+    "\n"
+    "static inline fossil_value rt_null(void) {\n"
+    "    fossil_value value;\n"
+    "    value.kind = FOSSIL_VALUE_NULL;\n"
+    "    value.as.integer = 0;\n"
+    "    return value;\n"
+    "}\n"
+    "\n"
+    "static inline fossil_value rt_bool(int boolean) {\n"
+    "    fossil_value value;\n"
+    "    value.kind = FOSSIL_VALUE_BOOL;\n"
+    "    value.as.boolean = boolean;\n"
+    "    return value;\n"
+    "}\n"
+    "\n"
+    "static inline fossil_value rt_int(int64_t integer) {\n"
+    "    fossil_value value;\n"
+    "    value.kind = FOSSIL_VALUE_INT;\n"
+    "    value.as.integer = integer;\n"
+    "    return value;\n"
+    "}\n"
+    "\n"
+    "static inline fossil_value rt_float(double number) {\n"
+    "    fossil_value value;\n"
+    "    value.kind = FOSSIL_VALUE_FLOAT;\n"
+    "    value.as.number = number;\n"
+    "    return value;\n"
+    "}\n"
+    "\n"
+    "static inline fossil_value rt_string(const char* string) {\n"
+    "    fossil_value value;\n"
+    "    value.kind = FOSSIL_VALUE_STRING;\n"
+    "    value.as.string = string;\n"
+    "    return value;\n"
+    "}\n"
+    "\n"
+    "static inline int rt_truthy(fossil_value value) {\n"
+    "    return value.kind == FOSSIL_VALUE_BOOL ? value.as.boolean : fscl_fossil_vm_truthy(&value);\n"
+    "}\n"
+    "\n"
+    "static inline fossil_value rt_binary(OperatorType op, fossil_value a, fossil_value b) {\n"
+    "    if (a.kind == FOSSIL_VALUE_INT && b.kind == FOSSIL_VALUE_INT) {\n"
+    "        uint64_t x = (uint64_t)a.as.integer;\n"
+    "        uint64_t y = (uint64_t)b.as.integer;\n"
+    "        switch (op) {\n"
+    "            case ADD:           return rt_int((int64_t)(x + y));\n"
+    "            case SUBTRACT:      return rt_int((int64_t)(x - y));\n"
+    "            case MULTIPLY:      return rt_int((int64_t)(x * y));\n"
+    "            case EQUALS:        return rt_bool(x == y);\n"
+    "            case NOT_EQUALS:    return rt_bool(x != y);\n"
+    "            case LESS_THAN:     return rt_bool(a.as.integer < b.as.integer);\n"
+    "            case LESS_EQUAL:    return rt_bool(a.as.integer <= b.as.integer);\n"
+    "            case GREATER_THAN:  return rt_bool(a.as.integer > b.as.integer);\n"
+    "            case GREATER_EQUAL: return rt_bool(a.as.integer >= b.as.integer);\n"
+    "            default:            break;\n"
+    "        }\n"
+    "    }\n"
+    "    if (fscl_fossil_vm_binary(&rt_vm, op, &a, &b) != 0) {\n"
+    "        rt_fail();\n"
+    "    }\n"
+    "    return a;\n"
+    "}\n"
+    "\n"
+    "static inline fossil_value rt_unary(OperatorType op, fossil_value value) {\n"
+    "    if (fscl_fossil_vm_unary(&rt_vm, op, &value) != 0) {\n"
+    "        rt_fail();\n"
+    "    }\n"
+    "    return value;\n"
+    "}\n"
+    "\n"
+    "static inline fossil_value rt_print(size_t count, const fossil_value* values) {\n"
+    "    if (fscl_fossil_vm_print(&rt_vm, values, count) != 0) {\n"
+    "        rt_fail();\n"
+    "    }\n"
+    "    return rt_null();\n"
+    "}\n"
+    "\n"
+    "static inline fossil_value rt_array(size_t count, const fossil_value* items) {\n"
+    "    fossil_value value;\n"
+    "    if (fscl_fossil_vm_array(&rt_vm, items, count, &value) != 0) {\n"
+    "        rt_fail();\n"
+    "    }\n"
+    "    return value;\n"
+    "}\n";
+
+// State of one C code generation
+typedef struct {
+    fossil_text* out;              // Text being written
+    fossil_symbol_table symbols;
+    const ASTNode* class_node;     // Class of the method being lowered, else NULL
+    fossil_scope* scope;           // Scope of the code being lowered
+    fossil_symbol_set declared;    // Locals whose declaration was written
+    size_t num_temps;              // and/or operators so far, each with its own temporary
+    int indent;
+    int failed;
+    char* error;
+    size_t error_size;
+} fossil_codegen;
+
+// Record the first generation error
+static void fossil_codegen_error(fossil_codegen* gen, const char* format, const char* name) {
+    if (!gen->failed) {
+        if (gen->error != NULL && gen->error_size > 0) {
+            snprintf(gen->error, gen->error_size, format, name != NULL ? name : "");
+        }
+        gen->failed = 1;
+    }
+}
+
+// Append formatted text to the output
+static void fossil_codegen_write(fossil_codegen* gen, const char* format, ...) {
+    if (gen->failed) {
+        return;
+    }
+
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) {
+        fossil_codegen_error(gen, "Invalid output%s", NULL);
+        return;
+    }
+
+    int status;
+    if ((size_t)length < sizeof(buffer)) {
+        status = fossil_text_append(gen->out, buffer, (size_t)length);
+    } else {
+        // Long names: format again into a buffer of the right size
+        char* text = (char*)malloc((size_t)length + 1);
+        status = -1;
+        if (text != NULL) {
+            va_start(args, format);
+            vsnprintf(text, (size_t)length + 1, format, args);
+            va_end(args);
+            status = fossil_text_append(gen->out, text, (size_t)length);
+            free(text);
+        }
+    }
+    if (status != 0) {
+        fossil_codegen_error(gen, "Out of memory%s", NULL);
+    }
+}
+
+// Start a line at the current indentation
+static void fossil_codegen_line(fossil_codegen* gen) {
+    for (int i = 0; i < gen->indent; ++i) {
+        fossil_codegen_write(gen, "    ");
+    }
+}
+
+// Resolve a name as seen from the code being lowered
+static fossil_symbol* fossil_codegen_resolve(fossil_codegen* gen, const char* name) {
+    if (name != NULL && strchr(name, '.') != NULL) {
+        fossil_codegen_error(gen, "Member access '%s' is not supported", name);
+        return NULL;
+    }
+    return fossil_symbols_resolve_reached(&gen->symbols, gen->scope, &gen->declared, name);
+}
+
+// Write the path from self to a field or to the object holding a method.
+// Members of parent classes are reached through the embedded base structs.
+static void fossil_codegen_member(fossil_codegen* gen, const fossil_symbol* symbol) {
+    const fossil_scope* level = fscl_fossil_symbols_scope(&gen->symbols, gen->class_node);
+    size_t steps = 0;
+    while (level != NULL && level != symbol->scope) {
+        level = level->base;
+        steps++;
+    }
+    if (level == NULL) {
+        fossil_codegen_error(gen, "Member '%s' is not reachable", symbol->name);
+        return;
+    }
+    if (steps > 0 && !symbol->node->is_public) {
+        fossil_codegen_error(gen, "Member '%s' is private to a parent class", symbol->name);
+        return;
+    }
+
+    int method = symbol->kind == FOSSIL_SYMBOL_METHOD;
+    if (steps == 0) {
+        fossil_codegen_write(gen, method ? "self" : "self->v_");
+    } else {
+        fossil_codegen_write(gen, method ? "&self->base" : "self->base");
+        for (size_t i = 1; i < steps; ++i) {
+            fossil_codegen_write(gen, ".base");
+        }
+        fossil_codegen_write(gen, method ? "" : ".v_");
+    }
+    if (!method) {
+        fossil_codegen_write(gen, "%s", symbol->name);
+    }
+}
+
+// Write the C lvalue of a local, parameter or field
+static int fossil_codegen_variable(fossil_codegen* gen, const char* name) {
+    fossil_symbol* symbol = fossil_codegen_resolve(gen, name);
+    if (gen->failed) {
+        return -1;
+    }
+    if (symbol == NULL || (symbol->kind != FOSSIL_SYMBOL_VARIABLE && symbol->kind != FOSSIL_SYMBOL_PARAMETER && symbol->kind != FOSSIL_SYMBOL_FIELD)) {
+        fossil_codegen_error(gen, "Undefined variable '%s'", name);
+        return -1;
+    }
+
+    if (symbol->kind == FOSSIL_SYMBOL_FIELD) {
+        fossil_codegen_member(gen, symbol);
+    } else {
+        fossil_codegen_write(gen, "v_%s", symbol->name);
+    }
+    return gen->failed ? -1 : 0;
+}
+
+// Write a string as a C literal
+static void fossil_codegen_string(fossil_codegen* gen, const char* text) {
+    fossil_codegen_write(gen, "\"");
+    for (const unsigned char* c = (const unsigned char*)text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            fossil_codegen_write(gen, "\\%c", *c);
+        } else if (*c >= 0x20 && *c < 0x7f && *c != '?') {
+            fossil_codegen_write(gen, "%c", *c);
+        } else {
+            // Octal escapes always take three digits, so a following digit is safe
+            fossil_codegen_write(gen, "\\%03o", (unsigned)*c);
+        }
+    }
+    fossil_codegen_write(gen, "\"");
+}
+
+// Write a CONSTANT node as a runtime value
+static void fossil_codegen_constant(fossil_codegen* gen, const ASTNode* node) {
+    fossil_value value;
+    if (fossil_constant_value(node, &value) != 0) {
+        fossil_codegen_error(gen, "Out of memory%s", NULL);
+        return;
+    }
+
+    switch (value.kind) {
+        case FOSSIL_VALUE_BOOL:
+            fossil_codegen_write(gen, "rt_bool(%d)", value.as.boolean);
+            return;
+        case FOSSIL_VALUE_INT:
+            if (value.as.integer == INT64_MIN) {
+                fossil_codegen_write(gen, "rt_int(INT64_MIN)");
+            } else {
+                fossil_codegen_write(gen, "rt_int(INT64_C(%lld))", (long long)value.as.integer);
+            }
+            return;
+        case FOSSIL_VALUE_FLOAT: {
+            double number = value.as.number;
+            if (number != number) {
+                fossil_codegen_write(gen, "rt_float(NAN)");
+                return;
+            }
+            if (number - number != 0.0) {
+                fossil_codegen_write(gen, number > 0 ? "rt_float(HUGE_VAL)" : "rt_float(-HUGE_VAL)");
+                return;
+            }
+            // Shortest form that reads back as the same double
+            char digits[40];
+            snprintf(digits, sizeof(digits), "%.15g", number);
+            if (strtod(digits, NULL) != number) {
+                snprintf(digits, sizeof(digits), "%.17g", number);
+            }
+            fossil_codegen_write(gen, "rt_float(%s)", digits);
+            return;
+        }
+        case FOSSIL_VALUE_STRING:
+            fossil_codegen_write(gen, "rt_string(");
+            fossil_codegen_string(gen, value.as.string);
+            fossil_codegen_write(gen, ")");
+            free((char*)value.as.string);
+            return;
+        default:
+            fossil_codegen_write(gen, "rt_null()");
+            return;
+    }
+}
+
+static void fossil_codegen_expression(fossil_codegen* gen, const ASTNode* node);
+
+// Write the arguments of print or an array literal as a compound literal
+static void fossil_codegen_values(fossil_codegen* gen, const ASTNode* node) {
+    if (node->num_children == 0) {
+        fossil_codegen_write(gen, "0, NULL");
+        return;
+    }
+    fossil_codegen_write(gen, "%lu, (fossil_value[]){", (unsigned long)node->num_children);
+    for (size_t i = 0; i < node->num_children; ++i) {
+        fossil_codegen_write(gen, i > 0 ? ", " : "");
+        fossil_codegen_expression(gen, node->children[i]);
+    }
+    fossil_codegen_write(gen, "}");
+}
+
+// Write a call to a function or to a method of the current object, filling
+// in parameter defaults like the compiler
+static void fossil_codegen_call(fossil_codegen* gen, const ASTNode* node) {
+    if (node->value != NULL && strchr(node->value, '.') != NULL) {
+        fossil_codegen_error(gen, "Calls through objects ('%s') are not supported", node->value);
+        return;
+    }
+
+    fossil_symbol* symbol = fossil_codegen_resolve(gen, node->value);
+    if (symbol == NULL || (symbol->kind != FOSSIL_SYMBOL_FUNCTION && symbol->kind != FOSSIL_SYMBOL_METHOD)) {
+        fossil_codegen_error(gen, "Unknown function '%s'", node->value);
+        return;
+    }
+
+    const ASTNode* callee = symbol->node;
+    size_t arity = fossil_function_arity(callee);
+    if (node->num_children > arity) {
+        fossil_codegen_error(gen, "Too many arguments to '%s'", node->value);
+        return;
+    }
+
+    if (symbol->kind == FOSSIL_SYMBOL_METHOD) {
+        fossil_codegen_write(gen, "fsl_%s__%s(", symbol->scope->owner->value, symbol->name);
+        fossil_codegen_member(gen, symbol);
+    } else {
+        fossil_codegen_write(gen, "fsl_%s(", symbol->name);
+    }
+
+    for (size_t i = 0; i < arity; ++i) {
+        const ASTNode* parameter = callee->children[i];
+        fossil_codegen_write(gen, i > 0 || symbol->kind == FOSSIL_SYMBOL_METHOD ? ", " : "");
+        if (i < node->num_children) {
+            fossil_codegen_expression(gen, node->children[i]);
+        } else if (parameter->num_children > 0) {
+            fossil_codegen_expression(gen, parameter->children[0]);
+        } else {
+            fossil_codegen_error(gen, "Missing argument in call to '%s'", node->value);
+            return;
+        }
+    }
+    fossil_codegen_write(gen, ")");
+}
+
+// Write an expression as a C expression of type fossil_value
+static void fossil_codegen_expression(fossil_codegen* gen, const ASTNode* node) {
+    if (gen->failed) {
+        return;
+    }
+
+    switch (node->type) {
+        case CONSTANT:
+            fossil_codegen_constant(gen, node);
+            return;
+        case VARIABLE:
+            fossil_codegen_variable(gen, node->value);
+            return;
+        case BINARY_OP:
+        case RELATIONAL_OP:
+            if (node->num_children != 2 || fossil_binary_opcode(node->operator_type) == FOSSIL_OP_COUNT) {
+                fossil_codegen_error(gen, "Invalid operator '%s'", node->value);
+                return;
+            }
+            fossil_codegen_write(gen, "rt_binary(%s, ", fscl_fossil_operator_name(node->operator_type));
+            fossil_codegen_expression(gen, node->children[0]);
+            fossil_codegen_write(gen, ", ");
+            fossil_codegen_expression(gen, node->children[1]);
+            fossil_codegen_write(gen, ")");
+            return;
+        case LOGICAL_OP: {
+            if (node->num_children != 2 || (node->operator_type != AND && node->operator_type != OR)) {
+                fossil_codegen_error(gen, "Invalid operator '%s'", node->value);
+                return;
+            }
+            // Short circuit: the left value is the result when it decides.
+            // Operands of one call are unsequenced, so temporaries are not shared.
+            unsigned long temp = (unsigned long)gen->num_temps++;
+            fossil_codegen_write(gen, "(rt_t[%lu] = ", temp);
+            fossil_codegen_expression(gen, node->children[0]);
+            if (node->operator_type == AND) {
+                fossil_codegen_write(gen, ", rt_truthy(rt_t[%lu]) ? ", temp);
+                fossil_codegen_expression(gen, node->children[1]);
+                fossil_codegen_write(gen, " : rt_t[%lu])", temp);
+            } else {
+                fossil_codegen_write(gen, ", rt_truthy(rt_t[%lu]) ? rt_t[%lu] : ", temp, temp);
+                fossil_codegen_expression(gen, node->children[1]);
+                fossil_codegen_write(gen, ")");
+            }
+            return;
+        }
+        case UNARY_OP:
+            if (node->operator_type == INCREMENT || node->operator_type == DECREMENT) {
+                const ASTNode* target = node->num_children > 0 ? node->children[0] : NULL;
+                if (target == NULL || target->type != VARIABLE) {
+                    fossil_codegen_error(gen, "Invalid operand for '%s'", node->value);
+                    return;
+                }
+                fossil_codegen_write(gen, "(");
+                fossil_codegen_variable(gen, target->value);
+                fossil_codegen_write(gen, " = rt_binary(%s, ", node->operator_type == INCREMENT ? "ADD" : "SUBTRACT");
+                fossil_codegen_variable(gen, target->value);
+                fossil_codegen_write(gen, ", rt_int(1)))");
+                return;
+            }
+            if (node->num_children != 1 || (node->operator_type != NEGATION && node->operator_type != NOT)) {
+                fossil_codegen_error(gen, "Invalid operator '%s'", node->value);
+                return;
+            }
+            fossil_codegen_write(gen, "rt_unary(%s, ", fscl_fossil_operator_name(node->operator_type));
+            fossil_codegen_expression(gen, node->children[0]);
+            fossil_codegen_write(gen, ")");
+            return;
+        case CALL_EXPRESSION:
+            fossil_codegen_call(gen, node);
+            return;
+        case PRINT_STATEMENT_TYPE:
+            fossil_codegen_write(gen, "rt_print(");
+            fossil_codegen_values(gen, node);
+            fossil_codegen_write(gen, ")");
+            return;
+        case ARRAY_LITERAL:
+            fossil_codegen_write(gen, "rt_array(");
+            fossil_codegen_values(gen, node);
+            fossil_codegen_write(gen, ")");
+            return;
+        default:
+            fossil_codegen_error(gen, "Unsupported expression%s", NULL);
+            return;
+    }
+}
+
+// Write a declaration, assignment or bare reference statement. The symbol
+// table decides which statements declare, by the compiler's rules.
+static void fossil_codegen_store(fossil_codegen* gen, const ASTNode* node) {
+    if (node->type == ASSIGNMENT && node->num_children != 1) {
+        fossil_codegen_error(gen, "Invalid assignment to '%s'", node->value);
+        return;
+    }
+
+    fossil_symbol* symbol = node->value != NULL ? fscl_fossil_symbols_resolve(&gen->symbols, gen->scope, node->value) : NULL;
+    if (symbol != NULL && symbol->node == node) {
+        // Declared after its initializer, which cannot see it yet
+        fossil_codegen_line(gen);
+        fossil_codegen_write(gen, "fossil_value v_%s = ", symbol->name);
+        if (node->num_children > 0) {
+            fossil_codegen_expression(gen, node->children[0]);
+        } else {
+            fossil_codegen_write(gen, "rt_null()");
+        }
+        fossil_codegen_write(gen, "; (void)v_%s;\n", symbol->name);
+        if (fossil_symbol_set_add(&gen->declared, symbol) != 0) {
+            fossil_codegen_error(gen, "Out of memory%s", NULL);
+        }
+        return;
+    }
+    if (node->num_children == 0) {
+        return;
+    }
+
+    fossil_codegen_line(gen);
+    if (fossil_codegen_variable(gen, node->value) != 0) {
+        return;
+    }
+    fossil_codegen_write(gen, " = ");
+    fossil_codegen_expression(gen, node->children[0]);
+    fossil_codegen_write(gen, ";\n");
+}
+
+static void fossil_codegen_statement(fossil_codegen* gen, const ASTNode* node);
+
+// Write a braced block, in the scope of the block when it opens one
+static void fossil_codegen_block(fossil_codegen* gen, const ASTNode* block) {
+    fossil_scope* outer = gen->scope;
+    fossil_scope* inner = block->type == BLOCK_STATEMENT ? fscl_fossil_symbols_scope(&gen->symbols, block) : NULL;
+    if (inner != NULL) {
+        gen->scope = inner;
+    }
+
+    fossil_codegen_write(gen, "{\n");
+    gen->indent++;
+    if (block->type == BLOCK_STATEMENT) {
+        for (size_t i = 0; i < block->num_children; ++i) {
+            fossil_codegen_statement(gen, block->children[i]);
+        }
+    } else {
+        fossil_codegen_statement(gen, block);
+    }
+    gen->indent--;
+    fossil_codegen_line(gen);
+    fossil_codegen_write(gen, "}");
+    gen->scope = outer;
+}
+
+// Write a statement
+static void fossil_codegen_statement(fossil_codegen* gen, const ASTNode* node) {
+    if (gen->failed) {
+        return;
+    }
+
+    switch (node->type) {
+        case VARIABLE:
+        case ASSIGNMENT:
+            fossil_codegen_store(gen, node);
+            return;
+        case RETURN_STATEMENT:
+            fossil_codegen_line(gen);
+            fossil_codegen_write(gen, "return ");
+            if (node->num_children > 0) {
+                fossil_codegen_expression(gen, node->children[0]);
+            } else {
+                fossil_codegen_write(gen, "rt_null()");
+            }
+            fossil_codegen_write(gen, ";\n");
+            return;
+        case IF_STATEMENT:
+            if (node->num_children < 2) {
+                fossil_codegen_error(gen, "Invalid if statement%s", NULL);
+                return;
+            }
+            fossil_codegen_line(gen);
+            fossil_codegen_write(gen, "if (rt_truthy(");
+            fossil_codegen_expression(gen, node->children[0]);
+            fossil_codegen_write(gen, ")) ");
+            fossil_codegen_block(gen, node->children[1]);
+            if (node->num_children > 2) {
+                fossil_codegen_write(gen, " else ");
+                fossil_codegen_block(gen, node->children[2]);
+            }
+            fossil_codegen_write(gen, "\n");
+            return;
+        case WHILE_LOOP:
+            if (node->num_children != 2) {
+                fossil_codegen_error(gen, "Invalid while loop%s", NULL);
+                return;
+            }
+            fossil_codegen_line(gen);
+            fossil_codegen_write(gen, "while (rt_truthy(");
+            fossil_codegen_expression(gen, node->children[0]);
+            fossil_codegen_write(gen, ")) ");
+            fossil_codegen_block(gen, node->children[1]);
+            fossil_codegen_write(gen, "\n");
+            return;
+        case BLOCK_STATEMENT:
+            fossil_codegen_line(gen);
+            fossil_codegen_block(gen, node);
+            fossil_codegen_write(gen, "\n");
+            return;
+        default:
+            // Expression statement, its value is discarded
+            fossil_codegen_line(gen);
+            fossil_codegen_write(gen, "(void)");
+            fossil_codegen_expression(gen, node);
+            fossil_codegen_write(gen, ";\n");
+            return;
+    }
+}
+
+// Check that a declaration is the one its scope knows by its name
+static void fossil_codegen_unique(fossil_codegen* gen, const fossil_scope* scope, const ASTNode* node) {
+    fossil_symbol* symbol = fscl_fossil_symbols_resolve(&gen->symbols, scope, node->value);
+    if (symbol == NULL || symbol->node != node) {
+        fossil_codegen_error(gen, "Duplicate declaration of '%s'", node->value);
+    }
+}
+
+// Write the C signature of a function, or of a method of class_node.
+// Private methods are static; everything else links externally.
+static void fossil_codegen_signature(fossil_codegen* gen, const ASTNode* function, const ASTNode* class_node) {
+    size_t arity = fossil_function_arity(function);
+    if (class_node != NULL) {
+        fossil_codegen_write(gen, "%sfossil_value fsl_%s__%s(struct fsl_%s* self", function->is_public ? "" : "static ", class_node->value, function->value, class_node->value);
+    } else {
+        fossil_codegen_write(gen, "fossil_value fsl_%s(", function->value);
+    }
+
+    for (size_t i = 0; i < arity; ++i) {
+        fossil_codegen_write(gen, i > 0 || class_node != NULL ? ", fossil_value v_%s" : "fossil_value v_%s", function->children[i]->value);
+    }
+    if (arity == 0 && class_node == NULL) {
+        fossil_codegen_write(gen, "void");
+    }
+    fossil_codegen_write(gen, ")");
+}
+
+// Write the definition of a function or method
+static void fossil_codegen_function(fossil_codegen* gen, const ASTNode* function, const ASTNode* class_node) {
+    size_t arity = fossil_function_arity(function);
+    fossil_scope* scope = fscl_fossil_symbols_scope(&gen->symbols, function);
+    for (size_t i = 0; i < arity; ++i) {
+        fossil_codegen_unique(gen, scope, function->children[i]);
+    }
+
+    // The body goes to its own text first: the number of and/or
+    // temporaries it needs is only known at the end
+    fossil_text body = {NULL, 0, 0};
+    fossil_text* out = gen->out;
+    gen->out = &body;
+    gen->class_node = class_node;
+    gen->scope = scope;
+    gen->indent = 1;
+    gen->num_temps = 0;
+    if (arity < function->num_children && function->children[arity]->type == BLOCK_STATEMENT) {
+        const ASTNode* block = function->children[arity];
+        for (size_t i = 0; i < block->num_children; ++i) {
+            fossil_codegen_statement(gen, block->children[i]);
+        }
+    }
+    gen->out = out;
+
+    fossil_codegen_signature(gen, function, class_node);
+    fossil_codegen_write(gen, " {\n");
+    if (gen->num_temps > 0) {
+        fossil_codegen_write(gen, "    fossil_value rt_t[%lu];\n", (unsigned long)gen->num_temps);
+    }
+    if (body.length > 0) {
+        fossil_codegen_write(gen, "%s", body.data);
+    }
+    // Falling off the end returns null
+    fossil_codegen_write(gen, "    return rt_null();\n}\n\n");
+    free(body.data);
+
+    gen->class_node = NULL;
+    gen->scope = NULL;
+    gen->indent = 0;
+}
+
+// Parent class of a class, NULL at the top of a hierarchy
+static const ASTNode* fossil_codegen_parent(fossil_codegen* gen, const ASTNode* class_node) {
+    for (size_t i = 0; i < class_node->num_children; ++i) {
+        const ASTNode* inheritance = class_node->children[i];
+        if (inheritance->type == INHERITANCE) {
+            if (inheritance->parent_class == NULL) {
+                fossil_codegen_error(gen, "Cannot inherit from '%s'", inheritance->value);
+            }
+            return inheritance->parent_class;
+        }
+    }
+    return NULL;
+}
+
+// Write the struct of a class: its parent first, embedded as base, then
+// one value per field
+static void fossil_codegen_struct(fossil_codegen* gen, const ASTNode* class_node) {
+    const ASTNode* parent = fossil_codegen_parent(gen, class_node);
+    fossil_scope* scope = fscl_fossil_symbols_scope(&gen->symbols, class_node);
+    size_t fields = 0;
+
+    fossil_codegen_write(gen, parent != NULL ? "// class %s extends %s\n" : "// class %s\n", class_node->value, parent != NULL ? parent->value : "");
+    fossil_codegen_write(gen, "struct fsl_%s {\n", class_node->value);
+    if (parent != NULL) {
+        fossil_codegen_write(gen, "    struct fsl_%s base;\n", parent->value);
+        fields++;
+    }
+    for (size_t i = 0; i < class_node->num_children; ++i) {
+        const ASTNode* member = class_node->children[i];
+        switch (member->type) {
+            case VARIABLE:
+                fossil_codegen_unique(gen, scope, member);
+                fossil_codegen_write(gen, "    fossil_value v_%s;  // %s %s\n", member->value, member->is_public ? "public" : "private", fscl_fossil_data_type_name(member->data_type));
+                fields++;
+                break;
+            case FUNCTION:
+                fossil_codegen_unique(gen, scope, member);
+                break;
+            case INHERITANCE:
+                break;
+            case ENCAPSULATION:
+                // Visibility comes from the members themselves
+                fossil_codegen_error(gen, "Encapsulation nodes are not supported in class '%s'", class_node->value);
+                break;
+            default:
+                fossil_codegen_error(gen, "Unsupported member in class '%s'", class_node->value);
+                break;
+        }
+    }
+    if (fields == 0) {
+        // C structs cannot be empty
+        fossil_codegen_write(gen, "    char unused;\n");
+    }
+    fossil_codegen_write(gen, "};\n\n");
+}
+
+// Write the initializer of a class: parent fields, then all fields null,
+// then the field initializers in order
+static void fossil_codegen_init(fossil_codegen* gen, const ASTNode* class_node) {
+    const ASTNode* parent = fossil_codegen_parent(gen, class_node);
+    fossil_codegen_write(gen, "void fsl_init_%s(struct fsl_%s* self) {\n", class_node->value, class_node->value);
+    if (parent != NULL) {
+        fossil_codegen_write(gen, "    fsl_init_%s(&self->base);\n", parent->value);
+    }
+    for (size_t i = 0; i < class_node->num_children; ++i) {
+        if (class_node->children[i]->type == VARIABLE) {
+            fossil_codegen_write(gen, "    self->v_%s = rt_null();\n", class_node->children[i]->value);
+        }
+    }
+
+    fossil_text body = {NULL, 0, 0};
+    fossil_text* out = gen->out;
+    gen->out = &body;
+    gen->class_node = class_node;
+    gen->scope = fscl_fossil_symbols_scope(&gen->symbols, class_node);
+    gen->num_temps = 0;
+    for (size_t i = 0; i < class_node->num_children; ++i) {
+        const ASTNode* member = class_node->children[i];
+        if (member->type == VARIABLE && member->num_children > 0) {
+            fossil_codegen_write(gen, "    self->v_%s = ", member->value);
+            fossil_codegen_expression(gen, member->children[0]);
+            fossil_codegen_write(gen, ";\n");
+        }
+    }
+    gen->out = out;
+
+    if (gen->num_temps > 0) {
+        fossil_codegen_write(gen, "    fossil_value rt_t[%lu];\n", (unsigned long)gen->num_temps);
+    }
+    if (body.length > 0) {
+        fossil_codegen_write(gen, "%s", body.data);
+    }
+    fossil_codegen_write(gen, "}\n\n");
+    free(body.data);
+
+    gen->class_node = NULL;
+    gen->scope = NULL;
+}
+
+// Number of classes above a class in its hierarchy
+static size_t fossil_codegen_class_depth(const ASTNode* class_node) {
+    size_t depth = 0;
+    for (;;) {
+        const ASTNode* parent = NULL;
+        for (size_t i = 0; i < class_node->num_children; ++i) {
+            if (class_node->children[i]->type == INHERITANCE) {
+                parent = class_node->children[i]->parent_class;
+                break;
+            }
+        }
+        if (parent == NULL) {
+            return depth;
+        }
+        class_node = parent;
+        depth++;
+    }
+}
+
+// Function to lower a parsed program to a C translation unit
+char* fscl_fossil_generate_c(ASTNode* root, size_t* length, char* error, size_t error_size) {
+    if (error != NULL && error_size > 0) {
+        error[0] = '\0';
+    }
+
+    fossil_text text = {NULL, 0, 0};
+    fossil_codegen gen;
+    memset(&gen, 0, sizeof(gen));
+    gen.out = &text;
+    gen.error = error;
+    gen.error_size = error_size;
+
+    if (root == NULL) {
+        fossil_codegen_error(&gen, "No program%s", NULL);
+        return NULL;
+    }
+    if (fscl_fossil_symbols_build(root, &gen.symbols) != 0) {
+        fossil_codegen_error(&gen, "Out of memory%s", NULL);
+        return NULL;
+    }
+
+    fossil_codegen_write(&gen, "// Generated from a Fossil program; link against xcore\n");
+    const ASTNode* entry = NULL;
+    size_t max_depth = 0;
+    for (size_t i = 0; i < root->num_children; ++i) {
+        const ASTNode* node = root->children[i];
+        switch (node->type) {
+            case FUNCTION:
+                fossil_codegen_unique(&gen, gen.symbols.global, node);
+                if (strcmp(node->value, "main") == 0) {
+                    entry = node;
+                }
+                break;
+            case CLASS: {
+                fossil_codegen_unique(&gen, gen.symbols.global, node);
+                size_t depth = fossil_codegen_class_depth(node);
+                max_depth = depth > max_depth ? depth : max_depth;
+                break;
+            }
+            case INCLUDE_FILE:
+                // Load the program with fscl_fossil_project_load to lower its includes
+                fossil_codegen_write(&gen, "// include \"%s\"\n", node->value);
+                break;
+            case LINK_LIBRARY:
+                fossil_codegen_write(&gen, "// link \"%s\"\n", node->value);
+                break;
+            default:
+                fossil_codegen_error(&gen, "Unsupported declaration%s", NULL);
+                break;
+        }
+    }
+    fossil_codegen_write(&gen, "\n%s\n", fossil_codegen_prelude);
+
+    // Parents before the classes that embed them
+    for (size_t depth = 0; depth <= max_depth; ++depth) {
+        for (size_t i = 0; i < root->num_children; ++i) {
+            const ASTNode* node = root->children[i];
+            if (node->type == CLASS && fossil_codegen_class_depth(node) == depth) {
+                fossil_codegen_struct(&gen, node);
+            }
+        }
+    }
+
+    // Prototypes first so bodies can call in any order
+    for (size_t i = 0; i < root->num_children; ++i) {
+        const ASTNode* node = root->children[i];
+        if (node->type == CLASS) {
+            fossil_codegen_write(&gen, "void fsl_init_%s(struct fsl_%s* self);\n", node->value, node->value);
+            for (size_t m = 0; m < node->num_children; ++m) {
+                if (node->children[m]->type == FUNCTION) {
+                    fossil_codegen_signature(&gen, node->children[m], node);
+                    fossil_codegen_write(&gen, ";\n");
+                }
+            }
+        } else if (node->type == FUNCTION) {
+            fossil_codegen_signature(&gen, node, NULL);
+            fossil_codegen_write(&gen, ";\n");
+        }
+    }
+    fossil_codegen_write(&gen, "\n");
+
+    for (size_t i = 0; i < root->num_children; ++i) {
+        const ASTNode* node = root->children[i];
+        if (node->type == CLASS) {
+            fossil_codegen_init(&gen, node);
+            for (size_t m = 0; m < node->num_children; ++m) {
+                if (node->children[m]->type == FUNCTION) {
+                    fossil_codegen_function(&gen, node->children[m], node);
+                }
+            }
+        } else if (node->type == FUNCTION) {
+            fossil_codegen_function(&gen, node, NULL);
+        }
+    }
+
+    // The program's main runs with null parameters, as in the machine
+    if (entry != NULL) {
+        fossil_codegen_write(&gen, "int main(void) {\n    fossil_value result = fsl_main(");
+        for (size_t i = 0; i < fossil_function_arity(entry); ++i) {
+            fossil_codegen_write(&gen, i > 0 ? ", rt_null()" : "rt_null()");
+        }
+        fossil_codegen_write(&gen, ");\n    fscl_fossil_vm_erase(&rt_vm);\n");
+        fossil_codegen_write(&gen, "    return result.kind == FOSSIL_VALUE_INT ? (int)result.as.integer : 0;\n}\n");
+    }
+
+    fscl_fossil_symbols_erase(&gen.symbols);
+    fossil_symbol_set_erase(&gen.declared);
+    if (gen.failed) {
+        free(text.data);
+        return NULL;
+    }
+    if (length != NULL) {
+        *length = text.length;
+    }
+    return text.data;
+}
+
+// =================================================================
+// Type checking
+// =================================================================
+
+// State of one type checking pass
+typedef struct {
+    fossil_symbol_table symbols;
+    fossil_symbol_set reached;     // Locals whose declaration was checked
+    fossil_scope* scope;           // Scope of the code being checked
+    const ASTNode* function;       // Function or method being checked, else NULL
+    fossil_diagnostics* diagnostics;
+    int problems;
+    int failed;                    // Allocation failure
+} fossil_checker;
+
+// Record a problem about a node
+static void fossil_check_error(fossil_checker* checker, ASTNode* node, const char* format, ...) {
+    fossil_diagnostic* diagnostic = fossil_diagnostics_add(checker->diagnostics);
+    if (diagnostic == NULL) {
+        checker->failed = 1;
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(diagnostic->message, sizeof(diagnostic->message), format, args);
+    va_end(args);
+    diagnostic->node = node;
+    checker->problems++;
+}
+
+// Integer types, which all share the 64-bit runtime integer
+static int fossil_type_is_integer(DataType type) {
+    return (type >= FOSSIL_INT && type <= FOSSIL_UINT64) || type == FOSSIL_HEX || type == FOSSIL_OCT;
+}
+
+static int fossil_type_is_number(DataType type) {
+    return fossil_type_is_integer(type) || type == FOSSIL_FLOAT;
+}
+
+// Types whose values are strings at run time
+static int fossil_type_is_text(DataType type) {
+    return type == FOSSIL_STRING || type == FOSSIL_CHAR || type == FOSSIL_DATETIME;
+}
+
+// Types only known at run time; error stands in for an expression that
+// was already reported, so one mistake is not reported again
+static int fossil_type_is_dynamic(DataType type) {
+    return type == FOSSIL_TOFU || type == FOSSIL_ERROR || type == FOSSIL_PLACEHOLDER;
+}
+
+// Whether a value of one type may be stored where another is declared
+static int fossil_type_accepts(DataType target, DataType value) {
+    if (fossil_type_is_dynamic(target) || fossil_type_is_dynamic(value) || value == FOSSIL_NULL_TYPE || target == value) {
+        return 1;
+    }
+    if (fossil_type_is_integer(target)) {
+        return fossil_type_is_integer(value);
+    }
+    if (target == FOSSIL_FLOAT) {
+        return fossil_type_is_number(value);
+    }
+    return fossil_type_is_text(target) && fossil_type_is_text(value);
+}
+
+static DataType fossil_check_expression(fossil_checker* checker, ASTNode* node);
+
+// Type of a binary or relational operation, from the rules of the machine
+static DataType fossil_check_binary(fossil_checker* checker, ASTNode* node) {
+    DataType left = fossil_check_expression(checker, node->children[0]);
+    DataType right = fossil_check_expression(checker, node->children[1]);
+    const char* op = node->value != NULL ? node->value : fscl_fossil_operator_name(node->operator_type);
+    int dynamic = fossil_type_is_dynamic(left) || fossil_type_is_dynamic(right);
+
+    switch (node->operator_type) {
+        case EQUALS:
+        case NOT_EQUALS:
+            return FOSSIL_BOOL;
+        case LESS_THAN:
+        case LESS_EQUAL:
+        case GREATER_THAN:
+        case GREATER_EQUAL:
+            if (!dynamic && !(fossil_type_is_number(left) && fossil_type_is_number(right)) && !(fossil_type_is_text(left) && fossil_type_is_text(right))) {
+                fossil_check_error(checker, node, "Cannot compare %s and %s with '%s'", fscl_fossil_data_type_name(left), fscl_fossil_data_type_name(right), op);
+            }
+            return FOSSIL_BOOL;
+        case ADD:
+            // Anything added to a string is concatenated
+            if (fossil_type_is_text(left) || fossil_type_is_text(right)) {
+                return FOSSIL_STRING;
+            }
+            // Fall through
+        case SUBTRACT:
+        case MULTIPLY:
+        case DIVIDE:
+            if (fossil_type_is_number(left) && fossil_type_is_number(right)) {
+                return fossil_type_is_integer(left) && fossil_type_is_integer(right) ? FOSSIL_INT : FOSSIL_FLOAT;
+            }
+            break;
+        case MODULO:
+            if (fossil_type_is_integer(left) && fossil_type_is_integer(right)) {
+                return FOSSIL_INT;
+            }
+            if ((dynamic || fossil_type_is_number(left)) && (dynamic || fossil_type_is_number(right))) {
+                if (left == FOSSIL_FLOAT || right == FOSSIL_FLOAT) {
+                    fossil_check_error(checker, node, "Operator '%s' requires integers, not %s and %s", op, fscl_fossil_data_type_name(left), fscl_fossil_data_type_name(right));
+                    return FOSSIL_ERROR;
+                }
+                return FOSSIL_INT;
+            }
+            break;
+        default:
+            fossil_check_error(checker, node, "Invalid operator '%s'", op);
+            return FOSSIL_ERROR;
+    }
+
+    if (dynamic) {
+        // A dynamic operand may still be a number, or a string to add to
+        int valid = (fossil_type_is_dynamic(left) || fossil_type_is_number(left)) && (fossil_type_is_dynamic(right) || fossil_type_is_number(right));
+        if (valid || node->operator_type == ADD) {
+            return FOSSIL_TOFU;
+        }
+    }
+    fossil_check_error(checker, node, "Cannot apply '%s' to %s and %s", op, fscl_fossil_data_type_name(left), fscl_fossil_data_type_name(right));
+    return FOSSIL_ERROR;
+}
+
+// Type of a variable reference, or error when the name is not a variable
+static DataType fossil_check_variable(fossil_checker* checker, ASTNode* node) {
+    if (node->value == NULL || strchr(node->value, '.') != NULL) {
+        // Members of objects are not tracked
+        return FOSSIL_TOFU;
+    }
+
+    fossil_symbol* symbol = fossil_symbols_resolve_reached(&checker->symbols, checker->scope, &checker->reached, node->value);
+    if (symbol == NULL) {
+        fossil_check_error(checker, node, "Undefined variable '%s'", node->value);
+        return FOSSIL_ERROR;
+    }
+    if (symbol->kind != FOSSIL_SYMBOL_VARIABLE && symbol->kind != FOSSIL_SYMBOL_PARAMETER && symbol->kind != FOSSIL_SYMBOL_FIELD) {
+        fossil_check_error(checker, node, "'%s' is not a variable", node->value);
+        return FOSSIL_ERROR;
+    }
+    return symbol->node->data_type;
+}
+
+// Type of a call: the declared return type of the callee
+static DataType fossil_check_call(fossil_checker* checker, ASTNode* node) {
+    // Calls through objects are not tracked
+    int dotted = node->value == NULL || strchr(node->value, '.') != NULL;
+    const ASTNode* callee = NULL;
+    if (!dotted) {
+        fossil_symbol* symbol = fossil_symbols_resolve_reached(&checker->symbols, checker->scope, &checker->reached, node->value);
+        if (symbol == NULL || (symbol->kind != FOSSIL_SYMBOL_FUNCTION && symbol->kind != FOSSIL_SYMBOL_METHOD)) {
+            fossil_check_error(checker, node, "Unknown function '%s'", node->value);
+        } else {
+            callee = symbol->node;
+        }
+    }
+
+    size_t arity = callee != NULL ? fossil_function_arity(callee) : 0;
+    for (size_t i = 0; i < node->num_children; ++i) {
+        DataType type = fossil_check_expression(checker, node->children[i]);
+        if (callee != NULL && i < arity && !fossil_type_accepts(callee->children[i]->data_type, type)) {
+            fossil_check_error(checker, node->children[i], "Argument %lu of '%s' must be %s, not %s", (unsigned long)(i + 1), node->value,
+                               fscl_fossil_data_type_name(callee->children[i]->data_type), fscl_fossil_data_type_name(type));
+        }
+    }
+
+    if (callee == NULL) {
+        return dotted ? FOSSIL_TOFU : FOSSIL_ERROR;
+    }
+    if (node->num_children > arity) {
+        fossil_check_error(checker, node, "Too many arguments to '%s'", node->value);
+    }
+    for (size_t i = node->num_children; i < arity; ++i) {
+        if (callee->children[i]->num_children == 0) {
+            fossil_check_error(checker, node, "Missing argument '%s' in call to '%s'", callee->children[i]->value, node->value);
+            break;
+        }
+    }
+    return callee->data_type;
+}
+
+// Infer the type of an expression and store it in the node
+static DataType fossil_check_expression(fossil_checker* checker, ASTNode* node) {
+    DataType type = FOSSIL_ERROR;
+
+    switch (node->type) {
+        case CONSTANT:
+            // Literals carry their type from the parser
+            return node->data_type;
+        case VARIABLE:
+            type = fossil_check_variable(checker, node);
+            break;
+        case BINARY_OP:
+        case RELATIONAL_OP:
+            if (node->num_children != 2) {
+                fossil_check_error(checker, node, "Invalid operator '%s'", node->value);
+                break;
+            }
+            type = fossil_check_binary(checker, node);
+            break;
+        case LOGICAL_OP:
+            if (node->num_children != 2) {
+                fossil_check_error(checker, node, "Invalid operator '%s'", node->value);
+                break;
+            }
+            // The result is whichever operand decides
+            type = fossil_check_expression(checker, node->children[0]);
+            if (fossil_check_expression(checker, node->children[1]) != type) {
+                type = FOSSIL_TOFU;
+            }
+            break;
+        case UNARY_OP: {
+            if (node->num_children != 1) {
+                fossil_check_error(checker, node, "Invalid operator '%s'", node->value);
+                break;
+            }
+            ASTNode* operand = node->children[0];
+            DataType inner = fossil_check_expression(checker, operand);
+            if (node->operator_type == NOT) {
+                type = FOSSIL_BOOL;
+            } else if ((node->operator_type == INCREMENT || node->operator_type == DECREMENT) && operand->type != VARIABLE) {
+                fossil_check_error(checker, node, "Invalid operand for '%s'", node->value);
+            } else if (fossil_type_is_number(inner) || fossil_type_is_dynamic(inner)) {
+                type = fossil_type_is_integer(inner) ? FOSSIL_INT : inner;
+            } else if (node->operator_type == INCREMENT && fossil_type_is_text(inner)) {
+                type = FOSSIL_STRING;
+            } else {
+                fossil_check_error(checker, node, "Cannot apply '%s' to %s", node->value, fscl_fossil_data_type_name(inner));
+            }
+            break;
+        }
+        case CALL_EXPRESSION:
+            type = fossil_check_call(checker, node);
+            break;
+        case PRINT_STATEMENT_TYPE:
+            for (size_t i = 0; i < node->num_children; ++i) {
+                fossil_check_expression(checker, node->children[i]);
+            }
+            type = FOSSIL_NULL_TYPE;
+            break;
+        case ARRAY_LITERAL:
+            for (size_t i = 0; i < node->num_children; ++i) {
+                fossil_check_expression(checker, node->children[i]);
+            }
+            type = FOSSIL_ARRAY;
+            break;
+        default:
+            fossil_check_error(checker, node, "Unsupported expression");
+            break;
+    }
+
+    node->data_type = type;
+    return type;
+}
+
+// Check a declaration, assignment or bare reference statement
+static void fossil_check_store(fossil_checker* checker, ASTNode* node) {
+    fossil_symbol* symbol = node->value != NULL ? fscl_fossil_symbols_resolve(&checker->symbols, checker->scope, node->value) : NULL;
+    DataType type = node->num_children > 0 ? fossil_check_expression(checker, node->children[0]) : FOSSIL_NULL_TYPE;
+
+    if (symbol != NULL && symbol->node == node) {
+        if (node->type == ASSIGNMENT) {
+            // Declared by its first value
+            node->data_type = fossil_type_is_dynamic(type) || type == FOSSIL_NULL_TYPE ? FOSSIL_TOFU : fossil_type_is_integer(type) ? FOSSIL_INT : type;
+        } else if (!fossil_type_accepts(node->data_type, type)) {
+            fossil_check_error(checker, node, "Cannot initialize %s '%s' with %s", fscl_fossil_data_type_name(node->data_type), node->value, fscl_fossil_data_type_name(type));
+        }
+        if (fossil_symbol_set_add(&checker->reached, symbol) != 0) {
+            checker->failed = 1;
+        }
+        return;
+    }
+    if (node->num_children == 0 || node->value == NULL || strchr(node->value, '.') != NULL) {
+        return;
+    }
+
+    symbol = fossil_symbols_resolve_reached(&checker->symbols, checker->scope, &checker->reached, node->value);
+    if (symbol == NULL || (symbol->kind != FOSSIL_SYMBOL_VARIABLE && symbol->kind != FOSSIL_SYMBOL_PARAMETER && symbol->kind != FOSSIL_SYMBOL_FIELD)) {
+        fossil_check_error(checker, node, symbol == NULL ? "Undefined variable '%s'" : "Cannot assign to '%s'", node->value);
+        return;
+    }
+    if (!fossil_type_accepts(symbol->node->data_type, type)) {
+        fossil_check_error(checker, node, "Cannot assign %s to %s '%s'", fscl_fossil_data_type_name(type), fscl_fossil_data_type_name(symbol->node->data_type), node->value);
+    }
+}
+
+static void fossil_check_statement(fossil_checker* checker, ASTNode* node);
+
+// Check a block in its own scope, or a single statement
+static void fossil_check_block(fossil_checker* checker, ASTNode* block) {
+    fossil_scope* outer = checker->scope;
+    fossil_scope* inner = block->type == BLOCK_STATEMENT ? fscl_fossil_symbols_scope(&checker->symbols, block) : NULL;
+    if (inner != NULL) {
+        checker->scope = inner;
+    }
+
+    if (block->type == BLOCK_STATEMENT) {
+        for (size_t i = 0; i < block->num_children; ++i) {
+            fossil_check_statement(checker, block->children[i]);
+        }
+    } else {
+        fossil_check_statement(checker, block);
+    }
+    checker->scope = outer;
+}
+
+// Check a statement
+static void fossil_check_statement(fossil_checker* checker, ASTNode* node) {
+    switch (node->type) {
+        case VARIABLE:
+        case ASSIGNMENT:
+            fossil_check_store(checker, node);
+            return;
+        case RETURN_STATEMENT: {
+            DataType type = node->num_children > 0 ? fossil_check_expression(checker, node->children[0]) : FOSSIL_NULL_TYPE;
+            if (checker->function != NULL && !fossil_type_accepts(checker->function->data_type, type)) {
+                fossil_check_error(checker, node, "'%s' must return %s, not %s", checker->function->value,
+                                   fscl_fossil_data_type_name(checker->function->data_type), fscl_fossil_data_type_name(type));
+            }
+            return;
+        }
+        case IF_STATEMENT:
+        case WHILE_LOOP:
+            // Conditions may be of any type, they are tested for truth
+            if (node->num_children > 0) {
+                fossil_check_expression(checker, node->children[0]);
+            }
+            for (size_t i = 1; i < node->num_children; ++i) {
+                fossil_check_block(checker, node->children[i]);
+            }
+            return;
+        case BLOCK_STATEMENT:
+            fossil_check_block(checker, node);
+            return;
+        default:
+            fossil_check_expression(checker, node);
+            return;
+    }
+}
+
+// Check the parameter defaults and the body of a function or method
+static void fossil_check_function(fossil_checker* checker, ASTNode* function) {
+    fossil_scope* outer = checker->scope;
+    size_t arity = fossil_function_arity(function);
+
+    // Defaults are evaluated where the call is, outside the function
+    for (size_t i = 0; i < arity; ++i) {
+        ASTNode* parameter = function->children[i];
+        if (parameter->num_children > 0) {
+            DataType type = fossil_check_expression(checker, parameter->children[0]);
+            if (!fossil_type_accepts(parameter->data_type, type)) {
+                fossil_check_error(checker, parameter, "Default of '%s' must be %s, not %s", parameter->value,
+                                   fscl_fossil_data_type_name(parameter->data_type), fscl_fossil_data_type_name(type));
+            }
+        }
+    }
+
+    checker->scope = fscl_fossil_symbols_scope(&checker->symbols, function);
+    checker->function = function;
+    if (arity < function->num_children) {
+        fossil_check_block(checker, function->children[arity]);
+    }
+    checker->function = NULL;
+    checker->scope = outer;
+}
+
+// Check the parent, field initializers and methods of a class
+static void fossil_check_class(fossil_checker* checker, ASTNode* class_node) {
+    checker->scope = fscl_fossil_symbols_scope(&checker->symbols, class_node);
+    for (size_t i = 0; i < class_node->num_children; ++i) {
+        ASTNode* member = class_node->children[i];
+        if (member->type == INHERITANCE && member->parent_class == NULL) {
+            fossil_check_error(checker, member, "Class '%s' cannot extend '%s'", class_node->value, member->value);
+        } else if (member->type == VARIABLE && member->num_children > 0) {
+            DataType type = fossil_check_expression(checker, member->children[0]);
+            if (!fossil_type_accepts(member->data_type, type)) {
+                fossil_check_error(checker, member, "Cannot initialize %s '%s' with %s", fscl_fossil_data_type_name(member->data_type), member->value, fscl_fossil_data_type_name(type));
+            }
+        } else if (member->type == FUNCTION) {
+            fossil_check_function(checker, member);
+        }
+    }
+    checker->scope = checker->symbols.global;
+}
+
+// Function to infer and check the types of a tree
+int fscl_fossil_check_types(ASTNode* root, fossil_diagnostics* diagnostics) {
+    if (root == NULL || diagnostics == NULL) {
+        return -1;
+    }
+
+    fossil_checker checker;
+    memset(&checker, 0, sizeof(checker));
+    checker.diagnostics = diagnostics;
+    if (fscl_fossil_symbols_build(root, &checker.symbols) != 0) {
+        return -1;
+    }
+    checker.scope = checker.symbols.global;
+
+    for (size_t i = 0; i < checker.symbols.num_duplicates; ++i) {
+        ASTNode* node = checker.symbols.duplicates[i].node;
+        fossil_check_error(&checker, node, "'%s' is already declared", node->value);
+    }
+
+    for (size_t i = 0; i < root->num_children; ++i) {
+        ASTNode* node = root->children[i];
+        if (node->type == FUNCTION) {
+            fossil_check_function(&checker, node);
+        } else if (node->type == CLASS) {
+            fossil_check_class(&checker, node);
+        }
+    }
+
+    fossil_symbol_set_erase(&checker.reached);
+    fscl_fossil_symbols_erase(&checker.symbols);
+    return checker.failed ? -1 : checker.problems;
+}
+
+// Function to free the entries of a diagnostics array
+void fscl_fossil_diagnostics_erase(fossil_diagnostics* diagnostics) {
+    if (diagnostics == NULL) {
+        return;
+    }
+    free(diagnostics->items);
+    memset(diagnostics, 0, sizeof(*diagnostics));
+}
+
+// =================================================================
+// Expression evaluation
+// =================================================================
+
+// State of one evaluation
+typedef struct fossil_expr_state {
+    fossil_vm* vm;
+    const fossil_value* env;
+    fossil_value* top;        // Next free stack slot
+    int done;                 // The halt step was reached
+} fossil_expr_state;
+
+// State of one expression compilation
+typedef struct {
+    fossil_expr* expr;
+    size_t depth;
+    int failed;
+} fossil_expr_compiler;
+
+// Push a constant
+static const fossil_expr_step* fossil_expr_constant(fossil_expr_state* state, const fossil_expr_step* step) {
+    *state->top++ = step->value;
+    return step + 1;
+}
+
+// Push the value of a variable
+static const fossil_expr_step* fossil_expr_load(fossil_expr_state* state, const fossil_expr_step* step) {
+    *state->top++ = state->env[step->operand];
+    return step + 1;
+}
+
+// Apply any binary or relational operator to the two top values
+static const fossil_expr_step* fossil_expr_binary(fossil_expr_state* state, const fossil_expr_step* step) {
+    fossil_value* b = --state->top;
+    if (fscl_fossil_vm_binary(state->vm, step->op, b - 1, b) != 0) {
+        return NULL;
+    }
+    return step + 1;
+}
+
+// Comparisons with a fast path for two integers
+#define FOSSIL_EXPR_COMPARE(name, cmp)                                                           \
+    static const fossil_expr_step* name(fossil_expr_state* state, const fossil_expr_step* step) { \
+        fossil_value* b = state->top - 1;                                                         \
+        fossil_value* a = b - 1;                                                                  \
+        if (a->kind == FOSSIL_VALUE_INT && b->kind == FOSSIL_VALUE_INT) {                         \
+            a->as.boolean = a->as.integer cmp b->as.integer;                                      \
+            a->kind = FOSSIL_VALUE_BOOL;                                                          \
+            state->top = b;                                                                       \
+            return step + 1;                                                                      \
+        }                                                                                         \
+        return fossil_expr_binary(state, step);                                                   \
+    }
+
+FOSSIL_EXPR_COMPARE(fossil_expr_equal, ==)
+FOSSIL_EXPR_COMPARE(fossil_expr_not_equal, !=)
+FOSSIL_EXPR_COMPARE(fossil_expr_less, <)
+FOSSIL_EXPR_COMPARE(fossil_expr_less_equal, <=)
+FOSSIL_EXPR_COMPARE(fossil_expr_greater, >)
+FOSSIL_EXPR_COMPARE(fossil_expr_greater_equal, >=)
+
+#undef FOSSIL_EXPR_COMPARE
+
+// Compare a variable with a constant in one step, the common shape of rules
+static const fossil_expr_step* fossil_expr_compare_constant(fossil_expr_state* state, const fossil_expr_step* step) {
+    const fossil_value* a = &state->env[step->operand];
+    const fossil_value* b = &step->value;
+    fossil_value* result = state->top++;
+
+    if (a->kind == FOSSIL_VALUE_INT && b->kind == FOSSIL_VALUE_INT) {
+        int64_t x = a->as.integer;
+        int64_t y = b->as.integer;
+        switch (step->op) {
+            case EQUALS:        result->as.boolean = x == y; break;
+            case NOT_EQUALS:    result->as.boolean = x != y; break;
+            case LESS_THAN:     result->as.boolean = x < y; break;
+            case LESS_EQUAL:    result->as.boolean = x <= y; break;
+            case GREATER_THAN:  result->as.boolean = x > y; break;
+            default:            result->as.boolean = x >= y; break;
+        }
+        result->kind = FOSSIL_VALUE_BOOL;
+        return step + 1;
+    }
+
+    *result = *a;
+    if (fscl_fossil_vm_binary(state->vm, step->op, result, b) != 0) {
+        return NULL;
+    }
+    return step + 1;
+}
+
+// Apply NEGATION or NOT to the top value
+static const fossil_expr_step* fossil_expr_unary(fossil_expr_state* state, const fossil_expr_step* step) {
+    if (fscl_fossil_vm_unary(state->vm, step->op, state->top - 1) != 0) {
+        return NULL;
+    }
+    return step + 1;
+}
+
+// Keep a false left operand as the result of and, else drop it
+static const fossil_expr_step* fossil_expr_and(fossil_expr_state* state, const fossil_expr_step* step) {
+    if (!fossil_vm_truthy(state->top - 1)) {
+        return step + step->operand;
+    }
+    state->top--;
+    return step + 1;
+}
+
+// Keep a true left operand as the result of or, else drop it
+static const fossil_expr_step* fossil_expr_or(fossil_expr_state* state, const fossil_expr_step* step) {
+    if (fossil_vm_truthy(state->top - 1)) {
+        return step + step->operand;
+    }
+    state->top--;
+    return step + 1;
+}
+
+// Last step of every expression
+static const fossil_expr_step* fossil_expr_halt(fossil_expr_state* state, const fossil_expr_step* step) {
+    (void)step;
+    state->done = 1;
+    return NULL;
+}
+
+// Record the first compile error
+static void fossil_expr_error(fossil_expr_compiler* compiler, const char* format, const char* name) {
+    if (!compiler->failed) {
+        snprintf(compiler->expr->error, sizeof(compiler->expr->error), format, name != NULL ? name : "");
+        compiler->failed = 1;
+    }
+}
+
+// Append a step and track the stack depth, NULL when out of memory
+static fossil_expr_step* fossil_expr_emit(fossil_expr_compiler* compiler, fossil_expr_fn run, int effect) {
+    fossil_expr* expr = compiler->expr;
+    if (expr->num_steps == expr->steps_capacity) {
+        size_t capacity = expr->steps_capacity == 0 ? 16 : expr->steps_capacity * 2;
+        fossil_expr_step* grown = (fossil_expr_step*)realloc(expr->steps, capacity * sizeof(fossil_expr_step));
+        if (grown == NULL) {
+            fossil_expr_error(compiler, "Out of memory%s", NULL);
+            return NULL;
+        }
+        expr->steps = grown;
+        expr->steps_capacity = capacity;
+    }
+
+    fossil_expr_step* step = &expr->steps[expr->num_steps++];
+    memset(step, 0, sizeof(*step));
+    step->run = run;
+    compiler->depth = (size_t)((int64_t)compiler->depth + effect);
+    if (compiler->depth > expr->max_stack) {
+        expr->max_stack = compiler->depth;
+    }
+    return step;
+}
+
+// Slot of a variable, added on first use
+static int fossil_expr_variable(fossil_expr_compiler* compiler, const char* name, uint32_t* slot) {
+    fossil_expr* expr = compiler->expr;
+    int found = fscl_fossil_expr_slot(expr, name);
+    if (found >= 0) {
+        *slot = (uint32_t)found;
+        return 0;
+    }
+
+    char** names = (char**)realloc(expr->names, (expr->num_names + 1) * sizeof(char*));
+    if (names == NULL) {
+        fossil_expr_error(compiler, "Out of memory%s", NULL);
+        return -1;
+    }
+    expr->names = names;
+    expr->names[expr->num_names] = fscl_fossil_strdup(name);
+    if (expr->names[expr->num_names] == NULL) {
+        fossil_expr_error(compiler, "Out of memory%s", NULL);
+        return -1;
+    }
+    *slot = (uint32_t)expr->num_names++;
+    return 0;
+}
+
+// Code of the step applying a binary or relational operator
+static fossil_expr_fn fossil_expr_operator(OperatorType op) {
+    switch (op) {
+        case EQUALS:        return fossil_expr_equal;
+        case NOT_EQUALS:    return fossil_expr_not_equal;
+        case LESS_THAN:     return fossil_expr_less;
+        case LESS_EQUAL:    return fossil_expr_less_equal;
+        case GREATER_THAN:  return fossil_expr_greater;
+        case GREATER_EQUAL: return fossil_expr_greater_equal;
+        default:            return fossil_expr_binary;
+    }
+}
+
+// Compile a node, leaving exactly one value on the stack
+static void fossil_expr_node(fossil_expr_compiler* compiler, const ASTNode* node) {
+    if (compiler->failed) {
+        return;
+    }
+
+    switch (node->type) {
+        case CONSTANT: {
+            fossil_expr_step* step = fossil_expr_emit(compiler, fossil_expr_constant, 1);
+            if (step != NULL && fossil_constant_value(node, &step->value) != 0) {
+                step->value.kind = FOSSIL_VALUE_NULL;
+                fossil_expr_error(compiler, "Out of memory%s", NULL);
+            }
+            return;
+        }
+        case VARIABLE: {
+            uint32_t slot;
+            if (node->value == NULL || fossil_expr_variable(compiler, node->value, &slot) != 0) {
+                fossil_expr_error(compiler, "Invalid variable%s", NULL);
+                return;
+            }
+            fossil_expr_step* step = fossil_expr_emit(compiler, fossil_expr_load, 1);
+            if (step != NULL) {
+                step->operand = slot;
+            }
+            return;
+        }
+        case BINARY_OP:
+        case RELATIONAL_OP: {
+            if (node->num_children != 2 || fossil_binary_opcode(node->operator_type) == FOSSIL_OP_COUNT) {
+                fossil_expr_error(compiler, "Invalid operator '%s'", node->value);
+                return;
+            }
+
+            // A variable compared with a constant takes a single step
+            const ASTNode* left = node->children[0];
+            const ASTNode* right = node->children[1];
+            if (node->type == RELATIONAL_OP && left->type == VARIABLE && left->value != NULL && right->type == CONSTANT) {
+                uint32_t slot;
+                if (fossil_expr_variable(compiler, left->value, &slot) != 0) {
+                    return;
+                }
+                fossil_expr_step* step = fossil_expr_emit(compiler, fossil_expr_compare_constant, 1);
+                if (step == NULL) {
+                    return;
+                }
+                step->op = node->operator_type;
+                step->operand = slot;
+                if (fossil_constant_value(right, &step->value) != 0) {
+                    step->value.kind = FOSSIL_VALUE_NULL;
+                    fossil_expr_error(compiler, "Out of memory%s", NULL);
+                }
+                return;
+            }
+
+            fossil_expr_node(compiler, left);
+            fossil_expr_node(compiler, right);
+            fossil_expr_step* step = fossil_expr_emit(compiler, fossil_expr_operator(node->operator_type), -1);
+            if (step != NULL) {
+                step->op = node->operator_type;
+            }
+            return;
+        }
+        case LOGICAL_OP: {
+            if (node->num_children != 2 || (node->operator_type != AND && node->operator_type != OR)) {
+                fossil_expr_error(compiler, "Invalid operator '%s'", node->value);
+                return;
+            }
+            // Short circuit: the left value is the result when it decides
+            fossil_expr_node(compiler, node->children[0]);
+            if (fossil_expr_emit(compiler, node->operator_type == AND ? fossil_expr_and : fossil_expr_or, -1) == NULL) {
+                return;
+            }
+            size_t jump = compiler->expr->num_steps - 1;
+            fossil_expr_node(compiler, node->children[1]);
+            if (!compiler->failed) {
+                compiler->expr->steps[jump].operand = (uint32_t)(compiler->expr->num_steps - jump);
+            }
+            return;
+        }
+        case UNARY_OP: {
+            if (node->num_children != 1 || (node->operator_type != NEGATION && node->operator_type != NOT)) {
+                fossil_expr_error(compiler, "Invalid operator '%s'", node->value);
+                return;
+            }
+            fossil_expr_node(compiler, node->children[0]);
+            fossil_expr_step* step = fossil_expr_emit(compiler, fossil_expr_unary, 0);
+            if (step != NULL) {
+                step->op = node->operator_type;
+            }
+            return;
+        }
+        default:
+            fossil_expr_error(compiler, "Unsupported expression%s", NULL);
+            return;
+    }
+}
+
+// Function to compile an expression to threaded code
+int fscl_fossil_expr_compile(const ASTNode* expression, fossil_expr* expr) {
+    if (expr == NULL) {
+        return -1;
+    }
+    memset(expr, 0, sizeof(*expr));
+    if (expression == NULL) {
+        snprintf(expr->error, sizeof(expr->error), "No expression");
+        return -1;
+    }
+
+    fossil_expr_compiler compiler = {expr, 0, 0};
+    fossil_expr_node(&compiler, expression);
+    fossil_expr_emit(&compiler, fossil_expr_halt, 0);
+    return compiler.failed ? -1 : 0;
+}
+
+// Function to find the environment slot of a variable
+int fscl_fossil_expr_slot(const fossil_expr* expr, const char* name) {
+    if (expr == NULL || name == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < expr->num_names; ++i) {
+        if (strcmp(expr->names[i], name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// Function to evaluate a compiled expression
+int fscl_fossil_expr_eval(const fossil_expr* expr, fossil_vm* vm, const fossil_value* env, fossil_value* result) {
+    if (expr == NULL || vm == NULL || result == NULL || expr->num_steps == 0 || (env == NULL && expr->num_names > 0)) {
+        return -1;
+    }
+    if (fossil_vm_reserve(vm, expr->max_stack) != 0) {
+        fossil_vm_error(vm, "Out of memory");
+        return -1;
+    }
+
+    fossil_expr_state state = {vm, env, vm->stack, 0};
+    const fossil_expr_step* step = expr->steps;
+    while (step != NULL) {
+        step = step->run(&state, step);
+    }
+
+    // A failed step stops before the halt step
+    if (!state.done) {
+        return -1;
+    }
+    *result = vm->stack[0];
+    return 0;
+}
+
+// Function to free a compiled expression
+void fscl_fossil_expr_erase(fossil_expr* expr) {
+    if (expr == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < expr->num_steps; ++i) {
+        if (expr->steps[i].value.kind == FOSSIL_VALUE_STRING) {
+            free((char*)expr->steps[i].value.as.string);
+        }
+    }
+    for (size_t i = 0; i < expr->num_names; ++i) {
+        free(expr->names[i]);
+    }
+    free(expr->steps);
+    free(expr->names);
+    memset(expr, 0, sizeof(*expr));
+}
+
+// =================================================================
+// Structural sharing
+// =================================================================
+
+// Fold the fields of one node, without its children, into a hash
+static uint64_t fossil_node_hash_fields(uint64_t hash, const ASTNode* node) {
+    uint32_t fields[4] = {(uint32_t)node->type, (uint32_t)node->data_type, (uint32_t)node->operator_type, node->value != NULL};
+    hash = fossil_hash_bytes(hash, fields, sizeof(fields));
+    if (node->value != NULL) {
+        hash = fossil_hash_bytes(hash, node->value, strlen(node->value) + 1);
+    }
+    return hash;
+}
+
+// Whether two nodes have the same fields, children aside
+static int fossil_node_fields_equal(const ASTNode* a, const ASTNode* b) {
+    if (a->type != b->type || a->data_type != b->data_type || a->operator_type != b->operator_type || a->num_children != b->num_children) {
+        return 0;
+    }
+    if (a->value == NULL || b->value == NULL) {
+        return a->value == b->value;
+    }
+    return strcmp(a->value, b->value) == 0;
+}
+
+// Preorder step of the structural hash; the child counts make the
+// sequence of nodes describe exactly one tree
+static int fossil_node_hash_enter(ASTNode* node, size_t depth, void* user_data) {
+    (void)depth;
+    uint64_t* hash = (uint64_t*)user_data;
+    uint64_t count = node->num_children;
+    *hash = fossil_hash_bytes(fossil_node_hash_fields(*hash, node), &count, sizeof(count));
+    return FOSSIL_VISIT_CONTINUE;
+}
+
+// Function to hash the structure of a subtree
+uint64_t fscl_fossil_node_hash(const ASTNode* node) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    fscl_fossil_visit_preorder((ASTNode*)node, fossil_node_hash_enter, &hash);
+    return hash;
+}
+
+// Function to check whether two subtrees have the same structure
+int fscl_fossil_node_equal(const ASTNode* a, const ASTNode* b) {
+    if (a == b) {
+        return 1;
+    }
+    if (a == NULL || b == NULL) {
+        return 0;
+    }
+
+    // Pairs still to compare; identical pointers are equal without a look inside
+    const ASTNode** pairs = (const ASTNode**)malloc(32 * sizeof(const ASTNode*));
+    size_t capacity = 16;
+    size_t count = 0;
+    int equal = 1;
+    if (pairs == NULL) {
+        return 0;
+    }
+    pairs[count * 2] = a;
+    pairs[count * 2 + 1] = b;
+    count++;
+
+    while (count > 0 && equal) {
+        count--;
+        const ASTNode* x = pairs[count * 2];
+        const ASTNode* y = pairs[count * 2 + 1];
+        if (x == y) {
+            continue;
+        }
+        if (x == NULL || y == NULL || !fossil_node_fields_equal(x, y)) {
+            equal = 0;
+            break;
+        }
+
+        if (count + x->num_children > capacity) {
+            while (count + x->num_children > capacity) {
+                capacity *= 2;
+            }
+            const ASTNode** grown = (const ASTNode**)realloc((void*)pairs, capacity * 2 * sizeof(const ASTNode*));
+            if (grown == NULL) {
+                equal = 0;
+                break;
+            }
+            pairs = grown;
+        }
+        for (size_t i = 0; i < x->num_children; ++i) {
+            pairs[count * 2] = x->children[i];
+            pairs[count * 2 + 1] = y->children[i];
+            count++;
+        }
+    }
+
+    free((void*)pairs);
+    return equal;
+}
+
+// Distinct expression subtrees of one arena. Their children are already
+// shared, so comparing the children by address compares whole subtrees.
+typedef struct {
+    ASTNode** slots;
+    uint64_t* hashes;
+    size_t capacity;
+    size_t count;
+    const fossil_arena* arena;
+    size_t shared;
+    int failed;
+} fossil_share_table;
+
+// Hash of a node whose children are already shared
+static uint64_t fossil_share_hash(const ASTNode* node) {
+    uint64_t hash = fossil_node_hash_fields(0xcbf29ce484222325ULL, node);
+    if (node->num_children > 0) {
+        hash = fossil_hash_bytes(hash, node->children, node->num_children * sizeof(ASTNode*));
+    }
+    return hash;
+}
+
+// Slot of the node equal to node, or of the empty slot where it would go
+static size_t fossil_share_slot(const fossil_share_table* table, const ASTNode* node, uint64_t hash) {
+    size_t mask = table->capacity - 1;
+    size_t index = (size_t)hash & mask;
+    while (table->slots[index] != NULL) {
+        const ASTNode* other = table->slots[index];
+        if (table->hashes[index] == hash && fossil_node_fields_equal(other, node) &&
+            (node->num_children == 0 || memcmp(other->children, node->children, node->num_children * sizeof(ASTNode*)) == 0)) {
+            break;
+        }
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+// The shared node equal to node, or NULL if there is none
+static ASTNode* fossil_share_find(const fossil_share_table* table, const ASTNode* node) {
+    if (table->capacity == 0) {
+        return NULL;
+    }
+    return table->slots[fossil_share_slot(table, node, fossil_share_hash(node))];
+}
+
+// The shared node equal to node, adding node when it is the first of its
+// shape; NULL when out of memory
+static ASTNode* fossil_share_intern(fossil_share_table* table, ASTNode* node) {
+    if ((table->count + 1) * 2 > table->capacity) {
+        fossil_share_table grown = *table;
+        grown.capacity = table->capacity == 0 ? 256 : table->capacity * 2;
+        grown.slots = (ASTNode**)calloc(grown.capacity, sizeof(ASTNode*));
+        grown.hashes = (uint64_t*)malloc(grown.capacity * sizeof(uint64_t));
+        if (grown.slots == NULL || grown.hashes == NULL) {
+            free(grown.slots);
+            free(grown.hashes);
+            return NULL;
+        }
+        for (size_t i = 0; i < table->capacity; ++i) {
+            if (table->slots[i] != NULL) {
+                size_t slot = fossil_share_slot(&grown, table->slots[i], table->hashes[i]);
+                grown.slots[slot] = table->slots[i];
+                grown.hashes[slot] = table->hashes[i];
+            }
+        }
+        free(table->slots);
+        free(table->hashes);
+        *table = grown;
+    }
+
+    uint64_t hash = fossil_share_hash(node);
+    size_t slot = fossil_share_slot(table, node, hash);
+    if (table->slots[slot] == NULL) {
+        table->slots[slot] = node;
+        table->hashes[slot] = hash;
+        table->count++;
+    }
+    return table->slots[slot];
+}
+
+// Whether a node is a pure expression that may be shared: declarations,
+// statements and bodies keep their identity, since passes key them by address
+static int fossil_share_candidate(const fossil_share_table* table, const ASTNode* node) {
+    if (node->arena != table->arena) {
+        return 0;
+    }
+
+    switch (node->type) {
+        case VARIABLE:
+            if (node->num_children > 0) {
+                return 0;
+            }
+            break;
+        case CONSTANT:
+        case UNARY_OP:
+        case BINARY_OP:
+        case RELATIONAL_OP:
+        case LOGICAL_OP:
+        case CALL_EXPRESSION:
+        case ARRAY_LITERAL:
+            break;
+        default:
+            return 0;
+    }
+
+    // Every child must already be a shared node
+    for (size_t i = 0; i < node->num_children; ++i) {
+        if (fossil_share_find(table, node->children[i]) != node->children[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Replace the expression children of a finished node by their shared copies
+static int fossil_share_leave(ASTNode* node, size_t depth, void* user_data) {
+    (void)depth;
+    fossil_share_table* table = (fossil_share_table*)user_data;
+
+    // Children of bodies, declarations and the root are statements
+    if (node->type == FUNCTION || node->type == CLASS || node->type == BLOCK_STATEMENT || node->type == PLACEHOLDER_NODE) {
+        return FOSSIL_VISIT_CONTINUE;
+    }
+
+    for (size_t i = 0; i < node->num_children; ++i) {
+        ASTNode* child = node->children[i];
+        if (!fossil_share_candidate(table, child)) {
+            continue;
+        }
+
+        ASTNode* shared = fossil_share_intern(table, child);
+        if (shared == NULL) {
+            table->failed = 1;
+            return FOSSIL_VISIT_STOP;
+        }
+        if (shared != child) {
+            node->children[i] = shared;
+            table->shared++;
+        }
+    }
+    return FOSSIL_VISIT_CONTINUE;
+}
+
+// Function to share structurally identical expressions of an arena tree
+size_t fscl_fossil_share_subtrees(ASTNode* root) {
+    if (root == NULL || root->arena == NULL) {
+        return 0;
+    }
+
+    fossil_share_table table;
+    memset(&table, 0, sizeof(table));
+    table.arena = root->arena;
+    fscl_fossil_visit_postorder(root, fossil_share_leave, &table);
+
+    free(table.slots);
+    free(table.hashes);
+    return table.shared;
+}
+
+// =================================================================
+// Source locations
+// =================================================================
+
+// Function to build the line table of a source
+int fscl_fossil_line_table_build(const char* code, size_t length, fossil_line_table* table) {
+    if (table == NULL) {
+        return -1;
+    }
+    memset(table, 0, sizeof(*table));
+    if ((code == NULL && length > 0) || length >= UINT32_MAX) {
+        return -1;
+    }
+
+    size_t count = 1 + fossil_count_lines(code, length);
+
+    table->starts = (uint32_t*)malloc(count * sizeof(uint32_t));
+    if (table->starts == NULL) {
+        return -1;
+    }
+    table->starts[table->count++] = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (code[i] == '\n') {
+            table->starts[table->count++] = (uint32_t)(i + 1);
+        }
+    }
+    table->length = (uint32_t)length;
+    return 0;
+}
+
+// Function to map a source offset to its line and column
+int fscl_fossil_line_table_locate(const fossil_line_table* table, uint32_t offset, uint32_t* line, uint32_t* column) {
+    if (table == NULL || table->count == 0 || offset == FOSSIL_NO_SOURCE_OFFSET || offset > table->length) {
+        return -1;
+    }
+
+    // Last line starting at or before the offset
+    size_t low = 0;
+    size_t high = table->count;
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if (table->starts[middle] <= offset) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (line != NULL) {
+        *line = (uint32_t)(low + 1);
+    }
+    if (column != NULL) {
+        *column = offset - table->starts[low] + 1;
+    }
+    return 0;
+}
+
+// Function to give node diagnostics the position of their node
+size_t fscl_fossil_diagnostics_locate(fossil_diagnostics* diagnostics, const fossil_line_table* table) {
+    if (diagnostics == NULL || table == NULL) {
+        return 0;
+    }
+
+    size_t located = 0;
+    for (size_t i = 0; i < diagnostics->count; ++i) {
+        fossil_diagnostic* diagnostic = &diagnostics->items[i];
+        if (diagnostic->node == NULL || diagnostic->line != 0) {
+            continue;
+        }
+        if (fscl_fossil_line_table_locate(table, diagnostic->node->source_offset, &diagnostic->line, &diagnostic->column) == 0) {
+            diagnostic->end_line = diagnostic->line;
+            diagnostic->end_column = diagnostic->column;
+            located++;
+        }
+    }
+    return located;
+}
+
+// Function to free a line table
+void fscl_fossil_line_table_erase(fossil_line_table* table) {
+    if (table == NULL) {
+        return;
+    }
+    free(table->starts);
+    memset(table, 0, sizeof(*table));
 }
@@ -11,10 +11,18 @@ Description:
 ==============================================================================
 */
 #include "fossil/xcore/parser.h"
+#include "fossil/xcore/thread.h"
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CSV_USE_SSE2 1
+#endif
 
 
 static void skip_whitespace(const char** ptr) {
@@ -436,6 +444,9 @@ ccsv*  fscl_csv_parser_create() {
     csv->rows = NULL;
     csv->num_rows = 0;
     csv->num_columns = 0;
+    csv->has_header = 0;
+    csv->header_index = NULL;
+    csv->header_index_size = 0;
 
     return csv;
 } // end of func
@@ -451,8 +462,9 @@ void  fscl_csv_parser_erase(ccsv** data) {
             free((*data)->rows[i]);
         }
 
-        // Free memory for rows array
+        // Free memory for rows array and header index
         free((*data)->rows);
+        free((*data)->header_index);
 
         // Free memory for ccsv structure
         free(*data);
@@ -464,88 +476,160 @@ void  fscl_csv_parser_erase(ccsv** data) {
 
 // Function to parse CSV file and populate ccsv structure
 void  fscl_csv_parser_parse(FILE* file, ccsv** data) {
-    char buffer[1024];  // Adjust buffer size as needed
+     fscl_csv_parser_parse_query(file, data, NULL);
+} // end of func
 
-    // Count the number of rows and columns in the CSV file
-    size_t num_rows = 0;
-    size_t num_columns = 0;
+// Parse a complete field as a number
+static int csv_parse_number(const char* text, double* number) {
+    char* end = NULL;
+    if (text == NULL || *text == '\0') {
+        return 0;
+    }
+    *number = strtod(text, &end);
+    return *end == '\0';
+}
 
-    while (fgets(buffer, sizeof(buffer), file) != NULL) {
-        char* token = strtok(buffer, ",");
-        size_t current_columns = 0;
+// Check one predicate against the fields of a row
+static int csv_predicate_holds(const ccsv_predicate* predicate, const ccsv_row* row, int constant_is_number, double constant) {
+    if (predicate->column >= row->num_fields) {
+        return 0;
+    }
 
-        while (token != NULL) {
-            token = strtok(NULL, ",");
-            current_columns++;
-        }
+    const char* field = row->fields[predicate->column];
+    double number = 0.0;
+    int order;
 
-        // Update the number of columns if it is greater than the current count
-        if (current_columns > num_columns) {
-            num_columns = current_columns;
-        }
+    if (constant_is_number && csv_parse_number(field, &number)) {
+        order = (number > constant) - (number < constant);
+    } else {
+        order = strcmp(field, predicate->value != NULL ? predicate->value : "");
+    }
 
-        num_rows++;
+    switch (predicate->op) {
+        case CSV_OP_EQUAL:         return order == 0;
+        case CSV_OP_NOT_EQUAL:     return order != 0;
+        case CSV_OP_LESS:          return order < 0;
+        case CSV_OP_LESS_EQUAL:    return order <= 0;
+        case CSV_OP_GREATER:       return order > 0;
+        case CSV_OP_GREATER_EQUAL: return order >= 0;
     }
+    return 0;
+}
 
-    // Reset file position to the beginning
-    fseek(file, 0, SEEK_SET);
+// Copy a field into a newly allocated cell
+static char* csv_copy_cell(const char* field) {
+    size_t len = strlen(field);
+    char* cell = (char*)malloc(len + 1);
+    if (cell == NULL) {
+        perror("Memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(cell, field, len + 1);
+    return cell;
+}
 
-    // Allocate memory for ccsv structure
+// Function to parse CSV file with column projection and row filtering
+void  fscl_csv_parser_parse_query(FILE* file, ccsv** data, const ccsv_query* query) {
     *data =  fscl_csv_parser_create();
+    if (file == NULL) {
+        return;
+    }
 
-    // Allocate memory for rows array
-    (*data)->rows = (char***)malloc(num_rows * sizeof(char**));
-    if ((*data)->rows == NULL) {
-        perror("Memory allocation error");
-        exit(EXIT_FAILURE);
+    // The reader works on streams, so wrap the caller's file
+    cstream stream;
+    stream.file = file;
+    stream.filename[0] = '\0';
+
+    ccsv_reader* reader =  fscl_csv_reader_create(&stream);
+    if (reader == NULL) {
+        return;
     }
 
-    for (size_t i = 0; i < num_rows; ++i) {
-        (*data)->rows[i] = (char**)malloc(num_columns * sizeof(char*));
-        if ((*data)->rows[i] == NULL) {
+    size_t num_predicates = query != NULL ? query->num_predicates : 0;
+    int* constant_is_number = NULL;
+    double* constants = NULL;
+    if (num_predicates > 0) {
+        constant_is_number = (int*)malloc(num_predicates * sizeof(int));
+        constants = (double*)malloc(num_predicates * sizeof(double));
+        if (constant_is_number == NULL || constants == NULL) {
             perror("Memory allocation error");
             exit(EXIT_FAILURE);
         }
-
-        // Initialize each element to NULL
-        for (size_t j = 0; j < num_columns; ++j) {
-            (*data)->rows[i][j] = NULL;
+        for (size_t i = 0; i < num_predicates; ++i) {
+            constant_is_number[i] = csv_parse_number(query->predicates[i].value, &constants[i]);
         }
     }
 
-    // Populate the ccsv structure with data from the CSV file
-    size_t row_index = 0;
+    int projected = query != NULL && query->columns != NULL;
+    size_t capacity = 0;
+    size_t* widths = NULL;
+    ccsv_row row;
 
-    while (fgets(buffer, sizeof(buffer), file) != NULL) {
-        char* token = strtok(buffer, ",");
-        size_t col_index = 0;
+    while (fscl_csv_reader_next(reader, &row) == 1) {
+        int is_header = query != NULL && query->has_header && reader->row_number == 1;
 
-        while (token != NULL) {
-            size_t len = strlen(token);
-            // Remove newline character if present
-            if (len > 0 && token[len - 1] == '\n') {
-                token[len - 1] = '\0';
-            }
+        int keep = 1;
+        for (size_t i = 0; keep && !is_header && i < num_predicates; ++i) {
+            keep = csv_predicate_holds(&query->predicates[i], &row, constant_is_number[i], constants[i]);
+        }
+        if (!keep) {
+            continue;
+        }
 
-            // Allocate memory for the token
-            (*data)->rows[row_index][col_index] = (char*)malloc((len + 1) * sizeof(char));
-            if ((*data)->rows[row_index][col_index] == NULL) {
+        if ((*data)->num_rows == capacity) {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            (*data)->rows = (char***)realloc((*data)->rows, capacity * sizeof(char**));
+            widths = (size_t*)realloc(widths, capacity * sizeof(size_t));
+            if ((*data)->rows == NULL || widths == NULL) {
                 perror("Memory allocation error");
                 exit(EXIT_FAILURE);
             }
+        }
+
+        size_t width = projected ? query->num_columns : row.num_fields;
+        char** cells = (char**)malloc((width > 0 ? width : 1) * sizeof(char*));
+        if (cells == NULL) {
+            perror("Memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+
+        for (size_t j = 0; j < width; ++j) {
+            size_t source = projected ? query->columns[j] : j;
+            cells[j] = source < row.num_fields ? csv_copy_cell(row.fields[source]) : NULL;
+        }
 
-            // Copy the token to the ccsv structure
-            strcpy((*data)->rows[row_index][col_index], token);
+        (*data)->rows[(*data)->num_rows] = cells;
+        widths[(*data)->num_rows] = width;
+        (*data)->num_rows++;
 
-            token = strtok(NULL, ",");
-            col_index++;
+        if (width > (*data)->num_columns) {
+            (*data)->num_columns = width;
         }
+    }
 
-        row_index++;
+    // Pad short rows so every row has num_columns cells
+    for (size_t i = 0; i < (*data)->num_rows; ++i) {
+        if (widths[i] < (*data)->num_columns) {
+            char** cells = (char**)realloc((*data)->rows[i], (*data)->num_columns * sizeof(char*));
+            if (cells == NULL) {
+                perror("Memory allocation error");
+                exit(EXIT_FAILURE);
+            }
+            for (size_t j = widths[i]; j < (*data)->num_columns; ++j) {
+                cells[j] = NULL;
+            }
+            (*data)->rows[i] = cells;
+        }
     }
 
-    (*data)->num_rows = num_rows;
-    (*data)->num_columns = num_columns;
+    free(widths);
+    free(constant_is_number);
+    free(constants);
+     fscl_csv_reader_erase(&reader);
+
+    if (query != NULL ? query->has_header : fscl_csv_detect_header(*data)) {
+        fscl_csv_set_header(*data, 1);
+    }
 } // end of func
 
 // Function to update a specific cell in the ccsv structure
@@ -565,6 +649,11 @@ void  fscl_csv_parser_setter(ccsv** data, size_t row, size_t col, const char* up
 
         // Copy the updated content to the cell
         strcpy((*data)->rows[row][col], update);
+
+        // Column names changed, so the name index must follow
+        if (row == 0 && (*data)->has_header) {
+            fscl_csv_set_header(*data, 1);
+        }
     } else {
         fprintf(stderr, "Invalid row or column index\n");
     }
@@ -579,4 +668,1021 @@ const char*  fscl_csv_parser_getter(const ccsv* data, size_t row, size_t col) {
         fprintf(stderr, "Invalid row or column index\n");
         return NULL;
     }
-} // end of func
\ No newline at end of file
+} // end of func
+
+// Function to create a streaming CSV reader
+ccsv_reader*  fscl_csv_reader_create(cstream* stream) {
+    if (stream == NULL || stream->file == NULL) {
+        fprintf(stderr, "Invalid stream for CSV reader\n");
+        return NULL;
+    }
+
+    ccsv_reader* reader = (ccsv_reader*)calloc(1, sizeof(ccsv_reader));
+    if (reader == NULL) {
+        perror("Memory allocation error");
+        return NULL;
+    }
+
+    reader->stream = stream;
+    reader->buffer = (char*)malloc(CSV_READER_BUFFER_SIZE);
+    reader->field_capacity = 256;
+    reader->field_data = (char*)malloc(reader->field_capacity);
+    reader->fields_capacity = 16;
+    reader->field_offsets = (size_t*)malloc(reader->fields_capacity * sizeof(size_t));
+    reader->fields = (char**)malloc(reader->fields_capacity * sizeof(char*));
+
+    if (reader->buffer == NULL || reader->field_data == NULL ||
+        reader->field_offsets == NULL || reader->fields == NULL) {
+        perror("Memory allocation error");
+        fscl_csv_reader_erase(&reader);
+        return NULL;
+    }
+
+    return reader;
+} // end of func
+
+// Function to erase a streaming CSV reader
+void  fscl_csv_reader_erase(ccsv_reader** reader) {
+    if (reader != NULL && *reader != NULL) {
+        free((*reader)->buffer);
+        free((*reader)->field_data);
+        free((*reader)->field_offsets);
+        free((*reader)->fields);
+        free(*reader);
+        *reader = NULL;
+    }
+} // end of func
+
+// Append a character to the row storage of the reader
+static int csv_reader_push(ccsv_reader* reader, char c) {
+    if (reader->field_length == reader->field_capacity) {
+        size_t capacity = reader->field_capacity * 2;
+        char* data = (char*)realloc(reader->field_data, capacity);
+        if (data == NULL) {
+            return 0;
+        }
+        reader->field_data = data;
+        reader->field_capacity = capacity;
+    }
+    reader->field_data[reader->field_length++] = c;
+    return 1;
+}
+
+// Terminate the current field and start a new one
+static int csv_reader_end_field(ccsv_reader* reader, size_t* num_fields, size_t field_start) {
+    if (!csv_reader_push(reader, '\0')) {
+        return 0;
+    }
+
+    if (*num_fields == reader->fields_capacity) {
+        size_t capacity = reader->fields_capacity * 2;
+        size_t* offsets = (size_t*)realloc(reader->field_offsets, capacity * sizeof(size_t));
+        if (offsets == NULL) {
+            return 0;
+        }
+        reader->field_offsets = offsets;
+
+        char** fields = (char**)realloc(reader->fields, capacity * sizeof(char*));
+        if (fields == NULL) {
+            return 0;
+        }
+        reader->fields = fields;
+        reader->fields_capacity = capacity;
+    }
+
+    reader->field_offsets[(*num_fields)++] = field_start;
+    return 1;
+}
+
+// Function to read the next row from a streaming CSV reader
+int  fscl_csv_reader_next(ccsv_reader* reader, ccsv_row* row) {
+    if (reader == NULL || row == NULL) {
+        return -1;
+    }
+
+    size_t num_fields = 0;
+    size_t field_start = 0;
+    int in_quotes = 0;
+    int row_has_data = 0;
+
+    reader->field_length = 0;
+
+    for (;;) {
+        if (reader->buffer_pos == reader->buffer_length) {
+            if (reader->eof) {
+                break;
+            }
+            reader->buffer_length = fscl_stream_read(reader->stream, reader->buffer, 1, CSV_READER_BUFFER_SIZE);
+            reader->buffer_pos = 0;
+            if (reader->buffer_length == 0) {
+                reader->eof = 1;
+                break;
+            }
+        }
+
+        char c = reader->buffer[reader->buffer_pos++];
+
+        if (in_quotes) {
+            if (c == '"') {
+                // A doubled quote is a literal quote, a single one closes the field
+                if (reader->buffer_pos == reader->buffer_length && !reader->eof) {
+                    reader->buffer_length = fscl_stream_read(reader->stream, reader->buffer, 1, CSV_READER_BUFFER_SIZE);
+                    reader->buffer_pos = 0;
+                    if (reader->buffer_length == 0) {
+                        reader->eof = 1;
+                    }
+                }
+                if (reader->buffer_pos < reader->buffer_length && reader->buffer[reader->buffer_pos] == '"') {
+                    reader->buffer_pos++;
+                    if (!csv_reader_push(reader, '"')) {
+                        return -1;
+                    }
+                } else {
+                    in_quotes = 0;
+                }
+            } else if (!csv_reader_push(reader, c)) {
+                return -1;
+            }
+            continue;
+        }
+
+        if (c == ',') {
+            if (!csv_reader_end_field(reader, &num_fields, field_start)) {
+                return -1;
+            }
+            field_start = reader->field_length;
+            row_has_data = 1;
+        } else if (c == '\n') {
+            if (row_has_data || reader->field_length > field_start) {
+                break;
+            }
+        } else if (c == '"' && reader->field_length == field_start) {
+            in_quotes = 1;
+            row_has_data = 1;
+        } else if (c != '\r') {
+            if (!csv_reader_push(reader, c)) {
+                return -1;
+            }
+            row_has_data = 1;
+        }
+    }
+
+    if (!row_has_data && reader->field_length == field_start) {
+        row->fields = NULL;
+        row->num_fields = 0;
+        return 0;
+    }
+
+    if (!csv_reader_end_field(reader, &num_fields, field_start)) {
+        return -1;
+    }
+
+    // Offsets are resolved only now since the row storage may have moved
+    for (size_t i = 0; i < num_fields; ++i) {
+        reader->fields[i] = reader->field_data + reader->field_offsets[i];
+    }
+
+    reader->row_number++;
+    row->fields = reader->fields;
+    row->num_fields = num_fields;
+    return 1;
+} // end of func
+
+// Function to create a buffered CSV writer
+ccsv_writer*  fscl_csv_writer_create(cstream* stream, size_t buffer_size) {
+    if (stream == NULL || stream->file == NULL) {
+        fprintf(stderr, "Invalid stream for CSV writer\n");
+        return NULL;
+    }
+
+    ccsv_writer* writer = (ccsv_writer*)calloc(1, sizeof(ccsv_writer));
+    if (writer == NULL) {
+        perror("Memory allocation error");
+        return NULL;
+    }
+
+    // Every flush is a stream write, so tiny buffers are raised to a minimum
+    if (buffer_size == 0) {
+        buffer_size = CSV_WRITER_BUFFER_SIZE;
+    }
+    writer->buffer_size = buffer_size < CSV_WRITER_MIN_BUFFER_SIZE ? CSV_WRITER_MIN_BUFFER_SIZE : buffer_size;
+    writer->buffer = (char*)malloc(writer->buffer_size);
+    if (writer->buffer == NULL) {
+        perror("Memory allocation error");
+        free(writer);
+        return NULL;
+    }
+
+    writer->stream = stream;
+    return writer;
+} // end of func
+
+// Function to erase a buffered CSV writer
+void  fscl_csv_writer_erase(ccsv_writer** writer) {
+    if (writer != NULL && *writer != NULL) {
+        fscl_csv_writer_flush(*writer);
+        free((*writer)->buffer);
+        free(*writer);
+        *writer = NULL;
+    }
+} // end of func
+
+// Function to flush a buffered CSV writer
+int  fscl_csv_writer_flush(ccsv_writer* writer) {
+    if (writer == NULL) {
+        return -1;
+    }
+
+    if (writer->buffer_length > 0) {
+        if (fscl_stream_write(writer->stream, writer->buffer, writer->buffer_length, 1) != 1) {
+            writer->error = 1;
+        }
+        writer->buffer_length = 0;
+    }
+
+    return writer->error ? -1 : 0;
+} // end of func
+
+// Make room for at least size bytes in the writer buffer
+static char* csv_writer_reserve(ccsv_writer* writer, size_t size) {
+    if (writer->buffer_size - writer->buffer_length < size) {
+        fscl_csv_writer_flush(writer);
+    }
+    return writer->buffer + writer->buffer_length;
+}
+
+// Copy raw bytes into the writer buffer
+static void csv_writer_put(ccsv_writer* writer, const char* data, size_t length) {
+    while (length > 0) {
+        if (writer->buffer_length == writer->buffer_size) {
+            fscl_csv_writer_flush(writer);
+        }
+
+        size_t chunk = writer->buffer_size - writer->buffer_length;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        memcpy(writer->buffer + writer->buffer_length, data, chunk);
+        writer->buffer_length += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+// Start a new field, writing the separator when needed
+static void csv_writer_separator(ccsv_writer* writer) {
+    if (writer->num_fields++ > 0) {
+        *csv_writer_reserve(writer, 1) = ',';
+        writer->buffer_length++;
+    }
+}
+
+// Function to write a text field
+int  fscl_csv_writer_field(ccsv_writer* writer, const char* value) {
+    if (writer == NULL) {
+        return -1;
+    }
+
+    csv_writer_separator(writer);
+    if (value == NULL) {
+        return writer->error ? -1 : 0;
+    }
+
+    size_t length = 0;
+    int needs_quotes = 0;
+    for (const char* p = value; *p != '\0'; ++p, ++length) {
+        if (*p == ',' || *p == '"' || *p == '\n' || *p == '\r') {
+            needs_quotes = 1;
+        }
+    }
+
+    if (!needs_quotes) {
+        csv_writer_put(writer, value, length);
+        return writer->error ? -1 : 0;
+    }
+
+    csv_writer_put(writer, "\"", 1);
+    const char* start = value;
+    for (const char* p = value; *p != '\0'; ++p) {
+        if (*p == '"') {
+            // Emit up to and including the quote, then double it
+            csv_writer_put(writer, start, (size_t)(p - start) + 1);
+            start = p;
+        }
+    }
+    csv_writer_put(writer, start, length - (size_t)(start - value));
+    csv_writer_put(writer, "\"", 1);
+
+    return writer->error ? -1 : 0;
+} // end of func
+
+// Format an unsigned integer backwards into the end of digits
+static char* csv_format_unsigned(unsigned long long value, char* end) {
+    do {
+        *--end = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    return end;
+}
+
+// Format a whole double beyond unsigned long long backwards into the end
+// of digits, exactly, by scaling its mantissa in base 1e9 limbs
+static char* csv_format_large(double magnitude, char* end) {
+    uint64_t bits;
+    memcpy(&bits, &magnitude, sizeof(bits));
+    int exponent = (int)((bits >> 52) & 0x7ff) - 1075;
+    uint64_t mantissa = (bits & ((UINT64_C(1) << 52) - 1)) | (UINT64_C(1) << 52);
+
+    // Least significant limb first; 2^1024 needs 35 of them
+    uint32_t limbs[40];
+    size_t count = 0;
+    limbs[count++] = (uint32_t)(mantissa % 1000000000u);
+    limbs[count++] = (uint32_t)(mantissa / 1000000000u);
+    while (exponent > 0) {
+        int shift = exponent < 29 ? exponent : 29;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t product = ((uint64_t)limbs[i] << shift) + carry;
+            limbs[i] = (uint32_t)(product % 1000000000u);
+            carry = product / 1000000000u;
+        }
+        if (carry > 0) {
+            limbs[count++] = (uint32_t)carry;
+        }
+        exponent -= shift;
+    }
+
+    for (size_t i = 0; i + 1 < count; ++i) {
+        uint32_t limb = limbs[i];
+        for (int digit = 0; digit < 9; ++digit) {
+            *--end = (char)('0' + limb % 10);
+            limb /= 10;
+        }
+    }
+    return csv_format_unsigned(limbs[count - 1], end);
+}
+
+// Function to write an integer field
+int  fscl_csv_writer_field_int(ccsv_writer* writer, long long value) {
+    if (writer == NULL) {
+        return -1;
+    }
+
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    char* start = csv_format_unsigned(magnitude, end);
+    if (value < 0) {
+        *--start = '-';
+    }
+
+    csv_writer_separator(writer);
+    csv_writer_put(writer, start, (size_t)(end - start));
+    return writer->error ? -1 : 0;
+} // end of func
+
+// Function to write a floating point field
+int  fscl_csv_writer_field_double(ccsv_writer* writer, double value, int precision) {
+    static const double scales[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+    if (writer == NULL) {
+        return -1;
+    }
+
+    if (precision < 0) {
+        precision = 0;
+    } else if (precision > 9) {
+        precision = 9;
+    }
+
+    if (value != value) {
+        return fscl_csv_writer_field(writer, "nan");
+    }
+    if (value - value != 0.0) {
+        return fscl_csv_writer_field(writer, value > 0 ? "inf" : "-inf");
+    }
+
+    int negative = value < 0;
+    double magnitude = negative ? -value : value;
+    unsigned long long scale = (unsigned long long)scales[precision];
+    unsigned long long whole = 0;
+    unsigned long long fraction = 0;
+
+    // Round the fraction on its own, so the whole part never loses digits to scaling
+    if (magnitude < 1.8e19) {
+        whole = (unsigned long long)magnitude;
+        fraction = (unsigned long long)((magnitude - (double)whole) * scales[precision] + 0.5);
+        if (fraction >= scale) {
+            whole++;
+            fraction -= scale;
+        }
+    }
+    // Larger doubles are whole numbers, formatted digit by digit below
+
+    // Values that round to zero are written without a sign
+    int rounds_to_zero = magnitude < 1.8e19 && whole == 0 && fraction == 0;
+
+    char digits[352];
+    char* end = digits + sizeof(digits);
+    char* start = end;
+
+    if (precision > 0) {
+        for (int i = 0; i < precision; ++i) {
+            *--start = (char)('0' + fraction % 10);
+            fraction /= 10;
+        }
+        *--start = '.';
+    }
+
+    if (magnitude < 1.8e19) {
+        start = csv_format_unsigned(whole, start);
+    } else {
+        start = csv_format_large(magnitude, start);
+    }
+    if (negative && !rounds_to_zero) {
+        *--start = '-';
+    }
+
+    csv_writer_separator(writer);
+    csv_writer_put(writer, start, (size_t)(end - start));
+    return writer->error ? -1 : 0;
+} // end of func
+
+// Function to terminate a row
+int  fscl_csv_writer_end_row(ccsv_writer* writer) {
+    if (writer == NULL) {
+        return -1;
+    }
+
+    *csv_writer_reserve(writer, 1) = '\n';
+    writer->buffer_length++;
+    writer->num_fields = 0;
+    return writer->error ? -1 : 0;
+} // end of func
+
+// Function to write a full row of text fields
+int  fscl_csv_writer_write_row(ccsv_writer* writer, const char* const* fields, size_t num_fields) {
+    if (writer == NULL || (fields == NULL && num_fields > 0)) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < num_fields; ++i) {
+        fscl_csv_writer_field(writer, fields[i]);
+    }
+
+    return fscl_csv_writer_end_row(writer);
+} // end of func
+
+// Function to write a whole parsed table
+int  fscl_csv_writer_write_table(ccsv_writer* writer, const ccsv* data) {
+    if (writer == NULL || data == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < data->num_rows; ++i) {
+        fscl_csv_writer_write_row(writer, (const char* const*)data->rows[i], data->num_columns);
+    }
+
+    return writer->error ? -1 : 0;
+} // end of func
+
+// Hash a column name ignoring ASCII case
+static size_t csv_hash_name(const char* name) {
+    size_t hash = 2166136261u;
+    for (; *name != '\0'; ++name) {
+        hash ^= (unsigned char)tolower((unsigned char)*name);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Compare two column names ignoring ASCII case
+static int csv_names_equal(const char* a, const char* b) {
+    while (*a != '\0' && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+        a++;
+        b++;
+    }
+    return tolower((unsigned char)*a) == tolower((unsigned char)*b);
+}
+
+// Function to guess whether row 0 is a header
+int  fscl_csv_detect_header(const ccsv* data) {
+    if (data == NULL || data->num_rows == 0 || data->num_columns == 0) {
+        return 0;
+    }
+
+    int numeric_below = data->num_rows == 1;
+    for (size_t j = 0; j < data->num_columns; ++j) {
+        const char* name = data->rows[0][j];
+        double number;
+        if (name == NULL || *name == '\0' || csv_parse_number(name, &number)) {
+            return 0;
+        }
+        for (size_t k = 0; k < j; ++k) {
+            if (csv_names_equal(name, data->rows[0][k])) {
+                return 0;
+            }
+        }
+        if (data->num_rows > 1 && csv_parse_number(data->rows[1][j], &number)) {
+            numeric_below = 1;
+        }
+    }
+
+    return numeric_below;
+} // end of func
+
+// Function to mark row 0 as a header and build the name index
+int  fscl_csv_set_header(ccsv* data, int has_header) {
+    if (data == NULL) {
+        return -1;
+    }
+
+    free(data->header_index);
+    data->header_index = NULL;
+    data->header_index_size = 0;
+    data->has_header = 0;
+
+    if (!has_header) {
+        return 0;
+    }
+    if (data->num_rows == 0) {
+        return -1;
+    }
+
+    // Keep the table at most half full so probe chains stay short
+    size_t size = 8;
+    while (size < data->num_columns * 2) {
+        size *= 2;
+    }
+
+    data->header_index = (size_t*)calloc(size, sizeof(size_t));
+    if (data->header_index == NULL) {
+        perror("Memory allocation error");
+        return -1;
+    }
+    data->header_index_size = size;
+    data->has_header = 1;
+
+    for (size_t j = 0; j < data->num_columns; ++j) {
+        const char* name = data->rows[0][j];
+        if (name == NULL) {
+            continue;
+        }
+
+        size_t slot = csv_hash_name(name) & (size - 1);
+        while (data->header_index[slot] != 0) {
+            if (csv_names_equal(name, data->rows[0][data->header_index[slot] - 1])) {
+                break;  // Duplicate names resolve to the first column
+            }
+            slot = (slot + 1) & (size - 1);
+        }
+        if (data->header_index[slot] == 0) {
+            data->header_index[slot] = j + 1;
+        }
+    }
+
+    return 0;
+} // end of func
+
+// Function to look up a column index by header name
+size_t  fscl_csv_column_index(const ccsv* data, const char* name) {
+    if (data == NULL || name == NULL || !data->has_header || data->header_index == NULL) {
+        return FSCL_CSV_NO_COLUMN;
+    }
+
+    size_t mask = data->header_index_size - 1;
+    size_t slot = csv_hash_name(name) & mask;
+    while (data->header_index[slot] != 0) {
+        size_t col = data->header_index[slot] - 1;
+        if (csv_names_equal(name, data->rows[0][col])) {
+            return col;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return FSCL_CSV_NO_COLUMN;
+} // end of func
+
+// Function to get a cell by row index and header name
+const char*  fscl_csv_get_by_name(const ccsv* data, size_t row, const char* name) {
+    size_t col = fscl_csv_column_index(data, name);
+    if (col == FSCL_CSV_NO_COLUMN || row >= data->num_rows) {
+        return NULL;
+    }
+    return data->rows[row][col];
+} // end of func
+
+// Function to convert a column to doubles
+int  fscl_csv_column_load(const ccsv* data, size_t col, ccsv_column* column) {
+    if (data == NULL || column == NULL || col >= data->num_columns) {
+        return -1;
+    }
+
+    size_t first = data->has_header ? 1 : 0;
+    column->count = data->num_rows > first ? data->num_rows - first : 0;
+    column->values = (double*)malloc((column->count > 0 ? column->count : 1) * sizeof(double));
+    if (column->values == NULL) {
+        perror("Memory allocation error");
+        column->count = 0;
+        return -1;
+    }
+
+    for (size_t i = 0; i < column->count; ++i) {
+        double number;
+        column->values[i] = csv_parse_number(data->rows[first + i][col], &number) ? number : (double)NAN;
+    }
+
+    return 0;
+} // end of func
+
+// Function to free a converted column
+void  fscl_csv_column_erase(ccsv_column* column) {
+    if (column != NULL) {
+        free(column->values);
+        column->values = NULL;
+        column->count = 0;
+    }
+} // end of func
+
+// Sum and count the non-null values of a column in one pass
+static double csv_column_sum_count(const ccsv_column* column, size_t* count) {
+    const double* values = column->values;
+    size_t n = column->count;
+    size_t i = 0;
+    double sum = 0.0;
+    double valid = 0.0;
+
+#ifdef CSV_USE_SSE2
+    // NaN != NaN, so the self-compare mask drops null cells
+    const __m128d ones = _mm_set1_pd(1.0);
+    __m128d sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd();
+    __m128d cnt0 = _mm_setzero_pd(), cnt1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m128d a = _mm_loadu_pd(values + i);
+        __m128d b = _mm_loadu_pd(values + i + 2);
+        __m128d ma = _mm_cmpeq_pd(a, a);
+        __m128d mb = _mm_cmpeq_pd(b, b);
+        sum0 = _mm_add_pd(sum0, _mm_and_pd(a, ma));
+        sum1 = _mm_add_pd(sum1, _mm_and_pd(b, mb));
+        cnt0 = _mm_add_pd(cnt0, _mm_and_pd(ones, ma));
+        cnt1 = _mm_add_pd(cnt1, _mm_and_pd(ones, mb));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+    sum = lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, _mm_add_pd(cnt0, cnt1));
+    valid = lanes[0] + lanes[1];
+#else
+    // Independent accumulators let the compiler keep several adds in flight
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+    for (; i + 4 <= n; i += 4) {
+        double a = values[i], b = values[i + 1], c = values[i + 2], d = values[i + 3];
+        s0 += a == a ? a : 0.0; c0 += a == a;
+        s1 += b == b ? b : 0.0; c1 += b == b;
+        s2 += c == c ? c : 0.0; c2 += c == c;
+        s3 += d == d ? d : 0.0; c3 += d == d;
+    }
+    sum = (s0 + s1) + (s2 + s3);
+    valid = (double)(c0 + c1 + c2 + c3);
+#endif
+
+    size_t counted = (size_t)valid;
+    for (; i < n; ++i) {
+        if (values[i] == values[i]) {
+            sum += values[i];
+            counted++;
+        }
+    }
+
+    if (count != NULL) {
+        *count = counted;
+    }
+    return sum;
+}
+
+// Find the minimum (or maximum) of the non-null values of a column
+static double csv_column_extreme(const ccsv_column* column, int want_max) {
+    const double* values = column->values;
+    size_t n = column->count;
+    size_t i = 0;
+    double best = want_max ? -(double)INFINITY : (double)INFINITY;
+
+#ifdef CSV_USE_SSE2
+    // minpd/maxpd return the second operand when the first is NaN
+    __m128d acc0 = _mm_set1_pd(best), acc1 = _mm_set1_pd(best);
+    for (; i + 4 <= n; i += 4) {
+        __m128d a = _mm_loadu_pd(values + i);
+        __m128d b = _mm_loadu_pd(values + i + 2);
+        if (want_max) {
+            acc0 = _mm_max_pd(a, acc0);
+            acc1 = _mm_max_pd(b, acc1);
+        } else {
+            acc0 = _mm_min_pd(a, acc0);
+            acc1 = _mm_min_pd(b, acc1);
+        }
+    }
+    double lanes[4];
+    _mm_storeu_pd(lanes, acc0);
+    _mm_storeu_pd(lanes + 2, acc1);
+    for (int k = 0; k < 4; ++k) {
+        best = want_max ? (lanes[k] > best ? lanes[k] : best) : (lanes[k] < best ? lanes[k] : best);
+    }
+#endif
+
+    // Comparisons with NaN are false, so null cells never win
+    for (; i < n; ++i) {
+        if (want_max ? values[i] > best : values[i] < best) {
+            best = values[i];
+        }
+    }
+
+    return best;
+}
+
+// Function to sum a column
+double  fscl_csv_column_sum(const ccsv_column* column) {
+    if (column == NULL || column->values == NULL) {
+        return 0.0;
+    }
+    return csv_column_sum_count(column, NULL);
+} // end of func
+
+// Function to count the non-null values of a column
+size_t  fscl_csv_column_count(const ccsv_column* column) {
+    size_t count = 0;
+    if (column != NULL && column->values != NULL) {
+        csv_column_sum_count(column, &count);
+    }
+    return count;
+} // end of func
+
+// Function to find the minimum of a column
+double  fscl_csv_column_min(const ccsv_column* column) {
+    if (fscl_csv_column_count(column) == 0) {
+        return (double)NAN;
+    }
+    return csv_column_extreme(column, 0);
+} // end of func
+
+// Function to find the maximum of a column
+double  fscl_csv_column_max(const ccsv_column* column) {
+    if (fscl_csv_column_count(column) == 0) {
+        return (double)NAN;
+    }
+    return csv_column_extreme(column, 1);
+} // end of func
+
+// Function to average a column
+double  fscl_csv_column_mean(const ccsv_column* column) {
+    size_t count = 0;
+    if (column == NULL || column->values == NULL) {
+        return (double)NAN;
+    }
+
+    double sum = csv_column_sum_count(column, &count);
+    return count > 0 ? sum / (double)count : (double)NAN;
+} // end of func
+
+// Function to build a histogram of a column
+int  fscl_csv_column_histogram(const ccsv_column* column, double low, double high, size_t* bins, size_t num_bins) {
+    if (column == NULL || bins == NULL || num_bins == 0 || !(high > low)) {
+        return -1;
+    }
+
+    memset(bins, 0, num_bins * sizeof(size_t));
+    double scale = (double)num_bins / (high - low);
+
+    for (size_t i = 0; i < column->count; ++i) {
+        double value = column->values[i];
+        if (value >= low && value <= high) {
+            size_t bin = (size_t)((value - low) * scale);
+            bins[bin < num_bins ? bin : num_bins - 1]++;
+        }
+    }
+
+    return 0;
+} // end of func
+
+// Hash table mapping group keys to entries of a ccsv_groups
+typedef struct {
+    ccsv_groups groups;
+    size_t* slots;          // Group index + 1, 0 for empty
+    size_t num_slots;
+    size_t capacity;
+} csv_group_table;
+
+// Work assigned to one group-by thread
+typedef struct {
+    const ccsv* data;
+    size_t key_col;
+    size_t value_col;
+    size_t first_row;
+    size_t last_row;
+    csv_group_table table;
+    int failed;
+} csv_group_task;
+
+// Hash a group key
+static size_t csv_hash_key(const char* key) {
+    size_t hash = 2166136261u;
+    for (; *key != '\0'; ++key) {
+        hash ^= (unsigned char)*key;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Rebuild the slots of a group table with the given size
+static int csv_group_rehash(csv_group_table* table, size_t num_slots) {
+    size_t* slots = (size_t*)calloc(num_slots, sizeof(size_t));
+    if (slots == NULL) {
+        return 0;
+    }
+
+    for (size_t g = 0; g < table->groups.num_groups; ++g) {
+        size_t slot = csv_hash_key(table->groups.keys[g]) & (num_slots - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (num_slots - 1);
+        }
+        slots[slot] = g + 1;
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->num_slots = num_slots;
+    return 1;
+}
+
+// Find the group of a key, creating it if needed
+static size_t csv_group_find(csv_group_table* table, const char* key) {
+    if ((table->groups.num_groups + 1) * 2 > table->num_slots &&
+        !csv_group_rehash(table, table->num_slots == 0 ? 64 : table->num_slots * 2)) {
+        return FSCL_CSV_NO_COLUMN;
+    }
+
+    size_t mask = table->num_slots - 1;
+    size_t slot = csv_hash_key(key) & mask;
+    while (table->slots[slot] != 0) {
+        size_t g = table->slots[slot] - 1;
+        if (strcmp(table->groups.keys[g], key) == 0) {
+            return g;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    ccsv_groups* groups = &table->groups;
+    if (groups->num_groups == table->capacity) {
+        size_t capacity = table->capacity == 0 ? 32 : table->capacity * 2;
+        const char** keys = (const char**)realloc((void*)groups->keys, capacity * sizeof(char*));
+        if (keys != NULL) groups->keys = keys;
+        double* sums = (double*)realloc(groups->sums, capacity * sizeof(double));
+        if (sums != NULL) groups->sums = sums;
+        double* mins = (double*)realloc(groups->mins, capacity * sizeof(double));
+        if (mins != NULL) groups->mins = mins;
+        double* maxs = (double*)realloc(groups->maxs, capacity * sizeof(double));
+        if (maxs != NULL) groups->maxs = maxs;
+        size_t* counts = (size_t*)realloc(groups->counts, capacity * sizeof(size_t));
+        if (counts != NULL) groups->counts = counts;
+        if (keys == NULL || sums == NULL || mins == NULL || maxs == NULL || counts == NULL) {
+            return FSCL_CSV_NO_COLUMN;
+        }
+        table->capacity = capacity;
+    }
+
+    size_t g = groups->num_groups++;
+    groups->keys[g] = key;
+    groups->sums[g] = 0.0;
+    groups->mins[g] = (double)INFINITY;
+    groups->maxs[g] = -(double)INFINITY;
+    groups->counts[g] = 0;
+    table->slots[slot] = g + 1;
+    return g;
+}
+
+// Aggregate a range of rows into the task's private table
+static cthread_task(csv_group_worker, arg) {
+    csv_group_task* task = (csv_group_task*)arg;
+
+    for (size_t i = task->first_row; i < task->last_row; ++i) {
+        const char* key = task->data->rows[i][task->key_col];
+        if (key == NULL) {
+            continue;
+        }
+
+        size_t g = csv_group_find(&task->table, key);
+        if (g == FSCL_CSV_NO_COLUMN) {
+            task->failed = 1;
+            break;
+        }
+
+        double value;
+        if (csv_parse_number(task->data->rows[i][task->value_col], &value)) {
+            ccsv_groups* groups = &task->table.groups;
+            groups->sums[g] += value;
+            groups->counts[g]++;
+            if (value < groups->mins[g]) groups->mins[g] = value;
+            if (value > groups->maxs[g]) groups->maxs[g] = value;
+        }
+    }
+
+    return CTHREAD_CNULLPTR;
+}
+
+// Function to group a table by a key column
+int  fscl_csv_group_by(const ccsv* data, size_t key_col, size_t value_col, int num_threads, ccsv_groups* groups) {
+    if (data == NULL || groups == NULL || key_col >= data->num_columns || value_col >= data->num_columns) {
+        return -1;
+    }
+
+    size_t first = data->has_header ? 1 : 0;
+    size_t rows = data->num_rows > first ? data->num_rows - first : 0;
+    size_t workers = num_threads < 1 ? 1 : (size_t)num_threads;
+    if (workers > rows) {
+        workers = rows > 0 ? rows : 1;
+    }
+
+    csv_group_task* tasks = (csv_group_task*)calloc(workers, sizeof(csv_group_task));
+    cthread* threads = (cthread*)calloc(workers, sizeof(cthread));
+    if (tasks == NULL || threads == NULL) {
+        free(tasks);
+        free(threads);
+        return -1;
+    }
+
+    for (size_t t = 0; t < workers; ++t) {
+        tasks[t].data = data;
+        tasks[t].key_col = key_col;
+        tasks[t].value_col = value_col;
+        tasks[t].first_row = first + rows * t / workers;
+        tasks[t].last_row = first + rows * (t + 1) / workers;
+    }
+
+    // The calling thread takes the first range itself
+    for (size_t t = 1; t < workers; ++t) {
+        threads[t] = fscl_thread_create(csv_group_worker, &tasks[t]);
+        if (!threads[t]) {
+            csv_group_worker(&tasks[t]);
+        }
+    }
+    csv_group_worker(&tasks[0]);
+    for (size_t t = 1; t < workers; ++t) {
+        if (threads[t]) {
+            fscl_thread_join(threads[t]);
+            fscl_thread_erase(threads[t]);
+        }
+    }
+
+    // Merge the partial tables in row order so groups keep first-seen order
+    csv_group_table merged = tasks[0].table;
+    int failed = tasks[0].failed;
+    for (size_t t = 1; t < workers; ++t) {
+        ccsv_groups* part = &tasks[t].table.groups;
+        failed |= tasks[t].failed;
+        for (size_t g = 0; !failed && g < part->num_groups; ++g) {
+            size_t m = csv_group_find(&merged, part->keys[g]);
+            if (m == FSCL_CSV_NO_COLUMN) {
+                failed = 1;
+                break;
+            }
+            merged.groups.sums[m] += part->sums[g];
+            merged.groups.counts[m] += part->counts[g];
+            if (part->mins[g] < merged.groups.mins[m]) merged.groups.mins[m] = part->mins[g];
+            if (part->maxs[g] > merged.groups.maxs[m]) merged.groups.maxs[m] = part->maxs[g];
+        }
+        fscl_csv_groups_erase(part);
+        free(tasks[t].table.slots);
+    }
+
+    // Groups without numeric values report NaN extremes
+    for (size_t g = 0; g < merged.groups.num_groups; ++g) {
+        if (merged.groups.counts[g] == 0) {
+            merged.groups.mins[g] = (double)NAN;
+            merged.groups.maxs[g] = (double)NAN;
+        }
+    }
+
+    free(merged.slots);
+    free(tasks);
+    free(threads);
+
+    *groups = merged.groups;
+    if (failed) {
+        fscl_csv_groups_erase(groups);
+        return -1;
+    }
+    return 0;
+} // end of func
+
+// Function to free the aggregates of a group-by
+void  fscl_csv_groups_erase(ccsv_groups* groups) {
+    if (groups != NULL) {
+        free((void*)groups->keys);
+        free(groups->sums);
+        free(groups->mins);
+        free(groups->maxs);
+        free(groups->counts);
+        memset(groups, 0, sizeof(ccsv_groups));
+    }
+} // end of func
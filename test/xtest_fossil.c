@@ -15,6 +15,8 @@ Description:
 #include <fossil/xtest.h>   // basic test tools
 #include <fossil/xassert.h> // extra asserts
 
+#include <string.h>
+
 // Function to create ASTNode from generic DSL code
 ASTNode* create_dsl_from_code(const char* dslCode, NodeType rootType) {
 
@@ -206,6 +208,1155 @@ XTEST_CASE(test_parse_meson_build_system_dsl) {
     fscl_fossil_erase_node(ast);
 }
 
+XTEST_CASE(test_arena_owns_nodes_and_children) {
+    fossil_arena* arena = fscl_fossil_arena_create(256);
+    TEST_ASSERT_NOT_CNULLPTR(arena);
+
+    ASTNode* root = fscl_fossil_arena_create_node(arena, PLACEHOLDER_NODE, FOSSIL_PLACEHOLDER, ADD, NULL);
+    arena->root = root;
+
+    for (int i = 0; i < 100; ++i) {
+        char* name = fscl_fossil_arena_strndup(arena, "counter_value", 7);
+        ASTNode* child = fscl_fossil_arena_create_node(arena, VARIABLE, FOSSIL_INT, ADD, name);
+        fscl_fossil_add_child(root, child);
+    }
+
+    TEST_ASSERT_EQUAL_INT(100, root->num_children);
+    TEST_ASSERT_EQUAL_STRING("counter", root->children[99]->value);
+    TEST_ASSERT_TRUE(root->children[42]->arena == arena);
+
+    ASTNode* classNode = fscl_fossil_arena_create_node(arena, CLASS, FOSSIL_TOFU, ADD, "Person");
+    fscl_fossil_add_class_member(classNode, root->children[0], 1);
+    fscl_fossil_add_class_member(classNode, root->children[1], 0);
+    TEST_ASSERT_EQUAL_INT(1, classNode->num_public_members);
+    TEST_ASSERT_EQUAL_INT(1, classNode->num_private_members);
+
+    // Heap nodes added below arena nodes are freed with the arena
+    ASTNode* heap = fscl_fossil_create_node(UNARY_OP, FOSSIL_INT, NEGATION, "-");
+    fscl_fossil_add_child(heap, fscl_fossil_create_constant(FOSSIL_INT, "1"));
+    fscl_fossil_add_child(root->children[5], heap);
+    TEST_ASSERT_EQUAL_INT(1, (int)arena->num_adopted);
+
+    // Erasing a non-root arena node is a no-op, erasing the root frees everything
+    fscl_fossil_erase_node(root->children[3]);
+    fscl_fossil_erase_node(root);
+}
+
+XTEST_CASE(test_heap_node_children_grow) {
+    ASTNode* function = fscl_fossil_create_function(FOSSIL_INT, "main");
+    TEST_ASSERT_CNULLPTR(function->arena);
+
+    for (int i = 0; i < 33; ++i) {
+        fscl_fossil_add_child(function, fscl_fossil_create_constant(FOSSIL_INT, "1"));
+    }
+    TEST_ASSERT_EQUAL_INT(33, function->num_children);
+    TEST_ASSERT_EQUAL_INT(CONSTANT, function->children[32]->type);
+
+    fscl_fossil_erase_node(function);
+}
+
+XTEST_CASE(test_lex_tokens_and_positions) {
+    const char* code = "fossil main() -> int: # entry\n"
+                       "    x = 0x1F <= 2.5e3 && !done\n"
+                       "    print(\"a:b\")";
+    fossil_token_array tokens = {0};
+
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_lex(code, strlen(code), &tokens));
+    TEST_ASSERT_EQUAL_INT(FOSSIL_TOKEN_FUNCTION, tokens.tokens[0].kind);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_TOKEN_ARROW, tokens.tokens[4].kind);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_TOKEN_COLON, tokens.tokens[6].kind);
+
+    // "x" starts the second line, comments are dropped
+    TEST_ASSERT_EQUAL_INT(FOSSIL_TOKEN_IDENTIFIER, tokens.tokens[7].kind);
+    TEST_ASSERT_EQUAL_INT(2, tokens.tokens[7].line);
+    TEST_ASSERT_EQUAL_INT(5, tokens.tokens[7].column);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_TOKEN_INTEGER, tokens.tokens[9].kind);
+    TEST_ASSERT_EQUAL_INT(4, tokens.tokens[9].length);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_TOKEN_LESS_EQUAL, tokens.tokens[10].kind);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_TOKEN_FLOAT, tokens.tokens[11].kind);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_TOKEN_AND, tokens.tokens[12].kind);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_TOKEN_NOT, tokens.tokens[13].kind);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_TOKEN_STRING, tokens.tokens[17].kind);
+    TEST_ASSERT_EQUAL_INT(5, tokens.tokens[17].length);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_TOKEN_EOF, tokens.tokens[tokens.count - 1].kind);
+    TEST_ASSERT_EQUAL_INT(20, tokens.count);
+
+    fscl_fossil_token_array_erase(&tokens);
+}
+
+XTEST_CASE(test_data_type_from_span) {
+    const char* names = "uint64 string[] placeholder";
+    size_t index = 0;
+
+    TEST_ASSERT_EQUAL_INT(FOSSIL_UINT64, fscl_fossil_data_type_from_span(names, 6));
+    TEST_ASSERT_EQUAL_INT(FOSSIL_ERROR, fscl_fossil_data_type_from_span(names, 5));
+    TEST_ASSERT_EQUAL_INT(FOSSIL_STRING, fscl_fossil_data_type_from_span(names + 7, 6));
+    TEST_ASSERT_EQUAL_INT(FOSSIL_ERROR, fscl_fossil_data_type_from_span("void", 4));
+
+    TEST_ASSERT_EQUAL_INT(FOSSIL_UINT64, fscl_fossil_parse_data_type(names, &index));
+    TEST_ASSERT_EQUAL_INT(FOSSIL_STRING, fscl_fossil_parse_data_type(names, &index));
+    index += 2;
+    TEST_ASSERT_EQUAL_INT(FOSSIL_PLACEHOLDER, fscl_fossil_parse_data_type(names, &index));
+}
+
+XTEST_CASE(test_parse_dsl_file_program) {
+    ASTNode* ast = fscl_fossil_parse_dsl_file("program.fossil");
+
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+    TEST_ASSERT_EQUAL_INT(3, ast->num_children);
+
+    // order_pizza(size: string, toppings: string[]) -> int
+    ASTNode* pizza = ast->children[1];
+    TEST_ASSERT_EQUAL_INT(FUNCTION, pizza->type);
+    TEST_ASSERT_EQUAL_STRING("order_pizza", pizza->value);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_INT, pizza->data_type);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_STRING, pizza->children[0]->data_type);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_ARRAY, pizza->children[1]->data_type);
+
+    ASTNode* mainNode = ast->children[2];
+    TEST_ASSERT_EQUAL_STRING("main", mainNode->value);
+    TEST_ASSERT_EQUAL_INT(1, mainNode->num_children);
+
+    ASTNode* body = mainNode->children[0];
+    TEST_ASSERT_EQUAL_INT(BLOCK_STATEMENT, body->type);
+    TEST_ASSERT_EQUAL_INT(5, body->num_children);
+    TEST_ASSERT_EQUAL_INT(PRINT_STATEMENT_TYPE, body->children[0]->type);
+    TEST_ASSERT_EQUAL_STRING("Welcome to the Fossil DSL Demo Program", body->children[0]->children[0]->value);
+    TEST_ASSERT_EQUAL_INT(CALL_EXPRESSION, body->children[2]->type);
+    TEST_ASSERT_EQUAL_INT(ARRAY_LITERAL, body->children[2]->children[1]->type);
+    TEST_ASSERT_EQUAL_INT(3, body->children[2]->children[1]->num_children);
+    TEST_ASSERT_EQUAL_INT(RETURN_STATEMENT, body->children[4]->type);
+
+    fscl_fossil_erase_node(ast);
+}
+
+XTEST_CASE(test_parse_dsl_string_class_and_expressions) {
+    const char* code = "fossil class Person extends Base {\n"
+                       "    private string name;\n"
+                       "    public void set_name(string n) {\n"
+                       "        name = n;\n"
+                       "    }\n"
+                       "}\n"
+                       "fossil main() {\n"
+                       "    Person person;\n"
+                       "    if (1 + 2 * 3 > 6 && ready) { person.set_name(\"John\"); } else { return; }\n"
+                       "}";
+    ASTNode* ast = fscl_fossil_parse_dsl_string(code);
+
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+    TEST_ASSERT_EQUAL_INT(2, ast->num_children);
+
+    ASTNode* person = ast->children[0];
+    TEST_ASSERT_EQUAL_INT(CLASS, person->type);
+    TEST_ASSERT_EQUAL_INT(INHERITANCE, person->children[0]->type);
+    TEST_ASSERT_EQUAL_STRING("Base", person->children[0]->value);
+    TEST_ASSERT_EQUAL_INT(1, person->num_private_members);
+    TEST_ASSERT_EQUAL_INT(1, person->num_public_members);
+    TEST_ASSERT_EQUAL_STRING("set_name", person->public_members[0]->value);
+
+    // 1 + 2 * 3 > 6 && ready groups as ((1 + (2 * 3)) > 6) && ready
+    ASTNode* ifNode = ast->children[1]->children[0]->children[1];
+    TEST_ASSERT_EQUAL_INT(IF_STATEMENT, ifNode->type);
+    TEST_ASSERT_EQUAL_INT(3, ifNode->num_children);
+    ASTNode* condition = ifNode->children[0];
+    TEST_ASSERT_EQUAL_INT(LOGICAL_OP, condition->type);
+    TEST_ASSERT_EQUAL_INT(GREATER_THAN, condition->children[0]->operator_type);
+    TEST_ASSERT_EQUAL_INT(MULTIPLY, condition->children[0]->children[0]->children[1]->operator_type);
+    TEST_ASSERT_EQUAL_STRING("person.set_name", ifNode->children[1]->children[0]->value);
+
+    fscl_fossil_erase_node(ast);
+
+    // Errors carry no partial tree
+    TEST_ASSERT_CNULLPTR(fscl_fossil_parse_dsl_string("fossil main() { x = ; }"));
+    TEST_ASSERT_CNULLPTR(fscl_fossil_parse_dsl_string("banana split"));
+}
+
+XTEST_CASE(test_document_incremental_edit) {
+    fossil_document doc;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_document_load(&doc, "program.fossil"));
+    TEST_ASSERT_EQUAL_INT(3, doc.reparsed);
+
+    ASTNode* generic = doc.root->children[0];
+    ASTNode* pizza = doc.root->children[1];
+    ASTNode* mainNode = doc.root->children[2];
+
+    // Editing inside order_pizza reparses it alone
+    size_t offset = (size_t)(strstr(doc.code, "\"Toppings:\"") - doc.code);
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_document_edit(&doc, offset + 1, 8, "Extra toppings", 14));
+    TEST_ASSERT_EQUAL_INT(1, doc.reparsed);
+    TEST_ASSERT_EQUAL_PTR(generic, doc.root->children[0]);
+    TEST_ASSERT_EQUAL_PTR(mainNode, doc.root->children[2]);
+    TEST_ASSERT_NOT_EQUAL_PTR(pizza, doc.root->children[1]);
+    TEST_ASSERT_EQUAL_STRING("Extra toppings:", doc.root->children[1]->children[2]->children[1]->children[0]->value);
+    TEST_ASSERT_EQUAL_INT((int)(strstr(doc.code, "fossil main") - doc.code), (int)doc.spans[2].start);
+
+    // Appending a function reparses the last one and the new one
+    const char* extra = "\nfossil extra() -> int:\n    return 1:\n";
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_document_edit(&doc, doc.length, 0, extra, strlen(extra)));
+    TEST_ASSERT_EQUAL_INT(2, doc.reparsed);
+    TEST_ASSERT_EQUAL_INT(4, doc.root->num_children);
+    TEST_ASSERT_EQUAL_PTR(generic, doc.root->children[0]);
+    TEST_ASSERT_EQUAL_STRING("extra", doc.root->children[3]->value);
+
+    fscl_fossil_document_erase(&doc);
+    // A missing file fails without taking the process down
+    TEST_ASSERT_EQUAL_INT(-1, fscl_fossil_document_load(&doc, "missing.fossil"));
+    TEST_ASSERT_CNULLPTR(doc.root);
+    TEST_ASSERT_CNULLPTR(doc.code);
+    fscl_fossil_document_erase(&doc);
+}
+
+XTEST_CASE(test_document_edit_recovers_after_error) {
+    fossil_document doc;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_document_open(&doc, "fossil a() { return 1; }\n"
+                                                             "fossil b() { return 2; }\n"
+                                                             "fossil c() { return 3; }\n"));
+
+    // Dropping a closing brace breaks the text; putting it back parses again
+    TEST_ASSERT_EQUAL_INT(-1, fscl_fossil_document_edit(&doc, 23, 1, "", 0));
+    TEST_ASSERT_CNULLPTR(doc.root);
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_document_edit(&doc, 23, 0, "}", 1));
+    TEST_ASSERT_EQUAL_INT(3, doc.root->num_children);
+
+    // Renaming b only touches b
+    ASTNode* a = doc.root->children[0];
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_document_edit(&doc, 32, 1, "bee", 3));
+    TEST_ASSERT_EQUAL_INT(1, doc.reparsed);
+    TEST_ASSERT_EQUAL_PTR(a, doc.root->children[0]);
+    TEST_ASSERT_EQUAL_STRING("bee", doc.root->children[1]->value);
+    TEST_ASSERT_EQUAL_INT(52, (int)doc.spans[2].start);
+
+    fscl_fossil_document_erase(&doc);
+}
+
+// Count nodes and remember the deepest level reached
+static int count_flat_nodes(const fossil_flat_ast* flat, uint32_t index, uint32_t depth, void* user_data) {
+    uint32_t* stats = (uint32_t*)user_data;
+    stats[0]++;
+    if (depth > stats[1]) {
+        stats[1] = depth;
+    }
+    return 0;
+}
+
+XTEST_CASE(test_flat_ast_from_program) {
+    ASTNode* ast = fscl_fossil_parse_dsl_file("program.fossil");
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+
+    fossil_flat_ast flat;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_flat_from_ast(ast, &flat));
+    TEST_ASSERT_EQUAL_INT(PLACEHOLDER_NODE, flat.kinds[0]);
+    TEST_ASSERT_EQUAL_INT(3, fscl_fossil_flat_num_children(&flat, 0));
+
+    // Pre-order: the first function directly follows the root
+    uint32_t first = flat.first_child[0];
+    TEST_ASSERT_EQUAL_INT(1, first);
+    TEST_ASSERT_EQUAL_STRING("generic_function", fscl_fossil_flat_value(&flat, first));
+    uint32_t pizza = flat.next_sibling[first];
+    TEST_ASSERT_EQUAL_STRING("order_pizza", fscl_fossil_flat_value(&flat, pizza));
+    TEST_ASSERT_EQUAL_INT(FOSSIL_ARRAY, flat.types[flat.next_sibling[flat.first_child[pizza]]]);
+    TEST_ASSERT_CNULLPTR(fscl_fossil_flat_value(&flat, 0));
+
+    uint32_t stats[2] = {0, 0};
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_flat_visit(&flat, 0, count_flat_nodes, stats));
+    TEST_ASSERT_EQUAL_INT(flat.count, stats[0]);
+    TEST_ASSERT_EQUAL_INT(5, stats[1]);  // root > main > body > call > array > element
+
+    // Walking a subtree stays inside it
+    uint32_t sub[2] = {0, 0};
+    fscl_fossil_flat_visit(&flat, pizza, count_flat_nodes, sub);
+    TEST_ASSERT_EQUAL_INT(flat.next_sibling[pizza] - pizza, sub[0]);
+
+    uint32_t all[2] = {0, 0};
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_flat_for_each(&flat, count_flat_nodes, all));
+    TEST_ASSERT_EQUAL_INT(flat.count, all[0]);
+
+    fscl_fossil_flat_erase(&flat);
+    fscl_fossil_erase_node(ast);
+}
+
+XTEST_CASE(test_optimize_folds_and_prunes) {
+    const char* code = "fossil main() -> int {\n"
+                       "    int x = (2 + 3) * 4 - -1;\n"
+                       "    if 1 < 2 && !false { x = x + 1; } else { x = 0; }\n"
+                       "    while false { x = 99; }\n"
+                       "    if \"a\" == \"b\" { x = 7; }\n"
+                       "    return x;\n"
+                       "    x = 100;\n"
+                       "}";
+    ASTNode* ast = fscl_fossil_parse_dsl_string(code);
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+
+    TEST_ASSERT_TRUE(fscl_fossil_optimize(ast) > 0);
+
+    // Left: the declaration, the taken branch and the return
+    ASTNode* body = ast->children[0]->children[0];
+    TEST_ASSERT_EQUAL_INT(3, body->num_children);
+    ASTNode* init = body->children[0]->children[0];
+    TEST_ASSERT_EQUAL_INT(CONSTANT, init->type);
+    TEST_ASSERT_EQUAL_STRING("21", init->value);
+    TEST_ASSERT_EQUAL_INT(BLOCK_STATEMENT, body->children[1]->type);
+    TEST_ASSERT_EQUAL_INT(ASSIGNMENT, body->children[1]->children[0]->type);
+    TEST_ASSERT_EQUAL_INT(RETURN_STATEMENT, body->children[2]->type);
+
+    // Nothing is left to do
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_optimize(ast));
+
+    fossil_program program;
+    fossil_vm vm;
+    fossil_value result;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_compile(ast, &program));
+    fscl_fossil_vm_init(&vm, NULL);
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_vm_run(&vm, &program, "main", &result));
+    TEST_ASSERT_EQUAL_INT(22, (int)result.as.integer);
+
+    fscl_fossil_vm_erase(&vm);
+    fscl_fossil_program_erase(&program);
+    fscl_fossil_erase_node(ast);
+}
+
+XTEST_CASE(test_fold_heap_constants) {
+    ASTNode* root = fscl_fossil_create_node(PLACEHOLDER_NODE, FOSSIL_PLACEHOLDER, ADD, NULL);
+    ASTNode* sum = fscl_fossil_create_node(BINARY_OP, FOSSIL_TOFU, ADD, "+");
+    fscl_fossil_add_children(sum, 2, fscl_fossil_create_constant(FOSSIL_INT, "40"), fscl_fossil_create_constant(FOSSIL_FLOAT, "2.5"));
+    ASTNode* ratio = fscl_fossil_create_node(BINARY_OP, FOSSIL_TOFU, DIVIDE, "/");
+    fscl_fossil_add_children(ratio, 2, fscl_fossil_create_constant(FOSSIL_INT, "1"), fscl_fossil_create_constant(FOSSIL_INT, "0"));
+    ASTNode* check = fscl_fossil_create_relational_op(FOSSIL_BOOL, GREATER_EQUAL, ">=");
+    fscl_fossil_add_children(check, 2, fscl_fossil_create_constant(FOSSIL_HEX, "0x10"), fscl_fossil_create_constant(FOSSIL_INT, "16"));
+    ASTNode* infinity = fscl_fossil_create_node(BINARY_OP, FOSSIL_TOFU, DIVIDE, "/");
+    fscl_fossil_add_children(infinity, 2, fscl_fossil_create_constant(FOSSIL_FLOAT, "1.0"), fscl_fossil_create_constant(FOSSIL_FLOAT, "0.0"));
+    ASTNode* nan = fscl_fossil_create_node(BINARY_OP, FOSSIL_TOFU, DIVIDE, "/");
+    fscl_fossil_add_children(nan, 2, fscl_fossil_create_constant(FOSSIL_FLOAT, "0.0"), fscl_fossil_create_constant(FOSSIL_FLOAT, "0.0"));
+    fscl_fossil_add_children(root, 5, sum, ratio, check, infinity, nan);
+
+    // Division by zero is left for run time, for floats as well
+    TEST_ASSERT_EQUAL_INT(2, fscl_fossil_fold_constants(root));
+    TEST_ASSERT_EQUAL_STRING("42.5", root->children[0]->value);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_FLOAT, root->children[0]->data_type);
+    TEST_ASSERT_EQUAL_INT(BINARY_OP, root->children[1]->type);
+    TEST_ASSERT_EQUAL_STRING("true", root->children[2]->value);
+    TEST_ASSERT_EQUAL_INT(BINARY_OP, root->children[3]->type);
+    TEST_ASSERT_EQUAL_INT(BINARY_OP, root->children[4]->type);
+
+    fscl_fossil_erase_node(root);
+}
+
+// Read back everything a test wrote to a temporary file
+static void read_output(FILE* file, char* buffer, size_t size) {
+    rewind(file);
+    size_t length = fread(buffer, 1, size - 1, file);
+    buffer[length] = '\0';
+}
+
+XTEST_CASE(test_vm_runs_program_main) {
+    ASTNode* ast = fscl_fossil_parse_dsl_file("program.fossil");
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+
+    fossil_program program;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_compile(ast, &program));
+    TEST_ASSERT_EQUAL_INT(3, program.num_functions);
+    fscl_fossil_erase_node(ast);
+
+    FILE* output = tmpfile();
+    fossil_vm vm;
+    fossil_value result;
+    fscl_fossil_vm_init(&vm, output);
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_vm_run(&vm, &program, "main", &result));
+    TEST_ASSERT_EQUAL_INT(FOSSIL_VALUE_INT, result.kind);
+    TEST_ASSERT_EQUAL_INT(0, (int)result.as.integer);
+
+    char buffer[512];
+    read_output(output, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_STRING("Welcome to the Fossil DSL Demo Program\n"
+                             "Executing generic_function\n"
+                             "Ordering pizza with size: Large\n"
+                             "Toppings: [Pepperoni, Mushrooms, Extra Cheese]\n"
+                             "Program execution completed.\n", buffer);
+
+    fclose(output);
+    fscl_fossil_vm_erase(&vm);
+    fscl_fossil_program_erase(&program);
+}
+
+XTEST_CASE(test_vm_arithmetic_loops_and_recursion) {
+    const char* code = "fossil fib(int n) -> int {\n"
+                       "    if n < 2 { return n; }\n"
+                       "    return fib(n - 1) + fib(n - 2);\n"
+                       "}\n"
+                       "fossil scale(int x, int factor = 3) -> int { return x * factor; }\n"
+                       "fossil main() -> int {\n"
+                       "    int total = 0;\n"
+                       "    int i = 0;\n"
+                       "    while i < 10 { total = total + fib(i); i++; }\n"
+                       "    print(\"total\", total, 7 / 2, 7.0 / 2, \"a\" + 1, !false && i >= 10, 0x10 % 5);\n"
+                       "    return scale(total);\n"
+                       "}";
+    ASTNode* ast = fscl_fossil_parse_dsl_string(code);
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+
+    fossil_program program;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_compile(ast, &program));
+    fscl_fossil_erase_node(ast);
+
+    FILE* output = tmpfile();
+    fossil_vm vm;
+    fossil_value result;
+    fscl_fossil_vm_init(&vm, output);
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_vm_run(&vm, &program, "main", &result));
+    TEST_ASSERT_EQUAL_INT(264, (int)result.as.integer);
+
+    char buffer[128];
+    read_output(output, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_STRING("total 88 3 3.5 a1 true 1\n", buffer);
+
+    fclose(output);
+    fscl_fossil_vm_erase(&vm);
+    fscl_fossil_program_erase(&program);
+}
+
+XTEST_CASE(test_vm_reports_errors) {
+    fossil_program program;
+    ASTNode* ast = fscl_fossil_parse_dsl_string("fossil main() { return missing + 1; }");
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+    TEST_ASSERT_EQUAL_INT(-1, fscl_fossil_compile(ast, &program));
+    TEST_ASSERT_EQUAL_STRING("Undefined variable 'missing'", program.error);
+    fscl_fossil_erase_node(ast);
+
+    ast = fscl_fossil_parse_dsl_string("fossil main() { int zero = 0; return 1 / zero; }");
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_compile(ast, &program));
+    fscl_fossil_erase_node(ast);
+
+    fossil_vm vm;
+    fscl_fossil_vm_init(&vm, NULL);
+    TEST_ASSERT_EQUAL_INT(-1, fscl_fossil_vm_run(&vm, &program, "main", NULL));
+    TEST_ASSERT_EQUAL_STRING("Division by zero", vm.error);
+    TEST_ASSERT_EQUAL_INT(-1, fscl_fossil_vm_run(&vm, &program, "nothing", NULL));
+
+    fscl_fossil_vm_erase(&vm);
+    fscl_fossil_program_erase(&program);
+}
+
+static void write_text_file(const char* path, const char* text) {
+    FILE* file = fopen(path, "w");
+    if (file != NULL) {
+        fputs(text, file);
+        fclose(file);
+    }
+}
+
+XTEST_CASE(test_project_load_includes) {
+    write_text_file("project_main.fossil",
+                    "include \"project_util.fossil\";\n"
+                    "include \"sub/../project_shared.fossil\";\n"
+                    "link \"m\";\n"
+                    "fossil main() { return util(); }\n");
+    write_text_file("project_util.fossil",
+                    "include \"./project_shared.fossil\";\n"
+                    "include \"project_main.fossil\";\n"
+                    "link \"pthread\";\n"
+                    "fossil util() { return shared(); }\n");
+    write_text_file("project_shared.fossil",
+                    "link \"m\";\n"
+                    "fossil shared() { return 1; }\n");
+
+    fossil_project project;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_project_load(&project, "./project_main.fossil", 4));
+
+    // Each file is parsed once and declarations follow include order
+    TEST_ASSERT_EQUAL_INT(3, project.num_files);
+    TEST_ASSERT_EQUAL_STRING("project_main.fossil", project.files[0].path);
+    TEST_ASSERT_EQUAL_STRING("project_shared.fossil", project.files[2].path);
+    TEST_ASSERT_EQUAL_INT(3, project.root->num_children);
+    TEST_ASSERT_EQUAL_STRING("shared", project.root->children[0]->value);
+    TEST_ASSERT_EQUAL_STRING("util", project.root->children[1]->value);
+    TEST_ASSERT_EQUAL_STRING("main", project.root->children[2]->value);
+
+    TEST_ASSERT_EQUAL_INT(2, project.num_libraries);
+    TEST_ASSERT_EQUAL_STRING("m", project.libraries[0]);
+    TEST_ASSERT_EQUAL_STRING("pthread", project.libraries[1]);
+    fscl_fossil_project_erase(&project);
+
+    // Missing and broken files name the file at fault
+    write_text_file("project_shared.fossil", "fossil shared( {\n");
+    TEST_ASSERT_EQUAL_INT(-1, fscl_fossil_project_load(&project, "project_main.fossil", 2));
+    TEST_ASSERT_CNULLPTR(project.root);
+    TEST_ASSERT_TRUE(strncmp(project.error, "project_shared.fossil: ", 23) == 0);
+    TEST_ASSERT_EQUAL_INT(-1, fscl_fossil_project_load(&project, "project_missing.fossil", 1));
+    TEST_ASSERT_TRUE(strstr(project.error, "project_missing.fossil") != NULL);
+
+    remove("project_main.fossil");
+    remove("project_util.fossil");
+    remove("project_shared.fossil");
+}
+
+XTEST_CASE(test_serialize_round_trip_and_cache) {
+    const char* code = "fossil class Person extends Base {\n"
+                       "    private string name;\n"
+                       "    public void greet() { print(\"hi\"); }\n"
+                       "}\n"
+                       "fossil main() { x = 1 + 2; }\n";
+    ASTNode* ast = fscl_fossil_parse_dsl_string(code);
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+
+    uint64_t key = fscl_fossil_source_key(code, strlen(code));
+    unsigned char* data;
+    size_t size;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_serialize(ast, key, &data, &size));
+
+    // The copy matches the original down to the class member lists
+    ASTNode* copy = fscl_fossil_deserialize(data, size, key);
+    TEST_ASSERT_NOT_CNULLPTR(copy);
+    TEST_ASSERT_EQUAL_INT(ast->num_children, copy->num_children);
+    ASTNode* person = copy->children[0];
+    TEST_ASSERT_EQUAL_INT(CLASS, person->type);
+    TEST_ASSERT_EQUAL_STRING("Person", person->value);
+    TEST_ASSERT_EQUAL_INT(1, person->num_private_members);
+    TEST_ASSERT_EQUAL_INT(1, person->num_public_members);
+    TEST_ASSERT_EQUAL_STRING("greet", person->public_members[0]->value);
+    TEST_ASSERT_EQUAL_INT(ADD, copy->children[1]->children[0]->children[0]->children[0]->operator_type);
+    TEST_ASSERT_CNULLPTR(copy->arena->blocks->next);
+    fscl_fossil_erase_node(copy);
+
+    // Another key, a truncated blob or a new source key are all misses
+    TEST_ASSERT_CNULLPTR(fscl_fossil_deserialize(data, size, key + 1));
+    TEST_ASSERT_CNULLPTR(fscl_fossil_deserialize(data, size - 1, key));
+    TEST_ASSERT_TRUE(key != fscl_fossil_source_key(code, strlen(code) - 1));
+    free(data);
+    fscl_fossil_erase_node(ast);
+
+    // A cached file loads without being parsed again
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_set_cache_directory("."));
+    ASTNode* parsed = fscl_fossil_parse_dsl_file("program.fossil");
+    TEST_ASSERT_NOT_CNULLPTR(parsed);
+    char* program = fscl_fossil_read_dsl("program.fossil");
+    uint64_t program_key = fscl_fossil_source_key(program, strlen(program));
+    ASTNode* cached = fscl_fossil_cache_load(".", program_key);
+    TEST_ASSERT_NOT_CNULLPTR(cached);
+    TEST_ASSERT_EQUAL_INT(parsed->num_children, cached->num_children);
+    TEST_ASSERT_EQUAL_STRING("order_pizza", cached->children[1]->value);
+    fscl_fossil_erase_node(cached);
+    fscl_fossil_erase_node(parsed);
+
+    // Planting another tree under the key shows the cache is consulted first
+    ASTNode* other = fscl_fossil_parse_dsl_string("fossil other() { }");
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_cache_store(".", program_key, other));
+    fscl_fossil_erase_node(other);
+    ASTNode* loaded = fscl_fossil_parse_dsl_file("program.fossil");
+    TEST_ASSERT_NOT_CNULLPTR(loaded);
+    TEST_ASSERT_EQUAL_INT(1, loaded->num_children);
+    TEST_ASSERT_EQUAL_STRING("other", loaded->children[0]->value);
+    fscl_fossil_erase_node(loaded);
+
+    char path[64];
+    snprintf(path, sizeof(path), "./%016llx.fossilc", (unsigned long long)program_key);
+    remove(path);
+    free(program);
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_set_cache_directory(NULL));
+}
+
+XTEST_CASE(test_symbols_scopes_and_inheritance) {
+    const char* code = "fossil class Base {\n"
+                       "    private string name;\n"
+                       "    public greet() { print(name); }\n"
+                       "}\n"
+                       "fossil class Child extends Base {\n"
+                       "    int age;\n"
+                       "    age() { return 1; }\n"
+                       "}\n"
+                       "fossil main(int count) {\n"
+                       "    int total = 0;\n"
+                       "    while (total < count) { int step = 1; total = total + step; }\n"
+                       "    fresh = 2;\n"
+                       "    total;\n"
+                       "}\n"
+                       "fossil main() { }\n";
+    ASTNode* ast = fscl_fossil_parse_dsl_string(code);
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+
+    fossil_symbol_table table;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_symbols_build(ast, &table));
+
+    // Methods and fields resolve through the parent class
+    ASTNode* base = ast->children[0];
+    ASTNode* child = ast->children[1];
+    TEST_ASSERT_EQUAL_PTR(base, child->children[0]->parent_class);
+    fossil_symbol* greet = fscl_fossil_symbols_find_member(&table, "Child", "greet");
+    TEST_ASSERT_NOT_CNULLPTR(greet);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_SYMBOL_METHOD, greet->kind);
+    TEST_ASSERT_EQUAL_PTR(base->children[1], greet->node);
+    TEST_ASSERT_CNULLPTR(fscl_fossil_symbols_find_member(&table, "Base", "age"));
+    fossil_scope* greet_scope = fscl_fossil_symbols_scope(&table, base->children[1]);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_SYMBOL_FIELD, fscl_fossil_symbols_resolve(&table, greet_scope, "name")->kind);
+
+    // Parameters and locals share the function scope, nested blocks nest
+    ASTNode* mainNode = ast->children[2];
+    ASTNode* body = mainNode->children[1];
+    fossil_scope* scope = fscl_fossil_symbols_scope(&table, mainNode);
+    TEST_ASSERT_EQUAL_PTR(scope, fscl_fossil_symbols_scope(&table, body));
+    TEST_ASSERT_EQUAL_INT(FOSSIL_SYMBOL_PARAMETER, fscl_fossil_symbols_resolve(&table, scope, "count")->kind);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_SYMBOL_VARIABLE, fscl_fossil_symbols_resolve(&table, scope, "fresh")->kind);
+    TEST_ASSERT_CNULLPTR(fscl_fossil_symbols_resolve(&table, scope, "step"));
+    fossil_scope* loop = fscl_fossil_symbols_scope(&table, body->children[1]->children[1]);
+    TEST_ASSERT_NOT_CNULLPTR(loop);
+    fossil_symbol* step = fscl_fossil_symbols_resolve(&table, loop, "step");
+    TEST_ASSERT_NOT_CNULLPTR(step);
+    TEST_ASSERT_EQUAL_PTR(loop, step->scope);
+    TEST_ASSERT_EQUAL_PTR(body->children[0], fscl_fossil_symbols_resolve(&table, loop, "total")->node);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_SYMBOL_FUNCTION, fscl_fossil_symbols_resolve(&table, loop, "main")->kind);
+
+    // Names are interned
+    TEST_ASSERT_EQUAL_PTR(fscl_fossil_symbols_resolve(&table, NULL, "main")->name, fscl_fossil_symbols_resolve(&table, scope, "main")->name);
+
+    // Two mains, and a field and a method named alike, clash
+    TEST_ASSERT_EQUAL_INT(2, table.num_duplicates);
+    TEST_ASSERT_EQUAL_PTR(ast->children[3], table.duplicates[0].node);
+    TEST_ASSERT_EQUAL_PTR(mainNode, table.duplicates[0].previous);
+    TEST_ASSERT_EQUAL_PTR(child->children[2], table.duplicates[1].node);
+    TEST_ASSERT_EQUAL_PTR(child->children[1], table.duplicates[1].previous);
+
+    fscl_fossil_symbols_erase(&table);
+    fscl_fossil_erase_node(ast);
+}
+
+typedef struct {
+    char order[16];
+    size_t count;
+    size_t max_depth;
+    const char* stop_at;
+} visit_log;
+
+static int log_visit(ASTNode* node, size_t depth, void* user_data) {
+    visit_log* log = (visit_log*)user_data;
+    if (log->count + 1 < sizeof(log->order)) {
+        log->order[log->count] = node->value != NULL ? node->value[0] : '-';
+    }
+    log->count++;
+    if (depth > log->max_depth) {
+        log->max_depth = depth;
+    }
+    return log->stop_at != NULL && node->value != NULL && strcmp(node->value, log->stop_at) == 0 ? FOSSIL_VISIT_STOP : FOSSIL_VISIT_CONTINUE;
+}
+
+XTEST_CASE(test_visit_orders_and_deep_trees) {
+    // a(b(d, e), c(f))
+    ASTNode* a = fscl_fossil_create_node(BLOCK_STATEMENT, FOSSIL_TOFU, ADD, "a");
+    ASTNode* b = fscl_fossil_create_node(BLOCK_STATEMENT, FOSSIL_TOFU, ADD, "b");
+    ASTNode* c = fscl_fossil_create_node(BLOCK_STATEMENT, FOSSIL_TOFU, ADD, "c");
+    fscl_fossil_add_children(b, 2, fscl_fossil_create_node(CONSTANT, FOSSIL_INT, ADD, "d"), fscl_fossil_create_node(CONSTANT, FOSSIL_INT, ADD, "e"));
+    fscl_fossil_add_child(c, fscl_fossil_create_node(CONSTANT, FOSSIL_INT, ADD, "f"));
+    fscl_fossil_add_children(a, 2, b, c);
+
+    visit_log log = {{0}, 0, 0, NULL};
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_visit_preorder(a, log_visit, &log));
+    TEST_ASSERT_EQUAL_STRING("abdecf", log.order);
+    TEST_ASSERT_EQUAL_INT(2, log.max_depth);
+
+    memset(&log, 0, sizeof(log));
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_visit_postorder(a, log_visit, &log));
+    TEST_ASSERT_EQUAL_STRING("debfca", log.order);
+
+    memset(&log, 0, sizeof(log));
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_visit_level_order(a, log_visit, &log));
+    TEST_ASSERT_EQUAL_STRING("abcdef", log.order);
+
+    memset(&log, 0, sizeof(log));
+    log.stop_at = "c";
+    TEST_ASSERT_EQUAL_INT(1, fscl_fossil_visit_level_order(a, log_visit, &log));
+    TEST_ASSERT_EQUAL_STRING("abc", log.order);
+    fscl_fossil_erase_node(a);
+
+    // A chain far deeper than the C stack would take when recursing
+    const size_t levels = 1000000;
+    ASTNode* root = fscl_fossil_create_node(BLOCK_STATEMENT, FOSSIL_TOFU, ADD, "r");
+    ASTNode* tail = root;
+    for (size_t i = 0; i < levels; ++i) {
+        ASTNode* next = fscl_fossil_create_node(BLOCK_STATEMENT, FOSSIL_TOFU, ADD, "n");
+        fscl_fossil_add_child(tail, next);
+        tail = next;
+    }
+
+    // Parsed trees hang off heap nodes as arena roots
+    fscl_fossil_add_child(tail, fscl_fossil_parse_dsl_string("fossil main() { x = 1; }"));
+
+    memset(&log, 0, sizeof(log));
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_visit_postorder(root, log_visit, &log));
+    TEST_ASSERT_EQUAL_INT(levels + 1 + 5, log.count);
+    TEST_ASSERT_EQUAL_INT(levels + 5, log.max_depth);
+    fscl_fossil_erase_node(root);
+}
+
+XTEST_CASE(test_dump_ast_formats) {
+    ASTNode* ast = fscl_fossil_parse_dsl_string("fossil f(int a) { return a + \"q\\\"\"; }");
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+
+    size_t length;
+    char* text = fscl_fossil_dump_ast(ast->children[0]->children[1], FOSSIL_DUMP_TEXT, &length);
+    TEST_ASSERT_NOT_CNULLPTR(text);
+    TEST_ASSERT_EQUAL_STRING("Type: BLOCK_STATEMENT, Data Type: tofu, Operator Type: ADD, Value: (null)\n"
+                             "  Type: RETURN_STATEMENT, Data Type: tofu, Operator Type: ADD, Value: (null)\n"
+                             "    Type: BINARY_OP, Data Type: tofu, Operator Type: ADD, Value: +\n"
+                             "      Type: VARIABLE, Data Type: tofu, Operator Type: ADD, Value: a\n"
+                             "      Type: CONSTANT, Data Type: string, Operator Type: ADD, Value: q\\\"\n", text);
+    TEST_ASSERT_EQUAL_INT((int)strlen(text), (int)length);
+    free(text);
+
+    char* json = fscl_fossil_dump_ast(ast->children[0], FOSSIL_DUMP_JSON, NULL);
+    TEST_ASSERT_NOT_CNULLPTR(json);
+    TEST_ASSERT_EQUAL_STRING("{\"type\":\"FUNCTION\",\"data_type\":\"tofu\",\"value\":\"f\",\"children\":["
+                             "{\"type\":\"VARIABLE\",\"data_type\":\"int\",\"value\":\"a\",\"children\":[]},"
+                             "{\"type\":\"BLOCK_STATEMENT\",\"data_type\":\"tofu\",\"value\":null,\"children\":["
+                             "{\"type\":\"RETURN_STATEMENT\",\"data_type\":\"tofu\",\"value\":null,\"children\":["
+                             "{\"type\":\"BINARY_OP\",\"data_type\":\"tofu\",\"operator\":\"ADD\",\"value\":\"+\",\"children\":["
+                             "{\"type\":\"VARIABLE\",\"data_type\":\"tofu\",\"value\":\"a\",\"children\":[]},"
+                             "{\"type\":\"CONSTANT\",\"data_type\":\"string\",\"value\":\"q\\\\\\\"\",\"children\":[]}]}]}]}]}\n", json);
+    free(json);
+
+    char* sexpr = fscl_fossil_dump_ast(ast->children[0], FOSSIL_DUMP_SEXPR, NULL);
+    TEST_ASSERT_NOT_CNULLPTR(sexpr);
+    TEST_ASSERT_EQUAL_STRING("(FUNCTION tofu \"f\" (VARIABLE int \"a\") (BLOCK_STATEMENT tofu (RETURN_STATEMENT tofu "
+                             "(BINARY_OP tofu ADD \"+\" (VARIABLE tofu \"a\") (CONSTANT string \"q\\\\\\\"\")))))\n", sexpr);
+    free(sexpr);
+
+    // Writing to a file produces the same bytes
+    FILE* file = tmpfile();
+    TEST_ASSERT_NOT_CNULLPTR(file);
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_write_ast(ast, FOSSIL_DUMP_SEXPR, file));
+    TEST_ASSERT_TRUE(ftell(file) > 0);
+    fclose(file);
+
+    TEST_ASSERT_EQUAL_STRING("CALL_EXPRESSION", fscl_fossil_node_type_name(CALL_EXPRESSION));
+    TEST_ASSERT_EQUAL_STRING("GREATER_EQUAL", fscl_fossil_operator_name(GREATER_EQUAL));
+    for (int type = FOSSIL_INT; type < FOSSIL_ERROR; ++type) {
+        const char* name = fscl_fossil_data_type_name((DataType)type);
+        TEST_ASSERT_EQUAL_INT(type, fscl_fossil_data_type_from_span(name, strlen(name)));
+    }
+
+    fscl_fossil_erase_node(ast);
+}
+
+XTEST_CASE(test_generate_c_program) {
+    const char* code = "fossil class Base {\n"
+                       "    public int id = 7;\n"
+                       "    private int secret;\n"
+                       "    public int get_id() { return id; }\n"
+                       "}\n"
+                       "fossil class Person extends Base {\n"
+                       "    private string name = \"Jo\";\n"
+                       "    private void rename(string n) { name = n; }\n"
+                       "    public int twice() { rename(\"Al\"); return get_id() * 2 + id; }\n"
+                       "}\n"
+                       "fossil scale(int x, int factor = 3) -> int { return x * factor; }\n"
+                       "fossil main() -> int {\n"
+                       "    int i = 0;\n"
+                       "    while i < 3 && true { i++; }\n"
+                       "    print(\"i\", i);\n"
+                       "    return scale(i);\n"
+                       "}";
+    ASTNode* ast = fscl_fossil_parse_dsl_string(code);
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+
+    char error[128];
+    size_t length = 0;
+    char* c = fscl_fossil_generate_c(ast, &length, error, sizeof(error));
+    TEST_ASSERT_NOT_CNULLPTR(c);
+    TEST_ASSERT_EQUAL_INT((int)strlen(c), (int)length);
+
+    // Parents come before the classes that embed them
+    const char* base = strstr(c, "struct fsl_Base {");
+    const char* person = strstr(c, "struct fsl_Person {\n    struct fsl_Base base;\n    fossil_value v_name;");
+    TEST_ASSERT_NOT_CNULLPTR(base);
+    TEST_ASSERT_NOT_CNULLPTR(person);
+    TEST_ASSERT_TRUE(base < person);
+
+    // Private methods are static, members of the parent go through base
+    TEST_ASSERT_NOT_CNULLPTR(strstr(c, "\nstatic fossil_value fsl_Person__rename(struct fsl_Person* self, fossil_value v_n);"));
+    TEST_ASSERT_NOT_CNULLPTR(strstr(c, "\nfossil_value fsl_Person__twice(struct fsl_Person* self);"));
+    TEST_ASSERT_NOT_CNULLPTR(strstr(c, "fsl_Person__rename(self, rt_string(\"Al\"));"));
+    TEST_ASSERT_NOT_CNULLPTR(strstr(c, "fsl_Base__get_id(&self->base)"));
+    TEST_ASSERT_NOT_CNULLPTR(strstr(c, "self->base.v_id"));
+    TEST_ASSERT_NOT_CNULLPTR(strstr(c, "fsl_init_Base(&self->base);"));
+
+    // Locals, defaults, short circuits and the entry point
+    TEST_ASSERT_NOT_CNULLPTR(strstr(c, "fossil_value v_i = rt_int(INT64_C(0));"));
+    TEST_ASSERT_NOT_CNULLPTR(strstr(c, "return fsl_scale(v_i, rt_int(INT64_C(3)));"));
+    TEST_ASSERT_NOT_CNULLPTR(strstr(c, "rt_truthy(rt_t[0]) ? rt_bool(1) : rt_t[0]"));
+    TEST_ASSERT_NOT_CNULLPTR(strstr(c, "int main(void) {\n    fossil_value result = fsl_main();"));
+    free(c);
+    fscl_fossil_erase_node(ast);
+
+    // Private members of a parent class are not reachable
+    ast = fscl_fossil_parse_dsl_string("fossil class A { private int s; }\n"
+                                       "fossil class B extends A { public int f() { return s; } }");
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+    TEST_ASSERT_CNULLPTR(fscl_fossil_generate_c(ast, NULL, error, sizeof(error)));
+    TEST_ASSERT_EQUAL_STRING("Member 's' is private to a parent class", error);
+    fscl_fossil_erase_node(ast);
+
+    // Constants without a literal, such as NaN and infinities, keep their value
+    ast = fscl_fossil_parse_dsl_string("fossil main() { print(1.5, 2.5, 3.5); }");
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+    ASTNode* print = ast->children[0]->children[0]->children[0];
+    print->children[0]->value = (char*)"nan";
+    print->children[1]->value = (char*)"inf";
+    print->children[2]->value = (char*)"-inf";
+    c = fscl_fossil_generate_c(ast, NULL, error, sizeof(error));
+    TEST_ASSERT_NOT_CNULLPTR(c);
+    TEST_ASSERT_NOT_CNULLPTR(strstr(c, "rt_float(NAN), rt_float(HUGE_VAL), rt_float(-HUGE_VAL)"));
+    free(c);
+    fscl_fossil_erase_node(ast);
+
+    ast = fscl_fossil_parse_dsl_string("fossil main() { print(x); int x = 1; }");
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+    TEST_ASSERT_CNULLPTR(fscl_fossil_generate_c(ast, NULL, error, sizeof(error)));
+    TEST_ASSERT_EQUAL_STRING("Undefined variable 'x'", error);
+    fscl_fossil_erase_node(ast);
+}
+
+XTEST_CASE(test_check_types_annotates_and_collects) {
+    const char* code = "fossil twice(int n) -> int { return n * 2; }\n"
+                       "fossil label() -> string { return 1; }\n"
+                       "fossil main() -> int {\n"
+                       "    total = twice(3) + 1;\n"
+                       "    string name = \"a\" + total;\n"
+                       "    float ratio = total / 2.0;\n"
+                       "    bool ok = ratio > 1 && true;\n"
+                       "    int bad = \"x\";\n"
+                       "    total = \"y\";\n"
+                       "    print(twice(\"z\"), missing, ok + 1);\n"
+                       "    return 1.5 % 2;\n"
+                       "}";
+    ASTNode* ast = fscl_fossil_parse_dsl_string(code);
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+
+    fossil_diagnostics diagnostics = {NULL, 0, 0};
+    TEST_ASSERT_EQUAL_INT(7, fscl_fossil_check_types(ast, &diagnostics));
+    TEST_ASSERT_EQUAL_INT(7, (int)diagnostics.count);
+    TEST_ASSERT_EQUAL_STRING("'label' must return string, not int", diagnostics.items[0].message);
+    TEST_ASSERT_EQUAL_STRING("Cannot initialize int 'bad' with string", diagnostics.items[1].message);
+    TEST_ASSERT_EQUAL_STRING("Cannot assign string to int 'total'", diagnostics.items[2].message);
+    TEST_ASSERT_EQUAL_STRING("Argument 1 of 'twice' must be int, not string", diagnostics.items[3].message);
+    TEST_ASSERT_EQUAL_STRING("Undefined variable 'missing'", diagnostics.items[4].message);
+    TEST_ASSERT_EQUAL_STRING("Cannot apply '+' to bool and int", diagnostics.items[5].message);
+    TEST_ASSERT_EQUAL_STRING("Operator '%' requires integers, not float and int", diagnostics.items[6].message);
+
+    // Every expression carries its inferred type
+    ASTNode* body = ast->children[2]->children[0];
+    TEST_ASSERT_EQUAL_INT(FOSSIL_INT, body->children[0]->data_type);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_INT, body->children[0]->children[0]->children[0]->data_type);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_STRING, body->children[1]->children[0]->data_type);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_INT, body->children[1]->children[0]->children[1]->data_type);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_FLOAT, body->children[2]->children[0]->data_type);
+    TEST_ASSERT_EQUAL_INT(FOSSIL_BOOL, body->children[3]->children[0]->data_type);
+    TEST_ASSERT_EQUAL_PTR(body->children[6]->children[1], diagnostics.items[4].node);
+    fscl_fossil_diagnostics_erase(&diagnostics);
+    fscl_fossil_erase_node(ast);
+
+    // The demo program and dynamic values check cleanly
+    ast = fscl_fossil_parse_dsl_file("program.fossil");
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_check_types(ast, &diagnostics));
+    TEST_ASSERT_EQUAL_INT(0, (int)diagnostics.count);
+    fscl_fossil_erase_node(ast);
+
+    ast = fscl_fossil_parse_dsl_string("fossil f(tofu x) -> int { int y = x + 1; string s = x + \"!\"; return x; }");
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_check_types(ast, &diagnostics));
+    fscl_fossil_diagnostics_erase(&diagnostics);
+    fscl_fossil_erase_node(ast);
+}
+
+XTEST_CASE(test_parse_dsl_recover_reports_every_error) {
+    const char* code = "fossil main() {\n"
+                       "    x = ;\n"
+                       "    print(1)\n"
+                       "    if (x > ) {\n"
+                       "        print(3)\n"
+                       "    }\n"
+                       "    print(2)\n"
+                       "}\n"
+                       "bogus thing\n"
+                       "fossil other():\n"
+                       "    z = 1 +\n"
+                       "    return z\n"
+                       "fossil fine() { return 2; }";
+    fossil_diagnostics diagnostics = {NULL, 0, 0};
+    ASTNode* ast = fscl_fossil_parse_dsl_recover(code, &diagnostics);
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+
+    // One error per broken statement or declaration, with its span
+    TEST_ASSERT_EQUAL_INT(4, (int)diagnostics.count);
+    TEST_ASSERT_EQUAL_STRING("Expected an expression", diagnostics.items[0].message);
+    TEST_ASSERT_EQUAL_INT(2, (int)diagnostics.items[0].line);
+    TEST_ASSERT_EQUAL_INT(9, (int)diagnostics.items[0].column);
+    TEST_ASSERT_EQUAL_INT(10, (int)diagnostics.items[0].end_column);
+    TEST_ASSERT_EQUAL_INT(4, (int)diagnostics.items[1].line);
+    TEST_ASSERT_EQUAL_STRING("Unknown keyword encountered during parsing", diagnostics.items[2].message);
+    TEST_ASSERT_EQUAL_INT(9, (int)diagnostics.items[2].line);
+    TEST_ASSERT_EQUAL_INT(1, (int)diagnostics.items[2].column);
+    TEST_ASSERT_EQUAL_INT(6, (int)diagnostics.items[2].end_column);
+    TEST_ASSERT_EQUAL_INT(12, (int)diagnostics.items[3].line);
+    TEST_ASSERT_EQUAL_INT(5, (int)diagnostics.items[3].column);
+
+    // Everything around the errors is still in the tree
+    TEST_ASSERT_EQUAL_INT(3, (int)ast->num_children);
+    TEST_ASSERT_EQUAL_STRING("main", ast->children[0]->value);
+    TEST_ASSERT_EQUAL_INT(2, (int)ast->children[0]->children[0]->num_children);
+    TEST_ASSERT_EQUAL_STRING("other", ast->children[1]->value);
+    TEST_ASSERT_EQUAL_INT(1, (int)ast->children[1]->children[0]->num_children);
+    TEST_ASSERT_EQUAL_STRING("fine", ast->children[2]->value);
+    fscl_fossil_erase_node(ast);
+    fscl_fossil_diagnostics_erase(&diagnostics);
+
+    // A missing closing brace is reported once, not once per open body
+    ast = fscl_fossil_parse_dsl_recover("fossil f() { if (true) { print(1)", &diagnostics);
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+    TEST_ASSERT_EQUAL_INT(1, (int)diagnostics.count);
+    TEST_ASSERT_EQUAL_STRING("Missing closing brace", diagnostics.items[0].message);
+    fscl_fossil_erase_node(ast);
+    fscl_fossil_diagnostics_erase(&diagnostics);
+}
+
+XTEST_CASE(test_parse_with_parser_ctx) {
+    // Each context has its own keywords, the globals are left as they are
+    fossil_parser_ctx plain;
+    fossil_parser_ctx custom;
+    fscl_fossil_parser_ctx_init(&plain);
+    fscl_fossil_parser_ctx_init(&custom);
+    custom.open_brace = '@';
+    custom.close_brace = '$';
+    custom.function_keyword = "fn";
+
+    const char* code = "fn main() @ return 1; $";
+    ASTNode* ast = fscl_fossil_parser_ctx_parse(&custom, code, strlen(code));
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+    TEST_ASSERT_EQUAL_INT(NO_ERRORS, custom.error);
+    TEST_ASSERT_EQUAL_PTR(ast->arena, custom.arena);
+    TEST_ASSERT_EQUAL_STRING("main", ast->children[0]->value);
+    fscl_fossil_erase_node(ast);
+
+    TEST_ASSERT_CNULLPTR(fscl_fossil_parser_ctx_parse(&plain, code, strlen(code)));
+    TEST_ASSERT_EQUAL_INT(UNKNOWN_KEYWORD_ERROR, plain.error);
+    TEST_ASSERT_EQUAL_STRING("Unknown keyword encountered during parsing at line 1, column 1", plain.message);
+    TEST_ASSERT_EQUAL_INT('{', OPEN_BRACE_KEYWORD);
+    TEST_ASSERT_EQUAL_STRING("fossil", FUNCTION_KEYWORD);
+
+    // The token buffer is reused and the outcome reset on the next parse
+    ast = fscl_fossil_parser_ctx_parse_file(&plain, "program.fossil");
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+    TEST_ASSERT_EQUAL_INT(NO_ERRORS, plain.error);
+    TEST_ASSERT_EQUAL_STRING("", plain.message);
+    TEST_ASSERT_TRUE(plain.tokens.capacity > 0);
+    fscl_fossil_erase_node(ast);
+
+    TEST_ASSERT_CNULLPTR(fscl_fossil_parser_ctx_parse_file(&plain, "missing.fossil"));
+    TEST_ASSERT_EQUAL_STRING("Cannot read 'missing.fossil'", plain.message);
+
+    fscl_fossil_parser_ctx_erase(&plain);
+    fscl_fossil_parser_ctx_erase(&custom);
+}
+
+XTEST_CASE(test_expr_compile_and_eval) {
+    ASTNode* ast = fscl_fossil_parse_statement("return (age >= 18 && !banned) || name == \"root\" && -age < 0 - limit * 2;");
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+
+    fossil_expr expr;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_expr_compile(ast->children[0], &expr));
+    TEST_ASSERT_EQUAL_INT(4, (int)expr.num_names);
+    int age = fscl_fossil_expr_slot(&expr, "age");
+    int banned = fscl_fossil_expr_slot(&expr, "banned");
+    int name = fscl_fossil_expr_slot(&expr, "name");
+    int limit = fscl_fossil_expr_slot(&expr, "limit");
+    TEST_ASSERT_EQUAL_INT(-1, fscl_fossil_expr_slot(&expr, "missing"));
+
+    fossil_vm vm;
+    fscl_fossil_vm_init(&vm, NULL);
+    fossil_value env[4];
+    fossil_value result;
+
+    // Evaluate the same code against changing environments
+    env[age].kind = FOSSIL_VALUE_INT;
+    env[banned].kind = FOSSIL_VALUE_BOOL;
+    env[banned].as.boolean = 0;
+    env[name].kind = FOSSIL_VALUE_STRING;
+    env[name].as.string = "guest";
+    env[limit].kind = FOSSIL_VALUE_INT;
+    env[limit].as.integer = 10;
+
+    env[age].as.integer = 30;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_expr_eval(&expr, &vm, env, &result));
+    TEST_ASSERT_EQUAL_INT(FOSSIL_VALUE_BOOL, result.kind);
+    TEST_ASSERT_TRUE(result.as.boolean);
+
+    env[age].as.integer = 12;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_expr_eval(&expr, &vm, env, &result));
+    TEST_ASSERT_TRUE(!result.as.boolean);
+
+    // The right side of || decides: -25 < -20
+    env[name].as.string = "root";
+    env[age].as.integer = 25;
+    env[banned].as.boolean = 1;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_expr_eval(&expr, &vm, env, &result));
+    TEST_ASSERT_TRUE(result.as.boolean);
+
+    // Floats and runtime errors follow the machine
+    env[age].kind = FOSSIL_VALUE_FLOAT;
+    env[age].as.number = 17.5;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_expr_eval(&expr, &vm, env, &result));
+    TEST_ASSERT_TRUE(!result.as.boolean);
+    env[age].kind = FOSSIL_VALUE_STRING;
+    env[age].as.string = "old";
+    TEST_ASSERT_EQUAL_INT(-1, fscl_fossil_expr_eval(&expr, &vm, env, &result));
+    TEST_ASSERT_EQUAL_STRING("Invalid operands for comparison", vm.error);
+    fscl_fossil_expr_erase(&expr);
+    fscl_fossil_erase_node(ast);
+
+    // Calls are not expressions of this form
+    ast = fscl_fossil_parse_statement("return f(1) > 0;");
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+    TEST_ASSERT_EQUAL_INT(-1, fscl_fossil_expr_compile(ast->children[0], &expr));
+    TEST_ASSERT_EQUAL_STRING("Unsupported expression", expr.error);
+    fscl_fossil_expr_erase(&expr);
+    fscl_fossil_erase_node(ast);
+    fscl_fossil_vm_erase(&vm);
+}
+
+XTEST_CASE(test_share_subtrees_of_repeated_expressions) {
+    const char* code = "fossil main() -> int {\n"
+                       "    a = 2;\n"
+                       "    b = a * 3 + 1;\n"
+                       "    c = a * 3 + 1;\n"
+                       "    if (a * 3 + 1 > 5) { c = c + b; }\n"
+                       "    return c;\n"
+                       "}";
+    ASTNode* ast = fscl_fossil_parse_dsl_string(code);
+    ASTNode* copy = fscl_fossil_parse_dsl_string(code);
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+    TEST_ASSERT_NOT_CNULLPTR(copy);
+
+    // Structure, not addresses, decides hash and equality
+    TEST_ASSERT_TRUE(fscl_fossil_node_hash(ast) == fscl_fossil_node_hash(copy));
+    TEST_ASSERT_TRUE(fscl_fossil_node_equal(ast, copy));
+    ASTNode* body = ast->children[0]->children[0];
+    TEST_ASSERT_TRUE(fscl_fossil_node_equal(body->children[1]->children[0], body->children[2]->children[0]));
+    TEST_ASSERT_TRUE(!fscl_fossil_node_equal(body->children[0], body->children[1]));
+    TEST_ASSERT_TRUE(fscl_fossil_node_hash(body->children[0]) != fscl_fossil_node_hash(body->children[1]));
+
+    // Repeated expressions become one node, statements stay apart
+    TEST_ASSERT_TRUE(fscl_fossil_share_subtrees(ast) > 0);
+    TEST_ASSERT_EQUAL_INT(0, (int)fscl_fossil_share_subtrees(ast));
+    TEST_ASSERT_NOT_EQUAL_PTR(body->children[1], body->children[2]);
+    TEST_ASSERT_EQUAL_PTR(body->children[1]->children[0], body->children[2]->children[0]);
+    TEST_ASSERT_EQUAL_PTR(body->children[1]->children[0], body->children[3]->children[0]->children[0]);
+    TEST_ASSERT_TRUE(fscl_fossil_node_equal(ast, copy));
+
+    // The shared tree still means the same program
+    fossil_program program;
+    fossil_vm vm;
+    fossil_value result;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_compile(ast, &program));
+    fscl_fossil_vm_init(&vm, NULL);
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_vm_run(&vm, &program, "main", &result));
+    TEST_ASSERT_EQUAL_INT(14, (int)result.as.integer);
+    fscl_fossil_vm_erase(&vm);
+    fscl_fossil_program_erase(&program);
+
+    // Heap trees are never shared
+    ASTNode* heap = fscl_fossil_create_node(BINARY_OP, FOSSIL_INT, ADD, "+");
+    fscl_fossil_add_children(heap, 2, fscl_fossil_create_constant(FOSSIL_INT, "1"), fscl_fossil_create_constant(FOSSIL_INT, "1"));
+    TEST_ASSERT_EQUAL_INT(0, (int)fscl_fossil_share_subtrees(heap));
+    TEST_ASSERT_NOT_EQUAL_PTR(heap->children[0], heap->children[1]);
+    fscl_fossil_erase_node(heap);
+
+    fscl_fossil_erase_node(copy);
+    fscl_fossil_erase_node(ast);
+}
+
+XTEST_CASE(test_source_offsets_and_line_table) {
+    const char* code = "fossil main() -> int {\n"
+                       "    total = 1 + 2;\n"
+                       "    print(missing);\n"
+                       "    return total;\n"
+                       "}";
+    ASTNode* ast = fscl_fossil_parse_dsl_string(code);
+    TEST_ASSERT_NOT_CNULLPTR(ast);
+
+    // Nodes point at their name, keyword or operator
+    ASTNode* mainNode = ast->children[0];
+    ASTNode* body = mainNode->children[0];
+    ASTNode* sum = body->children[0]->children[0];
+    TEST_ASSERT_EQUAL_INT((int)(strstr(code, "main") - code), (int)mainNode->source_offset);
+    TEST_ASSERT_EQUAL_INT((int)(strchr(code, '{') - code), (int)body->source_offset);
+    TEST_ASSERT_EQUAL_INT((int)(strstr(code, "total") - code), (int)body->children[0]->source_offset);
+    TEST_ASSERT_EQUAL_INT((int)(strchr(code, '+') - code), (int)sum->source_offset);
+    TEST_ASSERT_EQUAL_INT((int)(strstr(code, "return") - code), (int)body->children[2]->source_offset);
+
+    fossil_line_table table;
+    uint32_t line;
+    uint32_t column;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_line_table_build(code, strlen(code), &table));
+    TEST_ASSERT_EQUAL_INT(5, (int)table.count);
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_line_table_locate(&table, sum->source_offset, &line, &column));
+    TEST_ASSERT_EQUAL_INT(2, (int)line);
+    TEST_ASSERT_EQUAL_INT(15, (int)column);
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_line_table_locate(&table, (uint32_t)strlen(code) - 1, &line, &column));
+    TEST_ASSERT_EQUAL_INT(5, (int)line);
+    TEST_ASSERT_EQUAL_INT(1, (int)column);
+    TEST_ASSERT_EQUAL_INT(-1, fscl_fossil_line_table_locate(&table, FOSSIL_NO_SOURCE_OFFSET, &line, &column));
+    TEST_ASSERT_EQUAL_INT(-1, fscl_fossil_line_table_locate(&table, (uint32_t)strlen(code) + 1, &line, &column));
+
+    // Checker diagnostics get their position from the node
+    fossil_diagnostics diagnostics = {NULL, 0, 0};
+    TEST_ASSERT_TRUE(fscl_fossil_check_types(ast, &diagnostics) > 0);
+    TEST_ASSERT_EQUAL_STRING("Undefined variable 'missing'", diagnostics.items[0].message);
+    TEST_ASSERT_EQUAL_INT((int)diagnostics.count, (int)fscl_fossil_diagnostics_locate(&diagnostics, &table));
+    TEST_ASSERT_EQUAL_INT(3, (int)diagnostics.items[0].line);
+    TEST_ASSERT_EQUAL_INT(11, (int)diagnostics.items[0].column);
+    fscl_fossil_diagnostics_erase(&diagnostics);
+    fscl_fossil_line_table_erase(&table);
+
+    // Offsets survive serialization
+    unsigned char* data;
+    size_t size;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_serialize(ast, 1, &data, &size));
+    ASTNode* copy = fscl_fossil_deserialize(data, size, 1);
+    TEST_ASSERT_NOT_CNULLPTR(copy);
+    TEST_ASSERT_EQUAL_INT((int)sum->source_offset, (int)copy->children[0]->children[0]->children[0]->children[0]->source_offset);
+    fscl_fossil_erase_node(copy);
+    free(data);
+    fscl_fossil_erase_node(ast);
+
+    // Declarations parsed at an index are placed in the whole code
+    const char* pair = "fossil a() { return 1; }\nfossil b() { y = 1; return y + 2; }\n";
+    size_t index = 25;
+    ASTNode* second = fscl_fossil_parse_function_declaration(pair, &index, "main");
+    TEST_ASSERT_NOT_CNULLPTR(second);
+    TEST_ASSERT_EQUAL_INT(32, (int)second->source_offset);
+    TEST_ASSERT_EQUAL_INT((int)(strchr(pair, 'y') - pair), (int)second->children[0]->children[0]->source_offset);
+    TEST_ASSERT_EQUAL_INT((int)(strchr(pair, '+') - pair), (int)second->children[0]->children[1]->children[0]->source_offset);
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_line_table_build(pair, strlen(pair), &table));
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_line_table_locate(&table, second->source_offset, &line, &column));
+    TEST_ASSERT_EQUAL_INT(2, (int)line);
+    TEST_ASSERT_EQUAL_INT(8, (int)column);
+    fscl_fossil_line_table_erase(&table);
+    fscl_fossil_erase_node(second);
+
+    // Built nodes have no offset
+    ASTNode* built = fscl_fossil_create_node(CONSTANT, FOSSIL_INT, ADD, "1");
+    TEST_ASSERT_TRUE(built->source_offset == FOSSIL_NO_SOURCE_OFFSET);
+    fscl_fossil_erase_node(built);
+
+    // Document offsets are relative to their declaration, so reused ones stay valid
+    fossil_document doc;
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_document_open(&doc, "fossil a() { return 1; }\n"
+                                                             "fossil b() { return 2; }\n"));
+    ASTNode* b = doc.root->children[1];
+    TEST_ASSERT_EQUAL_INT(7, (int)b->source_offset);
+    TEST_ASSERT_EQUAL_INT(0, fscl_fossil_document_edit(&doc, 20, 1, "100", 3));
+    TEST_ASSERT_EQUAL_PTR(b, doc.root->children[1]);
+    TEST_ASSERT_EQUAL_INT((int)(strstr(doc.code, "b()") - doc.code), (int)(doc.spans[1].start + b->source_offset));
+    TEST_ASSERT_EQUAL_INT((int)(strstr(doc.code, "2;") - doc.code), (int)(doc.spans[1].start + b->children[0]->children[0]->children[0]->source_offset));
+    fscl_fossil_document_erase(&doc);
+}
 
 //
 // XUNIT-TEST RUNNER
@@ -218,4 +1369,30 @@ XTEST_DEFINE_POOL(test_fossil_group) {
     XTEST_RUN_UNIT(test_parse_using_library);
     XTEST_RUN_UNIT(test_parse_tape_language_dsl);
     XTEST_RUN_UNIT(test_parse_meson_build_system_dsl);
+    XTEST_RUN_UNIT(test_arena_owns_nodes_and_children);
+    XTEST_RUN_UNIT(test_heap_node_children_grow);
+    XTEST_RUN_UNIT(test_lex_tokens_and_positions);
+    XTEST_RUN_UNIT(test_data_type_from_span);
+    XTEST_RUN_UNIT(test_parse_dsl_file_program);
+    XTEST_RUN_UNIT(test_parse_dsl_string_class_and_expressions);
+    XTEST_RUN_UNIT(test_document_incremental_edit);
+    XTEST_RUN_UNIT(test_document_edit_recovers_after_error);
+    XTEST_RUN_UNIT(test_flat_ast_from_program);
+    XTEST_RUN_UNIT(test_optimize_folds_and_prunes);
+    XTEST_RUN_UNIT(test_fold_heap_constants);
+    XTEST_RUN_UNIT(test_vm_runs_program_main);
+    XTEST_RUN_UNIT(test_vm_arithmetic_loops_and_recursion);
+    XTEST_RUN_UNIT(test_vm_reports_errors);
+    XTEST_RUN_UNIT(test_project_load_includes);
+    XTEST_RUN_UNIT(test_serialize_round_trip_and_cache);
+    XTEST_RUN_UNIT(test_symbols_scopes_and_inheritance);
+    XTEST_RUN_UNIT(test_visit_orders_and_deep_trees);
+    XTEST_RUN_UNIT(test_dump_ast_formats);
+    XTEST_RUN_UNIT(test_generate_c_program);
+    XTEST_RUN_UNIT(test_check_types_annotates_and_collects);
+    XTEST_RUN_UNIT(test_parse_dsl_recover_reports_every_error);
+    XTEST_RUN_UNIT(test_parse_with_parser_ctx);
+    XTEST_RUN_UNIT(test_expr_compile_and_eval);
+    XTEST_RUN_UNIT(test_share_subtrees_of_repeated_expressions);
+    XTEST_RUN_UNIT(test_source_offsets_and_line_table);
 } // end of function main
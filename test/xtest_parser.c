@@ -14,6 +14,7 @@ Description:
 
 #include <fossil/xtest.h>   // basic test tools
 #include <fossil/xassert.h> // extra asserts
+#include <string.h>
 
 //
 // XUNIT-CASES: list of test cases testing project features
@@ -99,6 +100,214 @@ XTEST_CASE(test_update_and_get_cell) {
     fclose(csv_file);
 }
 
+XTEST_CASE(test_csv_parse_query_projection_and_filter) {
+    FILE* csv_file = fopen("eco_products.csv", "r");
+    TEST_ASSERT_NOT_CNULLPTR(csv_file);
+
+    const size_t columns[] = {0, 2};
+    const ccsv_predicate predicates[] = {
+        {2, CSV_OP_GREATER, "5"},
+        {1, CSV_OP_NOT_EQUAL, "Outdoor"}
+    };
+    ccsv_query query = {columns, 2, predicates, 2, 1};
+
+    ccsv* csv = NULL;
+    fscl_csv_parser_parse_query(csv_file, &csv, &query);
+    fclose(csv_file);
+
+    TEST_ASSERT_NOT_CNULLPTR(csv);
+    TEST_ASSERT_EQUAL_INT(2, csv->num_columns);
+    TEST_ASSERT_EQUAL_INT(4, csv->num_rows);
+    TEST_ASSERT_EQUAL_STRING("Price", fscl_csv_parser_getter(csv, 0, 1));
+    TEST_ASSERT_EQUAL_STRING("Reusable Water Bottle", fscl_csv_parser_getter(csv, 1, 0));
+    TEST_ASSERT_EQUAL_STRING("Recycled Paper Notebook", fscl_csv_parser_getter(csv, 2, 0));
+    TEST_ASSERT_EQUAL_STRING("12.99", fscl_csv_parser_getter(csv, 3, 1));
+
+    fscl_csv_parser_erase(&csv);
+}
+
+XTEST_CASE(test_csv_get_by_name) {
+    FILE* csv_file = fopen("eco_products.csv", "r");
+    TEST_ASSERT_NOT_CNULLPTR(csv_file);
+
+    ccsv* csv = NULL;
+    fscl_csv_parser_parse(csv_file, &csv);
+    fclose(csv_file);
+
+    TEST_ASSERT_TRUE(csv->has_header);
+    TEST_ASSERT_EQUAL_INT(2, fscl_csv_column_index(csv, "price"));
+    TEST_ASSERT_EQUAL_STRING("15.99", fscl_csv_get_by_name(csv, 1, "price"));
+    TEST_ASSERT_EQUAL_STRING("Outdoor", fscl_csv_get_by_name(csv, 4, "Category"));
+    TEST_ASSERT_CNULLPTR(fscl_csv_get_by_name(csv, 1, "discount"));
+
+    // Renaming a header cell keeps the index in sync
+    fscl_csv_parser_setter(&csv, 0, 3, "Quantity");
+    TEST_ASSERT_EQUAL_INT(FSCL_CSV_NO_COLUMN, fscl_csv_column_index(csv, "stock"));
+    TEST_ASSERT_EQUAL_STRING("100", fscl_csv_get_by_name(csv, 1, "quantity"));
+
+    TEST_ASSERT_EQUAL_INT(0, fscl_csv_set_header(csv, 0));
+    TEST_ASSERT_CNULLPTR(fscl_csv_get_by_name(csv, 1, "price"));
+
+    fscl_csv_parser_erase(&csv);
+}
+
+XTEST_CASE(test_csv_column_kernels) {
+    FILE* csv_file = fopen("eco_products.csv", "r");
+    TEST_ASSERT_NOT_CNULLPTR(csv_file);
+
+    ccsv* csv = NULL;
+    fscl_csv_parser_parse(csv_file, &csv);
+    fclose(csv_file);
+
+    ccsv_column price;
+    TEST_ASSERT_EQUAL_INT(0, fscl_csv_column_load(csv, fscl_csv_column_index(csv, "price"), &price));
+    TEST_ASSERT_EQUAL_INT(5, price.count);
+    TEST_ASSERT_EQUAL_INT(5, fscl_csv_column_count(&price));
+    TEST_ASSERT_TRUE(fscl_csv_column_sum(&price) > 61.449 && fscl_csv_column_sum(&price) < 61.451);
+    TEST_ASSERT_TRUE(fscl_csv_column_mean(&price) > 12.289 && fscl_csv_column_mean(&price) < 12.291);
+    TEST_ASSERT_EQUAL_DOUBLE(4.49, fscl_csv_column_min(&price));
+    TEST_ASSERT_EQUAL_DOUBLE(19.99, fscl_csv_column_max(&price));
+
+    size_t bins[4];
+    TEST_ASSERT_EQUAL_INT(0, fscl_csv_column_histogram(&price, 0.0, 20.0, bins, 4));
+    TEST_ASSERT_EQUAL_INT(1, bins[0]);
+    TEST_ASSERT_EQUAL_INT(1, bins[1]);
+    TEST_ASSERT_EQUAL_INT(1, bins[2]);
+    TEST_ASSERT_EQUAL_INT(2, bins[3]);
+
+    fscl_csv_column_erase(&price);
+    fscl_csv_parser_erase(&csv);
+}
+
+XTEST_CASE(test_csv_group_by_threads) {
+    const char* content = "region,sales\nnorth,10\nsouth,5\nnorth,7\neast,n/a\nsouth,1\n";
+    FILE* csv_file = fopen("sales.csv", "w+");
+    TEST_ASSERT_NOT_CNULLPTR(csv_file);
+    fputs(content, csv_file);
+    rewind(csv_file);
+
+    ccsv* csv = NULL;
+    fscl_csv_parser_parse(csv_file, &csv);
+    fclose(csv_file);
+    remove("sales.csv");
+
+    ccsv_groups groups;
+    TEST_ASSERT_EQUAL_INT(0, fscl_csv_group_by(csv, 0, 1, 3, &groups));
+    TEST_ASSERT_EQUAL_INT(3, groups.num_groups);
+    TEST_ASSERT_EQUAL_STRING("north", groups.keys[0]);
+    TEST_ASSERT_EQUAL_STRING("south", groups.keys[1]);
+    TEST_ASSERT_EQUAL_STRING("east", groups.keys[2]);
+    TEST_ASSERT_EQUAL_DOUBLE(17.0, groups.sums[0]);
+    TEST_ASSERT_EQUAL_INT(2, groups.counts[0]);
+    TEST_ASSERT_EQUAL_DOUBLE(7.0, groups.mins[0]);
+    TEST_ASSERT_EQUAL_DOUBLE(10.0, groups.maxs[0]);
+    TEST_ASSERT_EQUAL_DOUBLE(6.0, groups.sums[1]);
+    TEST_ASSERT_EQUAL_INT(0, groups.counts[2]);
+
+    fscl_csv_groups_erase(&groups);
+    fscl_csv_parser_erase(&csv);
+}
+
+XTEST_CASE(test_csv_reader_streams_rows) {
+    cstream stream;
+    TEST_ASSERT_EQUAL_INT(0, fscl_stream_open(&stream, "eco_products.csv", "r"));
+
+    ccsv_reader* reader = fscl_csv_reader_create(&stream);
+    TEST_ASSERT_NOT_CNULLPTR(reader);
+
+    ccsv_row row;
+    size_t num_rows = 0;
+    while (fscl_csv_reader_next(reader, &row) == 1) {
+        TEST_ASSERT_EQUAL_INT(4, row.num_fields);
+        if (num_rows == 1) {
+            TEST_ASSERT_EQUAL_STRING("Reusable Water Bottle", row.fields[0]);
+            TEST_ASSERT_EQUAL_STRING("100", row.fields[3]);
+        }
+        num_rows++;
+    }
+    TEST_ASSERT_EQUAL_INT(6, num_rows);
+
+    fscl_csv_reader_erase(&reader);
+    TEST_ASSERT_CNULLPTR(reader);
+    fscl_stream_close(&stream);
+}
+
+XTEST_CASE(test_csv_reader_quoted_fields) {
+    const char* content = "name,note\r\n\"Smith, J\",\"said \"\"hi\"\"\"\r\n\nlast,\n";
+    cstream stream;
+    TEST_ASSERT_EQUAL_INT(0, fscl_stream_open(&stream, "quoted.csv", "w"));
+    fscl_stream_write(&stream, content, strlen(content), 1);
+    fscl_stream_close(&stream);
+
+    TEST_ASSERT_EQUAL_INT(0, fscl_stream_open(&stream, "quoted.csv", "r"));
+    ccsv_reader* reader = fscl_csv_reader_create(&stream);
+    ccsv_row row;
+
+    TEST_ASSERT_EQUAL_INT(1, fscl_csv_reader_next(reader, &row));
+    TEST_ASSERT_EQUAL_STRING("note", row.fields[1]);
+
+    TEST_ASSERT_EQUAL_INT(1, fscl_csv_reader_next(reader, &row));
+    TEST_ASSERT_EQUAL_INT(2, row.num_fields);
+    TEST_ASSERT_EQUAL_STRING("Smith, J", row.fields[0]);
+    TEST_ASSERT_EQUAL_STRING("said \"hi\"", row.fields[1]);
+
+    TEST_ASSERT_EQUAL_INT(1, fscl_csv_reader_next(reader, &row));
+    TEST_ASSERT_EQUAL_INT(2, row.num_fields);
+    TEST_ASSERT_EQUAL_STRING("last", row.fields[0]);
+    TEST_ASSERT_EQUAL_STRING("", row.fields[1]);
+
+    TEST_ASSERT_EQUAL_INT(0, fscl_csv_reader_next(reader, &row));
+
+    fscl_csv_reader_erase(&reader);
+    fscl_stream_close(&stream);
+    fscl_stream_delete("quoted.csv");
+}
+
+XTEST_CASE(test_csv_writer_quotes_and_numbers) {
+    cstream stream;
+    TEST_ASSERT_EQUAL_INT(0, fscl_stream_open(&stream, "report.csv", "w"));
+
+    // A tiny buffer is raised to the minimum and flushes mid-output
+    ccsv_writer* writer = fscl_csv_writer_create(&stream, 1);
+    TEST_ASSERT_NOT_CNULLPTR(writer);
+    TEST_ASSERT_EQUAL_INT(CSV_WRITER_MIN_BUFFER_SIZE, (int)writer->buffer_size);
+
+    const char* header[] = {"Product", "Stock", "Price"};
+    TEST_ASSERT_EQUAL_INT(0, fscl_csv_writer_write_row(writer, header, 3));
+
+    fscl_csv_writer_field(writer, "Tote \"Bag\", Large");
+    fscl_csv_writer_field_int(writer, -120);
+    fscl_csv_writer_field_double(writer, 12.996, 2);
+    TEST_ASSERT_EQUAL_INT(0, fscl_csv_writer_end_row(writer));
+
+    fscl_csv_writer_field(writer, "Lantern");
+    fscl_csv_writer_field_int(writer, 0);
+    fscl_csv_writer_field_double(writer, -0.5, 3);
+    fscl_csv_writer_end_row(writer);
+
+    // Magnitudes too large to scale keep their digits and precision
+    fscl_csv_writer_field_double(writer, 123456789012.5, 9);
+    fscl_csv_writer_field_double(writer, -1e20, 0);
+    fscl_csv_writer_field_double(writer, 1180591620717411303424.0, 1);
+    fscl_csv_writer_field_double(writer, -1.0 / 0.0, 2);
+    fscl_csv_writer_end_row(writer);
+
+    fscl_csv_writer_erase(&writer);
+    TEST_ASSERT_CNULLPTR(writer);
+    fscl_stream_close(&stream);
+
+    char buffer[256] = {0};
+    TEST_ASSERT_EQUAL_INT(0, fscl_stream_open(&stream, "report.csv", "r"));
+    fscl_stream_read(&stream, buffer, 1, sizeof(buffer) - 1);
+    fscl_stream_close(&stream);
+    fscl_stream_delete("report.csv");
+
+    TEST_ASSERT_EQUAL_STRING("Product,Stock,Price\n"
+                             "\"Tote \"\"Bag\"\", Large\",-120,13.00\n"
+                             "Lantern,0,-0.500\n"
+                             "123456789012.500000000,-100000000000000000000,1180591620717411303424.0,-inf\n", buffer);
+}
+
 XTEST_CASE(test_fscl_ini_parser_parse) {
     FILE* file = fopen("test_config.ini", "r");
     TEST_ASSERT_NOT_CNULLPTR(file);
@@ -125,5 +334,12 @@ XTEST_DEFINE_POOL(test_parser_group) {
     XTEST_RUN_UNIT(test_fscl_json_parser_getter_setter);
     XTEST_RUN_UNIT(test_create_and_erase_csv);
     XTEST_RUN_UNIT(test_update_and_get_cell);
+    XTEST_RUN_UNIT(test_csv_parse_query_projection_and_filter);
+    XTEST_RUN_UNIT(test_csv_get_by_name);
+    XTEST_RUN_UNIT(test_csv_column_kernels);
+    XTEST_RUN_UNIT(test_csv_group_by_threads);
+    XTEST_RUN_UNIT(test_csv_reader_streams_rows);
+    XTEST_RUN_UNIT(test_csv_reader_quoted_fields);
+    XTEST_RUN_UNIT(test_csv_writer_quotes_and_numbers);
     XTEST_RUN_UNIT(test_fscl_ini_parser_parse);
 } // end of function main